@@ -1,15 +1,21 @@
 #include <iostream>
 #include <chrono>
 #include <vector>
+#include <cstdint>
 #include <cstring>
 #include <sys/socket.h>
 #include <unistd.h>
 
+// Packed to match the 20-byte '<QdI' records dummy_market_server.py sends;
+// unpacked, the trailing padding makes it 24 and every read drifts
+#pragma pack(push, 1)
 struct MarketData {
     uint64_t timestamp;
     double price;
     uint32_t volume;
 };
+#pragma pack(pop)
+static_assert(sizeof(MarketData) == 20, "MarketData must match the server's wire size");
 
 // Parsing function (works on raw bytes, no extra allocations)
 inline MarketData parse(const char* buffer) {
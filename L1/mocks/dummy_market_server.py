@@ -11,7 +11,7 @@ def generate_market_data():
     timestamp = int(time.time() * 1e9)  # nanosecond precision
     price = 100.0 + (time.time() % 10)  # oscillating price
     volume = 100
-    return struct.pack('QdI', timestamp, price, volume)  # 8+8+4 = 20 bytes
+    return struct.pack('<QdI', timestamp, price, volume)  # little-endian, unpadded: 8+8+4 = 20 bytes
 
 def main():
     with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <new>
+
+
+/// Bounded multi-producer, single-consumer circular FIFO (Vyukov-style).
+/// Every slot carries a sequence number: producers claim a cursor value with
+/// a CAS and publish the slot by advancing its sequence, so a slow producer
+/// never exposes a half-written element. Capacity must be a power of two.
+template<typename T, typename Alloc = std::allocator<T>>
+class MpscFifo
+{
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    using SlotAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Slot>;
+    using slot_traits = std::allocator_traits<SlotAlloc>;
+
+public:
+    using value_type = T;
+    using size_type = typename slot_traits::size_type;
+
+    explicit MpscFifo(size_type capacity, Alloc const& alloc = Alloc{})
+        : alloc_{alloc}
+        , capacity_{capacity}
+        , mask_{capacity - 1}
+        , ring_{slot_traits::allocate(alloc_, capacity)}
+    {
+        assert(capacity > 0 && (capacity & mask_) == 0);
+        for (size_type i = 0; i < capacity_; ++i) {
+            new (&ring_[i].sequence) std::atomic<std::size_t>(i);
+        }
+    }
+
+    MpscFifo(MpscFifo const&) = delete;
+    MpscFifo& operator=(MpscFifo const&) = delete;
+
+    ~MpscFifo() {
+        // Only slots published and not yet popped hold live elements
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        while (slot(popCursor).sequence.load(std::memory_order_relaxed) == popCursor + 1) {
+            slot(popCursor).value()->~T();
+            ++popCursor;
+        }
+        for (size_type i = 0; i < capacity_; ++i) {
+            ring_[i].sequence.~atomic();
+        }
+        slot_traits::deallocate(alloc_, ring_, capacity_);
+    }
+
+
+    /// Returns the number of claimed elements (approximate while producers run)
+    auto size() const noexcept {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        return pushCursor > popCursor ? pushCursor - popCursor : size_type{0};
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns the number of elements that can be held in the fifo
+    auto capacity() const noexcept { return capacity_; }
+
+
+    /// Push one object onto the fifo; safe to call from any number of threads.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& s = slot(pushCursor);
+            auto sequence = s.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence - pushCursor);
+            if (diff == 0) {
+                // Slot is free for this lap; try to claim the cursor value
+                if (pushCursor_.compare_exchange_weak(pushCursor, pushCursor + 1,
+                                                      std::memory_order_relaxed)) {
+                    new (s.storage) T(value);
+                    s.sequence.store(pushCursor + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Consumer has not freed this slot yet: full
+            } else {
+                pushCursor = pushCursor_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Pop one object from the fifo; consumer thread only.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        Slot& s = slot(popCursor);
+        if (s.sequence.load(std::memory_order_acquire) != popCursor + 1) {
+            return false;
+        }
+        value = *s.value();
+        s.value()->~T();
+        s.sequence.store(popCursor + capacity_, std::memory_order_release);
+        popCursor_.store(popCursor + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// Pop up to `count` consecutive published objects; consumer thread only.
+    /// Slot sequences are scanned relaxed and ordered by one acquire fence,
+    /// then handed back to producers behind one release fence, so a burst
+    /// pays for two barriers instead of two per message.
+    /// @return number of objects written to `out`
+    auto try_pop_n(T* out, size_type count) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        size_type ready = 0;
+        while (ready < count &&
+               slot(popCursor + ready).sequence.load(std::memory_order_relaxed) == popCursor + ready + 1) {
+            ++ready;
+        }
+        if (ready == 0) {
+            return ready;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        for (size_type i = 0; i < ready; ++i) {
+            Slot& s = slot(popCursor + i);
+            out[i] = *s.value();
+            s.value()->~T();
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_type i = 0; i < ready; ++i) {
+            slot(popCursor + i).sequence.store(popCursor + i + capacity_, std::memory_order_relaxed);
+        }
+        popCursor_.store(popCursor + ready, std::memory_order_relaxed);
+        return ready;
+    }
+
+private:
+    Slot& slot(size_type cursor) noexcept { return ring_[cursor & mask_]; }
+
+private:
+    SlotAlloc alloc_;
+    size_type capacity_;
+    size_type mask_;
+    Slot* ring_;
+
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free);
+
+    static constexpr auto hardware_destructive_interference_size = size_type{64};
+
+    /// Claimed with a CAS by every push thread
+    alignas(hardware_destructive_interference_size) CursorType pushCursor_{};
+
+    /// Loaded and stored by the pop thread only; read by size()
+    alignas(hardware_destructive_interference_size) CursorType popCursor_{};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[hardware_destructive_interference_size - sizeof(size_type)];
+};
@@ -0,0 +1,191 @@
+// SPSC ring benchmark: throughput and ping-pong round-trip latency for
+// Fifo2/Fifo3/Fifo4 with producer and consumer pinned to chosen CPUs.
+// Fifo1 is not thread-safe and is left out.
+//
+// Usage: spsc_bench [--cpus P,C] [--messages N] [--round-trips N]
+//   --cpus P,C       CPUs for the producer/ping and consumer/pong threads.
+//                    Pick two CPUs on one socket, then on different sockets,
+//                    to compare placements; the socket of each is printed.
+//   --messages N     Messages per throughput run   (default 10000000)
+//   --round-trips N  Round trips per latency run   (default 1000000)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "book_manager.h"
+#include "latency_histogram.h"
+#include "SPSC_QUEUES/spsc_q2.cpp"
+#include "SPSC_QUEUES/spsc_q3.cpp"
+#include "SPSC_QUEUES/spsc_q4.cpp"
+
+namespace {
+
+struct BenchConfig {
+    int producer_cpu = 0;
+    int consumer_cpu = 1;
+    uint64_t messages = 10000000;
+    uint64_t round_trips = 1000000;
+    bool yield = false; // Spin politely when both threads share one CPU
+};
+
+// Message of a given size; the first word carries a sequence number
+template <size_t Bytes>
+struct Payload {
+    uint64_t sequence;
+    char pad[Bytes - sizeof(uint64_t)];
+};
+
+template <>
+struct Payload<8> {
+    uint64_t sequence;
+};
+
+int socket_of(int cpu) {
+    std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                       "/topology/physical_package_id");
+    int socket = -1;
+    file >> socket;
+    return socket;
+}
+
+inline void spin(const BenchConfig& config) {
+    if (config.yield) {
+        std::this_thread::yield();
+    } else {
+        __builtin_ia32_pause();
+    }
+}
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Messages per second from one pinned producer to one pinned consumer
+template <typename Fifo>
+double throughput(const BenchConfig& config, size_t capacity) {
+    using T = typename Fifo::value_type;
+    Fifo fifo(capacity);
+
+    std::thread consumer([&] {
+        pin_current_thread(config.consumer_cpu);
+        T value;
+        for (uint64_t i = 0; i < config.messages; i++) {
+            while (!fifo.pop(value)) spin(config);
+            if (value.sequence != i) std::abort();
+        }
+    });
+
+    pin_current_thread(config.producer_cpu);
+    T value{};
+    const uint64_t start = now_ns();
+    for (uint64_t i = 0; i < config.messages; i++) {
+        value.sequence = i;
+        while (!fifo.push(value)) spin(config);
+    }
+    consumer.join();
+    const uint64_t elapsed = now_ns() - start;
+    return static_cast<double>(config.messages) * 1e9 / static_cast<double>(elapsed ? elapsed : 1);
+}
+
+// Round trip through a ping ring and a pong ring
+template <typename Fifo>
+LatencyHistogram round_trip(const BenchConfig& config, size_t capacity) {
+    using T = typename Fifo::value_type;
+    Fifo ping(capacity);
+    Fifo pong(capacity);
+
+    std::thread echo([&] {
+        pin_current_thread(config.consumer_cpu);
+        T value;
+        for (uint64_t i = 0; i < config.round_trips; i++) {
+            while (!ping.pop(value)) spin(config);
+            while (!pong.push(value)) spin(config);
+        }
+    });
+
+    pin_current_thread(config.producer_cpu);
+    LatencyHistogram histogram;
+    T value{};
+    for (uint64_t i = 0; i < config.round_trips; i++) {
+        value.sequence = i;
+        const uint64_t start = now_ns();
+        while (!ping.push(value)) spin(config);
+        while (!pong.pop(value)) spin(config);
+        histogram.record(now_ns() - start);
+    }
+    echo.join();
+    return histogram;
+}
+
+template <template <typename, typename> class Fifo, size_t Bytes>
+void bench(const char* name, const BenchConfig& config, size_t capacity) {
+    using Ring = Fifo<Payload<Bytes>, std::allocator<Payload<Bytes>>>;
+    const double rate = throughput<Ring>(config, capacity);
+    const LatencyHistogram rtt = round_trip<Ring>(config, capacity);
+    std::printf("%-6s %8zu %7zu %10.2f %8llu %8llu %8llu %8llu %9llu\n",
+                name, capacity, Bytes, rate / 1e6,
+                static_cast<unsigned long long>(rtt.percentile(50)),
+                static_cast<unsigned long long>(rtt.percentile(90)),
+                static_cast<unsigned long long>(rtt.percentile(99)),
+                static_cast<unsigned long long>(rtt.percentile(99.9)),
+                static_cast<unsigned long long>(rtt.max()));
+}
+
+template <size_t Bytes>
+void bench_payload(const BenchConfig& config) {
+    for (size_t capacity : {256, 4096, 65536}) {
+        bench<Fifo2, Bytes>("Fifo2", config, capacity);
+        bench<Fifo3, Bytes>("Fifo3", config, capacity);
+        bench<Fifo4, Bytes>("Fifo4", config, capacity);
+    }
+}
+
+bool parse_args(int argc, char** argv, BenchConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--cpus") == 0 && has_value) {
+            if (std::sscanf(argv[++i], "%d,%d", &config.producer_cpu, &config.consumer_cpu) != 2) {
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--messages") == 0 && has_value) {
+            config.messages = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--round-trips") == 0 && has_value) {
+            config.round_trips = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!parse_args(argc, argv, config)) {
+        std::fprintf(stderr, "usage: %s [--cpus P,C] [--messages N] [--round-trips N]\n", argv[0]);
+        return 1;
+    }
+    config.yield = config.producer_cpu == config.consumer_cpu ||
+                   std::thread::hardware_concurrency() < 2;
+
+    std::printf("producer cpu %d (socket %d), consumer cpu %d (socket %d)%s\n",
+                config.producer_cpu, socket_of(config.producer_cpu),
+                config.consumer_cpu, socket_of(config.consumer_cpu),
+                config.yield ? ", shared CPU: yielding instead of spinning" : "");
+    std::printf("%llu messages per throughput run, %llu round trips per latency run\n\n",
+                static_cast<unsigned long long>(config.messages),
+                static_cast<unsigned long long>(config.round_trips));
+    std::printf("%-6s %8s %7s %10s %8s %8s %8s %8s %9s\n",
+                "ring", "capacity", "payload", "Mmsg/s", "rtt p50", "p90", "p99", "p99.9", "max (ns)");
+
+    bench_payload<8>(config);
+    bench_payload<64>(config);
+    bench_payload<256>(config);
+    return 0;
+}
@@ -5,6 +5,8 @@
 #include <memory>
 #include <new>
 
+#include "wait_strategy.cpp"
+
 
 /// Threadsafe, efficient circular FIFO
 template<typename T, typename Alloc = std::allocator<T>>
@@ -76,6 +78,30 @@ public:
         return true;
     }
 
+    /// Push one object, then let a consumer waiting on `wait` know.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    template<typename Wait>
+    auto push(T const& value, Wait& wait) {
+        if (not push(value)) {
+            return false;
+        }
+        wait.notify();
+        return true;
+    }
+
+    /// Pop one object, idling with `wait` (see wait_strategy.cpp) while the
+    /// fifo is empty.
+    /// @return `true` once an object is popped; `false` if `wait` was stopped first.
+    template<typename Wait>
+    auto pop_wait(T& value, Wait& wait) {
+        for (unsigned spins = 0; not pop(value); ++spins) {
+            if (not wait.idle(spins, [this] { return not empty(); })) {
+                return pop(value);
+            }
+        }
+        return true;
+    }
+
 private:
     auto full(size_type pushCursor, size_type popCursor) const noexcept {
         return (pushCursor - popCursor) == capacity_;
@@ -103,10 +129,10 @@ private:
     static constexpr auto hardware_destructive_interference_size = size_type{64};
 
     /// Loaded and stored by the push thread; loaded by the pop thread
-    alignas(hardware_destructive_interference_size) CursorType pushCursor_;
+    alignas(hardware_destructive_interference_size) CursorType pushCursor_{};
 
     /// Loaded and stored by the pop thread; loaded by the push thread
-    alignas(hardware_destructive_interference_size) CursorType popCursor_;
+    alignas(hardware_destructive_interference_size) CursorType popCursor_{};
 
     // Padding to avoid false sharing with adjacent objects
     char padding_[hardware_destructive_interference_size - sizeof(size_type)];
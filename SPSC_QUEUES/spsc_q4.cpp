@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <utility>
+
+
+/// Threadsafe, efficient circular FIFO with cached cursors.
+/// Each side keeps a private copy of the other side's cursor and only
+/// reloads it when the ring looks full (producer) or empty (consumer), so in
+/// steady state push and pop touch only their own cache line. Capacity must
+/// be a power of two so indexing is a mask instead of a division.
+template<typename T, typename Alloc = std::allocator<T>>
+class Fifo4 : private Alloc
+{
+public:
+    using value_type = T;
+    using allocator_traits = std::allocator_traits<Alloc>;
+    using size_type = typename allocator_traits::size_type;
+
+    explicit Fifo4(size_type capacity, Alloc const& alloc = Alloc{})
+        : Alloc{alloc}
+        , capacity_{capacity}
+        , mask_{capacity - 1}
+        , ring_{allocator_traits::allocate(*this, capacity)}
+    {
+        assert(capacity > 0 && (capacity & mask_) == 0);
+    }
+
+    Fifo4(Fifo4 const&) = delete;
+    Fifo4& operator=(Fifo4 const&) = delete;
+
+    ~Fifo4() {
+        while(not empty()) {
+            element(popCursor_)->~T();
+            ++popCursor_;
+        }
+        allocator_traits::deallocate(*this, ring_, capacity_);
+    }
+
+
+    /// Returns the number of elements in the fifo
+    auto size() const noexcept {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+
+        assert(popCursor <= pushCursor);
+        return pushCursor - popCursor;
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns whether the container has capacity_() elements
+    auto full() const noexcept { return size() == capacity(); }
+
+    /// Returns the ring storage, e.g. to see which NUMA node holds it
+    T const* data() const noexcept { return ring_; }
+
+    /// Returns the number of elements that can be held in the fifo
+    auto capacity() const noexcept { return capacity_; }
+
+
+    /// Push one object onto the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        return emplace(value);
+    }
+
+    /// Construct one object in place at the back of the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    template<typename... Args>
+    auto emplace(Args&&... args) {
+        auto slot = try_claim();
+        if (slot == nullptr) {
+            return false;
+        }
+        new (slot) T(std::forward<Args>(args)...);
+        publish();
+        return true;
+    }
+
+    /// Reserve the next slot for the producer to construct into with
+    /// placement new (or to fill field by field for trivial types); it is
+    /// invisible to the consumer until publish().
+    /// @return storage for one object, or `nullptr` if fifo is full
+    T* try_claim() {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        if (full(pushCursor, popCursorCached_)) {
+            // Looks full: refresh the consumer's cursor and check again
+            popCursorCached_ = popCursor_.load(std::memory_order_acquire);
+            if (full(pushCursor, popCursorCached_)) {
+                return nullptr;
+            }
+        }
+        return element(pushCursor);
+    }
+
+    /// Make the slot returned by the last successful try_claim() visible
+    void publish() {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        pushCursor_.store(pushCursor + 1, std::memory_order_release);
+    }
+
+    /// Push up to `count` objects with a single cursor store.
+    /// @return number of objects pushed; fewer than `count` if fifo fills up
+    auto push_n(T const* values, size_type count) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        size_type pushed = 0;
+        // At most two contiguous runs: up to the end of the ring, then from its start
+        while (pushed < count) {
+            auto run = claimable(pushCursor, count - pushed);
+            if (run == 0) {
+                break;
+            }
+            auto slots = element(pushCursor);
+            for (size_type i = 0; i < run; ++i) {
+                new (&slots[i]) T(values[pushed + i]);
+            }
+            pushed += run;
+            pushCursor += run;
+        }
+        if (pushed > 0) {
+            pushCursor_.store(pushCursor, std::memory_order_release);
+        }
+        return pushed;
+    }
+
+    /// Reserve up to `count` contiguous slots (stopping at the end of the
+    /// ring) for the producer to construct into; see try_claim().
+    /// @param claimed set to the number of slots reserved
+    /// @return storage for `claimed` objects, or `nullptr` if fifo is full
+    T* try_claim_n(size_type count, size_type& claimed) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        claimed = claimable(pushCursor, count);
+        return claimed == 0 ? nullptr : element(pushCursor);
+    }
+
+    /// Make `count` slots from the last successful try_claim_n() visible
+    void publish_n(size_type count) {
+        auto pushCursor = pushCursor_.load(std::memory_order_relaxed);
+        pushCursor_.store(pushCursor + count, std::memory_order_release);
+    }
+
+    /// Pop one object from the fifo.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto slot = front();
+        if (slot == nullptr) {
+            return false;
+        }
+        value = *slot;
+        release();
+        return true;
+    }
+
+    /// Pop up to `count` objects with a single cursor store.
+    /// @return number of objects written to `values`
+    auto pop_n(T* values, size_type count) {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        auto ready = pushCursorCached_ - popCursor;
+        if (ready < count) {
+            pushCursorCached_ = pushCursor_.load(std::memory_order_acquire);
+            ready = pushCursorCached_ - popCursor;
+        }
+        const auto popped = ready < count ? ready : count;
+        for (size_type i = 0; i < popped; ++i) {
+            auto slot = element(popCursor + i);
+            values[i] = *slot;
+            slot->~T();
+        }
+        if (popped > 0) {
+            popCursor_.store(popCursor + popped, std::memory_order_release);
+        }
+        return popped;
+    }
+
+    /// Oldest object, read in place; it stays in the ring until release().
+    /// @return pointer to the object, or `nullptr` if fifo is empty
+    T* front() {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        if (empty(pushCursorCached_, popCursor)) {
+            // Looks empty: refresh the producer's cursor and check again
+            pushCursorCached_ = pushCursor_.load(std::memory_order_acquire);
+            if (empty(pushCursorCached_, popCursor)) {
+                return nullptr;
+            }
+        }
+        return element(popCursor);
+    }
+
+    /// Destroy the object returned by the last successful front() and hand
+    /// its slot back to the producer
+    void release() {
+        auto popCursor = popCursor_.load(std::memory_order_relaxed);
+        element(popCursor)->~T();
+        popCursor_.store(popCursor + 1, std::memory_order_release);
+    }
+
+private:
+    // Free contiguous slots from pushCursor, capped at count
+    size_type claimable(size_type pushCursor, size_type count) noexcept {
+        auto available = capacity_ - (pushCursor - popCursorCached_);
+        if (available < count) {
+            popCursorCached_ = popCursor_.load(std::memory_order_acquire);
+            available = capacity_ - (pushCursor - popCursorCached_);
+        }
+        const auto contiguous = capacity_ - (pushCursor & mask_);
+        return std::min({count, available, contiguous});
+    }
+
+    auto full(size_type pushCursor, size_type popCursor) const noexcept {
+        return (pushCursor - popCursor) == capacity_;
+    }
+    static auto empty(size_type pushCursor, size_type popCursor) noexcept {
+        return pushCursor == popCursor;
+    }
+    auto element(size_type cursor) noexcept {
+        return &ring_[cursor & mask_];
+    }
+
+private:
+    size_type capacity_;
+    size_type mask_;
+    T* ring_;
+
+    using CursorType = std::atomic<size_type>;
+    static_assert(CursorType::is_always_lock_free);
+
+    static constexpr auto hardware_destructive_interference_size = size_type{64};
+
+    /// Loaded and stored by the push thread; loaded by the pop thread
+    alignas(hardware_destructive_interference_size) CursorType pushCursor_{};
+
+    /// Exclusive to the push thread; shares its line with pushCursor_
+    size_type popCursorCached_{};
+
+    /// Loaded and stored by the pop thread; loaded by the push thread
+    alignas(hardware_destructive_interference_size) CursorType popCursor_{};
+
+    /// Exclusive to the pop thread; shares its line with popCursor_
+    size_type pushCursorCached_{};
+
+    // Padding to avoid false sharing with adjacent objects
+    char padding_[hardware_destructive_interference_size - 2 * sizeof(size_type)];
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/// Where a ShmFifo region lives and how it is mapped; creator and attacher must agree
+struct ShmFifoOptions {
+    bool huge_pages = false;                   // Back the ring with 2 MiB pages
+    std::string hugetlbfs_dir = "/dev/hugepages"; // hugetlbfs mount used when huge_pages is set
+    bool prefault = true;                      // Touch every page at create/attach
+};
+
+/// Fifo4's algorithm over a memory-mapped region shared by two processes.
+/// The region starts with a fixed header (magic, version, geometry, and
+/// the two cursors on their own cache lines) followed by the ring. The
+/// creator initialises the header and publishes `magic` last; an attacher
+/// waits for it and checks the geometry before touching the ring, so the
+/// data path is plain loads and stores with no syscalls.
+///
+/// T must be trivially copyable: it crosses a process boundary as bytes.
+/// One process pushes and one pops; either may be the creator.
+template<typename T>
+class ShmFifo
+{
+    static_assert(std::is_trivially_copyable_v<T>, "ShmFifo elements are copied as bytes");
+
+    static constexpr auto kLine = size_t{64};
+    static constexpr auto kHugePage = size_t{2} << 20;
+
+    using CursorType = std::atomic<uint64_t>;
+    static_assert(CursorType::is_always_lock_free, "cursors must be address-free");
+
+    struct Header {
+        std::atomic<uint64_t> magic;  // kMagic once the creator has initialised the region
+        uint32_t version;
+        uint32_t element_size;
+        uint64_t capacity;
+        uint64_t mapped_size;
+        alignas(kLine) CursorType pushCursor;
+        alignas(kLine) CursorType popCursor;
+    };
+    static_assert(sizeof(Header) % kLine == 0);
+
+public:
+    using value_type = T;
+    using size_type = uint64_t;
+
+    static constexpr uint64_t kMagic = 0x4f464946'4d485348; // "HSHMFIFO"
+    static constexpr uint32_t kVersion = 1;
+
+    ShmFifo() = default;
+    ShmFifo(ShmFifo const&) = delete;
+    ShmFifo& operator=(ShmFifo const&) = delete;
+
+    ~ShmFifo() { close(); }
+
+    /// Create and initialise a new region; fails if `name` already exists.
+    /// Capacity must be a power of two.
+    /// @return `true` if the region is mapped and ready for an attacher
+    bool create(std::string const& name, size_type capacity, ShmFifoOptions const& options = ShmFifoOptions{}) {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+        close();
+
+        size_t size = sizeof(Header) + capacity * sizeof(T);
+        size = options.huge_pages ? round_up(size, kHugePage) : round_up(size, page_size());
+
+        const int fd = open_region(name, options, O_CREAT | O_EXCL | O_RDWR);
+        if (fd < 0) {
+            return false;
+        }
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0 || !map(fd, size, options.prefault)) {
+            ::close(fd);
+            remove(name, options);
+            return false;
+        }
+        ::close(fd);
+
+        // The file is zero-filled, so an attacher sees magic == 0 until the end
+        header_ = new (header_) Header;
+        header_->magic.store(0, std::memory_order_relaxed);
+        header_->version = kVersion;
+        header_->element_size = sizeof(T);
+        header_->capacity = capacity;
+        header_->mapped_size = size;
+        header_->pushCursor.store(0, std::memory_order_relaxed);
+        header_->popCursor.store(0, std::memory_order_relaxed);
+        header_->magic.store(kMagic, std::memory_order_release);
+
+        adopt(capacity);
+        name_ = name;
+        options_ = options;
+        owner_ = true;
+        return true;
+    }
+
+    /// Map a region made by create() in another process. Retries up to
+    /// `spins` times while the creator is still initialising it.
+    /// @return `false` if it does not exist or its layout does not match T
+    bool attach(std::string const& name, ShmFifoOptions const& options = ShmFifoOptions{}, uint64_t spins = 1000000) {
+        close();
+        const int fd = open_region(name, options, O_RDWR);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header) ||
+            !map(fd, static_cast<size_t>(st.st_size), options.prefault)) {
+            ::close(fd);
+            return false;
+        }
+        ::close(fd);
+
+        while (header_->magic.load(std::memory_order_acquire) != kMagic) {
+            if (spins-- == 0) {
+                close();
+                return false;
+            }
+            __builtin_ia32_pause();
+        }
+        if (header_->version != kVersion || header_->element_size != sizeof(T) ||
+            header_->mapped_size != mapped_size_ ||
+            sizeof(Header) + header_->capacity * sizeof(T) > mapped_size_) {
+            close();
+            return false;
+        }
+
+        adopt(header_->capacity);
+        pushCursorCached_ = header_->pushCursor.load(std::memory_order_acquire);
+        popCursorCached_ = header_->popCursor.load(std::memory_order_acquire);
+        return true;
+    }
+
+    /// Unmap; the creator also removes the name
+    void close() {
+        if (header_ != nullptr) {
+            ::munmap(header_, mapped_size_);
+            header_ = nullptr;
+            ring_ = nullptr;
+        }
+        if (owner_) {
+            remove(name_, options_);
+            owner_ = false;
+        }
+    }
+
+    /// Remove a region's name (e.g. one left behind by a crashed creator)
+    static void remove(std::string const& name, ShmFifoOptions const& options = ShmFifoOptions{}) {
+        if (options.huge_pages) {
+            ::unlink((options.hugetlbfs_dir + "/" + name).c_str());
+        } else {
+            ::shm_unlink(shm_name(name).c_str());
+        }
+    }
+
+    bool valid() const noexcept { return header_ != nullptr; }
+
+
+    /// Returns the number of elements in the fifo
+    auto size() const noexcept {
+        auto pushCursor = header_->pushCursor.load(std::memory_order_relaxed);
+        auto popCursor = header_->popCursor.load(std::memory_order_relaxed);
+        return pushCursor - popCursor;
+    }
+
+    /// Returns whether the container has no elements
+    auto empty() const noexcept { return size() == 0; }
+
+    /// Returns the number of elements that can be held in the fifo
+    auto capacity() const noexcept { return capacity_; }
+
+
+    /// Push one object onto the fifo.
+    /// @return `true` if the operation is successful; `false` if fifo is full.
+    auto push(T const& value) {
+        auto pushCursor = header_->pushCursor.load(std::memory_order_relaxed);
+        if (pushCursor - popCursorCached_ == capacity_) {
+            popCursorCached_ = header_->popCursor.load(std::memory_order_acquire);
+            if (pushCursor - popCursorCached_ == capacity_) {
+                return false;
+            }
+        }
+        std::memcpy(&ring_[pushCursor & mask_], &value, sizeof(T));
+        header_->pushCursor.store(pushCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Pop one object from the fifo.
+    /// @return `true` if the pop operation is successful; `false` if fifo is empty.
+    auto pop(T& value) {
+        auto popCursor = header_->popCursor.load(std::memory_order_relaxed);
+        if (pushCursorCached_ == popCursor) {
+            pushCursorCached_ = header_->pushCursor.load(std::memory_order_acquire);
+            if (pushCursorCached_ == popCursor) {
+                return false;
+            }
+        }
+        std::memcpy(&value, &ring_[popCursor & mask_], sizeof(T));
+        header_->popCursor.store(popCursor + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static size_t page_size() { return static_cast<size_t>(::sysconf(_SC_PAGESIZE)); }
+    static size_t round_up(size_t size, size_t to) { return (size + to - 1) / to * to; }
+    static std::string shm_name(std::string const& name) { return name[0] == '/' ? name : "/" + name; }
+
+    static int open_region(std::string const& name, ShmFifoOptions const& options, int flags) {
+        if (options.huge_pages) {
+            return ::open((options.hugetlbfs_dir + "/" + name).c_str(), flags, 0600);
+        }
+        return ::shm_open(shm_name(name).c_str(), flags, 0600);
+    }
+
+    bool map(int fd, size_t size, bool prefault) {
+        void* region = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | (prefault ? MAP_POPULATE : 0), fd, 0);
+        if (region == MAP_FAILED) {
+            return false;
+        }
+        header_ = static_cast<Header*>(region);
+        mapped_size_ = size;
+        return true;
+    }
+
+    void adopt(size_type capacity) {
+        capacity_ = capacity;
+        mask_ = capacity - 1;
+        ring_ = reinterpret_cast<T*>(reinterpret_cast<char*>(header_) + sizeof(Header));
+    }
+
+private:
+    Header* header_ = nullptr;
+    T* ring_ = nullptr;
+    size_t mapped_size_ = 0;
+    size_type capacity_ = 0;
+    size_type mask_ = 0;
+
+    // Process-local copies of the other side's cursor, as in Fifo4
+    size_type popCursorCached_ = 0;
+    size_type pushCursorCached_ = 0;
+
+    std::string name_;
+    ShmFifoOptions options_;
+    bool owner_ = false;
+};
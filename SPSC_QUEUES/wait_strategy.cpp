@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+/// Consumer-side wait strategies for an SPSC ring's `pop_wait()`.
+///
+/// `idle(spins, ready)` is called each time the ring is found empty, with
+/// the number of empty polls so far and a callable that reports whether an
+/// item has arrived. It returns `false` once `stop()` has been called.
+/// A producer that pushes with the ring's `push(value, wait)` calls
+/// `notify()` after every push; only `SpinParkWait` does anything there.
+///
+/// One strategy object serves one ring: the producer and the consumer share
+/// it.
+
+/// Pause-spin forever: the lowest wake-up latency, one core fully used.
+class BusySpinWait
+{
+public:
+    template<typename Ready>
+    bool idle(unsigned /*spins*/, Ready&& /*ready*/) noexcept {
+        __builtin_ia32_pause();
+        return !stopped_.load(std::memory_order_relaxed);
+    }
+
+    void notify() noexcept {}
+
+    void stop() noexcept { stopped_.store(true, std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> stopped_{false};
+};
+
+
+/// Pause-spin for `spin_limit` polls, then yield the core between polls.
+/// Wakes within a scheduler slice when the core is contended.
+class SpinYieldWait
+{
+public:
+    explicit SpinYieldWait(unsigned spin_limit = 256) noexcept : spin_limit_{spin_limit} {}
+
+    template<typename Ready>
+    bool idle(unsigned spins, Ready&& /*ready*/) noexcept {
+        if (spins < spin_limit_) {
+            __builtin_ia32_pause();
+        } else {
+            sched_yield();
+        }
+        return !stopped_.load(std::memory_order_relaxed);
+    }
+
+    void notify() noexcept {}
+
+    void stop() noexcept { stopped_.store(true, std::memory_order_relaxed); }
+
+private:
+    unsigned spin_limit_;
+    std::atomic<bool> stopped_{false};
+};
+
+
+/// Pause-spin for `spin_limit` polls, then sleep on a futex until the
+/// producer's `notify()`. The producer pays a fence and one load of a line
+/// it only shares with a parked consumer, and it only makes an exchange and
+/// a syscall when the consumer is (about to be) asleep.
+class SpinParkWait
+{
+public:
+    explicit SpinParkWait(unsigned spin_limit = 1024) noexcept : spin_limit_{spin_limit} {}
+
+    template<typename Ready>
+    bool idle(unsigned spins, Ready&& ready) noexcept {
+        if (spins < spin_limit_) {
+            __builtin_ia32_pause();
+            return !stopped_.load(std::memory_order_relaxed);
+        }
+        parked_.store(1, std::memory_order_relaxed);
+        // Pairs with the fence in notify(): either the producer sees the
+        // flag, or this re-check sees its item
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ready() && !stopped_.load(std::memory_order_relaxed)) {
+            parks_.store(parks_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            futex(FUTEX_WAIT_PRIVATE, 1);
+        }
+        parked_.store(0, std::memory_order_relaxed);
+        return !stopped_.load(std::memory_order_relaxed);
+    }
+
+    void notify() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Clearing the word is the wake: a consumer that has not reached
+        // FUTEX_WAIT yet finds it 0 there and does not sleep
+        if (parked_.load(std::memory_order_relaxed) != 0 &&
+            parked_.exchange(0, std::memory_order_seq_cst) != 0) {
+            futex(FUTEX_WAKE_PRIVATE, 1);
+        }
+    }
+
+    void stop() noexcept {
+        stopped_.store(true, std::memory_order_relaxed);
+        notify();
+    }
+
+    /// Times the consumer went to sleep
+    uint64_t parks() const noexcept { return parks_.load(std::memory_order_relaxed); }
+
+private:
+    void futex(int op, uint32_t value) noexcept {
+        // FUTEX_WAIT returns EAGAIN at once if notify() already cleared the word
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&parked_), op, value, nullptr, nullptr, 0);
+    }
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+    unsigned spin_limit_;
+    std::atomic<bool> stopped_{false};
+    std::atomic<uint64_t> parks_{0};
+
+    /// Futex word: set by the consumer before it sleeps, cleared by whichever
+    /// of the consumer (on waking) or notify() gets there first
+    alignas(64) std::atomic<uint32_t> parked_{0};
+};
@@ -0,0 +1,118 @@
+#include "arena.h"
+#include "numa_placement.h"
+#include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace {
+
+constexpr size_t kHugePageBytes = 2 << 20;
+
+size_t round_up(size_t bytes, size_t granule) {
+    return (bytes + granule - 1) & ~(granule - 1);
+}
+
+} // namespace
+
+Arena::~Arena() {
+    for (const Chunk& chunk : chunks_) ::munmap(chunk.base, chunk.bytes);
+}
+
+void* Arena::allocate_slow(size_t bytes, size_t align) {
+    // Room for the request at any alignment of the chunk start
+    const size_t needed = bytes + align;
+    for (;;) {
+        if (current_ < chunks_.size()) chunks_[current_].filled = offset_;
+        const size_t next = chunks_.empty() ? 0 : current_ + 1;
+        // Bring the first kept chunk big enough up next, else map one there
+        size_t fit = next;
+        while (fit < chunks_.size() && chunks_[fit].bytes < needed) fit++;
+        if (fit < chunks_.size()) {
+            std::rotate(chunks_.begin() + static_cast<std::ptrdiff_t>(next),
+                        chunks_.begin() + static_cast<std::ptrdiff_t>(fit),
+                        chunks_.begin() + static_cast<std::ptrdiff_t>(fit) + 1);
+        } else if (!map_chunk(next, needed)) {
+            return nullptr;
+        }
+        current_ = next;
+        offset_ = 0;
+        Chunk& chunk = chunks_[current_];
+        const size_t start = round_up(reinterpret_cast<uintptr_t>(chunk.base), align) -
+                             reinterpret_cast<uintptr_t>(chunk.base);
+        if (start + bytes <= chunk.bytes) {
+            offset_ = start + bytes;
+            return chunk.base + start;
+        }
+    }
+}
+
+bool Arena::map_chunk(size_t position, size_t min_bytes) {
+    const bool want_huge = config_.pages != ArenaPages::Normal;
+    size_t bytes = min_bytes > config_.chunk_bytes ? min_bytes : config_.chunk_bytes;
+    bytes = round_up(bytes, want_huge ? kHugePageBytes : 4096);
+
+    // A node binding or THP advice has to be in place before the pages are
+    // faulted in, so those chunks are touched by hand instead of MAP_POPULATE
+    const bool touch = config_.numa_node >= 0 || (config_.populate && want_huge);
+    const int populate = config_.populate && !touch ? MAP_POPULATE : 0;
+
+    void* base = MAP_FAILED;
+    bool huge = false;
+    if (config_.pages == ArenaPages::Huge) {
+        base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge = base != MAP_FAILED;
+    }
+    if (base == MAP_FAILED) {
+        base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | populate, -1, 0);
+        if (base == MAP_FAILED) return false;
+        if (want_huge) ::madvise(base, bytes, MADV_HUGEPAGE);
+    }
+    if (config_.numa_node >= 0) numa_bind(base, bytes, config_.numa_node);
+    if (touch) {
+        const size_t page = huge ? kHugePageBytes : static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        for (size_t offset = 0; offset < bytes; offset += page) static_cast<volatile char*>(base)[offset] = 0;
+    }
+    if (locked_) ::mlock(base, bytes);
+    chunks_.insert(chunks_.begin() + static_cast<std::ptrdiff_t>(position),
+                   Chunk{static_cast<char*>(base), bytes, 0, huge});
+    return true;
+}
+
+bool Arena::reserve(size_t bytes) {
+    Guard guard(*this);
+    size_t free_bytes = current_ < chunks_.size() ? chunks_[current_].bytes - offset_ : 0;
+    for (size_t i = current_ + 1; i < chunks_.size(); i++) free_bytes += chunks_[i].bytes;
+    if (free_bytes >= bytes) return true;
+    return map_chunk(chunks_.size(), bytes - free_bytes);
+}
+
+bool Arena::lock() {
+    Guard guard(*this);
+    locked_ = true;
+    bool ok = true;
+    for (const Chunk& chunk : chunks_) {
+        if (::mlock(chunk.base, chunk.bytes) != 0) ok = false;
+    }
+    return ok;
+}
+
+void Arena::rewind(const Mark& mark) {
+    Guard guard(*this);
+    // Recycled blocks may lie past the mark; drop them all
+    for (FreeBlock*& head : free_) head = nullptr;
+    current_ = mark.chunk;
+    offset_ = mark.offset;
+}
+
+ArenaStats Arena::stats() const {
+    Guard guard(*this);
+    ArenaStats stats;
+    stats.chunks = chunks_.size();
+    for (size_t i = 0; i < chunks_.size(); i++) {
+        stats.bytes_mapped += chunks_[i].bytes;
+        stats.huge_chunks += chunks_[i].huge;
+        if (i < current_) stats.bytes_used += chunks_[i].filled;
+    }
+    if (current_ < chunks_.size()) stats.bytes_used += offset_;
+    return stats;
+}
@@ -0,0 +1,314 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Page backing of arena chunks
+enum class ArenaPages : uint8_t {
+    Normal,      // 4 KiB pages
+    Transparent, // madvise(MADV_HUGEPAGE): THP where the kernel allows it
+    Huge         // MAP_HUGETLB from the reserved pool, Transparent if it is empty
+};
+
+struct ArenaConfig {
+    size_t chunk_bytes = 2 << 20;  // Mapped per chunk; larger requests get their own
+    ArenaPages pages = ArenaPages::Normal;
+    bool thread_safe = true;       // false: one owning thread, no lock on any call
+    int numa_node = -1;            // >= 0: chunks are bound to this node and touched
+                                   // when mapped; -1: pages land where first touched
+    bool populate = false;         // Fault every chunk in when it is mapped (MAP_POPULATE)
+};
+
+struct ArenaStats {
+    size_t bytes_used = 0;     // Bump-allocated since the last reset, padding included
+    size_t bytes_mapped = 0;   // Across every chunk
+    size_t chunks = 0;
+    size_t huge_chunks = 0;    // Chunks backed by MAP_HUGETLB
+};
+
+// Growable bump allocator over a chain of mmap'd chunks. Nothing is mapped
+// until the first allocation; a full chunk chains the next one (reusing a
+// chunk kept from before a reset if there is one), so pointers handed out
+// stay valid until reset() or a rewind past them.
+//
+// Freed blocks up to kMaxRecycled bytes go on per-size free lists and are
+// handed out again for the same size, so node containers (std::map,
+// std::list) churning on an arena stay bounded. Larger frees are dropped
+// until the next reset.
+//
+// With config.thread_safe every call takes an uncontended spinlock;
+// reset() and rewind() must still not race allocations that outlive them.
+class Arena {
+public:
+    static constexpr size_t kMaxRecycled = 512;
+
+    // Position to rewind to: everything allocated after it is released
+    struct Mark {
+        size_t chunk;
+        size_t offset;
+    };
+
+    explicit Arena(const ArenaConfig& config = ArenaConfig{}) : config_(config) {}
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // @return bytes aligned to align (a power of two), or nullptr if no
+    // chunk could be mapped
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        Guard guard(*this);
+        if (bytes <= kMaxRecycled) {
+            FreeBlock*& head = free_[size_class(bytes)];
+            if (head && (reinterpret_cast<uintptr_t>(head) & (align - 1)) == 0) {
+                FreeBlock* block = head;
+                head = block->next;
+                return block;
+            }
+            bytes = class_bytes(size_class(bytes));
+            if (align < kRecycledAlign) align = kRecycledAlign;
+        }
+        if (current_ < chunks_.size()) {
+            Chunk& chunk = chunks_[current_];
+            const uintptr_t base = reinterpret_cast<uintptr_t>(chunk.base);
+            const size_t start = ((base + offset_ + align - 1) & ~(align - 1)) - base;
+            if (start + bytes <= chunk.bytes) {
+                offset_ = start + bytes;
+                return chunk.base + start;
+            }
+        }
+        return allocate_slow(bytes, align);
+    }
+
+    // Release a block of bytes taken from this arena
+    void deallocate(void* pointer, size_t bytes) {
+        if (!pointer || bytes > kMaxRecycled) return;
+        Guard guard(*this);
+        FreeBlock*& head = free_[size_class(bytes)];
+        FreeBlock* block = static_cast<FreeBlock*>(pointer);
+        block->next = head;
+        head = block;
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        return memory ? new (memory) T(std::forward<Args>(args)...) : nullptr;
+    }
+
+    Mark mark() const {
+        Guard guard(*this);
+        return {current_, offset_};
+    }
+
+    // Release everything allocated since mark; chunks stay mapped for reuse
+    void rewind(const Mark& mark);
+
+    // Release everything; chunks stay mapped for reuse
+    void reset() { rewind({0, 0}); }
+
+    // Map chunks ahead of use until at least bytes are free past the current
+    // position, so up to that much is allocated with no mmap or page fault
+    // (with populate or numa_node); @return false if a chunk could not be mapped
+    bool reserve(size_t bytes);
+
+    // mlock every chunk, and each one mapped from now on, into RAM
+    // @return false if mlock failed (e.g. RLIMIT_MEMLOCK)
+    bool lock();
+
+    ArenaStats stats() const;
+
+private:
+    struct Chunk {
+        char* base;
+        size_t bytes;
+        size_t filled; // Bytes used when the arena moved on to the next chunk
+        bool huge;
+    };
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // Recycled blocks come in 16-byte classes, aligned to at least 16; one
+    // is reused only if it also meets the alignment asked for
+    static constexpr size_t kRecycledAlign = 16;
+    static constexpr size_t kClasses = kMaxRecycled / kRecycledAlign;
+    static size_t size_class(size_t bytes) { return bytes == 0 ? 0 : (bytes - 1) / kRecycledAlign; }
+    static size_t class_bytes(size_t size_class) { return (size_class + 1) * kRecycledAlign; }
+
+    class Guard {
+    public:
+        explicit Guard(const Arena& arena) : arena_(arena) {
+            if (!arena_.config_.thread_safe) return;
+            while (arena_.lock_.exchange(true, std::memory_order_acquire)) {
+                while (arena_.lock_.load(std::memory_order_relaxed)) __builtin_ia32_pause();
+            }
+        }
+        ~Guard() {
+            if (arena_.config_.thread_safe) arena_.lock_.store(false, std::memory_order_release);
+        }
+
+    private:
+        const Arena& arena_;
+    };
+
+    void* allocate_slow(size_t bytes, size_t align);
+    bool map_chunk(size_t position, size_t min_bytes);
+
+    ArenaConfig config_;
+    mutable std::atomic<bool> lock_{false};
+    std::vector<Chunk> chunks_;
+    size_t current_ = 0; // Chunk being bumped
+    size_t offset_ = 0;  // Next free byte in it
+    bool locked_ = false;
+    FreeBlock* free_[kClasses] = {};
+};
+
+// Rewinds the arena to where it was at construction, e.g. around the
+// scratch of one message
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena) : arena_(arena), mark_(arena.mark()) {}
+    ~ArenaScope() { arena_.rewind(mark_); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena& arena_;
+    Arena::Mark mark_;
+};
+
+// Fixed-size slots of T carved from an arena in blocks, with an intrusive
+// LIFO free list (the last released, still cache-warm slot goes out first).
+// Single-threaded; the arena must outlive the pool and not be reset under it.
+template <typename T>
+class ArenaPool {
+public:
+    explicit ArenaPool(Arena& arena, size_t block_slots = 1024) : arena_(arena), block_slots_(block_slots) {}
+
+    ArenaPool(const ArenaPool&) = delete;
+    ArenaPool& operator=(const ArenaPool&) = delete;
+
+    // Raw slot, or nullptr if the arena is out of memory
+    T* allocate() {
+        if (free_head_) {
+            Slot* slot = free_head_;
+            free_head_ = slot->next;
+            ++in_use_;
+            return reinterpret_cast<T*>(slot);
+        }
+        if (bump_ == block_end_) {
+            bump_ = static_cast<Slot*>(arena_.allocate(block_slots_ * sizeof(Slot), alignof(Slot)));
+            if (!bump_) {
+                block_end_ = nullptr;
+                return nullptr;
+            }
+            block_end_ = bump_ + block_slots_;
+            capacity_ += block_slots_;
+        }
+        ++in_use_;
+        return reinterpret_cast<T*>(bump_++);
+    }
+
+    void release(T* pointer) {
+        Slot* slot = reinterpret_cast<Slot*>(pointer);
+        slot->next = free_head_;
+        free_head_ = slot;
+        --in_use_;
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        T* slot = allocate();
+        return slot ? new (slot) T(std::forward<Args>(args)...) : nullptr;
+    }
+
+    void destroy(T* pointer) {
+        pointer->~T();
+        release(pointer);
+    }
+
+    // Live slots
+    size_t size() const { return in_use_; }
+
+    // Slots carved so far
+    size_t capacity() const { return capacity_; }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    Arena& arena_;
+    size_t block_slots_;
+    Slot* bump_ = nullptr;
+    Slot* block_end_ = nullptr;
+    Slot* free_head_ = nullptr;
+    size_t in_use_ = 0;
+    size_t capacity_ = 0;
+};
+
+// std::allocator-compatible handle on an Arena, for Fifo3 or the level maps
+// of OrderBook. A default-constructed (null) allocator uses the global heap,
+// so containers keep working when no arena is configured.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() noexcept = default;
+    explicit ArenaAllocator(Arena* arena) noexcept : arena_(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+    T* allocate(size_t count) {
+        if (!arena_) {
+            // Over-aligned types (e.g. cache-line level headers) need aligned new
+            if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{alignof(T)}));
+            } else {
+                return static_cast<T*>(::operator new(count * sizeof(T)));
+            }
+        }
+        void* memory = arena_->allocate(count * sizeof(T), alignof(T));
+        if (!memory) throw std::bad_alloc();
+        return static_cast<T*>(memory);
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept {
+        if (!arena_) {
+            if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+                ::operator delete(pointer, count * sizeof(T), std::align_val_t{alignof(T)});
+            } else {
+                ::operator delete(pointer, count * sizeof(T));
+            }
+        } else {
+            arena_->deallocate(pointer, count * sizeof(T));
+        }
+    }
+
+    Arena* arena() const noexcept { return arena_; }
+
+private:
+    Arena* arena_ = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+    return !(a == b);
+}
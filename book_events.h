@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include "price.h"
+
+// Incremental market-data event emitted by the book as a side effect of
+// add/cancel/amend/match. L2 events describe aggregated levels, L3 events
+// individual orders; each stream carries its own gap-free sequence.
+enum class BookEventType : uint8_t {
+    // L2
+    LevelAdd,     // New level; quantity = level total
+    LevelChange,  // Level total changed; quantity = new total
+    LevelDelete,  // Level removed; quantity = 0
+    // L3
+    OrderAdd,     // Order rested; quantity = resting quantity
+    OrderCancel,  // Order removed; quantity = quantity it had left
+    OrderModify,  // Quantity amended in place; quantity = new quantity
+    OrderExecute  // Resting order traded; quantity = executed quantity
+};
+
+// Streams a sink subscribes to
+enum BookEventStream : uint8_t {
+    kL2Events = 1 << 0,
+    kL3Events = 1 << 1
+};
+
+struct BookEvent {
+    uint64_t sequence;  // Per-stream sequence number
+    uint64_t order_id;  // L3 only
+    Ticks price;
+    uint64_t quantity;
+    BookEventType type;
+    bool is_buy;
+};
+
+inline bool is_l2_event(BookEventType type) { return type <= BookEventType::LevelDelete; }
+
+// Destination for book events
+class BookEventSink {
+public:
+    virtual ~BookEventSink() = default;
+    virtual void publish(const BookEvent& event) = 0;
+};
+
+// Sink that pushes events into an SPSC ring such as Fifo3 (SPSC_QUEUES/spsc_q3.cpp).
+// A full ring drops the event and counts it; consumers see the sequence gap.
+template <typename Fifo>
+class FifoEventSink : public BookEventSink {
+public:
+    explicit FifoEventSink(Fifo& fifo) : fifo_(fifo) {}
+
+    void publish(const BookEvent& event) override {
+        if (!fifo_.push(event)) {
+            ++dropped_;
+        }
+    }
+
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    Fifo& fifo_;
+    uint64_t dropped_ = 0;
+};
@@ -0,0 +1,305 @@
+#include "book_journal.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "order_book.h"
+
+namespace {
+
+constexpr size_t kHeaderBytes = sizeof(JournalSegmentHeader);
+
+std::string segment_path(const std::string& path, uint64_t index) {
+    char suffix[24];
+    std::snprintf(suffix, sizeof(suffix), ".%06llu", static_cast<unsigned long long>(index));
+    return path + suffix;
+}
+
+bool file_exists(const std::string& path) {
+    struct stat st{};
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+// Read-only mapping of one segment file for read()
+struct MappedSegment {
+    const char* base = nullptr;
+    size_t bytes = 0;
+
+    bool map(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderBytes) {
+            ::close(fd);
+            return false;
+        }
+        bytes = static_cast<size_t>(st.st_size);
+        void* map = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) return false;
+        base = static_cast<const char*>(map);
+        return true;
+    }
+
+    ~MappedSegment() {
+        if (base) ::munmap(const_cast<char*>(base), bytes);
+    }
+
+    const JournalSegmentHeader& header() const { return *reinterpret_cast<const JournalSegmentHeader*>(base); }
+};
+
+} // namespace
+
+BookJournal::Segment::~Segment() {
+    if (base) ::munmap(base, bytes);
+    if (fd >= 0) ::close(fd);
+}
+
+BookJournal::BookJournal(const JournalConfig& config) : config_(config) {}
+
+BookJournal::~BookJournal() {
+    close();
+}
+
+bool BookJournal::open() {
+    close();
+
+    // Carry the sequence on from whatever is already on disk
+    sequence_.store(0, std::memory_order_relaxed);
+    read(config_.path, [this](const JournalRecord& record) {
+        sequence_.store(record.sequence, std::memory_order_relaxed);
+    });
+    next_index_ = 1;
+    while (file_exists(segment_path(config_.path, next_index_))) next_index_++;
+
+    std::unique_ptr<Segment> first;
+    {
+        std::lock_guard<std::mutex> lock(segment_mutex_);
+        first = create_segment();
+    }
+    if (!first) return false;
+
+    first->first_sequence = sequence() + 1;
+    reinterpret_cast<JournalSegmentHeader*>(first->base)->first_sequence = first->first_sequence;
+    cursor_ = reinterpret_cast<JournalRecord*>(first->base + kHeaderBytes);
+    end_ = cursor_ + (first->bytes - kHeaderBytes) / sizeof(JournalRecord);
+    active_owner_ = std::move(first);
+    active_.store(active_owner_.get(), std::memory_order_release);
+    segments_.store(1, std::memory_order_relaxed);
+    durable_sequence_.store(sequence(), std::memory_order_relaxed);
+
+    running_.store(true, std::memory_order_release);
+    flusher_ = std::thread([this] { run_flusher(); });
+    return true;
+}
+
+void BookJournal::close() {
+    if (!active_owner_) return;
+    running_.store(false, std::memory_order_release);
+    if (flusher_.joinable()) flusher_.join();
+
+    // The flusher is gone; finish its work here
+    for (auto& segment : retired_) flush(*segment);
+    retired_.clear();
+    flush(*active_owner_);
+    active_.store(nullptr, std::memory_order_relaxed);
+    active_owner_.reset();
+
+    // A spare mapped ahead but never used would only be skipped on read
+    if (Segment* spare = spare_.exchange(nullptr)) {
+        const std::string path = segment_path(config_.path, spare->index);
+        delete spare;
+        ::unlink(path.c_str());
+    }
+    cursor_ = nullptr;
+    end_ = nullptr;
+}
+
+std::unique_ptr<BookJournal::Segment> BookJournal::create_segment() {
+    const uint64_t index = next_index_;
+    const std::string path = segment_path(config_.path, index);
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return nullptr;
+
+    auto segment = std::make_unique<Segment>();
+    segment->index = index;
+    segment->fd = fd;
+    segment->bytes = std::max(config_.segment_bytes, kHeaderBytes + sizeof(JournalRecord));
+
+    // Reserve the blocks now: a store into a hole the filesystem cannot
+    // back would be a SIGBUS on the book thread
+    if (::posix_fallocate(fd, 0, static_cast<off_t>(segment->bytes)) != 0) {
+        ::unlink(path.c_str());
+        return nullptr;
+    }
+    void* map = ::mmap(nullptr, segment->bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (map == MAP_FAILED) {
+        ::unlink(path.c_str());
+        return nullptr;
+    }
+    segment->base = static_cast<char*>(map);
+
+    JournalSegmentHeader& header = *reinterpret_cast<JournalSegmentHeader*>(segment->base);
+    std::memcpy(header.magic, kJournalMagic, sizeof(header.magic));
+    header.version = kJournalVersion;
+    header.record_size = sizeof(JournalRecord);
+    header.index = index;
+    header.first_sequence = 0;
+    segment->written.store(kHeaderBytes, std::memory_order_relaxed);
+    next_index_++;
+    return segment;
+}
+
+bool BookJournal::rotate() {
+    if (!active_owner_) return false;
+
+    // Normally the flusher has the next segment mapped already
+    std::unique_ptr<Segment> next(spare_.exchange(nullptr, std::memory_order_acq_rel));
+    if (!next) {
+        rotation_stalls_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(segment_mutex_);
+        next.reset(spare_.exchange(nullptr, std::memory_order_acq_rel));
+        if (!next) next = create_segment();
+        if (!next) return false;
+    }
+
+    next->first_sequence = sequence() + 1;
+    reinterpret_cast<JournalSegmentHeader*>(next->base)->first_sequence = next->first_sequence;
+    cursor_ = reinterpret_cast<JournalRecord*>(next->base + kHeaderBytes);
+    end_ = cursor_ + (next->bytes - kHeaderBytes) / sizeof(JournalRecord);
+    {
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        retired_.push_back(std::move(active_owner_));
+    }
+    active_owner_ = std::move(next);
+    active_.store(active_owner_.get(), std::memory_order_release);
+    segments_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void BookJournal::flush(Segment& segment) {
+    const size_t written = segment.written.load(std::memory_order_acquire);
+    if (written <= segment.flushed) return;
+
+    // msync wants a page-aligned start
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t start = segment.flushed & ~(page - 1);
+    ::msync(segment.base + start, written - start, config_.durable ? MS_SYNC : MS_ASYNC);
+    segment.flushed = written;
+    flushes_.fetch_add(1, std::memory_order_relaxed);
+
+    // A retired segment's last flush can come after the active one's
+    const uint64_t records = (written - kHeaderBytes) / sizeof(JournalRecord);
+    const uint64_t durable = segment.first_sequence + records - 1;
+    if (records > 0 && durable > durable_sequence_.load(std::memory_order_relaxed)) {
+        durable_sequence_.store(durable, std::memory_order_release);
+    }
+}
+
+void BookJournal::run_flusher() {
+    const auto interval = std::chrono::microseconds(config_.flush_interval_us);
+    while (running_.load(std::memory_order_acquire)) {
+        // Retired segments first: they hold the older records
+        std::vector<std::unique_ptr<Segment>> retired;
+        {
+            std::lock_guard<std::mutex> lock(retired_mutex_);
+            retired.swap(retired_);
+        }
+        for (auto& segment : retired) {
+            flush(*segment);
+            if (config_.durable) ::fdatasync(segment->fd);
+        }
+        retired.clear(); // Unmaps and closes
+
+        if (Segment* active = active_.load(std::memory_order_acquire)) flush(*active);
+
+        // Map the next segment ahead of the writer
+        if (!spare_.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(segment_mutex_);
+            if (!spare_.load(std::memory_order_acquire)) spare_.store(create_segment().release());
+        }
+
+        std::this_thread::sleep_for(interval);
+    }
+}
+
+JournalStats BookJournal::stats() const {
+    JournalStats stats;
+    stats.records = sequence_.load(std::memory_order_relaxed);
+    stats.durable_sequence = durable_sequence_.load(std::memory_order_acquire);
+    stats.segments = segments_.load(std::memory_order_relaxed);
+    stats.flushes = flushes_.load(std::memory_order_relaxed);
+    stats.rotation_stalls = rotation_stalls_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint64_t BookJournal::read(const std::string& path, const std::function<void(const JournalRecord&)>& fn) {
+    uint64_t expected = 1;
+    uint64_t count = 0;
+    for (uint64_t index = 1;; index++) {
+        const std::string file = segment_path(path, index);
+        if (!file_exists(file)) break;
+        MappedSegment segment;
+        if (!segment.map(file)) break;
+        const JournalSegmentHeader& header = segment.header();
+        if (std::memcmp(header.magic, kJournalMagic, sizeof(header.magic)) != 0 ||
+            header.record_size != sizeof(JournalRecord)) {
+            break;
+        }
+        if (header.first_sequence == 0) continue; // Mapped ahead, never rotated in
+        if (header.first_sequence != expected) break;
+
+        const auto* record = reinterpret_cast<const JournalRecord*>(segment.base + kHeaderBytes);
+        const auto* end = record + (segment.bytes - kHeaderBytes) / sizeof(JournalRecord);
+        for (; record != end && record->sequence == expected; record++, expected++, count++) {
+            fn(*record);
+        }
+    }
+    return count;
+}
+
+uint64_t BookJournal::replay(const std::string& path, OrderBook& book, uint64_t after_sequence) {
+    BookJournal* const journal = book.journal();
+    book.set_journal(nullptr);
+    uint64_t applied = 0;
+    read(path, [&](const JournalRecord& record) {
+        if (record.sequence <= after_sequence) return;
+        applied++;
+        switch (record.op) {
+        case JournalOp::Add:
+            // add_order only looks at the TIF to schedule a GoodTillTime deadline
+            book.add_order(Order{record.order_id, record.is_buy != 0, record.price, record.quantity,
+                                 record.timestamp_ns,
+                                 record.tif == static_cast<uint8_t>(TimeInForce::GoodTillTime)
+                                     ? TimeInForce::GoodTillTime
+                                     : TimeInForce::GoodTillCancel,
+                                 OrderType::Limit, record.account, record.expire_ns});
+            break;
+        case JournalOp::Cancel:
+            book.cancel_order(record.order_id);
+            break;
+        case JournalOp::Amend:
+            book.amend_order(record.order_id, record.price, record.quantity);
+            break;
+        case JournalOp::Match:
+            book.match_order(Order{record.order_id, record.is_buy != 0, record.price, record.quantity,
+                                   record.timestamp_ns, static_cast<TimeInForce>(record.tif),
+                                   static_cast<OrderType>(record.order_type), record.account, record.expire_ns},
+                             [](const Fill&) {});
+            break;
+        case JournalOp::Auction:
+            book.begin_auction();
+            break;
+        case JournalOp::Uncross:
+            book.uncross(record.timestamp_ns, [](const Fill&) {});
+            break;
+        }
+    });
+    book.set_journal(journal);
+    return applied;
+}
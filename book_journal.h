@@ -0,0 +1,182 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class OrderBook;
+
+// Book call a journal record replays as
+enum class JournalOp : uint8_t {
+    Add = 1, // add_order(order)
+    Cancel,  // cancel_order(order_id)
+    Amend,   // amend_order(order_id, price, quantity)
+    Match,   // match_order(order); fills follow deterministically from the book
+    Auction, // begin_auction()
+    Uncross  // uncross(timestamp_ns); fills follow as for Match
+};
+
+// One journaled call. The sequence is stored last, so a record whose
+// sequence is not the next one expected (zero in a preallocated segment)
+// marks the end of the journal.
+struct JournalRecord {
+    uint64_t sequence; // 1, 2, 3, ... across every segment
+    uint64_t order_id;
+    double price;
+    uint64_t quantity;
+    uint64_t timestamp_ns;
+    JournalOp op;
+    uint8_t is_buy;
+    uint8_t tif;        // TimeInForce, for Match
+    uint8_t order_type; // OrderType, for Match
+    uint32_t account;   // Order::account, for Add and Match
+    uint64_t expire_ns; // Order::expire_ns, for Add and Match
+};
+static_assert(sizeof(JournalRecord) == 56, "journal records are fixed-size on disk");
+
+// First bytes of every segment file; records follow it
+struct JournalSegmentHeader {
+    char magic[8];           // kJournalMagic
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t index;          // path.000001 is segment 1
+    uint64_t first_sequence; // 0 until the segment is rotated in
+    uint8_t reserved[32];
+};
+static_assert(sizeof(JournalSegmentHeader) == 64, "records start on a cache line");
+
+constexpr char kJournalMagic[8] = {'O', 'B', 'J', 'R', 'N', 'L', '0', '1'};
+constexpr uint32_t kJournalVersion = 2; // 2: records carry expire_ns
+
+struct JournalConfig {
+    std::string path = "book.journal"; // Segments are path.000001, path.000002, ...
+    size_t segment_bytes = 64 << 20;   // Preallocated size of each segment file
+    uint32_t flush_interval_us = 1000; // Background flush period
+    bool durable = true;               // msync(MS_SYNC) + fdatasync; false = MS_ASYNC,
+                                       // which survives a process crash but not power loss
+};
+
+struct JournalStats {
+    uint64_t records = 0;          // Appended (== last sequence written this run)
+    uint64_t durable_sequence = 0; // Last sequence known flushed
+    uint64_t segments = 0;         // Segments rotated in
+    uint64_t flushes = 0;          // msync calls
+    uint64_t rotation_stalls = 0;  // Rotations that had to map the next segment inline
+    uint64_t dropped = 0;          // Appends lost because no segment could be mapped
+};
+
+// Append-only journal of book calls in preallocated, mmap'd segment files.
+// The book thread only stores a record into mapped memory; a background
+// thread msyncs the written range, maps the next segment before it is
+// needed, and fdatasyncs and unmaps segments once they are full.
+//
+// One writer thread calls append(); stats() may be read from any thread.
+class BookJournal {
+public:
+    explicit BookJournal(const JournalConfig& config = JournalConfig{});
+    ~BookJournal();
+
+    BookJournal(const BookJournal&) = delete;
+    BookJournal& operator=(const BookJournal&) = delete;
+
+    // Continue after any segments already at config.path (sequence carries
+    // on from their last record) in a new segment, and start the flusher
+    // @return false if the first segment cannot be created
+    bool open();
+
+    // Flush everything written, stop the flusher and unmap
+    void close();
+
+    bool is_open() const { return active_owner_ != nullptr; }
+
+    // Journal one book call: a 56-byte store into the mapped segment
+    // @return false if the journal is closed or no segment could be mapped
+    bool append(JournalOp op, uint64_t order_id, bool is_buy, double price, uint64_t quantity,
+                uint64_t timestamp_ns, uint8_t tif = 0, uint8_t order_type = 0, uint32_t account = 0,
+                uint64_t expire_ns = 0) {
+        if (cursor_ == end_ && !rotate()) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        JournalRecord* record = cursor_++;
+        record->order_id = order_id;
+        record->price = price;
+        record->quantity = quantity;
+        record->timestamp_ns = timestamp_ns;
+        record->op = op;
+        record->is_buy = is_buy;
+        record->tif = tif;
+        record->order_type = order_type;
+        record->account = account;
+        record->expire_ns = expire_ns;
+        const uint64_t sequence = sequence_.load(std::memory_order_relaxed) + 1;
+        sequence_.store(sequence, std::memory_order_relaxed); // Only this thread writes it
+        __atomic_store_n(&record->sequence, sequence, __ATOMIC_RELEASE);
+        active_owner_->written.store(reinterpret_cast<char*>(cursor_) - active_owner_->base,
+                                     std::memory_order_release);
+        return true;
+    }
+
+    // Last sequence appended (or recovered by open()); any thread
+    uint64_t sequence() const { return sequence_.load(std::memory_order_relaxed); }
+
+    JournalStats stats() const;
+
+    // Call fn(const JournalRecord&) for every record at path in sequence
+    // order, stopping at the first gap (a torn tail after a crash)
+    // @return records read
+    static uint64_t read(const std::string& path, const std::function<void(const JournalRecord&)>& fn);
+
+    // Rebuild book by replaying the journal at path onto it, skipping
+    // records up to after_sequence (e.g. those a restored snapshot covers).
+    // The book's own journal is detached meanwhile, so replay is not
+    // journaled again. @return records applied
+    static uint64_t replay(const std::string& path, OrderBook& book, uint64_t after_sequence = 0);
+
+private:
+    struct Segment {
+        uint64_t index = 0;
+        int fd = -1;
+        char* base = nullptr;
+        size_t bytes = 0;
+        uint64_t first_sequence = 0;
+        std::atomic<size_t> written{0}; // Bytes in use, published by append()
+        size_t flushed = 0;             // Flusher only
+
+        ~Segment();
+    };
+
+    std::unique_ptr<Segment> create_segment(); // Caller holds segment_mutex_
+    bool rotate();
+    void flush(Segment& segment);
+    void run_flusher();
+
+    JournalConfig config_;
+
+    // Writer thread
+    JournalRecord* cursor_ = nullptr;
+    JournalRecord* end_ = nullptr;
+    std::atomic<uint64_t> sequence_{0}; // Atomic only so stats() can read it
+    std::unique_ptr<Segment> active_owner_;
+
+    // Shared with the flusher
+    std::atomic<Segment*> active_{nullptr};
+    std::atomic<Segment*> spare_{nullptr};       // Next segment, mapped ahead of time
+    std::mutex segment_mutex_;                   // Segment creation and next_index_
+    uint64_t next_index_ = 1;
+    std::mutex retired_mutex_;
+    std::vector<std::unique_ptr<Segment>> retired_; // Full, awaiting the final sync
+    std::atomic<bool> running_{false};
+    std::thread flusher_;
+
+    std::atomic<uint64_t> durable_sequence_{0};
+    std::atomic<uint64_t> segments_{0};
+    std::atomic<uint64_t> flushes_{0};
+    std::atomic<uint64_t> rotation_stalls_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
@@ -0,0 +1,148 @@
+#include "book_manager.h"
+#include "numa_placement.h"
+#include <cstdio>
+#include <pthread.h>
+#include <sched.h>
+
+bool pin_current_thread(int cpu) {
+    if (cpu < 0) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+BookManager::BookManager(size_t symbol_count, const BookManagerConfig& config)
+    : owner_(symbol_count)
+    , book_nodes_(symbol_count, -1)
+    , numa_local_(config.numa_local)
+    , warm_up_(config.warm_up)
+    , warmup_(config.warmup) {
+    books_.reserve(symbol_count);
+    for (size_t i = 0; i < symbol_count; i++) {
+        books_.emplace_back(config.book);
+    }
+    if (config.publish_depth) {
+        depth_ = std::make_unique<BookDepth[]>(symbol_count);
+        for (size_t i = 0; i < symbol_count; i++) {
+            depth_[i].publish(books_[i].book); // Readers never see an unpublished book
+        }
+    }
+
+    const size_t worker_count = config.worker_count ? config.worker_count : 1;
+    for (size_t i = 0; i < worker_count; i++) {
+        const int cpu = i < config.worker_cpus.size() ? config.worker_cpus[i] : -1;
+        const int node = config.numa_local ? numa_node_of_cpu(cpu) : -1;
+        workers_.push_back(std::make_unique<Worker>(i, config.ring_capacity, cpu, node));
+    }
+
+    for (size_t i = 0; i < symbol_count; i++) {
+        owner_[i] = static_cast<uint32_t>(i % worker_count);
+    }
+}
+
+BookManager::~BookManager() {
+    stop();
+}
+
+void BookManager::assign(SymbolId symbol, size_t worker) {
+    owner_[symbol] = static_cast<uint32_t>(worker);
+}
+
+void BookManager::start() {
+    if (running_.exchange(true)) return;
+    for (auto& worker : workers_) {
+        Worker& w = *worker;
+        w.ready.store(false, std::memory_order_relaxed);
+        w.thread = std::thread([this, &w] { run(w); });
+    }
+    // Placement is reportable, and books are rebuilt and warm, once every
+    // worker is ready
+    for (auto& worker : workers_) {
+        while (!worker->ready.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+}
+
+void BookManager::stop() {
+    if (!running_.exchange(false)) return;
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+bool BookManager::submit(SymbolId symbol, const BookOp& op) {
+    return workers_[owner_[symbol]]->ring.emplace(SymbolOp{symbol, op});
+}
+
+int BookManager::ring_node(size_t worker) const {
+    return numa_node_of_address(workers_[worker]->ring.data());
+}
+
+void BookManager::print_placement() const {
+    std::printf("%zu worker(s), %zu book(s), %d NUMA node(s)%s\n", workers_.size(), books_.size(),
+                numa_node_count(), numa_local_ ? ", numa_local" : "");
+    for (const auto& worker : workers_) {
+        std::printf("  worker %zu: cpu %d (node %d), ring on node %d, books:", worker->index, worker->cpu,
+                    numa_node_of_cpu(worker->cpu), ring_node(worker->index));
+        size_t owned = 0;
+        size_t remote = 0;
+        for (SymbolId symbol = 0; symbol < books_.size(); symbol++) {
+            if (owner_[symbol] != worker->index) continue;
+            owned++;
+            if (worker->node >= 0 && book_nodes_[symbol] != worker->node) remote++;
+            if (owned <= 8) std::printf(" %u@%d", symbol, book_nodes_[symbol]);
+        }
+        if (owned > 8) std::printf(" ... (%zu total)", owned);
+        if (remote) std::printf(", %zu off-node", remote);
+        std::printf("\n");
+    }
+}
+
+void BookManager::rehome_books(const Worker& worker) {
+    // A book rebuilt from its own image on this thread gets a fresh slab,
+    // index and level maps first-touched here; empty books (the usual case at
+    // startup) are just reconstructed. A book with an event sink re-emits
+    // its contents, as on any restore
+    std::vector<uint64_t> image;
+    for (SymbolId symbol = 0; symbol < books_.size(); symbol++) {
+        if (owner_[symbol] != worker.index) continue;
+        OrderBook& book = books_[symbol].book;
+        image.resize((book.snapshot_bytes() + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        char* data = reinterpret_cast<char*>(image.data());
+        const size_t bytes = book.write_snapshot(data, image.size() * sizeof(uint64_t));
+        book.restore_snapshot(data, bytes);
+    }
+}
+
+void BookManager::run(Worker& worker) {
+    pin_current_thread(worker.cpu);
+    if (numa_local_ && worker.cpu >= 0) rehome_books(worker);
+    if (warm_up_) {
+        // On this thread, so it is this core's caches and predictors that warm
+        for (SymbolId symbol = 0; symbol < books_.size(); symbol++) {
+            if (owner_[symbol] == worker.index) books_[symbol].book.warm_up(warmup_);
+        }
+    }
+    for (SymbolId symbol = 0; symbol < books_.size(); symbol++) {
+        if (owner_[symbol] != worker.index) continue;
+        book_nodes_[symbol] = numa_node_of_address(books_[symbol].book.order_storage());
+    }
+    worker.ready.store(true, std::memory_order_release);
+
+    uint64_t processed = 0;
+    for (;;) {
+        // Sampled before the pop: once stopping, everything submitted is visible
+        const bool stopping = !running_.load(std::memory_order_acquire);
+        if (const SymbolOp* message = worker.ring.front()) {
+            // Applied straight out of the ring slot
+            const SymbolId symbol = message->symbol;
+            books_[symbol].book.apply(message->op);
+            worker.ring.release();
+            if (depth_) depth_[symbol].publish(books_[symbol].book);
+            worker.processed.store(++processed, std::memory_order_relaxed);
+            continue;
+        }
+        if (stopping) break;
+        __builtin_ia32_pause();
+    }
+}
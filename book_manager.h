@@ -0,0 +1,144 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "arena.h"
+#include "order_book.h"
+#include "depth_publisher.h"
+#include "SPSC_QUEUES/spsc_q4.cpp"
+
+// Compact instrument identifier; indexes BookManager's book array directly
+using SymbolId = uint32_t;
+
+// Operation addressed to one instrument's book
+struct SymbolOp {
+    SymbolId symbol;
+    BookOp op;
+};
+
+struct BookManagerConfig {
+    size_t worker_count = 1;       // Book threads; each owns a disjoint set of symbols
+    size_t ring_capacity = 1 << 16; // Per-worker ingress ring size; a power of two
+    std::vector<int> worker_cpus;  // CPU to pin worker i to; -1 or missing = unpinned
+    OrderBookConfig book{0.01, 1 << 12}; // Configuration shared by every book
+    bool publish_depth = false;    // Seqlock-publish each book's top levels for depth()
+    bool numa_local = false;       // Put each worker's ring and books on its CPU's NUMA node
+    bool warm_up = false;          // Warm every book on its worker in start() (OrderBook::warm_up)
+    WarmupConfig warmup;
+};
+
+// Top levels every book publishes when BookManagerConfig::publish_depth is set
+using BookDepth = DepthPublisher<10>;
+
+// Owns one OrderBook per symbol in contiguous storage and shards them across
+// worker threads. Each worker is fed by its own Fifo4 ring and is the only
+// thread that touches its books, so no book ever needs a lock.
+//
+// submit() is the producer side of every ring: call it, and stop(), from a
+// single thread (e.g. the feed decoder). Books may be read directly only
+// while stopped.
+//
+// With numa_local, a pinned worker's ring comes from an arena bound to its
+// CPU's node, and start() rebuilds each book on its worker before the worker
+// takes ops, so the book's slab, id index and level maps are first-touched
+// there too. Group symbols onto workers with assign() before start().
+class BookManager {
+public:
+    BookManager(size_t symbol_count, const BookManagerConfig& config = BookManagerConfig{});
+    ~BookManager();
+
+    BookManager(const BookManager&) = delete;
+    BookManager& operator=(const BookManager&) = delete;
+
+    size_t symbol_count() const { return books_.size(); }
+    size_t worker_count() const { return workers_.size(); }
+
+    // Symbols are assigned round-robin; reassign before start() to group them
+    void assign(SymbolId symbol, size_t worker);
+    size_t worker_of(SymbolId symbol) const { return owner_[symbol]; }
+
+    OrderBook& book(SymbolId symbol) { return books_[symbol].book; }
+    const OrderBook& book(SymbolId symbol) const { return books_[symbol].book; }
+
+    // Top of one book, readable lock-free from any thread while running;
+    // workers republish after every operation that changes it
+    // (publish_depth only)
+    const BookDepth& depth(SymbolId symbol) const { return depth_[symbol]; }
+    bool publishes_depth() const { return depth_ != nullptr; }
+
+    // Spawn (and pin) the worker threads; returns once each has rehomed and
+    // warmed its books as configured
+    void start();
+
+    // Drain every ring and join the workers
+    void stop();
+
+    // NUMA node holding a book's order slab as of the last start(), or -1
+    // before the first start
+    int book_node(SymbolId symbol) const { return book_nodes_[symbol]; }
+
+    // NUMA node holding a worker's ring storage, and the node of its CPU
+    // (-1 if unpinned or unknown)
+    int ring_node(size_t worker) const;
+    int worker_node(size_t worker) const { return workers_[worker]->node; }
+
+    // Startup report: CPU and node of every worker, where its ring lives,
+    // and which node each of its books lives on; to stdout
+    void print_placement() const;
+
+    bool running() const { return running_.load(std::memory_order_relaxed); }
+
+    // Route an operation to the owning worker's ring
+    // @return false if that ring is full
+    bool submit(SymbolId symbol, const BookOp& op);
+
+    // Apply an operation on the calling thread (only while stopped)
+    bool apply(SymbolId symbol, const BookOp& op) { return book(symbol).apply(op); }
+
+    // Operations applied by a worker so far
+    uint64_t processed(size_t worker) const {
+        return workers_[worker]->processed.load(std::memory_order_relaxed);
+    }
+
+private:
+    // Keep neighbouring books owned by different workers off a shared line
+    struct alignas(64) BookSlot {
+        explicit BookSlot(const OrderBookConfig& config) : book(config) {}
+        OrderBook book;
+    };
+
+    struct Worker {
+        Worker(size_t index, size_t capacity, int cpu, int node)
+            : index(index)
+            , cpu(cpu)
+            , node(node)
+            , arena(ArenaConfig{capacity * sizeof(SymbolOp), ArenaPages::Normal, false, node})
+            , ring(capacity, ArenaAllocator<SymbolOp>(node >= 0 ? &arena : nullptr)) {}
+        size_t index;
+        int cpu;
+        int node;   // Node memory is placed on; -1 = wherever it is first touched
+        Arena arena; // Backs the ring when node >= 0
+        Fifo4<SymbolOp, ArenaAllocator<SymbolOp>> ring;
+        std::thread thread;
+        std::atomic<bool> ready{false}; // Books rehomed and placement recorded
+        alignas(64) std::atomic<uint64_t> processed{0};
+    };
+
+    void run(Worker& worker);
+    void rehome_books(const Worker& worker);
+
+    std::vector<BookSlot> books_;
+    std::vector<uint32_t> owner_;
+    std::vector<int> book_nodes_;        // Written by each book's worker at start()
+    std::unique_ptr<BookDepth[]> depth_; // Per symbol, when publishing
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_{false};
+    bool numa_local_ = false;
+    bool warm_up_ = false;
+    WarmupConfig warmup_;
+};
+
+// Pin the calling thread to one CPU; @return false if the call failed
+bool pin_current_thread(int cpu);
@@ -0,0 +1,61 @@
+#include "book_metrics.h"
+#include <cstdio>
+#include <thread>
+
+const char* book_metric_name(BookMetric metric) {
+    switch (metric) {
+    case BookMetric::Add:      return "add";
+    case BookMetric::Cancel:   return "cancel";
+    case BookMetric::Amend:    return "amend";
+    case BookMetric::Snapshot: return "snapshot";
+    case BookMetric::Count:    break;
+    }
+    return "?";
+}
+
+double tsc_ticks_per_ns() {
+    // 20 ms against the steady clock is well inside 0.1%; done on first use
+    static const double ticks_per_ns = [] {
+        const auto wall_start = std::chrono::steady_clock::now();
+        const uint64_t tsc_start = tsc_begin();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const uint64_t tsc_stop = tsc_end();
+        const auto wall_stop = std::chrono::steady_clock::now();
+        const double ns = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(wall_stop - wall_start).count());
+        return static_cast<double>(tsc_stop - tsc_start) / ns;
+    }();
+    return ticks_per_ns;
+}
+
+BookMetricSummary BookMetrics::summary(BookMetric metric) const {
+    LatencyHistogram histogram;
+    cycles(metric, histogram);
+    const double ticks_per_ns = tsc_ticks_per_ns();
+    BookMetricSummary summary;
+    summary.count = histogram.count();
+    summary.p50_ns = static_cast<double>(histogram.percentile(50)) / ticks_per_ns;
+    summary.p99_ns = static_cast<double>(histogram.percentile(99)) / ticks_per_ns;
+    summary.p999_ns = static_cast<double>(histogram.percentile(99.9)) / ticks_per_ns;
+    summary.max_ns = static_cast<double>(histogram.max()) / ticks_per_ns;
+    return summary;
+}
+
+void BookMetrics::print() const {
+    for (size_t i = 0; i < static_cast<size_t>(BookMetric::Count); i++) {
+        const BookMetric metric = static_cast<BookMetric>(i);
+        const BookMetricSummary s = summary(metric);
+        std::printf("  %-8s %10llu  p50 %7.1f  p99 %7.1f  p99.9 %8.1f  max %10.1f (ns)\n", book_metric_name(metric),
+                    static_cast<unsigned long long>(s.count), s.p50_ns, s.p99_ns, s.p999_ns, s.max_ns);
+    }
+    std::printf("  levels created %llu, erased %llu; lookups missed %llu\n",
+                static_cast<unsigned long long>(levels_created()), static_cast<unsigned long long>(levels_erased()),
+                static_cast<unsigned long long>(lookups_missed()));
+}
+
+void BookMetrics::reset() {
+    for (auto& histogram : latency_) histogram.reset();
+    levels_created_.store(0, std::memory_order_relaxed);
+    levels_erased_.store(0, std::memory_order_relaxed);
+    lookups_missed_.store(0, std::memory_order_relaxed);
+}
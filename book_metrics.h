@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <x86intrin.h>
+#include "latency_histogram.h"
+
+// Hot-path instrumentation of OrderBook, compiled in only with
+// -DORDERBOOK_METRICS (CMake: -DORDERBOOK_METRICS=ON, make: METRICS=1).
+// Without it the book has no metrics member and the timing macros expand
+// to nothing, so the cost is zero.
+
+// Timed book operations
+enum class BookMetric : uint8_t {
+    Add,      // add_order
+    Cancel,   // cancel_order
+    Amend,    // amend_order
+    Snapshot, // get_snapshot, any overload
+    Count
+};
+
+const char* book_metric_name(BookMetric metric);
+
+// Serialising TSC reads: nothing before begin or after end leaks into the
+// measured region
+inline uint64_t tsc_begin() {
+    _mm_lfence();
+    return __rdtsc();
+}
+
+inline uint64_t tsc_end() {
+    unsigned aux;
+    const uint64_t tsc = __rdtscp(&aux);
+    _mm_lfence();
+    return tsc;
+}
+
+// TSC ticks per nanosecond, measured once against steady_clock
+double tsc_ticks_per_ns();
+
+// Percentiles of one operation, converted to ns
+struct BookMetricSummary {
+    uint64_t count = 0;
+    double p50_ns = 0.0;
+    double p99_ns = 0.0;
+    double p999_ns = 0.0;
+    double max_ns = 0.0;
+};
+
+// Per-book recorder. The book thread records; any thread may read.
+class BookMetrics {
+public:
+    // Book thread
+    void record(BookMetric metric, uint64_t cycles) { latency_[index(metric)].record(cycles); }
+    void level_created() { bump(levels_created_); }
+    void level_erased() { bump(levels_erased_); }
+    void lookup_missed() { bump(lookups_missed_); }
+
+    // Any thread
+    void cycles(BookMetric metric, LatencyHistogram& out) const { latency_[index(metric)].snapshot(out); }
+    BookMetricSummary summary(BookMetric metric) const;
+    uint64_t levels_created() const { return levels_created_.load(std::memory_order_relaxed); }
+    uint64_t levels_erased() const { return levels_erased_.load(std::memory_order_relaxed); }
+    uint64_t lookups_missed() const { return lookups_missed_.load(std::memory_order_relaxed); }
+
+    // One line per operation plus the counters, to stdout
+    void print() const;
+
+    // Book thread, or while it is quiet
+    void reset();
+
+private:
+    static size_t index(BookMetric metric) { return static_cast<size_t>(metric); }
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    AtomicLatencyHistogram latency_[static_cast<size_t>(BookMetric::Count)];
+    std::atomic<uint64_t> levels_created_{0};
+    std::atomic<uint64_t> levels_erased_{0};
+    std::atomic<uint64_t> lookups_missed_{0};
+};
+
+// Records the cycles from construction to destruction under one metric
+class BookMetricTimer {
+public:
+    BookMetricTimer(BookMetrics& metrics, BookMetric metric)
+        : metrics_(metrics), metric_(metric), start_(tsc_begin()) {}
+    ~BookMetricTimer() { metrics_.record(metric_, tsc_end() - start_); }
+
+    BookMetricTimer(const BookMetricTimer&) = delete;
+    BookMetricTimer& operator=(const BookMetricTimer&) = delete;
+
+private:
+    BookMetrics& metrics_;
+    BookMetric metric_;
+    uint64_t start_;
+};
+
+#ifdef ORDERBOOK_METRICS
+#define BOOK_METRIC_TIMER(metrics, metric) BookMetricTimer book_metric_timer_((metrics), (metric))
+#define BOOK_METRIC_COUNT(metrics, counter) (metrics).counter()
+#else
+#define BOOK_METRIC_TIMER(metrics, metric) ((void)0)
+#define BOOK_METRIC_COUNT(metrics, counter) ((void)0)
+#endif
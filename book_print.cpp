@@ -0,0 +1,42 @@
+#include "order_book.h"
+#include "ladder_order_book.h"
+#include <iostream>
+#include <iomanip>
+
+// Console output for both book types, kept out of order_book.cpp so the
+// iostream machinery never shares a translation unit with the hot path
+
+void OrderBook::print_book(size_t depth) const {
+    std::vector<PriceLevel> bids, asks;
+    get_snapshot(depth, bids, asks);
+    print_levels(bids, asks);
+}
+
+void LadderOrderBook::print_book(size_t depth) const {
+    std::vector<PriceLevel> bids, asks;
+    get_snapshot(depth, bids, asks);
+    print_levels(bids, asks);
+}
+
+void print_levels(const std::vector<PriceLevel>& bids, const std::vector<PriceLevel>& asks) {
+    std::cout << "\n========== ORDER BOOK ==========" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    
+    // Print asks in reverse order (highest to lowest)
+    std::cout << "\n--- ASKS (Sell Orders) ---" << std::endl;
+    for (auto it = asks.rbegin(); it != asks.rend(); ++it) {
+        std::cout << "  " << std::setw(10) << it->total_quantity 
+                  << " @ $" << std::setw(8) << it->price << std::endl;
+    }
+    
+    std::cout << "\n--------------------------" << std::endl;
+    
+    // Print bids (highest to lowest)
+    std::cout << "--- BIDS (Buy Orders) ---" << std::endl;
+    for (const auto& bid : bids) {
+        std::cout << "  " << std::setw(10) << bid.total_quantity 
+                  << " @ $" << std::setw(8) << bid.price << std::endl;
+    }
+    
+    std::cout << "==============================\n" << std::endl;
+}
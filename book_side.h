@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include "price.h"
+
+enum class Side : uint8_t { Buy, Sell };
+
+// Everything that differs between the two sides of a book, resolved at
+// compile time: level order, which price is better, and which resting
+// prices an incoming order crosses. Code templated on Side is written once
+// and compiles to two straight-line copies; the runtime is_buy is looked at
+// once, where an operation enters the book.
+template <Side S>
+struct SideTraits {
+    static constexpr bool is_buy = S == Side::Buy;
+    static constexpr Side opposite = is_buy ? Side::Sell : Side::Buy;
+
+    // Level map order: best price first (bids descending, asks ascending)
+    using Compare = std::conditional_t<is_buy, std::greater<Ticks>, std::less<Ticks>>;
+
+    // Whether price a ranks ahead of b among resting orders on this side
+    static constexpr bool better(Ticks a, Ticks b) { return is_buy ? a > b : a < b; }
+
+    // Whether a resting level at price on this side trades with an incoming
+    // opposite order limited at limit: unless the limit is strictly better
+    static constexpr bool crossed_by(Ticks price, Ticks limit) { return !better(limit, price); }
+
+    // Limit of a market order entered on this side: the worst price it may take
+    static constexpr Ticks market_limit = is_buy ? std::numeric_limits<Ticks>::max()
+                                                 : std::numeric_limits<Ticks>::min();
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include "price.h"
+
+// Binary image of a whole OrderBook (OrderBook::write_snapshot). Laid out
+// for bulk restore rather than per-order inserts:
+//
+//   SnapshotHeader
+//   SnapshotLevel[bid_levels]   best bid first
+//   SnapshotLevel[ask_levels]   best ask first
+//   SnapshotOrder[order_count]  level by level in the order above, each
+//                               level's orders in FIFO (time priority) order
+//
+// All fields are little-endian, as on the machines that write them.
+constexpr char kSnapshotMagic[8] = {'O', 'B', 'S', 'N', 'A', 'P', '0', '1'};
+constexpr uint32_t kSnapshotVersion = 3; // 2: SnapshotOrder carries the account; 3: and its deadline
+
+struct SnapshotHeader {
+    char magic[8];        // kSnapshotMagic
+    uint32_t version;     // kSnapshotVersion
+    uint32_t reserved;
+    double tick_size;     // Prices below are ticks of this size
+    uint64_t sequence;    // Caller's position, e.g. the journal sequence covered
+    uint64_t order_count;
+    uint64_t bid_levels;
+    uint64_t ask_levels;
+    uint64_t expiry_now_ns; // Time the expiry wheel had reached; deadlines resume from it
+};
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header is one cache line");
+
+struct SnapshotLevel {
+    Ticks price;
+    uint64_t order_count;    // Orders of this level in the order section
+    uint64_t total_quantity;
+};
+static_assert(sizeof(SnapshotLevel) == 24, "snapshot levels are packed");
+
+struct SnapshotOrder {
+    uint64_t order_id;
+    uint64_t quantity;
+    uint64_t timestamp_ns;
+    uint64_t expire_ns; // GoodTillTime deadline, rounded up to the expiry tick; 0 = none
+    uint32_t account;
+    uint8_t tif;        // TimeInForce: GoodTillTime with a deadline, else GoodTillCancel
+    uint8_t reserved[3];
+};
+static_assert(sizeof(SnapshotOrder) == 40, "snapshot orders are packed");
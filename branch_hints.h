@@ -0,0 +1,20 @@
+#pragma once
+
+// Hot/cold discipline for the book's fast paths. BOOK_LIKELY/BOOK_UNLIKELY
+// steer block layout so the common case falls through (C++17, so
+// __builtin_expect rather than [[likely]]); BOOK_COLD moves a function to
+// .text.unlikely and keeps it from being inlined into its caller, and
+// BOOK_HOT groups the core operations in .text.hot. Building with
+// ORDERBOOK_NO_BRANCH_HINTS turns all of them into no-ops, so a bench run
+// of each build shows what the layout buys.
+#ifdef ORDERBOOK_NO_BRANCH_HINTS
+#define BOOK_LIKELY(x) (x)
+#define BOOK_UNLIKELY(x) (x)
+#define BOOK_HOT
+#define BOOK_COLD
+#else
+#define BOOK_LIKELY(x) __builtin_expect(!!(x), 1)
+#define BOOK_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define BOOK_HOT [[gnu::hot]]
+#define BOOK_COLD [[gnu::cold, gnu::noinline]]
+#endif
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "book_side.h"
+#include "price.h"
+
+// Top-N aggregated levels of one book side, maintained incrementally.
+// Entries are ordered best first. While clean the cache holds exactly the
+// min(N, level count) best levels; erasing a cached level that has to be
+// back-filled from deeper in the book only marks it dirty, and the next
+// reader rebuilds it in O(N).
+//
+// Updates take the side the cache belongs to as a template argument, so the
+// ordering compare in each scan is fixed at compile time. Tick prices and
+// quantities are also kept as plain arrays for the depth_kernels.h queries.
+class DepthCache {
+public:
+    static constexpr size_t kCapacity = 16;
+
+    size_t size() const { return count_; }
+    bool dirty() const { return dirty_; }
+    const PriceLevel* levels() const { return levels_; }
+    const Ticks* prices() const { return prices_; }
+    const uint64_t* quantities() const { return quantities_; }
+
+    // Copy a compile-time number of entries; a fixed-size memcpy the compiler
+    // unrolls. Slots past size() are copied but meaningless.
+    // @return number of valid entries written
+    template <size_t Depth>
+    size_t copy_to(PriceLevel* out) const {
+        static_assert(Depth <= kCapacity, "depth exceeds cached levels");
+        std::memcpy(out, levels_, Depth * sizeof(PriceLevel));
+        return count_ < Depth ? count_ : Depth;
+    }
+
+    // Quantity of an existing level changed; @return whether the cache changed
+    template <Side S>
+    bool update(Ticks price, uint64_t total_quantity) {
+        if (dirty_) return true;
+        for (size_t i = 0; i < count_; ++i) {
+            if (prices_[i] == price) {
+                levels_[i].total_quantity = total_quantity;
+                quantities_[i] = total_quantity;
+                return true;
+            }
+            if (SideTraits<S>::better(price, prices_[i])) break;
+        }
+        return false;
+    }
+
+    // A new level was created; @return whether the cache changed
+    template <Side S>
+    bool insert(Ticks price, double display_price, uint64_t total_quantity) {
+        if (dirty_) return true;
+        size_t i = count_;
+        while (i > 0 && SideTraits<S>::better(price, prices_[i - 1])) --i;
+        if (i == kCapacity) return false; // Deeper than the cache
+
+        const size_t moved = (count_ < kCapacity ? count_ : kCapacity - 1) - i;
+        std::memmove(&prices_[i + 1], &prices_[i], moved * sizeof(Ticks));
+        std::memmove(&levels_[i + 1], &levels_[i], moved * sizeof(PriceLevel));
+        std::memmove(&quantities_[i + 1], &quantities_[i], moved * sizeof(uint64_t));
+        prices_[i] = price;
+        levels_[i] = PriceLevel{display_price, total_quantity};
+        quantities_[i] = total_quantity;
+        if (count_ < kCapacity) ++count_;
+        return true;
+    }
+
+    // A level was removed; remaining is the side's level count afterwards
+    template <Side S>
+    bool erase(Ticks price, size_t remaining) {
+        if (dirty_) return true;
+        size_t i = 0;
+        while (i < count_ && prices_[i] != price) {
+            if (SideTraits<S>::better(price, prices_[i])) return false;
+            ++i;
+        }
+        if (i == count_) return false;
+
+        if (remaining >= count_) {
+            // A deeper level must move up; defer that to the next reader
+            dirty_ = true;
+            return true;
+        }
+        const size_t moved = count_ - i - 1;
+        std::memmove(&prices_[i], &prices_[i + 1], moved * sizeof(Ticks));
+        std::memmove(&levels_[i], &levels_[i + 1], moved * sizeof(PriceLevel));
+        std::memmove(&quantities_[i], &quantities_[i + 1], moved * sizeof(uint64_t));
+        --count_;
+        return true;
+    }
+
+    // Refill from the side's level map (best first)
+    template <typename Levels>
+    void rebuild(const Levels& levels, const TickScale& ticks) {
+        count_ = 0;
+        for (auto it = levels.begin(); it != levels.end() && count_ < kCapacity; ++it) {
+            prices_[count_] = it->first;
+            levels_[count_] = PriceLevel{ticks.to_price(it->first), it->second.total_quantity};
+            quantities_[count_] = it->second.total_quantity;
+            ++count_;
+        }
+        dirty_ = false;
+    }
+
+    void mark_dirty() { dirty_ = true; }
+
+private:
+    bool dirty_ = false;
+    size_t count_ = 0;
+    Ticks prices_[kCapacity]{};
+    uint64_t quantities_[kCapacity]{};
+    PriceLevel levels_[kCapacity]{};
+};
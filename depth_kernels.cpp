@@ -0,0 +1,235 @@
+#include "depth_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DEPTH_KERNELS_X86 1
+#include <immintrin.h>
+// GCC 12 flags the deliberately undefined pass-through operand inside its own
+// AVX-512 reduce/alignr helpers
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace {
+
+// Scalar reference: branch-free so it also auto-vectorises where it can
+
+uint64_t sum_within_scalar(const Ticks* prices, const uint64_t* quantities, size_t count, Ticks bound,
+                           bool descending) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        const bool inside = descending ? prices[i] >= bound : prices[i] <= bound;
+        total += inside ? quantities[i] : 0;
+    }
+    return total;
+}
+
+void prefix_sum_scalar(const uint64_t* quantities, size_t count, uint64_t* out) {
+    uint64_t running = 0;
+    for (size_t i = 0; i < count; i++) {
+        running += quantities[i];
+        out[i] = running;
+    }
+}
+
+size_t count_below_scalar(const uint64_t* cumulative, size_t count, uint64_t target) {
+    size_t below = 0;
+    for (size_t i = 0; i < count; i++) below += cumulative[i] < target;
+    return below;
+}
+
+double notional_scalar(const Ticks* prices, const uint64_t* quantities, size_t count) {
+    double total = 0.0;
+    for (size_t i = 0; i < count; i++) total += static_cast<double>(prices[i]) * static_cast<double>(quantities[i]);
+    return total;
+}
+
+constexpr DepthKernels kScalar{sum_within_scalar, prefix_sum_scalar, count_below_scalar, notional_scalar};
+
+#ifdef DEPTH_KERNELS_X86
+
+// AVX2: four 64-bit lanes, scalar tails
+
+__attribute__((target("avx2"))) uint64_t sum_within_avx2(const Ticks* prices, const uint64_t* quantities,
+                                                         size_t count, Ticks bound, bool descending) {
+    const __m256i limit = _mm256_set1_epi64x(bound);
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i price = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prices + i));
+        const __m256i quantity = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(quantities + i));
+        // Lanes strictly worse than the bound contribute nothing
+        const __m256i outside = descending ? _mm256_cmpgt_epi64(limit, price) : _mm256_cmpgt_epi64(price, limit);
+        acc = _mm256_add_epi64(acc, _mm256_andnot_si256(outside, quantity));
+    }
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+           sum_within_scalar(prices + i, quantities + i, count - i, bound, descending);
+}
+
+__attribute__((target("avx2"))) void prefix_sum_avx2(const uint64_t* quantities, size_t count, uint64_t* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i carry = zero;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(quantities + i));
+        // In-register scan: add the vector shifted up one lane, then two
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03));
+        x = _mm256_add_epi64(x, _mm256_permute2x128_si256(x, x, 0x08));
+        x = _mm256_add_epi64(x, carry);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), x);
+        carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    uint64_t running = i ? out[i - 1] : 0;
+    for (; i < count; i++) {
+        running += quantities[i];
+        out[i] = running;
+    }
+}
+
+__attribute__((target("avx2"))) size_t count_below_avx2(const uint64_t* cumulative, size_t count,
+                                                        uint64_t target) {
+    // Signed compare is fine: cumulative quantities stay below 2^63
+    const __m256i limit = _mm256_set1_epi64x(static_cast<long long>(target));
+    size_t below = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cumulative + i));
+        const int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(limit, value)));
+        below += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(mask)));
+    }
+    return below + count_below_scalar(cumulative + i, count - i, target);
+}
+
+// int64 -> double for |x| < 2^51 without AVX-512DQ: add the bits of 1.5 * 2^52
+// and subtract it back as a double
+__attribute__((target("avx2"))) inline __m256d to_double_avx2(__m256i x) {
+    const __m256d magic = _mm256_set1_pd(6755399441055744.0);
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(x, _mm256_castpd_si256(magic))), magic);
+}
+
+__attribute__((target("avx2"))) double notional_avx2(const Ticks* prices, const uint64_t* quantities,
+                                                     size_t count) {
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d price = to_double_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(prices + i)));
+        const __m256d quantity =
+            to_double_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(quantities + i)));
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(price, quantity));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + notional_scalar(prices + i, quantities + i, count - i);
+}
+
+constexpr DepthKernels kAvx2{sum_within_avx2, prefix_sum_avx2, count_below_avx2, notional_avx2};
+
+// AVX-512: eight lanes, tails through masked loads instead of scalar loops
+
+inline __mmask8 tail_mask(size_t remaining) {
+    return remaining >= 8 ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1u << remaining) - 1);
+}
+
+__attribute__((target("avx512f,avx512dq"))) uint64_t sum_within_avx512(const Ticks* prices,
+                                                                       const uint64_t* quantities, size_t count,
+                                                                       Ticks bound, bool descending) {
+    const __m512i limit = _mm512_set1_epi64(bound);
+    __m512i acc = _mm512_setzero_si512();
+    for (size_t i = 0; i < count; i += 8) {
+        const __mmask8 valid = tail_mask(count - i);
+        const __m512i price = _mm512_maskz_loadu_epi64(valid, prices + i);
+        const __m512i quantity = _mm512_maskz_loadu_epi64(valid, quantities + i);
+        const __mmask8 inside = descending ? _mm512_mask_cmpge_epi64_mask(valid, price, limit)
+                                           : _mm512_mask_cmple_epi64_mask(valid, price, limit);
+        acc = _mm512_mask_add_epi64(acc, inside, acc, quantity);
+    }
+    return static_cast<uint64_t>(_mm512_reduce_add_epi64(acc));
+}
+
+__attribute__((target("avx512f,avx512dq"))) void prefix_sum_avx512(const uint64_t* quantities, size_t count,
+                                                                   uint64_t* out) {
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i carry = zero;
+    for (size_t i = 0; i < count; i += 8) {
+        const __mmask8 valid = tail_mask(count - i);
+        __m512i x = _mm512_maskz_loadu_epi64(valid, quantities + i);
+        // Shift up by 1, 2 and 4 lanes, filling with zero
+        x = _mm512_add_epi64(x, _mm512_alignr_epi64(x, zero, 7));
+        x = _mm512_add_epi64(x, _mm512_alignr_epi64(x, zero, 6));
+        x = _mm512_add_epi64(x, _mm512_alignr_epi64(x, zero, 4));
+        x = _mm512_add_epi64(x, carry);
+        _mm512_mask_storeu_epi64(out + i, valid, x);
+        carry = _mm512_permutexvar_epi64(_mm512_set1_epi64(7), x);
+    }
+}
+
+__attribute__((target("avx512f,avx512dq"))) size_t count_below_avx512(const uint64_t* cumulative, size_t count,
+                                                                      uint64_t target) {
+    const __m512i limit = _mm512_set1_epi64(static_cast<long long>(target));
+    size_t below = 0;
+    for (size_t i = 0; i < count; i += 8) {
+        const __mmask8 valid = tail_mask(count - i);
+        const __m512i value = _mm512_maskz_loadu_epi64(valid, cumulative + i);
+        below += static_cast<size_t>(__builtin_popcount(_mm512_mask_cmplt_epu64_mask(valid, value, limit)));
+    }
+    return below;
+}
+
+__attribute__((target("avx512f,avx512dq"))) double notional_avx512(const Ticks* prices,
+                                                                   const uint64_t* quantities, size_t count) {
+    __m512d acc = _mm512_setzero_pd();
+    for (size_t i = 0; i < count; i += 8) {
+        const __mmask8 valid = tail_mask(count - i);
+        const __m512d price = _mm512_cvtepi64_pd(_mm512_maskz_loadu_epi64(valid, prices + i));
+        const __m512d quantity = _mm512_cvtepu64_pd(_mm512_maskz_loadu_epi64(valid, quantities + i));
+        acc = _mm512_fmadd_pd(price, quantity, acc);
+    }
+    return _mm512_reduce_add_pd(acc);
+}
+
+constexpr DepthKernels kAvx512{sum_within_avx512, prefix_sum_avx512, count_below_avx512, notional_avx512};
+
+#endif // DEPTH_KERNELS_X86
+
+SimdLevel detect_level() {
+#ifdef DEPTH_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) return SimdLevel::Avx512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+} // namespace
+
+SimdLevel depth_simd_level() {
+    static const SimdLevel level = detect_level();
+    return level;
+}
+
+const DepthKernels& depth_kernels() {
+    static const DepthKernels& kernels = depth_kernels(depth_simd_level());
+    return kernels;
+}
+
+const DepthKernels& depth_kernels(SimdLevel level) {
+    if (level > depth_simd_level()) level = depth_simd_level();
+#ifdef DEPTH_KERNELS_X86
+    switch (level) {
+    case SimdLevel::Avx512: return kAvx512;
+    case SimdLevel::Avx2:   return kAvx2;
+    case SimdLevel::Scalar: break;
+    }
+#endif
+    return kScalar;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Avx512: return "avx512";
+    case SimdLevel::Avx2:   return "avx2";
+    case SimdLevel::Scalar: break;
+    }
+    return "scalar";
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "price.h"
+
+// Vector kernels over one side's top levels, laid out as parallel arrays
+// (prices in ticks, quantities) best first, as DepthCache keeps them. Each
+// instruction set fills the same table; depth_kernels() picks the widest
+// one the CPU supports the first time it is called. Quantities and tick
+// prices are assumed below 2^51, so the AVX2 int64 -> double conversion is
+// exact.
+
+enum class SimdLevel : uint8_t { Scalar, Avx2, Avx512 };
+
+struct DepthKernels {
+    // Sum of quantities[i] over levels no worse than bound: prices[i] >= bound
+    // when descending (bids), prices[i] <= bound otherwise
+    uint64_t (*sum_within)(const Ticks* prices, const uint64_t* quantities, size_t count, Ticks bound,
+                           bool descending);
+
+    // out[i] = quantities[0] + ... + quantities[i]
+    void (*prefix_sum)(const uint64_t* quantities, size_t count, uint64_t* out);
+
+    // Number of leading entries of a non-decreasing cumulative array that are
+    // below target, i.e. the index of the level that reaches it
+    size_t (*count_below)(const uint64_t* cumulative, size_t count, uint64_t target);
+
+    // Sum of prices[i] * quantities[i], in ticks x quantity
+    double (*notional)(const Ticks* prices, const uint64_t* quantities, size_t count);
+};
+
+// Widest level this CPU runs (AVX-512 needs F and DQ)
+SimdLevel depth_simd_level();
+
+// Kernels for the best supported level
+const DepthKernels& depth_kernels();
+
+// Kernels for a specific level; falls back to narrower ones the CPU or
+// compiler lacks. Used by tests and benchmarks to compare implementations.
+const DepthKernels& depth_kernels(SimdLevel level);
+
+const char* simd_level_name(SimdLevel level);
@@ -0,0 +1,101 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "order_book.h"
+
+// One book's top levels as of one publish
+template <size_t Depth>
+struct TopOfBook {
+    uint64_t depth_sequence = 0; // OrderBook::depth_sequence() when taken
+    uint64_t bid_count = 0;      // Valid entries in bids / asks
+    uint64_t ask_count = 0;
+    std::array<PriceLevel, Depth> bids{};
+    std::array<PriceLevel, Depth> asks{};
+};
+
+// Single-writer seqlock over the top Depth levels of one book. The book
+// thread publishes; any number of reader threads (strategy, risk, UI) copy
+// out a consistent TopOfBook without locks, and the writer never waits for
+// them: a reader that overlaps a publish just retries.
+//
+// The image is held as relaxed atomic words, so a reader racing a publish
+// sees torn data only until the sequence check throws it away, and the
+// overlap is not a data race.
+template <size_t Depth = 10>
+class DepthPublisher {
+public:
+    using View = TopOfBook<Depth>;
+
+    DepthPublisher() {
+        for (auto& word : words_) word.store(0, std::memory_order_relaxed);
+    }
+
+    DepthPublisher(const DepthPublisher&) = delete;
+    DepthPublisher& operator=(const DepthPublisher&) = delete;
+
+    // Writer: publish book's top levels if they changed since the last
+    // publish; otherwise one compare. @return whether a version went out
+    bool publish(const OrderBook& book) {
+        const uint64_t depth_sequence = book.depth_sequence();
+        if (depth_sequence == published_sequence_ && version_ != 0) return false;
+        const SnapshotDepth depth = book.get_snapshot(staging_.bids, staging_.asks);
+        staging_.depth_sequence = depth_sequence;
+        staging_.bid_count = depth.bids;
+        staging_.ask_count = depth.asks;
+        publish(staging_);
+        return true;
+    }
+
+    // Writer: publish a view taken elsewhere
+    void publish(const View& view) {
+        uint64_t image[kWords];
+        std::memcpy(image, &view, sizeof(View));
+
+        const uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed); // Odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) words_[i].store(image[i], std::memory_order_relaxed);
+        sequence_.store(sequence + 2, std::memory_order_release);
+
+        published_sequence_ = view.depth_sequence;
+        version_++;
+    }
+
+    // Reader: one attempt; false if a publish was in progress meanwhile
+    bool try_read(View& out) const {
+        const uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+        uint64_t image[kWords];
+        for (size_t i = 0; i < kWords; i++) image[i] = words_[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != before) return false;
+        std::memcpy(&out, image, sizeof(View));
+        return true;
+    }
+
+    // Reader: the latest consistent view, retrying while publishes overlap
+    void read(View& out) const {
+        while (!try_read(out)) __builtin_ia32_pause();
+    }
+
+    // Publishes so far, readable from any thread; poll it to skip copying
+    // when nothing changed
+    uint64_t version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static_assert(std::is_trivially_copyable<View>::value && sizeof(View) % sizeof(uint64_t) == 0,
+                  "the view is copied as whole words");
+    static constexpr size_t kWords = sizeof(View) / sizeof(uint64_t);
+
+    // Readers poll the sequence; keep it off the lines the writer fills
+    alignas(64) std::atomic<uint64_t> sequence_{0};
+    alignas(64) std::atomic<uint64_t> words_[kWords];
+
+    // Writer only
+    alignas(64) View staging_;
+    uint64_t published_sequence_ = 0;
+    uint64_t version_ = 0;
+};
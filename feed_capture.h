@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "feed_protocol.h"
+
+// Read-only view of a feed capture: feed_protocol.h packets back to back,
+// exactly as they arrived on the wire (feed_generator.py's file mode writes
+// one). The file is mmap'd, so walking it is pointer arithmetic over the
+// page cache with no read() copies.
+class FeedCapture {
+public:
+    FeedCapture() = default;
+    ~FeedCapture() { close(); }
+
+    FeedCapture(const FeedCapture&) = delete;
+    FeedCapture& operator=(const FeedCapture&) = delete;
+
+    // Map the whole file; populate = fault every page in now, so a replay
+    // does not measure page faults
+    // @return false if the file cannot be opened or mapped
+    bool open(const std::string& path, bool populate = true) {
+        close();
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+        ::close(fd); // The mapping keeps the file alive
+        if (map == MAP_FAILED) {
+            size_ = 0;
+            return false;
+        }
+        ::madvise(map, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(map);
+        return true;
+    }
+
+    void close() {
+        if (data_ != nullptr) ::munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool is_open() const { return data_ != nullptr; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // Call fn(const PacketView&) for each packet in file order, stopping at
+    // the first one that fails validate_feed_packet (e.g. a torn tail)
+    // @return bytes of valid packets walked; size() if the whole file is good
+    template <typename Fn>
+    size_t for_each_packet(Fn&& fn) const {
+        size_t offset = 0;
+        while (size_ - offset >= sizeof(wire::PacketHeader)) {
+            const PacketView packet(data_ + offset);
+            const size_t length = packet.length();
+            if (length > size_ - offset || !validate_feed_packet(data_ + offset, length)) break;
+            fn(packet);
+            offset += length;
+        }
+        return offset;
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
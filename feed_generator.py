@@ -0,0 +1,227 @@
+# feed_generator.py
+# Synthetic order feed in the feed_protocol.h wire format (version 1), for
+# load-testing FeedHandler. Orders rest around a drifting mid price; some are
+# amended or cancelled, and fills are reported as a trade plus the maker's
+# amend or cancel, the same way real feeds report them.
+#
+#   python3 feed_generator.py udp 239.1.1.1 5555 --rate 100000
+#   python3 feed_generator.py tcp 0.0.0.0 5555          (serve one client)
+#   python3 feed_generator.py file capture.bin --messages 1000000
+import argparse
+import random
+import socket
+import struct
+import time
+
+VERSION = 1
+PRICE_SCALE = 100_000_000
+MAX_PACKET = 1472
+
+PACKET_HEADER = struct.Struct('<HBBIQ')     # length, version, message_count, session, sequence
+ADD_ORDER = struct.Struct('<HcQQqIB')       # 32 B
+CANCEL_ORDER = struct.Struct('<HcQQ')       # 19 B
+AMEND_ORDER = struct.Struct('<HcQQqI')      # 31 B
+TRADE = struct.Struct('<HcQQqIB')           # 32 B
+HEARTBEAT = struct.Struct('<HcQ')           # 11 B
+
+assert PACKET_HEADER.size == 16 and ADD_ORDER.size == 32 and CANCEL_ORDER.size == 19
+assert AMEND_ORDER.size == 31 and TRADE.size == 32 and HEARTBEAT.size == 11
+
+
+def fixed(price):
+    return round(price * PRICE_SCALE)
+
+
+class PacketBuilder:
+    """Packs messages into packets; sequence numbers one per message"""
+
+    def __init__(self, session, sequence=1):
+        self.session = session
+        self.sequence = sequence
+        self.messages = []
+        self.size = PACKET_HEADER.size
+
+    def add(self, message):
+        if self.size + len(message) > MAX_PACKET or len(self.messages) == 255:
+            return False
+        self.messages.append(message)
+        self.size += len(message)
+        return True
+
+    def finish(self):
+        header = PACKET_HEADER.pack(self.size, VERSION, len(self.messages), self.session, self.sequence)
+        packet = header + b''.join(self.messages)
+        self.sequence += len(self.messages)
+        self.messages = []
+        self.size = PACKET_HEADER.size
+        return packet
+
+    def heartbeat(self):
+        # Alone in its packet, carrying the next sequence without consuming it
+        message = HEARTBEAT.pack(HEARTBEAT.size, b'H', time.time_ns())
+        return PACKET_HEADER.pack(PACKET_HEADER.size + len(message), VERSION, 1, self.session,
+                                  self.sequence) + message
+
+
+class OrderFlow:
+    """Random walk mid price with resting orders up to `depth` ticks either side.
+
+    Event weights follow production shapes: cancels dominate after adds, and
+    most of them hit recently placed orders near the touch (`skew`), while
+    the deep book churns slowly.
+    """
+
+    def __init__(self, seed, cancel_ratio=0.35, amend_ratio=0.1, trade_ratio=0.05, depth=20, skew=0.8,
+                 min_orders=100, mid=100.0, tick=0.01):
+        self.random = random.Random(seed)
+        self.cancel_ratio = cancel_ratio
+        self.amend_ratio = amend_ratio
+        self.trade_ratio = trade_ratio
+        self.depth = depth
+        self.skew = skew
+        self.min_orders = min_orders
+        self.mid = mid
+        self.tick = tick
+        self.next_id = 1
+        self.live = {}   # order id -> [is_buy, price, quantity]
+        self.ids = []    # live ids, oldest first, for O(1) random picks
+        self.index = {}  # order id -> position in ids
+
+    def _remember(self, order_id, order):
+        self.live[order_id] = order
+        self.index[order_id] = len(self.ids)
+        self.ids.append(order_id)
+
+    def _forget(self, order_id):
+        del self.live[order_id]
+        position = self.index.pop(order_id)
+        last = self.ids.pop()
+        if last != order_id:
+            self.ids[position] = last
+            self.index[last] = position
+
+    def _pick(self):
+        # Recent orders (the newest 10%) take `skew` of the cancels and amends
+        if self.random.random() < self.skew:
+            recent = max(1, len(self.ids) // 10)
+            return self.ids[-self.random.randint(1, recent)]
+        return self.ids[self.random.randrange(len(self.ids))]
+
+    def next_messages(self):
+        now = time.time_ns()
+        dice = self.random.random()
+        self.mid += self.random.choice((-1, 0, 0, 1)) * self.tick
+
+        if len(self.live) < self.min_orders or dice >= self.cancel_ratio + self.amend_ratio + self.trade_ratio:
+            is_buy = self.random.random() < 0.5
+            # Geometric-ish distance from the mid: most orders near the touch
+            ticks = min(self.depth, 1 + int(self.random.expovariate(4.0 / self.depth)))
+            price = round(self.mid - ticks * self.tick if is_buy else self.mid + ticks * self.tick, 2)
+            quantity = self.random.choice((100, 100, 200, 500, 1000))
+            order_id = self.next_id
+            self.next_id += 1
+            self._remember(order_id, [is_buy, price, quantity])
+            return [ADD_ORDER.pack(ADD_ORDER.size, b'A', now, order_id, fixed(price), quantity, int(is_buy))]
+
+        order_id = self._pick()
+        is_buy, price, quantity = self.live[order_id]
+        if dice < self.cancel_ratio:
+            self._forget(order_id)
+            return [CANCEL_ORDER.pack(CANCEL_ORDER.size, b'X', now, order_id)]
+        if dice < self.cancel_ratio + self.amend_ratio:
+            quantity = max(1, quantity + self.random.choice((-100, 100)))
+            self.live[order_id][2] = quantity
+            return [AMEND_ORDER.pack(AMEND_ORDER.size, b'U', now, order_id, fixed(price), quantity)]
+
+        # A fill against the resting order: the trade, then its book change
+        filled = min(quantity, self.random.choice((100, 200, 500)))
+        messages = [TRADE.pack(TRADE.size, b'T', now, order_id, fixed(price), filled, int(not is_buy))]
+        if filled == quantity:
+            self._forget(order_id)
+            messages.append(CANCEL_ORDER.pack(CANCEL_ORDER.size, b'X', now, order_id))
+        else:
+            self.live[order_id][2] = quantity - filled
+            messages.append(AMEND_ORDER.pack(AMEND_ORDER.size, b'U', now, order_id, fixed(price),
+                                             quantity - filled))
+        return messages
+
+
+def packets(args):
+    """Yield packets of up to --batch messages, with a heartbeat every second"""
+    flow = OrderFlow(args.seed, cancel_ratio=args.cancel_ratio, depth=args.depth, skew=args.skew,
+                     min_orders=args.min_orders)
+    builder = PacketBuilder(args.session)
+    sent = 0
+    last_heartbeat = time.monotonic()
+    while args.messages == 0 or sent < args.messages:
+        for message in flow.next_messages():
+            if len(builder.messages) >= args.batch or not builder.add(message):
+                yield builder.finish()
+                builder.add(message)
+            sent += 1
+        if time.monotonic() - last_heartbeat >= 1.0:
+            if builder.messages:
+                yield builder.finish()
+            yield builder.heartbeat()
+            last_heartbeat = time.monotonic()
+    if builder.messages:
+        yield builder.finish()
+
+
+def paced(stream, rate):
+    """Hold packets back so messages leave at roughly `rate` per second"""
+    start = time.monotonic()
+    sent = 0
+    for packet in stream:
+        yield packet
+        sent += packet[3]  # message_count
+        if rate > 0:
+            delay = start + sent / rate - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('mode', choices=('udp', 'tcp', 'file'))
+    parser.add_argument('target', help='UDP destination, TCP bind address, or capture path')
+    parser.add_argument('port', type=int, nargs='?', default=5555)
+    parser.add_argument('--messages', type=int, default=0, help='stop after N messages (0 = forever)')
+    parser.add_argument('--rate', type=int, default=0, help='messages per second (0 = unpaced)')
+    parser.add_argument('--batch', type=int, default=16, help='messages per packet')
+    parser.add_argument('--session', type=int, default=1)
+    parser.add_argument('--seed', type=int, default=2027)
+    parser.add_argument('--cancel-ratio', type=float, default=0.35, help='share of events that are cancels')
+    parser.add_argument('--depth', type=int, default=20, help='ticks either side of the mid orders rest at')
+    parser.add_argument('--skew', type=float, default=0.8, help='share of cancels/amends hitting recent orders')
+    parser.add_argument('--min-orders', type=int, default=100, help='resting orders kept at least')
+    args = parser.parse_args()
+
+    stream = paced(packets(args), args.rate)
+    if args.mode == 'file':
+        with open(args.target, 'wb') as capture:
+            for packet in stream:
+                capture.write(packet)
+    elif args.mode == 'udp':
+        with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+            s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+            for packet in stream:
+                s.sendto(packet, (args.target, args.port))
+    else:
+        with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
+            s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            s.bind((args.target, args.port))
+            s.listen()
+            print(f"Feed generator serving on {args.target}:{args.port}")
+            conn, addr = s.accept()
+            with conn:
+                print(f"Connected by {addr}")
+                try:
+                    for packet in stream:
+                        conn.sendall(packet)
+                except (ConnectionResetError, BrokenPipeError):
+                    print("Client disconnected")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,258 @@
+#include "feed_handler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Room for every message of the fullest packet
+constexpr size_t kMaxOpsPerFlush = kMaxFeedMessages;
+
+// Sequence numbers a packet consumes: heartbeats carry the next one
+uint64_t sequenced_messages(const PacketView& packet) {
+    if (packet.message_count() == 1 && MessageView(packet.messages()).type() == FeedMessageType::Heartbeat) {
+        return 0;
+    }
+    return packet.message_count();
+}
+
+} // namespace
+
+FeedHandler::FeedHandler(OrderBook& book, const FeedHandlerConfig& config)
+    : book_(book), config_(config), buffers_(config.batch), ops_(kMaxOpsPerFlush) {
+    if (config_.transport == FeedTransport::Tcp) {
+        stream_.resize(std::max(config_.stream_buffer, kMaxFeedPacketSize));
+    }
+}
+
+FeedHandler::~FeedHandler() {
+    close();
+    if (recovery_thread_.joinable()) recovery_thread_.join();
+}
+
+bool FeedHandler::open() {
+    close();
+    receiver_ = make_feed_receiver(config_);
+    stream_size_ = 0;
+    if (receiver_ == nullptr || !receiver_->open()) {
+        receiver_.reset();
+        return false;
+    }
+    return true;
+}
+
+void FeedHandler::close() {
+    receiver_.reset();
+}
+
+size_t FeedHandler::poll() {
+    if (recovering_ && recovery_done_.load(std::memory_order_acquire)) {
+        finish_recovery();
+    }
+    if (!is_open()) return 0;
+    const int received = receiver_->receive(buffers_.data(), buffers_.size());
+    if (received < 0) {
+        close(); // Peer closed the stream
+        return 0;
+    }
+
+    for (int i = 0; i < received; i++) {
+        if (config_.transport == FeedTransport::Udp) {
+            on_packet(buffers_[i].data, buffers_[i].size);
+        } else {
+            const uint64_t start = now_ns();
+            stats_.packets++;
+            on_stream(buffers_[i].data, buffers_[i].size);
+            decode_latency_.record(now_ns() - start);
+        }
+    }
+    return static_cast<size_t>(received);
+}
+
+size_t FeedHandler::on_packet(const char* data, size_t size) {
+    const uint64_t start = now_ns();
+    stats_.packets++;
+    stats_.bytes += size;
+    const size_t applied = process_packet(data, size);
+    decode_latency_.record(now_ns() - start);
+    return applied;
+}
+
+size_t FeedHandler::process_packet(const char* data, size_t size) {
+    if (!validate_feed_packet(data, size)) {
+        stats_.malformed++;
+        return 0;
+    }
+    const PacketView packet(data);
+    stats_.messages += packet.message_count();
+    if (recovering_ && recovery_done_.load(std::memory_order_acquire)) {
+        finish_recovery();
+    }
+
+    const uint64_t count = sequenced_messages(packet);
+    if (!sequenced_) {
+        sequenced_ = true;
+        session_ = packet.session();
+        expected_sequence_ = packet.sequence();
+    }
+    if (recovering_) {
+        buffer_packet(data, size);
+        return 0;
+    }
+    if (packet.session() != session_ || packet.sequence() > expected_sequence_) {
+        stats_.gaps++;
+        stale_ = true;
+        session_ = packet.session();
+        if (snapshot_source_) {
+            start_recovery();
+            buffer_packet(data, size);
+            return 0;
+        }
+        expected_sequence_ = packet.sequence(); // Nothing to recover from: carry on, stale
+    } else if (packet.sequence() + count <= expected_sequence_) {
+        if (count > 0) stats_.duplicates++;
+        return 0;
+    }
+
+    // Skip the front of a packet that overlaps what was already applied
+    const size_t skip = static_cast<size_t>(expected_sequence_ - packet.sequence());
+    expected_sequence_ = packet.sequence() + count;
+    return apply_packet(book_, packet, skip);
+}
+
+size_t FeedHandler::apply_packet(OrderBook& book, const PacketView& packet, size_t skip) {
+    // Decode in place; trades and heartbeats carry no book change
+    const char* message = packet.messages();
+    size_t count = 0;
+    for (size_t i = 0; i < packet.message_count(); i++) {
+        const MessageView view(message);
+        if (i >= skip) count += decode_feed_message(view, ops_[count]);
+        message += view.length();
+    }
+    return count == 0 ? 0 : book.apply_batch(ops_.data(), count);
+}
+
+void FeedHandler::start_recovery() {
+    recovering_ = true;
+    if (recovery_packets_.empty()) {
+        recovery_packets_.resize(config_.recovery_buffer * kMaxFeedPacketSize);
+        recovery_sizes_.resize(config_.recovery_buffer);
+    }
+    recovery_done_.store(false, std::memory_order_relaxed);
+    // The staging book is filled on the recovery thread, so it must not
+    // draw on the live book's arena: its level maps (and the live book's,
+    // once it is swapped in) come from the heap
+    OrderBookConfig config = book_.config();
+    config.arena = nullptr;
+    recovery_thread_ = std::thread([this, config] {
+        FeedSnapshot snapshot;
+        std::unique_ptr<OrderBook> rebuilt;
+        if (snapshot_source_(snapshot)) {
+            rebuilt = std::make_unique<OrderBook>(config);
+            for (const Order& order : snapshot.orders) rebuilt->add_order(order);
+        }
+        staging_ = std::move(rebuilt);
+        snapshot_sequence_ = snapshot.sequence;
+        recovery_done_.store(true, std::memory_order_release);
+    });
+}
+
+void FeedHandler::buffer_packet(const char* data, size_t size) {
+    if (recovery_count_ == recovery_sizes_.size()) {
+        // Full: the oldest packet goes; finish_recovery notices the hole if
+        // the snapshot does not cover it
+        recovery_head_ = (recovery_head_ + 1) % recovery_sizes_.size();
+        recovery_count_--;
+        stats_.overflowed++;
+    }
+    const size_t slot = (recovery_head_ + recovery_count_) % recovery_sizes_.size();
+    std::memcpy(&recovery_packets_[slot * kMaxFeedPacketSize], data, size);
+    recovery_sizes_[slot] = static_cast<uint16_t>(size);
+    recovery_count_++;
+}
+
+void FeedHandler::finish_recovery() {
+    recovery_thread_.join();
+    if (staging_ == nullptr) {
+        start_recovery(); // Fetch failed: try again, still buffering
+        return;
+    }
+
+    // Replay what arrived after the snapshot onto the rebuilt book
+    uint64_t next = snapshot_sequence_ + 1;
+    while (recovery_count_ > 0) {
+        const PacketView packet(&recovery_packets_[recovery_head_ * kMaxFeedPacketSize]);
+        const uint64_t count = sequenced_messages(packet);
+        if (packet.session() == session_ && packet.sequence() > next) {
+            // Messages between the snapshot and the buffer were lost too:
+            // keep the rest buffered and fetch a newer snapshot
+            staging_.reset();
+            start_recovery();
+            return;
+        }
+        if (packet.session() == session_ && packet.sequence() + count > next) {
+            apply_packet(*staging_, packet, static_cast<size_t>(next - packet.sequence()));
+            next = packet.sequence() + count;
+        }
+        recovery_head_ = (recovery_head_ + 1) % recovery_sizes_.size();
+        recovery_count_--;
+    }
+
+    book_.replace_contents(std::move(*staging_));
+    staging_.reset();
+    expected_sequence_ = next;
+    recovery_head_ = 0;
+    recovering_ = false;
+    stale_ = false;
+    stats_.recoveries++;
+}
+
+size_t FeedHandler::on_stream(const char* data, size_t size) {
+    stats_.bytes += size;
+    size_t applied = 0;
+    if (stream_size_ == 0) {
+        // Nothing buffered: apply whole packets straight from the chunk
+        const size_t consumed = drain(data, size, applied);
+        data += consumed;
+        size -= consumed;
+    }
+    if (size > 0 && stream_.empty()) {
+        stream_.resize(std::max(config_.stream_buffer, kMaxFeedPacketSize));
+    }
+    while (size > 0) {
+        const size_t chunk = std::min(size, stream_.size() - stream_size_);
+        std::memcpy(stream_.data() + stream_size_, data, chunk);
+        stream_size_ += chunk;
+        data += chunk;
+        size -= chunk;
+
+        // Keep the partial tail at the front of the buffer for the next chunk
+        const size_t consumed = drain(stream_.data(), stream_size_, applied);
+        std::memmove(stream_.data(), stream_.data() + consumed, stream_size_ - consumed);
+        stream_size_ -= consumed;
+    }
+    return applied;
+}
+
+size_t FeedHandler::drain(const char* data, size_t size, size_t& applied) {
+    size_t offset = 0;
+    while (size - offset >= sizeof(wire::PacketHeader)) {
+        const size_t length = PacketView(data + offset).length();
+        if (length < sizeof(wire::PacketHeader) || length > kMaxFeedPacketSize) {
+            // No way to find the next packet boundary: drop the bytes
+            stats_.malformed++;
+            return size;
+        }
+        if (length > size - offset) {
+            break; // Wait for the rest of the packet
+        }
+        applied += process_packet(data + offset, length);
+        offset += length;
+    }
+    return offset;
+}
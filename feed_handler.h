@@ -0,0 +1,167 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "feed_protocol.h"
+#include "feed_receiver.h"
+#include "latency_histogram.h"
+#include "order_book.h"
+
+enum class FeedTransport : uint8_t {
+    Udp, // One packet per datagram; multicast group or unicast address
+    Tcp  // Packets on a byte stream, split arbitrarily across reads
+};
+
+struct FeedHandlerConfig {
+    FeedTransport transport = FeedTransport::Udp;
+    FeedBackend backend = FeedBackend::Socket;
+    std::string address = "239.1.1.1"; // UDP: group or local address to bind; TCP: server
+    uint16_t port = 5555;
+    std::string interface = "0.0.0.0"; // Local interface to join a multicast group on
+    size_t batch = 64;                 // Buffers taken per poll()
+    size_t max_packet = kMaxFeedPacketSize; // Largest datagram accepted
+    int busy_poll_us = 50;             // SO_BUSY_POLL budget; 0 = interrupt-driven
+    int receive_buffer = 8 << 20;      // SO_RCVBUF
+    size_t stream_buffer = 1 << 20;    // TCP read size and reassembly buffer
+    size_t ring_buffers = 1024;        // io_uring provided buffers / AF_XDP UMEM frames (power of two)
+    std::string xdp_device;            // NIC the AF_XDP socket binds to, e.g. "eth1"
+    uint32_t xdp_queue = 0;            // Its RX queue; steer the feed there with ethtool -N
+    bool xdp_zero_copy = true;         // Try XDP_ZEROCOPY before falling back to XDP_COPY
+    size_t recovery_buffer = 4096;     // Packets held while a snapshot is fetched; oldest dropped beyond
+};
+
+struct FeedStats {
+    uint64_t packets = 0;   // Datagrams (UDP) or reads (TCP)
+    uint64_t messages = 0;  // Messages in valid packets, book-changing or not
+    uint64_t malformed = 0; // Packets dropped, or TCP streams reset, on bad framing
+    uint64_t bytes = 0;
+    uint64_t gaps = 0;       // Sequence gaps (or session changes) detected
+    uint64_t duplicates = 0; // Packets already applied, dropped
+    uint64_t recoveries = 0; // Snapshots installed
+    uint64_t overflowed = 0; // Packets dropped from a full recovery buffer
+};
+
+// The venue's book as of one feed sequence
+struct FeedSnapshot {
+    uint64_t sequence = 0;     // Last message reflected; deltas resume at sequence + 1
+    std::vector<Order> orders; // Resting orders, in time priority within each level
+};
+
+// Fetches a snapshot (venue TCP request, snapshot multicast group, file...).
+// Runs on the recovery thread and may block; @return false to retry.
+using FeedSnapshotSource = std::function<bool(FeedSnapshot&)>;
+
+// Receives order-feed packets (feed_protocol.h) and applies them to one
+// OrderBook on the calling thread. The receive path is pluggable
+// (feed_receiver.h): each poll() takes up to `batch` buffers from the
+// backend. UDP buffers are whole packets; TCP buffers are stream chunks,
+// reassembled here when a packet straddles two. Each packet is validated,
+// decoded in place into a BookOp array and applied with
+// OrderBook::apply_batch.
+//
+// Packets carry per-message sequence numbers. A gap (or a new session)
+// marks the book stale and starts recovery: live packets are copied into a
+// bounded buffer while a side thread fetches a snapshot from the
+// FeedSnapshotSource and rebuilds a fresh OrderBook from it. The next
+// packet or poll() after that replays the buffered deltas past the
+// snapshot's sequence onto the rebuilt book and swaps it in with
+// OrderBook::replace_contents. The live thread never waits on the
+// snapshot; without a source, gaps are counted and the book stays stale.
+// The rebuilt book never uses the live book's OrderBookConfig::arena, so
+// after a recovery the level maps are on the heap.
+//
+// decode_latency() holds the time from a packet leaving the socket to its
+// operations being applied, in ns.
+class FeedHandler {
+public:
+    FeedHandler(OrderBook& book, const FeedHandlerConfig& config = FeedHandlerConfig{});
+    ~FeedHandler();
+
+    FeedHandler(const FeedHandler&) = delete;
+    FeedHandler& operator=(const FeedHandler&) = delete;
+
+    // Start the configured backend on a bound (UDP) or connected (TCP) socket
+    // @return false if the backend is unavailable or any setup step failed
+    bool open();
+    void close();
+    bool is_open() const { return receiver_ != nullptr && receiver_->is_open(); }
+    int fd() const { return receiver_ != nullptr ? receiver_->fd() : -1; }
+
+    // Drain whatever is ready without blocking
+    // @return number of buffers processed
+    size_t poll();
+
+    // Validate, decode and apply one packet
+    // @return number of operations applied
+    size_t on_packet(const char* data, size_t size);
+
+    // Append bytes from a stream and apply every complete packet
+    // @return number of operations applied; bad framing resets the stream
+    size_t on_stream(const char* data, size_t size);
+
+    // Must be set before the first packet; the source must eventually return
+    void set_snapshot_source(FeedSnapshotSource source) { snapshot_source_ = std::move(source); }
+
+    // The book has missed messages and should not be traded on
+    bool stale() const { return stale_; }
+    bool recovering() const { return recovering_; }
+    // Next message sequence the book expects
+    uint64_t expected_sequence() const { return expected_sequence_; }
+
+    const FeedStats& stats() const { return stats_; }
+    const LatencyHistogram& decode_latency() const { return decode_latency_; }
+
+private:
+    // Sequence-check one validated-length packet and apply, skip or buffer it
+    size_t process_packet(const char* data, size_t size);
+
+    // Decode messages [skip, count) of a valid packet and apply them to book
+    size_t apply_packet(OrderBook& book, const PacketView& packet, size_t skip);
+
+    void start_recovery();
+    void buffer_packet(const char* data, size_t size);
+    // Called on the live thread once the recovery thread is done
+    void finish_recovery();
+
+    // Apply every complete packet at the front of [data, data + size)
+    // @return bytes consumed; all of them if the framing is bad
+    size_t drain(const char* data, size_t size, size_t& applied);
+
+    OrderBook& book_;
+    FeedHandlerConfig config_;
+    std::unique_ptr<FeedReceiver> receiver_;
+    std::vector<FeedBuffer> buffers_;
+
+    // TCP reassembly buffer, holding a packet that straddles two chunks
+    std::vector<char> stream_;
+    size_t stream_size_ = 0;
+
+    std::vector<BookOp> ops_;
+
+    // Sequencing
+    bool sequenced_ = false; // Session and sequence adopted from the first packet
+    uint32_t session_ = 0;
+    uint64_t expected_sequence_ = 0;
+    bool stale_ = false;
+
+    // Recovery: the live thread owns the buffer; the recovery thread fills
+    // staging_ and the snapshot fields, then sets recovery_done_
+    FeedSnapshotSource snapshot_source_;
+    bool recovering_ = false;
+    std::vector<char> recovery_packets_; // recovery_buffer slots of kMaxFeedPacketSize
+    std::vector<uint16_t> recovery_sizes_;
+    size_t recovery_head_ = 0;
+    size_t recovery_count_ = 0;
+    std::thread recovery_thread_;
+    std::atomic<bool> recovery_done_{false};
+    std::unique_ptr<OrderBook> staging_; // nullptr if the fetch failed
+    uint64_t snapshot_sequence_ = 0;
+
+    FeedStats stats_;
+    LatencyHistogram decode_latency_;
+};
@@ -0,0 +1,364 @@
+#include "feed_receiver.h"
+#include "feed_handler.h"
+
+#if __has_include(<linux/io_uring.h>)
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// Ring sizes are fixed by the kernel ABI, so the raw syscalls are all
+// liburing would add here
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+template <typename T>
+T load_acquire(const T* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+void store_release(T* p, T value) {
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+constexpr uint64_t kRecvTag = 1;
+constexpr uint64_t kProbeTag = 2;
+constexpr uint64_t kProvideTag = 3;
+constexpr unsigned kSqEntries = 64;
+constexpr uint16_t kBufferGroup = 0;
+constexpr size_t kTcpBufferSize = 64 << 10;
+
+// One multishot IORING_OP_RECV stays armed on the feed socket. Each arrival
+// lands in a buffer the kernel picks from a provided-buffer ring and posts
+// one CQE naming it, so the data path is a shared-memory read: no syscall
+// per packet or per batch, only to re-arm when the kernel drops the
+// request (out of buffers, or an error).
+class IoUringReceiver final : public FeedReceiver {
+public:
+    explicit IoUringReceiver(const FeedHandlerConfig& config)
+        : config_(config),
+          buffer_size_(config.transport == FeedTransport::Udp ? config.max_packet : kTcpBufferSize),
+          buffer_count_(config.ring_buffers) {}
+
+    ~IoUringReceiver() override { close(); }
+
+    bool open() override {
+        close();
+        // Provided-buffer rings index with a 16-bit id
+        if (buffer_count_ == 0 || (buffer_count_ & (buffer_count_ - 1)) != 0 || buffer_count_ > 32768) {
+            return false;
+        }
+        fd_ = open_feed_socket(config_);
+        if (fd_ < 0 || !setup_ring() || !setup_buffers() || !arm()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() override {
+        if (ring_fd_ >= 0) {
+            ::close(ring_fd_);
+            ring_fd_ = -1;
+        }
+        unmap(sq_ring_, sq_ring_size_);
+        unmap(cq_ring_, cq_ring_size_);
+        unmap(sqes_, sqes_size_);
+        unmap(buf_ring_, buf_ring_size_);
+        unmap(buffers_, buffers_size_);
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        held_count_ = 0;
+        pending_ = 0;
+        closed_ = false;
+    }
+
+    bool is_open() const override { return fd_ >= 0 && ring_fd_ >= 0; }
+    int fd() const override { return fd_; }
+
+    int receive(FeedBuffer* out, size_t max) override {
+        recycle();
+        if (closed_) return -1;
+
+        unsigned head = *cq_head_; // Only this thread moves the head
+        const unsigned tail = load_acquire(cq_tail_);
+        int count = 0;
+        bool rearm = false;
+        while (head != tail && static_cast<size_t>(count) < max) {
+            const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+            head++;
+            if (cqe.user_data != kRecvTag) {
+                continue; // A failed PROVIDE_BUFFERS; its buffers stay out
+            }
+            if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                rearm = true; // The kernel retired the multishot request
+            }
+            if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                const uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                out[count++] = {buffers_ + static_cast<size_t>(bid) * buffer_size_, static_cast<size_t>(cqe.res)};
+                held_[held_count_++] = bid;
+            } else if (cqe.res == 0 && config_.transport == FeedTransport::Tcp) {
+                closed_ = true; // Orderly shutdown by the peer
+            } else if (cqe.res < 0 && cqe.res != -ENOBUFS && config_.transport == FeedTransport::Tcp) {
+                closed_ = true;
+            }
+        }
+        store_release(cq_head_, head);
+
+        if (closed_) {
+            if (count == 0) return -1;
+        } else if (rearm) {
+            // Buffers go back first so the new request has somewhere to write
+            recycle();
+            arm();
+        }
+        return count;
+    }
+
+private:
+    template <typename T>
+    static void unmap(T*& p, size_t size) {
+        if (p != nullptr && p != MAP_FAILED) ::munmap(p, size);
+        p = nullptr;
+    }
+
+    bool setup_ring() {
+        // Room for a CQE per buffer plus errors, so the CQ never overflows
+        const unsigned cq_entries = static_cast<unsigned>(std::max<size_t>(buffer_count_, kSqEntries) * 2);
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER;
+        params.cq_entries = cq_entries;
+        ring_fd_ = io_uring_setup(kSqEntries, &params);
+        if (ring_fd_ < 0) {
+            params = io_uring_params{}; // Pre-6.0 kernels reject SINGLE_ISSUER
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = cq_entries;
+            ring_fd_ = io_uring_setup(kSqEntries, &params);
+        }
+        if (ring_fd_ < 0) return false;
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_); // One mapping holds both
+        }
+        sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                          IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) return false;
+        if (!single) {
+            cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                              IORING_OFF_CQ_RING);
+            if (cq_ring_ == MAP_FAILED) return false;
+        }
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                       IORING_OFF_SQES);
+        if (sqes_ == MAP_FAILED) return false;
+
+        char* sq = static_cast<char*>(sq_ring_);
+        char* cq = static_cast<char*>(single ? sq_ring_ : cq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    bool setup_buffers() {
+        buffers_size_ = buffer_count_ * buffer_size_;
+        buffers_ = static_cast<char*>(::mmap(nullptr, buffers_size_, PROT_READ | PROT_WRITE,
+                                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0));
+        buf_ring_size_ = buffer_count_ * sizeof(io_uring_buf);
+        buf_ring_ = ::mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE,
+                           -1, 0);
+        if (buffers_ == MAP_FAILED || buf_ring_ == MAP_FAILED) return false;
+        held_.resize(buffer_count_);
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+        reg.ring_entries = static_cast<uint32_t>(buffer_count_);
+        reg.bgid = kBufferGroup;
+        ring_mapped_ = io_uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+        if (ring_mapped_) {
+            buf_tail_ = 0;
+            for (size_t bid = 0; bid < buffer_count_; bid++) {
+                provide(static_cast<uint16_t>(bid));
+            }
+            store_release(&ring()->tail, buf_tail_);
+            if (probe_ring()) return true;
+            io_uring_register(ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+            ring_mapped_ = false;
+        }
+
+        // Fallback (pre-5.19 kernels, or a ring that never selects): the
+        // original provided-buffer API, one PROVIDE_BUFFERS per recycled run
+        held_count_ = 0;
+        provide_run(0, buffer_count_);
+        return submit() >= 0;
+    }
+
+    // Some kernels accept IORING_REGISTER_PBUF_RING yet never select from
+    // the ring; one buffered read of a pipe tells before the feed depends on it
+    bool probe_ring() {
+        int pipe_fds[2];
+        if (::pipe(pipe_fds) != 0) return false;
+        bool selected = false;
+        if (::write(pipe_fds[1], "x", 1) == 1) {
+            io_uring_sqe& sqe = next_sqe(kProbeTag);
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = pipe_fds[0];
+            sqe.len = static_cast<uint32_t>(buffer_size_);
+            sqe.off = ~uint64_t{0}; // Current file position
+            sqe.flags = IOSQE_BUFFER_SELECT;
+            sqe.buf_group = kBufferGroup;
+            if (io_uring_enter(ring_fd_, 1, 1, IORING_ENTER_GETEVENTS) == 1 && *cq_head_ != load_acquire(cq_tail_)) {
+                const io_uring_cqe& cqe = cqes_[*cq_head_ & *cq_mask_];
+                selected = cqe.res == 1 && (cqe.flags & IORING_CQE_F_BUFFER);
+                if (selected) held_[held_count_++] = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                store_release(cq_head_, *cq_head_ + 1);
+            }
+        }
+        ::close(pipe_fds[0]);
+        ::close(pipe_fds[1]);
+        return selected;
+    }
+
+    io_uring_buf_ring* ring() const { return static_cast<io_uring_buf_ring*>(buf_ring_); }
+
+    void provide(uint16_t bid) {
+        io_uring_buf& buf = ring()->bufs[buf_tail_ & (buffer_count_ - 1)];
+        buf.addr = reinterpret_cast<uint64_t>(buffers_ + static_cast<size_t>(bid) * buffer_size_);
+        buf.len = static_cast<uint32_t>(buffer_size_);
+        buf.bid = bid;
+        buf_tail_++;
+    }
+
+    // Queue an IORING_OP_PROVIDE_BUFFERS for bids [first, first + count)
+    void provide_run(uint16_t first, size_t count) {
+        if (pending_ == kSqEntries) submit();
+        io_uring_sqe& sqe = next_sqe(kProvideTag);
+        sqe.opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe.fd = static_cast<int>(count);
+        sqe.addr = reinterpret_cast<uint64_t>(buffers_ + static_cast<size_t>(first) * buffer_size_);
+        sqe.len = static_cast<uint32_t>(buffer_size_);
+        sqe.off = first;
+        sqe.buf_group = kBufferGroup;
+        sqe.flags = IOSQE_CQE_SKIP_SUCCESS;
+    }
+
+    // Hand the buffers from the last receive() back to the kernel
+    void recycle() {
+        if (held_count_ == 0) return;
+        if (ring_mapped_) {
+            for (size_t i = 0; i < held_count_; i++) provide(held_[i]);
+            store_release(&ring()->tail, buf_tail_);
+        } else {
+            // Buffers usually come back in order, so runs coalesce
+            size_t start = 0;
+            for (size_t i = 1; i <= held_count_; i++) {
+                if (i == held_count_ || held_[i] != held_[i - 1] + 1) {
+                    provide_run(held_[start], i - start);
+                    start = i;
+                }
+            }
+            submit();
+        }
+        held_count_ = 0;
+    }
+
+    io_uring_sqe& next_sqe(uint64_t tag) {
+        const unsigned tail = *sq_tail_;
+        const unsigned index = tail & *sq_mask_;
+        io_uring_sqe& sqe = static_cast<io_uring_sqe*>(sqes_)[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.user_data = tag;
+        sq_array_[index] = index;
+        store_release(sq_tail_, tail + 1);
+        pending_++;
+        return sqe;
+    }
+
+    int submit() {
+        const unsigned count = pending_;
+        pending_ = 0;
+        return count == 0 ? 0 : io_uring_enter(ring_fd_, count, 0, 0);
+    }
+
+    bool arm() {
+        io_uring_sqe& sqe = next_sqe(kRecvTag);
+        sqe.opcode = IORING_OP_RECV;
+        sqe.fd = fd_;
+        sqe.ioprio = IORING_RECV_MULTISHOT;
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = kBufferGroup;
+        return submit() == 1;
+    }
+
+    FeedHandlerConfig config_;
+    const size_t buffer_size_;
+    const size_t buffer_count_;
+    int fd_ = -1;
+    int ring_fd_ = -1;
+    bool closed_ = false;
+    bool ring_mapped_ = false;
+    unsigned pending_ = 0; // SQEs queued since the last submit()
+
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    void* sqes_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    size_t sqes_size_ = 0;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+
+    // Provided buffers and the ring that lends them to the kernel
+    void* buf_ring_ = nullptr;
+    size_t buf_ring_size_ = 0;
+    char* buffers_ = nullptr;
+    size_t buffers_size_ = 0;
+    uint16_t buf_tail_ = 0;
+    std::vector<uint16_t> held_; // Lent to the caller until the next receive()
+    size_t held_count_ = 0;
+};
+
+} // namespace
+
+std::unique_ptr<FeedReceiver> make_io_uring_receiver(const FeedHandlerConfig& config) {
+    return std::make_unique<IoUringReceiver>(config);
+}
+
+#else
+
+std::unique_ptr<FeedReceiver> make_io_uring_receiver(const FeedHandlerConfig&) {
+    return nullptr;
+}
+
+#endif
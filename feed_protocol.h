@@ -0,0 +1,398 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "order_book.h"
+
+// Binary order-feed wire format, version 1. All integers are little-endian
+// and nothing is padded. A packet is one UDP datagram, or one unit of the
+// TCP byte stream:
+//
+//   PacketHeader (16 B)  length u16 (whole packet), version u8,
+//                        message_count u8, session u32, sequence u64
+//   message_count messages, each starting with
+//   MessageHeader (3 B)  length u16 (whole message), type u8
+//
+// `sequence` numbers the packet's first message; message i carries
+// sequence + i, so a receiver can spot loss per message. Heartbeats carry
+// the next sequence to be used and do not consume one.
+//
+// Prices are fixed point: price / kFeedPriceScale units of currency.
+//
+// The same framing carries book deltas out (multicast_publisher.h) as
+// LevelUpdate messages; an order-feed receiver ignores them like trades.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "wire format is read in host order");
+
+constexpr uint8_t kFeedVersion = 1;
+constexpr int64_t kFeedPriceScale = 100000000; // 1e-8 resolution
+constexpr size_t kMaxFeedPacketSize = 1472;      // One Ethernet-MTU UDP payload
+constexpr size_t kMaxFeedMessages = 255;
+
+enum class FeedMessageType : uint8_t {
+    AddOrder = 'A',
+    CancelOrder = 'X',
+    AmendOrder = 'U', // New price and quantity; see OrderBook::amend_order
+    Trade = 'T',      // Informational; the book changes arrive as amend/cancel
+    Heartbeat = 'H',
+    LevelUpdate = 'L' // Aggregated level delta, published by MulticastPublisher
+};
+
+namespace wire {
+#pragma pack(push, 1)
+struct PacketHeader {
+    uint16_t length;
+    uint8_t version;
+    uint8_t message_count;
+    uint32_t session;
+    uint64_t sequence;
+};
+
+struct MessageHeader {
+    uint16_t length;
+    FeedMessageType type;
+};
+
+struct AddOrder {
+    MessageHeader header;
+    uint64_t timestamp_ns;
+    uint64_t order_id;
+    int64_t price;
+    uint32_t quantity;
+    uint8_t side; // 1 = buy, 0 = sell
+};
+
+struct CancelOrder {
+    MessageHeader header;
+    uint64_t timestamp_ns;
+    uint64_t order_id;
+};
+
+struct AmendOrder {
+    MessageHeader header;
+    uint64_t timestamp_ns;
+    uint64_t order_id;
+    int64_t price;
+    uint32_t quantity;
+};
+
+struct Trade {
+    MessageHeader header;
+    uint64_t timestamp_ns;
+    uint64_t maker_order_id;
+    int64_t price;
+    uint32_t quantity;
+    uint8_t aggressor_side; // 1 = buy, 0 = sell
+};
+
+struct Heartbeat {
+    MessageHeader header;
+    uint64_t timestamp_ns;
+};
+
+struct LevelUpdate {
+    MessageHeader header;
+    uint64_t timestamp_ns;
+    int64_t price;
+    uint64_t quantity; // Level total after the update; 0 on delete
+    uint8_t side;      // 1 = bid, 0 = ask
+    uint8_t update;    // BookEventType::LevelAdd, LevelChange or LevelDelete
+};
+#pragma pack(pop)
+
+// The layout is the protocol: any change here is a new kFeedVersion
+static_assert(sizeof(PacketHeader) == 16 && offsetof(PacketHeader, sequence) == 8);
+static_assert(sizeof(MessageHeader) == 3);
+static_assert(sizeof(AddOrder) == 32 && offsetof(AddOrder, price) == 19 && offsetof(AddOrder, side) == 31);
+static_assert(sizeof(CancelOrder) == 19 && offsetof(CancelOrder, order_id) == 11);
+static_assert(sizeof(AmendOrder) == 31 && offsetof(AmendOrder, quantity) == 27);
+static_assert(sizeof(Trade) == 32 && offsetof(Trade, aggressor_side) == 31);
+static_assert(sizeof(Heartbeat) == 11);
+static_assert(sizeof(LevelUpdate) == 29 && offsetof(LevelUpdate, side) == 27 && offsetof(LevelUpdate, update) == 28);
+} // namespace wire
+
+namespace feed_detail {
+template <typename T>
+inline T load(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template <typename T>
+inline void store(char* p, T value) {
+    std::memcpy(p, &value, sizeof(T));
+}
+} // namespace feed_detail
+
+// Zero-copy readers over the receive buffer: each accessor is one unaligned
+// load at the field's fixed offset. Validate lengths before constructing.
+#define FEED_FIELD(Msg, type, name) \
+    type name() const { return feed_detail::load<type>(p_ + offsetof(wire::Msg, name)); }
+
+class PacketView {
+public:
+    explicit PacketView(const char* p) : p_(p) {}
+    FEED_FIELD(PacketHeader, uint16_t, length)
+    FEED_FIELD(PacketHeader, uint8_t, version)
+    FEED_FIELD(PacketHeader, uint8_t, message_count)
+    FEED_FIELD(PacketHeader, uint32_t, session)
+    FEED_FIELD(PacketHeader, uint64_t, sequence)
+    const char* messages() const { return p_ + sizeof(wire::PacketHeader); }
+private:
+    const char* p_;
+};
+
+class MessageView {
+public:
+    explicit MessageView(const char* p) : p_(p) {}
+    uint16_t length() const { return feed_detail::load<uint16_t>(p_); }
+    FeedMessageType type() const { return feed_detail::load<FeedMessageType>(p_ + 2); }
+    FEED_FIELD(Heartbeat, uint64_t, timestamp_ns) // Common to every message
+    const char* data() const { return p_; }
+private:
+    const char* p_;
+};
+
+class AddOrderView {
+public:
+    explicit AddOrderView(const char* p) : p_(p) {}
+    FEED_FIELD(AddOrder, uint64_t, timestamp_ns)
+    FEED_FIELD(AddOrder, uint64_t, order_id)
+    FEED_FIELD(AddOrder, int64_t, price)
+    FEED_FIELD(AddOrder, uint32_t, quantity)
+    FEED_FIELD(AddOrder, uint8_t, side)
+private:
+    const char* p_;
+};
+
+class CancelOrderView {
+public:
+    explicit CancelOrderView(const char* p) : p_(p) {}
+    FEED_FIELD(CancelOrder, uint64_t, timestamp_ns)
+    FEED_FIELD(CancelOrder, uint64_t, order_id)
+private:
+    const char* p_;
+};
+
+class AmendOrderView {
+public:
+    explicit AmendOrderView(const char* p) : p_(p) {}
+    FEED_FIELD(AmendOrder, uint64_t, timestamp_ns)
+    FEED_FIELD(AmendOrder, uint64_t, order_id)
+    FEED_FIELD(AmendOrder, int64_t, price)
+    FEED_FIELD(AmendOrder, uint32_t, quantity)
+private:
+    const char* p_;
+};
+
+class TradeView {
+public:
+    explicit TradeView(const char* p) : p_(p) {}
+    FEED_FIELD(Trade, uint64_t, timestamp_ns)
+    FEED_FIELD(Trade, uint64_t, maker_order_id)
+    FEED_FIELD(Trade, int64_t, price)
+    FEED_FIELD(Trade, uint32_t, quantity)
+    FEED_FIELD(Trade, uint8_t, aggressor_side)
+private:
+    const char* p_;
+};
+
+class LevelUpdateView {
+public:
+    explicit LevelUpdateView(const char* p) : p_(p) {}
+    FEED_FIELD(LevelUpdate, uint64_t, timestamp_ns)
+    FEED_FIELD(LevelUpdate, int64_t, price)
+    FEED_FIELD(LevelUpdate, uint64_t, quantity)
+    FEED_FIELD(LevelUpdate, uint8_t, side)
+    FEED_FIELD(LevelUpdate, uint8_t, update)
+private:
+    const char* p_;
+};
+
+#undef FEED_FIELD
+
+inline double feed_to_price(int64_t price) { return static_cast<double>(price) / kFeedPriceScale; }
+inline int64_t feed_from_price(double price) { return llround(price * kFeedPriceScale); }
+
+// Wire size of each message type; 0 for unknown types
+inline size_t feed_message_size(FeedMessageType type) {
+    switch (type) {
+        case FeedMessageType::AddOrder: return sizeof(wire::AddOrder);
+        case FeedMessageType::CancelOrder: return sizeof(wire::CancelOrder);
+        case FeedMessageType::AmendOrder: return sizeof(wire::AmendOrder);
+        case FeedMessageType::Trade: return sizeof(wire::Trade);
+        case FeedMessageType::Heartbeat: return sizeof(wire::Heartbeat);
+        case FeedMessageType::LevelUpdate: return sizeof(wire::LevelUpdate);
+    }
+    return 0;
+}
+
+// Check a packet's header and framing before any message is read
+// @return false if truncated, of another version, or with inconsistent lengths
+inline bool validate_feed_packet(const char* data, size_t size) {
+    if (size < sizeof(wire::PacketHeader)) return false;
+    const PacketView packet(data);
+    if (packet.version() != kFeedVersion || packet.length() != size) return false;
+
+    size_t offset = sizeof(wire::PacketHeader);
+    for (size_t i = 0; i < packet.message_count(); i++) {
+        if (size - offset < sizeof(wire::MessageHeader)) return false;
+        const MessageView message(data + offset);
+        const size_t expected = feed_message_size(message.type());
+        if (expected == 0 || message.length() != expected || expected > size - offset) return false;
+        offset += expected;
+    }
+    return offset == size;
+}
+
+// Decode a validated message into a book operation
+// @return false for messages that do not change the book (trade, heartbeat)
+inline bool decode_feed_message(MessageView message, BookOp& op) {
+    switch (message.type()) {
+        case FeedMessageType::AddOrder: {
+            const AddOrderView add(message.data());
+            op.type = BookOpType::Add;
+            op.order = Order{add.order_id(), add.side() == 1, feed_to_price(add.price()),
+                             add.quantity(), add.timestamp_ns()};
+            return true;
+        }
+        case FeedMessageType::CancelOrder: {
+            const CancelOrderView cancel(message.data());
+            op.type = BookOpType::Cancel;
+            op.order = Order{cancel.order_id(), false, 0.0, 0, cancel.timestamp_ns()};
+            return true;
+        }
+        case FeedMessageType::AmendOrder: {
+            const AmendOrderView amend(message.data());
+            op.type = BookOpType::Amend;
+            op.order = Order{amend.order_id(), false, feed_to_price(amend.price()),
+                             amend.quantity(), amend.timestamp_ns()};
+            return true;
+        }
+        case FeedMessageType::Trade:
+        case FeedMessageType::Heartbeat:
+        case FeedMessageType::LevelUpdate:
+            return false;
+    }
+    return false;
+}
+
+// Writes one packet at a time into a caller-owned buffer of at least
+// kMaxFeedPacketSize bytes. The C++ counterpart of feed_generator.py.
+class FeedPacketBuilder {
+public:
+    FeedPacketBuilder(char* buffer, uint32_t session, uint64_t next_sequence)
+        : buffer_(buffer), session_(session), next_sequence_(next_sequence) {
+        reset();
+    }
+
+    // Append a book operation; @return false if the packet is full
+    bool add(const BookOp& op) {
+        const Order& order = op.order;
+        switch (op.type) {
+            case BookOpType::Add: {
+                char* p = begin(FeedMessageType::AddOrder, order.timestamp_ns);
+                if (p == nullptr) return false;
+                put(p, offsetof(wire::AddOrder, order_id), order.order_id);
+                put(p, offsetof(wire::AddOrder, price), feed_from_price(order.price));
+                put(p, offsetof(wire::AddOrder, quantity), static_cast<uint32_t>(order.quantity));
+                put(p, offsetof(wire::AddOrder, side), static_cast<uint8_t>(order.is_buy ? 1 : 0));
+                return true;
+            }
+            case BookOpType::Cancel: {
+                char* p = begin(FeedMessageType::CancelOrder, order.timestamp_ns);
+                if (p == nullptr) return false;
+                put(p, offsetof(wire::CancelOrder, order_id), order.order_id);
+                return true;
+            }
+            case BookOpType::Amend: {
+                char* p = begin(FeedMessageType::AmendOrder, order.timestamp_ns);
+                if (p == nullptr) return false;
+                put(p, offsetof(wire::AmendOrder, order_id), order.order_id);
+                put(p, offsetof(wire::AmendOrder, price), feed_from_price(order.price));
+                put(p, offsetof(wire::AmendOrder, quantity), static_cast<uint32_t>(order.quantity));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool trade(uint64_t timestamp_ns, uint64_t maker_order_id, double price, uint32_t quantity, bool aggressor_buy) {
+        char* p = begin(FeedMessageType::Trade, timestamp_ns);
+        if (p == nullptr) return false;
+        put(p, offsetof(wire::Trade, maker_order_id), maker_order_id);
+        put(p, offsetof(wire::Trade, price), feed_from_price(price));
+        put(p, offsetof(wire::Trade, quantity), quantity);
+        put(p, offsetof(wire::Trade, aggressor_side), static_cast<uint8_t>(aggressor_buy ? 1 : 0));
+        return true;
+    }
+
+    // type is one of the L2 BookEventTypes
+    bool level(uint64_t timestamp_ns, bool is_buy, double price, uint64_t quantity, BookEventType type) {
+        char* p = begin(FeedMessageType::LevelUpdate, timestamp_ns);
+        if (p == nullptr) return false;
+        put(p, offsetof(wire::LevelUpdate, price), feed_from_price(price));
+        put(p, offsetof(wire::LevelUpdate, quantity), quantity);
+        put(p, offsetof(wire::LevelUpdate, side), static_cast<uint8_t>(is_buy ? 1 : 0));
+        put(p, offsetof(wire::LevelUpdate, update), static_cast<uint8_t>(type));
+        return true;
+    }
+
+    // A heartbeat goes alone in its packet and consumes no sequence number
+    bool heartbeat(uint64_t timestamp_ns) {
+        if (count_ != 0 || begin(FeedMessageType::Heartbeat, timestamp_ns) == nullptr) return false;
+        heartbeat_ = true;
+        return true;
+    }
+
+    size_t message_count() const { return count_; }
+    uint64_t next_sequence() const { return next_sequence_; }
+
+    // Write the header and return the packet's size; the builder then
+    // starts the next packet in the same buffer
+    size_t finish() {
+        using feed_detail::store;
+        const size_t length = size_;
+        store(buffer_ + offsetof(wire::PacketHeader, length), static_cast<uint16_t>(length));
+        store(buffer_ + offsetof(wire::PacketHeader, version), kFeedVersion);
+        store(buffer_ + offsetof(wire::PacketHeader, message_count), static_cast<uint8_t>(count_));
+        store(buffer_ + offsetof(wire::PacketHeader, session), session_);
+        store(buffer_ + offsetof(wire::PacketHeader, sequence), next_sequence_);
+        if (!heartbeat_) next_sequence_ += count_;
+        reset();
+        return length;
+    }
+
+private:
+    void reset() {
+        size_ = sizeof(wire::PacketHeader);
+        count_ = 0;
+        heartbeat_ = false;
+    }
+
+    // Reserve a message and fill its header and timestamp
+    char* begin(FeedMessageType type, uint64_t timestamp_ns) {
+        const size_t size = feed_message_size(type);
+        if (heartbeat_ || count_ == kMaxFeedMessages || size_ + size > kMaxFeedPacketSize) return nullptr;
+        char* p = buffer_ + size_;
+        feed_detail::store(p, static_cast<uint16_t>(size));
+        feed_detail::store(p + 2, type);
+        feed_detail::store(p + 3, timestamp_ns);
+        size_ += size;
+        count_++;
+        return p;
+    }
+
+    template <typename T>
+    static void put(char* message, size_t offset, T value) {
+        feed_detail::store(message + offset, value);
+    }
+
+    char* buffer_;
+    uint32_t session_;
+    uint64_t next_sequence_;
+    size_t size_ = 0;
+    size_t count_ = 0;
+    bool heartbeat_ = false;
+};
@@ -0,0 +1,161 @@
+#include "feed_receiver.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "feed_handler.h"
+
+const char* feed_backend_name(FeedBackend backend) {
+    switch (backend) {
+        case FeedBackend::Socket: return "socket";
+        case FeedBackend::IoUring: return "io_uring";
+        case FeedBackend::Xdp: return "xdp";
+    }
+    return "unknown";
+}
+
+bool parse_feed_backend(const std::string& name, FeedBackend& backend) {
+    for (FeedBackend candidate : {FeedBackend::Socket, FeedBackend::IoUring, FeedBackend::Xdp}) {
+        if (name == feed_backend_name(candidate)) {
+            backend = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<FeedReceiver> make_feed_receiver(const FeedHandlerConfig& config) {
+    switch (config.backend) {
+        case FeedBackend::Socket: return make_socket_receiver(config);
+        case FeedBackend::IoUring: return make_io_uring_receiver(config);
+        case FeedBackend::Xdp: return make_xdp_receiver(config);
+    }
+    return nullptr;
+}
+
+int open_feed_socket(const FeedHandlerConfig& config) {
+    const bool udp = config.transport == FeedTransport::Udp;
+    const int fd = ::socket(AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config.port);
+    if (::inet_pton(AF_INET, config.address.c_str(), &addr.sin_addr) != 1) {
+        ::close(fd);
+        return -1;
+    }
+
+    // Best effort: both are capped or refused without privileges
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &config.receive_buffer, sizeof(config.receive_buffer));
+    if (config.busy_poll_us > 0) {
+        ::setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &config.busy_poll_us, sizeof(config.busy_poll_us));
+    }
+
+    if (udp) {
+        const int reuse = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        if (IN_MULTICAST(ntohl(addr.sin_addr.s_addr))) {
+            ip_mreq group{};
+            group.imr_multiaddr = addr.sin_addr;
+            if (::inet_pton(AF_INET, config.interface.c_str(), &group.imr_interface) != 1 ||
+                ::setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group)) != 0) {
+                ::close(fd);
+                return -1;
+            }
+        }
+    } else {
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        const int nodelay = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    }
+
+    // The book thread polls; it must never block in the kernel
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+namespace {
+
+// UDP: one recvmmsg drains up to `batch` datagrams. TCP: one large recv.
+class SocketReceiver final : public FeedReceiver {
+public:
+    explicit SocketReceiver(const FeedHandlerConfig& config) : config_(config) {
+        if (config_.transport == FeedTransport::Udp) {
+            buffer_.resize(config_.batch * config_.max_packet);
+            headers_.resize(config_.batch);
+            iovecs_.resize(config_.batch);
+            for (size_t i = 0; i < config_.batch; i++) {
+                iovecs_[i].iov_base = &buffer_[i * config_.max_packet];
+                iovecs_[i].iov_len = config_.max_packet;
+                std::memset(&headers_[i], 0, sizeof(headers_[i]));
+                headers_[i].msg_hdr.msg_iov = &iovecs_[i];
+                headers_[i].msg_hdr.msg_iovlen = 1;
+            }
+        } else {
+            buffer_.resize(config_.stream_buffer);
+        }
+    }
+
+    ~SocketReceiver() override { close(); }
+
+    bool open() override {
+        close();
+        fd_ = open_feed_socket(config_);
+        return fd_ >= 0;
+    }
+
+    void close() override {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    bool is_open() const override { return fd_ >= 0; }
+    int fd() const override { return fd_; }
+
+    int receive(FeedBuffer* out, size_t max) override {
+        if (config_.transport == FeedTransport::Tcp) {
+            const ssize_t received = ::recv(fd_, buffer_.data(), buffer_.size(), MSG_DONTWAIT);
+            if (received <= 0) return received == 0 ? -1 : 0;
+            out[0] = {buffer_.data(), static_cast<size_t>(received)};
+            return 1;
+        }
+
+        const int received = ::recvmmsg(fd_, headers_.data(), static_cast<unsigned>(std::min(max, headers_.size())),
+                                        MSG_DONTWAIT, nullptr);
+        if (received <= 0) return 0;
+        for (int i = 0; i < received; i++) {
+            out[i] = {static_cast<const char*>(iovecs_[i].iov_base), headers_[i].msg_len};
+        }
+        return received;
+    }
+
+private:
+    FeedHandlerConfig config_;
+    int fd_ = -1;
+
+    // recvmmsg scatter state, or the TCP read buffer
+    std::vector<char> buffer_;
+    std::vector<struct mmsghdr> headers_;
+    std::vector<struct iovec> iovecs_;
+};
+
+} // namespace
+
+std::unique_ptr<FeedReceiver> make_socket_receiver(const FeedHandlerConfig& config) {
+    return std::make_unique<SocketReceiver>(config);
+}
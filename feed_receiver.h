@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct FeedHandlerConfig;
+
+// How FeedHandler gets bytes off the wire. All three hand its decoder the
+// same thing (UDP payloads, or chunks of the TCP stream), so the backend is
+// a startup choice: Socket everywhere, IoUring on Linux 6.0+, Xdp on a NIC
+// dedicated to the feed.
+enum class FeedBackend : uint8_t {
+    Socket,  // recvmmsg / recv on a non-blocking socket
+    IoUring, // Multishot recv into a provided-buffer ring; no syscall per packet
+    Xdp      // AF_XDP socket on one NIC queue; UDP only, bypasses the IP stack
+};
+
+// "socket", "io_uring" or "xdp"
+const char* feed_backend_name(FeedBackend backend);
+bool parse_feed_backend(const std::string& name, FeedBackend& backend);
+
+// A received UDP payload or TCP chunk, owned by the receiver
+struct FeedBuffer {
+    const char* data;
+    size_t size;
+};
+
+class FeedReceiver {
+public:
+    virtual ~FeedReceiver() = default;
+
+    // @return false if the backend is unavailable or any setup step failed
+    virtual bool open() = 0;
+    virtual void close() = 0;
+    virtual bool is_open() const = 0;
+
+    // The UDP/TCP socket the feed arrives on (Xdp keeps one bound to
+    // reserve the port and hold multicast membership)
+    virtual int fd() const = 0;
+
+    // Collect up to max buffers without blocking. They stay valid until the
+    // next receive() or close(), which hands them back to the backend.
+    // @return number of buffers, or -1 once a TCP peer has closed
+    virtual int receive(FeedBuffer* out, size_t max) = 0;
+};
+
+// @return nullptr if the backend was compiled out
+std::unique_ptr<FeedReceiver> make_feed_receiver(const FeedHandlerConfig& config);
+
+std::unique_ptr<FeedReceiver> make_socket_receiver(const FeedHandlerConfig& config);
+std::unique_ptr<FeedReceiver> make_io_uring_receiver(const FeedHandlerConfig& config);
+std::unique_ptr<FeedReceiver> make_xdp_receiver(const FeedHandlerConfig& config);
+
+// Create, configure and bind (UDP) or connect (TCP) a non-blocking socket
+// @return the fd, or -1 if any required call failed
+int open_feed_socket(const FeedHandlerConfig& config);
@@ -0,0 +1,254 @@
+// Replays a recorded feed capture (feed_capture.h) into an OrderBook and
+// reports throughput and latency, for capacity planning on real flow.
+//
+// Usage: feed_replay CAPTURE [--mode fast|timed] [--speed X] [--repeat N] [--per-op] [--cold]
+//   --mode fast    Apply packets back to back: the book's ceiling      (default)
+//   --mode timed   Apply each packet at its recorded timestamp_ns; latency
+//                  is measured from that due time, so it includes any
+//                  queueing when the book falls behind a burst
+//   --speed X      Timed mode only: replay X times faster than recorded (default 1)
+//   --repeat N     Runs, each on a fresh book                          (default 1)
+//   --per-op       Apply and time each message alone instead of one
+//                  apply_batch per packet, for per-type distributions
+//   --cold         Skip OrderBook::warm_up, to see first-touch costs in the tail
+//
+// A capture comes from feed_generator.py's file mode or a recorded feed:
+//   python3 feed_generator.py file flow.bin --messages 5000000 --cancel-ratio 0.45
+//   feed_replay flow.bin --mode timed --speed 10
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include "feed_capture.h"
+#include "latency_histogram.h"
+#include "order_book.h"
+
+namespace {
+
+struct ReplayConfig {
+    std::string path;
+    bool timed = false;
+    double speed = 1.0;
+    int repeat = 1;
+    bool per_op = false;
+    bool warm_up = true;
+};
+
+// Shape of the flow in the capture, from one pass before any timing
+struct FlowProfile {
+    uint64_t packets = 0;
+    uint64_t messages = 0;
+    uint64_t by_type[4] = {0, 0, 0, 0}; // Add, Cancel, Amend, other (trade/heartbeat)
+    size_t peak_orders = 0;
+    size_t peak_levels = 0;
+    uint64_t first_ns = 0;
+    uint64_t last_ns = 0;
+};
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool parse_args(int argc, char** argv, ReplayConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--mode" && has_value) {
+            const std::string mode = argv[++i];
+            if (mode != "fast" && mode != "timed") return false;
+            config.timed = mode == "timed";
+        } else if (arg == "--speed" && has_value) {
+            config.speed = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--repeat" && has_value) {
+            config.repeat = std::atoi(argv[++i]);
+        } else if (arg == "--per-op") {
+            config.per_op = true;
+        } else if (arg == "--cold") {
+            config.warm_up = false;
+        } else if (arg[0] != '-' && config.path.empty()) {
+            config.path = arg;
+        } else {
+            return false;
+        }
+    }
+    return !config.path.empty() && config.speed > 0.0 && config.repeat > 0;
+}
+
+size_t type_index(BookOpType type) {
+    switch (type) {
+        case BookOpType::Add: return 0;
+        case BookOpType::Cancel: return 1;
+        case BookOpType::Amend: return 2;
+    }
+    return 3;
+}
+
+// Count the mix and track live orders and levels to size the book
+FlowProfile profile(const FeedCapture& capture, size_t& valid_bytes) {
+    FlowProfile flow;
+    std::unordered_map<uint64_t, std::pair<bool, int64_t>> live; // id -> side, price
+    std::unordered_map<int64_t, uint32_t> levels[2];              // price -> orders, per side
+    auto leave = [&](uint64_t id) {
+        auto it = live.find(id);
+        if (it == live.end()) return;
+        auto& side = levels[it->second.first];
+        if (--side[it->second.second] == 0) side.erase(it->second.second);
+        live.erase(it);
+    };
+
+    valid_bytes = capture.for_each_packet([&](const PacketView& packet) {
+        flow.packets++;
+        const char* message = packet.messages();
+        for (size_t i = 0; i < packet.message_count(); i++) {
+            const MessageView view(message);
+            message += view.length();
+            flow.messages++;
+            if (flow.first_ns == 0) flow.first_ns = view.timestamp_ns();
+            flow.last_ns = view.timestamp_ns();
+            BookOp op;
+            if (!decode_feed_message(view, op)) {
+                flow.by_type[3]++;
+                continue;
+            }
+            flow.by_type[type_index(op.type)]++;
+            const int64_t price = feed_from_price(op.order.price);
+            if (op.type != BookOpType::Add) {
+                if (op.type == BookOpType::Cancel) {
+                    leave(op.order.order_id);
+                    continue;
+                }
+                auto it = live.find(op.order.order_id);
+                if (it == live.end()) continue;
+                op.order.is_buy = it->second.first;
+                leave(op.order.order_id);
+            }
+            live[op.order.order_id] = {op.order.is_buy, price};
+            levels[op.order.is_buy][price]++;
+        }
+        flow.peak_orders = std::max(flow.peak_orders, live.size());
+        flow.peak_levels = std::max(flow.peak_levels, levels[0].size() + levels[1].size());
+    });
+    return flow;
+}
+
+struct RunResult {
+    double seconds = 0.0;
+    uint64_t late = 0; // Timed mode: packets started more than 1 us after their due time
+    LatencyHistogram latency;       // Per packet (or per message with --per-op), ns
+    LatencyHistogram by_type[3];    // --per-op only: Add, Cancel, Amend
+};
+
+void replay(const ReplayConfig& config, const FeedCapture& capture, const FlowProfile& flow, RunResult& result) {
+    OrderBookConfig book_config;
+    // Headroom over the peak; Hashed ids make any id range fine
+    book_config.order_capacity = flow.peak_orders + flow.peak_orders / 4 + 1024;
+    OrderBook book(book_config);
+    if (config.warm_up) book.warm_up();
+    BookOp ops[kMaxFeedMessages];
+
+    const uint64_t start = now_ns();
+    capture.for_each_packet([&](const PacketView& packet) {
+        uint64_t due = 0;
+        if (config.timed) {
+            const MessageView first(packet.messages());
+            const uint64_t recorded = std::max(first.timestamp_ns(), flow.first_ns);
+            const double offset = static_cast<double>(recorded - flow.first_ns) / config.speed;
+            due = start + static_cast<uint64_t>(offset);
+            uint64_t now = now_ns();
+            while (now < due) {
+                __builtin_ia32_pause();
+                now = now_ns();
+            }
+            if (now - due > 1000) result.late++;
+        }
+
+        const uint64_t begin = config.timed ? due : now_ns();
+        const char* message = packet.messages();
+        size_t count = 0;
+        for (size_t i = 0; i < packet.message_count(); i++) {
+            const MessageView view(message);
+            message += view.length();
+            if (!decode_feed_message(view, ops[count])) continue;
+            if (config.per_op) {
+                const uint64_t op_begin = now_ns();
+                book.apply(ops[count]);
+                const uint64_t elapsed = now_ns() - op_begin;
+                result.latency.record(elapsed);
+                result.by_type[type_index(ops[count].type)].record(elapsed);
+            } else {
+                count++;
+            }
+        }
+        if (!config.per_op) {
+            book.apply_batch(ops, count);
+            result.latency.record(now_ns() - begin);
+        }
+    });
+    result.seconds = static_cast<double>(now_ns() - start) / 1e9;
+    if (const BookMetrics* metrics = book.metrics()) metrics->print(); // ORDERBOOK_METRICS builds
+}
+
+void print_latency(const char* label, const LatencyHistogram& histogram) {
+    std::printf("  %-8s %10llu  p50 %6llu  p90 %6llu  p99 %7llu  p99.9 %7llu  max %8llu (ns)\n", label,
+                static_cast<unsigned long long>(histogram.count()),
+                static_cast<unsigned long long>(histogram.percentile(50)),
+                static_cast<unsigned long long>(histogram.percentile(90)),
+                static_cast<unsigned long long>(histogram.percentile(99)),
+                static_cast<unsigned long long>(histogram.percentile(99.9)),
+                static_cast<unsigned long long>(histogram.max()));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ReplayConfig config;
+    if (!parse_args(argc, argv, config)) {
+        std::fprintf(stderr, "usage: %s CAPTURE [--mode fast|timed] [--speed X] [--repeat N] [--per-op] [--cold]\n",
+                     argv[0]);
+        return 1;
+    }
+    FeedCapture capture;
+    if (!capture.open(config.path)) {
+        std::fprintf(stderr, "cannot map %s: %s\n", config.path.c_str(), std::strerror(errno));
+        return 1;
+    }
+
+    size_t valid_bytes = 0;
+    const FlowProfile flow = profile(capture, valid_bytes);
+    if (valid_bytes != capture.size()) {
+        std::fprintf(stderr, "warning: stopped at a malformed packet at byte %zu of %zu\n", valid_bytes,
+                     capture.size());
+    }
+    const double span = static_cast<double>(flow.last_ns - flow.first_ns) / 1e9;
+    const double messages = static_cast<double>(flow.messages);
+    std::printf("%s: %llu packets, %llu messages over %.3f s recorded\n", config.path.c_str(),
+                static_cast<unsigned long long>(flow.packets), static_cast<unsigned long long>(flow.messages), span);
+    std::printf("mix: add %.1f%%  cancel %.1f%%  amend %.1f%%  other %.1f%%; peak %zu orders on %zu levels\n",
+                100.0 * flow.by_type[0] / messages, 100.0 * flow.by_type[1] / messages,
+                100.0 * flow.by_type[2] / messages, 100.0 * flow.by_type[3] / messages, flow.peak_orders,
+                flow.peak_levels);
+
+    for (int run = 0; run < config.repeat; run++) {
+        RunResult result;
+        replay(config, capture, flow, result);
+        std::printf("\nrun %d (%s%s): %.3f s, %.2f M msg/s", run + 1, config.timed ? "timed" : "fast",
+                    config.per_op ? ", per op" : "", result.seconds, messages / result.seconds / 1e6);
+        if (config.timed) {
+            std::printf(", %llu packets late by > 1 us", static_cast<unsigned long long>(result.late));
+        }
+        std::printf("\n");
+        print_latency(config.per_op ? "message" : "packet", result.latency);
+        if (config.per_op) {
+            print_latency("add", result.by_type[0]);
+            print_latency("cancel", result.by_type[1]);
+            print_latency("amend", result.by_type[2]);
+        }
+    }
+    return 0;
+}
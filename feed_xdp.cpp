@@ -0,0 +1,329 @@
+#include "feed_receiver.h"
+#include "feed_handler.h"
+
+#if __has_include(<linux/if_xdp.h>) && __has_include(<linux/bpf.h>)
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+namespace {
+
+constexpr size_t kFrameSize = 2048; // Fits a 1500-byte MTU frame; UMEM chunks are a power of two
+constexpr size_t kEthHeader = 14;
+constexpr size_t kUdpHeader = 8;
+
+int bpf(int cmd, bpf_attr* attr) {
+    return static_cast<int>(::syscall(__NR_bpf, cmd, attr, sizeof(*attr)));
+}
+
+bpf_insn insn(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm) {
+    bpf_insn i{};
+    i.code = code;
+    i.dst_reg = dst & 0xf;
+    i.src_reg = src & 0xf;
+    i.off = off;
+    i.imm = imm;
+    return i;
+}
+
+// XDP program: IPv4/UDP to `port` without IP options goes to the AF_XDP
+// socket bound on the arriving queue, anything else to the kernel stack.
+//
+//   r6 = ctx; r2 = data; r3 = data_end
+//   if data + 42 > data_end || ethertype != IPv4 || ihl != 5 || proto != UDP
+//      || dport != port: return XDP_PASS
+//   return bpf_redirect_map(xsks, ctx->rx_queue_index, XDP_PASS)
+std::vector<bpf_insn> redirect_program(int map_fd, uint16_t port) {
+    constexpr int kPass = 20; // Index of the fall-through
+    std::vector<bpf_insn> p;
+    auto jne = [&](uint8_t reg, int32_t imm) {
+        const int16_t off = static_cast<int16_t>(kPass - static_cast<int>(p.size()) - 1);
+        p.push_back(insn(BPF_JMP | BPF_JNE | BPF_K, reg, 0, off, imm));
+    };
+    p.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0));
+    p.push_back(insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, offsetof(xdp_md, data), 0));
+    p.push_back(insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_6, offsetof(xdp_md, data_end), 0));
+    p.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+    p.push_back(insn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, kEthHeader + 20 + kUdpHeader));
+    p.push_back(insn(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, static_cast<int16_t>(kPass - 6), 0));
+    p.push_back(insn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, 12, 0));
+    jne(BPF_REG_5, htons(0x0800));
+    p.push_back(insn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, 14, 0));
+    jne(BPF_REG_5, 0x45);
+    p.push_back(insn(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, 23, 0));
+    jne(BPF_REG_5, IPPROTO_UDP);
+    p.push_back(insn(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, 36, 0));
+    jne(BPF_REG_5, htons(port));
+    p.push_back(insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, offsetof(xdp_md, rx_queue_index), 0));
+    p.push_back(insn(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, map_fd));
+    p.push_back(insn(0, 0, 0, 0, 0));
+    p.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS));
+    p.push_back(insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map));
+    p.push_back(insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+    p.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS)); // kPass
+    p.push_back(insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+    return p;
+}
+
+// Producer/consumer view of one mmap'd AF_XDP ring
+template <typename Desc>
+struct XdpRing {
+    uint32_t* producer = nullptr;
+    uint32_t* consumer = nullptr;
+    uint32_t* flags = nullptr;
+    Desc* descs = nullptr;
+    uint32_t mask = 0;
+    void* map = nullptr;
+    size_t map_size = 0;
+
+    bool open(int fd, const xdp_ring_offset& offsets, uint32_t entries, off_t pgoff) {
+        map_size = offsets.desc + entries * sizeof(Desc);
+        map = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, pgoff);
+        if (map == MAP_FAILED) {
+            map = nullptr;
+            return false;
+        }
+        char* base = static_cast<char*>(map);
+        producer = reinterpret_cast<uint32_t*>(base + offsets.producer);
+        consumer = reinterpret_cast<uint32_t*>(base + offsets.consumer);
+        flags = reinterpret_cast<uint32_t*>(base + offsets.flags);
+        descs = reinterpret_cast<Desc*>(base + offsets.desc);
+        mask = entries - 1;
+        return true;
+    }
+
+    void close() {
+        if (map != nullptr) ::munmap(map, map_size);
+        map = nullptr;
+    }
+};
+
+// AF_XDP socket on one RX queue of a NIC dedicated to the feed. An XDP
+// program steers the feed's UDP port into the socket's RX ring, where
+// frames land in a UMEM this process maps; receive() walks that ring and
+// hands out the UDP payloads in place. In zero-copy mode the NIC DMAs
+// straight into the UMEM and nothing touches the kernel's IP stack.
+//
+// A plain UDP socket stays bound alongside: it holds the multicast
+// membership the NIC filters on and keeps ICMP port-unreachable quiet.
+class XdpReceiver final : public FeedReceiver {
+public:
+    explicit XdpReceiver(const FeedHandlerConfig& config) : config_(config), frames_(config.ring_buffers) {}
+
+    ~XdpReceiver() override { close(); }
+
+    bool open() override {
+        close();
+        if (config_.transport != FeedTransport::Udp || frames_ == 0 || (frames_ & (frames_ - 1)) != 0) {
+            return false;
+        }
+        ifindex_ = ::if_nametoindex(config_.xdp_device.c_str());
+        if (ifindex_ == 0) return false;
+        fd_ = open_feed_socket(config_);
+        sockaddr_in bound{};
+        socklen_t length = sizeof(bound);
+        if (fd_ < 0 || ::getsockname(fd_, reinterpret_cast<sockaddr*>(&bound), &length) != 0 || !setup_socket() ||
+            !attach_program(ntohs(bound.sin_port))) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() override {
+        if (link_fd_ >= 0) ::close(link_fd_); // Detaches the program
+        if (prog_fd_ >= 0) ::close(prog_fd_);
+        if (map_fd_ >= 0) ::close(map_fd_);
+        link_fd_ = prog_fd_ = map_fd_ = -1;
+        rx_.close();
+        fill_.close();
+        completion_.close();
+        if (xsk_fd_ >= 0) ::close(xsk_fd_);
+        xsk_fd_ = -1;
+        if (umem_ != nullptr) ::munmap(umem_, frames_ * kFrameSize);
+        umem_ = nullptr;
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        held_.clear();
+    }
+
+    bool is_open() const override { return link_fd_ >= 0; }
+    int fd() const override { return fd_; }
+
+    int receive(FeedBuffer* out, size_t max) override {
+        recycle();
+
+        const uint32_t available = __atomic_load_n(rx_.producer, __ATOMIC_ACQUIRE) - rx_cursor_;
+        int count = 0;
+        uint32_t taken = 0;
+        for (; taken < available && static_cast<size_t>(count) < max; taken++) {
+            const xdp_desc& desc = rx_.descs[(rx_cursor_ + taken) & rx_.mask];
+            held_.push_back(desc.addr);
+            // The program only passes IPv4 without options, so the payload
+            // offset is fixed; the UDP length bounds it
+            const char* frame = static_cast<const char*>(umem_) + desc.addr;
+            const size_t headers = kEthHeader + 20 + kUdpHeader;
+            if (desc.len < headers) continue;
+            uint16_t udp_length;
+            std::memcpy(&udp_length, frame + kEthHeader + 20 + 4, sizeof(udp_length));
+            const size_t payload = ntohs(udp_length) - kUdpHeader;
+            if (payload > desc.len - headers) continue;
+            out[count++] = {frame + headers, payload};
+        }
+        rx_cursor_ += taken;
+        __atomic_store_n(rx_.consumer, rx_cursor_, __ATOMIC_RELEASE);
+        return count;
+    }
+
+private:
+    bool setup_socket() {
+        umem_ = ::mmap(nullptr, frames_ * kFrameSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (umem_ == MAP_FAILED) {
+            umem_ = nullptr;
+            return false;
+        }
+        xsk_fd_ = ::socket(AF_XDP, SOCK_RAW, 0);
+        if (xsk_fd_ < 0) return false;
+
+        xdp_umem_reg reg{};
+        reg.addr = reinterpret_cast<uint64_t>(umem_);
+        reg.len = frames_ * kFrameSize;
+        reg.chunk_size = kFrameSize;
+        const uint32_t entries = static_cast<uint32_t>(frames_);
+        const uint32_t completion_entries = 64; // Required by bind; unused without TX
+        if (::setsockopt(xsk_fd_, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) != 0 ||
+            ::setsockopt(xsk_fd_, SOL_XDP, XDP_UMEM_FILL_RING, &entries, sizeof(entries)) != 0 ||
+            ::setsockopt(xsk_fd_, SOL_XDP, XDP_UMEM_COMPLETION_RING, &completion_entries,
+                         sizeof(completion_entries)) != 0 ||
+            ::setsockopt(xsk_fd_, SOL_XDP, XDP_RX_RING, &entries, sizeof(entries)) != 0) {
+            return false;
+        }
+
+        xdp_mmap_offsets offsets{};
+        socklen_t length = sizeof(offsets);
+        if (::getsockopt(xsk_fd_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &length) != 0 ||
+            !rx_.open(xsk_fd_, offsets.rx, entries, XDP_PGOFF_RX_RING) ||
+            !fill_.open(xsk_fd_, offsets.fr, entries, XDP_UMEM_PGOFF_FILL_RING) ||
+            !completion_.open(xsk_fd_, offsets.cr, completion_entries, XDP_UMEM_PGOFF_COMPLETION_RING)) {
+            return false;
+        }
+
+        // Every frame starts out lent to the kernel
+        for (uint32_t i = 0; i < entries; i++) fill_.descs[i] = static_cast<uint64_t>(i) * kFrameSize;
+        fill_cursor_ = entries;
+        __atomic_store_n(fill_.producer, fill_cursor_, __ATOMIC_RELEASE);
+        rx_cursor_ = 0;
+        held_.reserve(frames_);
+
+        sockaddr_xdp addr{};
+        addr.sxdp_family = AF_XDP;
+        addr.sxdp_ifindex = ifindex_;
+        addr.sxdp_queue_id = config_.xdp_queue;
+        addr.sxdp_flags = XDP_USE_NEED_WAKEUP | (config_.xdp_zero_copy ? XDP_ZEROCOPY : XDP_COPY);
+        if (::bind(xsk_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return true;
+        addr.sxdp_flags = XDP_USE_NEED_WAKEUP | XDP_COPY; // Driver without zero-copy support
+        return ::bind(xsk_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    }
+
+    // Filter on the port actually bound, so port 0 works as for sockets
+    bool attach_program(uint16_t port) {
+        bpf_attr attr{};
+        attr.map_type = BPF_MAP_TYPE_XSKMAP;
+        attr.key_size = sizeof(uint32_t);
+        attr.value_size = sizeof(uint32_t);
+        attr.max_entries = config_.xdp_queue + 1;
+        map_fd_ = bpf(BPF_MAP_CREATE, &attr);
+        if (map_fd_ < 0) return false;
+
+        const uint32_t key = config_.xdp_queue;
+        const uint32_t value = static_cast<uint32_t>(xsk_fd_);
+        attr = bpf_attr{};
+        attr.map_fd = static_cast<uint32_t>(map_fd_);
+        attr.key = reinterpret_cast<uint64_t>(&key);
+        attr.value = reinterpret_cast<uint64_t>(&value);
+        if (bpf(BPF_MAP_UPDATE_ELEM, &attr) != 0) return false;
+
+        const std::vector<bpf_insn> program = redirect_program(map_fd_, port);
+        static const char license[] = "GPL";
+        attr = bpf_attr{};
+        attr.prog_type = BPF_PROG_TYPE_XDP;
+        attr.insns = reinterpret_cast<uint64_t>(program.data());
+        attr.insn_cnt = static_cast<uint32_t>(program.size());
+        attr.license = reinterpret_cast<uint64_t>(license);
+        prog_fd_ = bpf(BPF_PROG_LOAD, &attr);
+        if (prog_fd_ < 0) return false;
+
+        // Native (driver) mode first, generic SKB mode as the fallback
+        for (uint32_t mode : {XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE}) {
+            attr = bpf_attr{};
+            attr.link_create.prog_fd = static_cast<uint32_t>(prog_fd_);
+            attr.link_create.target_ifindex = ifindex_;
+            attr.link_create.attach_type = BPF_XDP;
+            attr.link_create.flags = mode;
+            link_fd_ = bpf(BPF_LINK_CREATE, &attr);
+            if (link_fd_ >= 0) return true;
+        }
+        return false;
+    }
+
+    // Return the frames from the last receive() to the fill ring
+    void recycle() {
+        if (held_.empty()) return;
+        for (uint64_t addr : held_) {
+            fill_.descs[fill_cursor_++ & fill_.mask] = addr & ~static_cast<uint64_t>(kFrameSize - 1);
+        }
+        held_.clear();
+        __atomic_store_n(fill_.producer, fill_cursor_, __ATOMIC_RELEASE);
+        if (__atomic_load_n(fill_.flags, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP) {
+            ::recvfrom(xsk_fd_, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+        }
+    }
+
+    FeedHandlerConfig config_;
+    const size_t frames_;
+    unsigned ifindex_ = 0;
+    int fd_ = -1;
+    int xsk_fd_ = -1;
+    int map_fd_ = -1;
+    int prog_fd_ = -1;
+    int link_fd_ = -1;
+
+    void* umem_ = nullptr;
+    XdpRing<xdp_desc> rx_;
+    XdpRing<uint64_t> fill_;
+    XdpRing<uint64_t> completion_;
+    uint32_t rx_cursor_ = 0;
+    uint32_t fill_cursor_ = 0;
+    std::vector<uint64_t> held_; // Frames lent to the caller until the next receive()
+};
+
+} // namespace
+
+std::unique_ptr<FeedReceiver> make_xdp_receiver(const FeedHandlerConfig& config) {
+    return std::make_unique<XdpReceiver>(config);
+}
+
+#else
+
+std::unique_ptr<FeedReceiver> make_xdp_receiver(const FeedHandlerConfig&) {
+    return nullptr;
+}
+
+#endif
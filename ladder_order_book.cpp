@@ -0,0 +1,251 @@
+#include "ladder_order_book.h"
+#include <algorithm>
+
+namespace {
+
+// Round a non power-of-two band up so slot() stays a mask
+size_t round_up_pow2(size_t n) {
+    size_t band = 1;
+    while (band < n) band <<= 1;
+    return band;
+}
+
+} // namespace
+
+LadderOrderBook::LadderOrderBook(const LadderOrderBookConfig& config)
+    : ticks_(config.tick_size)
+    , mask_(round_up_pow2(config.band_ticks) - 1)
+    , pool_(config.order_capacity)
+    , order_lookup_(config.order_capacity, config.id_index, config.first_order_id) {
+    const size_t band = mask_ + 1;
+    bids_.levels.resize(band);
+    bids_.occupied = LevelBitmap(band);
+    asks_.levels.resize(band);
+    asks_.occupied = LevelBitmap(band);
+}
+
+bool LadderOrderBook::next_at_or_above(const Side& side, Ticks from, Ticks& out) const {
+    if (side.level_count == 0) return false;
+    from = std::max(from, anchor_);
+    if (!in_band(from)) return false;
+
+    // Ticks [from, anchor + band) occupy slots start.. up to base, wrapping at the end
+    const size_t start = slot(from);
+    const size_t base = slot(anchor_);
+    size_t found = side.occupied.find_next(start);
+    if (start >= base) {
+        if (found == LevelBitmap::npos) {
+            found = side.occupied.find_next(0);
+            if (found >= base) return false;
+        }
+    } else if (found >= base) {
+        return false;
+    }
+    out = tick_at(found);
+    return true;
+}
+
+bool LadderOrderBook::next_at_or_below(const Side& side, Ticks from, Ticks& out) const {
+    if (side.level_count == 0) return false;
+    from = std::min(from, anchor_ + static_cast<Ticks>(mask_));
+    if (!in_band(from)) return false;
+
+    // Ticks [anchor, from] occupy slots base.. up to start, wrapping at the front
+    const size_t start = slot(from);
+    const size_t base = slot(anchor_);
+    size_t found = side.occupied.find_prev(start);
+    if (start >= base) {
+        if (found == LevelBitmap::npos || found < base) return false;
+    } else if (found == LevelBitmap::npos) {
+        found = side.occupied.find_prev(mask_);
+        if (found == LevelBitmap::npos || found < base) return false;
+    }
+    out = tick_at(found);
+    return true;
+}
+
+bool LadderOrderBook::bring_into_band(Ticks price) {
+    if (in_band(price)) return true;
+
+    const Ticks band = static_cast<Ticks>(mask_) + 1;
+    if (bids_.level_count == 0 && asks_.level_count == 0) {
+        // Empty book: centre the window on the first price
+        anchor_ = price - band / 2;
+        return true;
+    }
+
+    // Occupied span across both sides
+    Ticks lo = price;
+    Ticks hi = price;
+    Ticks t;
+    if (next_at_or_above(bids_, anchor_, t)) lo = std::min(lo, t);
+    if (asks_.level_count > 0) lo = std::min(lo, asks_.best);
+    if (bids_.level_count > 0) hi = std::max(hi, bids_.best);
+    if (next_at_or_below(asks_, anchor_ + band - 1, t)) hi = std::max(hi, t);
+
+    if (hi - lo >= band) {
+        return false; // Price band exceeded
+    }
+
+    // Every slot leaving the window is empty, so moving the anchor is enough
+    anchor_ = lo - (band - 1 - (hi - lo)) / 2;
+    return true;
+}
+
+bool LadderOrderBook::add_order(const Order& order) {
+    const Ticks price = ticks_.to_ticks(order.price);
+    if (BOOK_UNLIKELY(!order_storable(price, order.quantity))) {
+        return false;
+    }
+    if (BOOK_UNLIKELY(!in_band(price)) && !bring_into_band(price)) {
+        return false;
+    }
+
+    Side& side = order.is_buy ? bids_ : asks_;
+    const size_t index = slot(price);
+    PriceLevelData& price_level = side.levels[index];
+
+    if (price_level.orders.empty()) {
+        add_level(side, order.is_buy, price);
+    }
+
+    // Take a pool slot and append it to the FIFO queue at this price level
+    OrderHandle handle = pool_.allocate();
+    OrderNode& node = pool_[handle];
+    node.order_id = order.order_id;
+    node.quantity = static_cast<NodeQuantity>(order.quantity);
+    node.price = static_cast<NodeTicks>(price);
+    price_level.orders.push_back(pool_, handle);
+    price_level.total_quantity += order.quantity;
+
+    // Add to lookup table
+    OrderLocation location;
+    location.slot = handle;
+    location.is_buy = order.is_buy;
+    order_lookup_.insert(order.order_id, location);
+    return true;
+}
+
+void LadderOrderBook::add_level(Side& side, bool is_buy, Ticks price) {
+    // Mark a new level and refresh the cached best price
+    side.occupied.set(slot(price));
+    if (side.level_count++ == 0 || (is_buy ? price > side.best : price < side.best)) {
+        side.best = price;
+    }
+}
+
+void LadderOrderBook::erase_level(Side& side, bool is_buy, Ticks price) {
+    side.occupied.clear(slot(price));
+    if (--side.level_count == 0 || price != side.best) {
+        return;
+    }
+
+    // Best level emptied: one bitmap scan finds the next one
+    Ticks next = 0;
+    if (is_buy) {
+        next_at_or_below(side, price - 1, next);
+    } else {
+        next_at_or_above(side, price + 1, next);
+    }
+    side.best = next;
+}
+
+bool LadderOrderBook::cancel_order(uint64_t order_id) {
+    // Look up the order
+    size_t lookup_slot = order_lookup_.find(order_id);
+    if (BOOK_UNLIKELY(lookup_slot == OrderIdIndex<OrderLocation>::npos)) {
+        return false; // Order not found
+    }
+
+    const OrderLocation& location = order_lookup_.value_at(lookup_slot);
+    const OrderNode& order = pool_[location.slot];
+    Side& side = location.is_buy ? bids_ : asks_;
+    PriceLevelData& price_level = side.levels[slot(order.price)];
+
+    // Update total quantity and unlink the order from the level queue
+    price_level.total_quantity -= order.quantity;
+    price_level.orders.unlink(pool_, location.slot);
+
+    // If the price level is now empty, clear its bit
+    if (price_level.orders.empty()) {
+        erase_level(side, location.is_buy, order.price);
+    }
+
+    // Return the slot and remove from lookup table
+    pool_.release(location.slot);
+    order_lookup_.erase_at(lookup_slot);
+    return true;
+}
+
+bool LadderOrderBook::amend_order(uint64_t order_id, double new_price, uint64_t new_quantity) {
+    // Look up the order
+    size_t lookup_slot = order_lookup_.find(order_id);
+    if (BOOK_UNLIKELY(lookup_slot == OrderIdIndex<OrderLocation>::npos)) {
+        return false; // Order not found
+    }
+
+    const OrderLocation& location = order_lookup_.value_at(lookup_slot);
+    OrderNode& order = pool_[location.slot];
+    const Ticks price = ticks_.to_ticks(new_price);
+    if (BOOK_UNLIKELY(!order_storable(price, new_quantity))) {
+        return false;
+    }
+
+    Side& side = location.is_buy ? bids_ : asks_;
+    PriceLevelData& price_level = side.levels[slot(order.price)];
+
+    if (order.price != price) {
+        // Make room first so a rejected re-price leaves the order untouched
+        if (BOOK_UNLIKELY(!in_band(price)) && !bring_into_band(price)) {
+            return false;
+        }
+
+        // Price change: move the node to the tail of the new level; the pool
+        // slot and index entry stay as they are
+        const Ticks old_price = order.price;
+        price_level.total_quantity -= order.quantity;
+        price_level.orders.unlink(pool_, location.slot);
+        if (price_level.orders.empty()) {
+            erase_level(side, location.is_buy, old_price);
+        }
+
+        PriceLevelData& new_level = side.levels[slot(price)];
+        if (new_level.orders.empty()) {
+            add_level(side, location.is_buy, price);
+        }
+        order.price = static_cast<NodeTicks>(price);
+        order.quantity = static_cast<NodeQuantity>(new_quantity);
+        new_level.orders.push_back(pool_, location.slot);
+        new_level.total_quantity += new_quantity;
+        return true;
+    }
+
+    // Only quantity is changing: a decrease keeps queue priority, an
+    // increase goes to the back of the queue
+    price_level.total_quantity = price_level.total_quantity - order.quantity + new_quantity;
+    if (new_quantity > order.quantity) {
+        price_level.orders.unlink(pool_, location.slot);
+        price_level.orders.push_back(pool_, location.slot);
+    }
+    order.quantity = static_cast<NodeQuantity>(new_quantity);
+    return true;
+}
+
+void LadderOrderBook::get_snapshot(size_t depth, std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const {
+    bids.clear();
+    asks.clear();
+
+    // Collect top N bids by walking the bitmap downward from the best bid
+    Ticks price = bids_.best;
+    for (bool found = bids_.level_count > 0; found && bids.size() < depth;
+         found = next_at_or_below(bids_, price - 1, price)) {
+        bids.push_back({ticks_.to_price(price), bids_.levels[slot(price)].total_quantity});
+    }
+
+    // Collect top N asks by walking upward from the best ask
+    price = asks_.best;
+    for (bool found = asks_.level_count > 0; found && asks.size() < depth;
+         found = next_at_or_above(asks_, price + 1, price)) {
+        asks.push_back({ticks_.to_price(price), asks_.levels[slot(price)].total_quantity});
+    }
+}
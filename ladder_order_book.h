@@ -0,0 +1,97 @@
+#pragma once
+#include "order_book.h"
+#include "level_bitmap.h"
+
+// Configuration for a bounded-band instrument
+struct LadderOrderBookConfig {
+    double tick_size = 0.01;         // Minimum price increment of the instrument
+    size_t band_ticks = 4096;        // Ticks covered by the ladder; rounded up to a power of two
+    size_t order_capacity = 1 << 16; // Order slots preallocated in the pool and id index
+    OrderIdIndexMode id_index = OrderIdIndexMode::Hashed;
+    uint64_t first_order_id = 0;     // Base id for OrderIdIndexMode::Direct
+};
+
+// Order book for instruments with a bounded price band.
+// Levels live in a contiguous ring indexed by (tick & mask); the window
+// [anchor, anchor + band) slides without moving any level data. Per-side
+// occupancy bitmaps make "next non-empty level" a ctz/clz.
+class LadderOrderBook {
+public:
+    // @throw std::length_error if config.order_capacity exceeds kMaxOrderCapacity
+    explicit LadderOrderBook(const LadderOrderBookConfig& config = LadderOrderBookConfig{});
+    ~LadderOrderBook() = default;
+
+    // Insert a new order into the book
+    // @return false if the price cannot be brought inside the band
+    BOOK_HOT bool add_order(const Order& order);
+
+    // Cancel an existing order by its ID
+    BOOK_HOT bool cancel_order(uint64_t order_id);
+
+    // Amend an existing order's price or quantity
+    BOOK_HOT bool amend_order(uint64_t order_id, double new_price, uint64_t new_quantity);
+
+    // Get a snapshot of top N bid and ask levels (aggregated quantities)
+    void get_snapshot(size_t depth, std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const;
+
+    // Print current state of the order book
+    BOOK_COLD void print_book(size_t depth = 10) const;
+
+    // Price <-> tick conversion used at the API edge
+    const TickScale& tick_scale() const { return ticks_; }
+
+private:
+    // Internal structure to maintain orders at each price level; kept at
+    // 16 bytes (four per line) since the ladder scans levels contiguously
+    struct PriceLevelData {
+        OrderQueue orders; // FIFO queue of orders at this price
+        uint64_t total_quantity = 0;
+    };
+    static_assert(sizeof(PriceLevelData) == 16, "ladder levels must stay four per cache line");
+
+    // One side of the ladder; best is only meaningful while level_count > 0
+    struct Side {
+        std::vector<PriceLevelData> levels;
+        LevelBitmap occupied;
+        Ticks best = 0;
+        size_t level_count = 0;
+    };
+
+    size_t slot(Ticks price) const { return static_cast<size_t>(price) & mask_; }
+    Ticks tick_at(size_t slot) const { return anchor_ + static_cast<Ticks>((slot - this->slot(anchor_)) & mask_); }
+    bool in_band(Ticks price) const { return price >= anchor_ && price - anchor_ <= static_cast<Ticks>(mask_); }
+
+    // Slide the window so that price fits; fails if the occupied span is too wide.
+    // Callers test in_band first, so only a recentre reaches this
+    BOOK_COLD bool bring_into_band(Ticks price);
+
+    // Lowest occupied tick >= from / highest occupied tick <= from
+    bool next_at_or_above(const Side& side, Ticks from, Ticks& out) const;
+    bool next_at_or_below(const Side& side, Ticks from, Ticks& out) const;
+
+    void add_level(Side& side, bool is_buy, Ticks price);
+    void erase_level(Side& side, bool is_buy, Ticks price);
+
+    TickScale ticks_;
+    size_t mask_;
+    Ticks anchor_ = 0; // Lowest tick covered by the ring
+
+    Side bids_;
+    Side asks_;
+
+    // Storage for every resting order; levels link into it by handle
+    OrderPool pool_;
+
+    // Order lookup for O(1) access through a flat, presized table
+    struct OrderLocation {
+#ifdef ORDERBOOK_COMPACT_ORDERS
+        OrderHandle slot : 31; // As in OrderBook
+        OrderHandle is_buy : 1;
+#else
+        OrderHandle slot; // Pool node; holds the level price
+        bool is_buy;
+#endif
+    };
+
+    OrderIdIndex<OrderLocation> order_lookup_;
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// HDR-style log-linear histogram of non-negative integer samples (e.g. ns
+// or cycles). Each power-of-two range is split into 2^kSubBucketBits linear
+// sub-buckets, so every recorded value is kept to within ~3% relative error
+// over the whole 64-bit range with a fixed ~1900-bucket table. Recording is
+// a clz, a shift and an increment; nothing allocates after construction.
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 5;
+    static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBucketBits;
+
+    LatencyHistogram() : counts_(bucket_index(UINT64_MAX) + 1) {}
+
+    void record(uint64_t value) {
+        ++counts_[bucket_index(value)];
+        ++count_;
+        sum_ += value;
+        if (value < min_) min_ = value;
+        if (value > max_) max_ = value;
+    }
+
+    // Fold another histogram into this one
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        if (other.min_ < min_) min_ = other.min_;
+        if (other.max_ > max_) max_ = other.max_;
+    }
+
+    void reset() {
+        counts_.assign(counts_.size(), 0);
+        count_ = sum_ = max_ = 0;
+        min_ = UINT64_MAX;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0; }
+
+    // Smallest bucket bound with at least `percentile` % of samples at or
+    // below it; clamped to the observed min/max
+    uint64_t percentile(double percentile) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count_) + 0.5);
+        if (rank == 0) rank = 1;
+        if (rank > count_) rank = count_;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                const uint64_t value = bucket_upper(i);
+                if (value < min_) return min_;
+                return value > max_ ? max_ : value;
+            }
+        }
+        return max_;
+    }
+
+    static size_t bucket_index(uint64_t value) {
+        if (value < 2 * kSubBuckets) {
+            return static_cast<size_t>(value); // Exact below 64
+        }
+        const unsigned magnitude = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        const unsigned shift = magnitude - kSubBucketBits;
+        return static_cast<size_t>((shift + 1) * kSubBuckets + ((value >> shift) - kSubBuckets));
+    }
+
+private:
+    friend class AtomicLatencyHistogram;
+
+    // Largest value that maps to bucket i
+    static uint64_t bucket_upper(size_t i) {
+        if (i < 2 * kSubBuckets) return i;
+        const unsigned shift = static_cast<unsigned>(i / kSubBuckets) - 1;
+        const uint64_t top = i % kSubBuckets + kSubBuckets;
+        return (top << shift) + ((uint64_t{1} << shift) - 1);
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+// LatencyHistogram for one recording thread that other threads read while
+// it records: same buckets, but counts are relaxed atomics. The single
+// writer never does a read-modify-write, so record() costs the same plain
+// loads and stores as LatencyHistogram's. Readers take a snapshot(); it may
+// split a concurrent record() but never tears a count.
+class AtomicLatencyHistogram {
+public:
+    AtomicLatencyHistogram()
+        : buckets_(LatencyHistogram::bucket_index(UINT64_MAX) + 1)
+        , counts_(std::make_unique<std::atomic<uint64_t>[]>(buckets_)) {
+        reset();
+    }
+
+    // Recording thread only
+    void record(uint64_t value) {
+        bump(counts_[LatencyHistogram::bucket_index(value)], 1);
+        bump(count_, 1);
+        bump(sum_, value);
+        if (value < min_.load(std::memory_order_relaxed)) min_.store(value, std::memory_order_relaxed);
+        if (value > max_.load(std::memory_order_relaxed)) max_.store(value, std::memory_order_relaxed);
+    }
+
+    // Recording thread only (or while it is quiet)
+    void reset() {
+        for (size_t i = 0; i < buckets_; ++i) counts_[i].store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        min_.store(UINT64_MAX, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+    // Any thread: copy into a plain histogram for percentiles
+    void snapshot(LatencyHistogram& out) const {
+        out.count_ = 0;
+        for (size_t i = 0; i < buckets_; ++i) {
+            out.counts_[i] = counts_[i].load(std::memory_order_relaxed);
+            out.count_ += out.counts_[i];
+        }
+        out.sum_ = sum_.load(std::memory_order_relaxed);
+        out.min_ = min_.load(std::memory_order_relaxed);
+        out.max_ = max_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    size_t buckets_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> min_{UINT64_MAX};
+    std::atomic<uint64_t> max_{0};
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Two-level occupancy bitmap over price slots.
+// Finding the next/previous non-empty slot is a ctz/clz on one word,
+// falling back to the summary word only when the current word is empty.
+class LevelBitmap {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit LevelBitmap(size_t size = 0)
+        : size_(size)
+        , words_((size + 63) / 64, 0)
+        , summary_((words_.size() + 63) / 64, 0) {}
+
+    size_t size() const { return size_; }
+
+    bool test(size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1; }
+
+    void set(size_t i) {
+        words_[i >> 6] |= uint64_t{1} << (i & 63);
+        summary_[i >> 12] |= uint64_t{1} << ((i >> 6) & 63);
+    }
+
+    void clear(size_t i) {
+        uint64_t& word = words_[i >> 6];
+        word &= ~(uint64_t{1} << (i & 63));
+        if (word == 0) {
+            summary_[i >> 12] &= ~(uint64_t{1} << ((i >> 6) & 63));
+        }
+    }
+
+    // Lowest set index in [i, size), or npos
+    size_t find_next(size_t i) const {
+        if (i >= size_) return npos;
+        size_t w = i >> 6;
+        uint64_t bits = words_[w] & (~uint64_t{0} << (i & 63));
+        if (bits) return (w << 6) + __builtin_ctzll(bits);
+
+        // Next non-empty word after w
+        size_t s = w + 1;
+        if (s >= words_.size()) return npos;
+        size_t sw = s >> 6;
+        uint64_t summary = summary_[sw] & (~uint64_t{0} << (s & 63));
+        while (!summary) {
+            if (++sw >= summary_.size()) return npos;
+            summary = summary_[sw];
+        }
+        w = (sw << 6) + __builtin_ctzll(summary);
+        return (w << 6) + __builtin_ctzll(words_[w]);
+    }
+
+    // Highest set index in [0, i], or npos
+    size_t find_prev(size_t i) const {
+        if (size_ == 0) return npos;
+        if (i >= size_) i = size_ - 1;
+        size_t w = i >> 6;
+        uint64_t bits = words_[w] & (~uint64_t{0} >> (63 - (i & 63)));
+        if (bits) return (w << 6) + 63 - __builtin_clzll(bits);
+
+        // Previous non-empty word before w
+        if (w == 0) return npos;
+        size_t s = w - 1;
+        size_t sw = s >> 6;
+        uint64_t summary = summary_[sw] & (~uint64_t{0} >> (63 - (s & 63)));
+        while (!summary) {
+            if (sw-- == 0) return npos;
+            summary = summary_[sw];
+        }
+        w = (sw << 6) + 63 - __builtin_clzll(summary);
+        return (w << 6) + 63 - __builtin_clzll(words_[w]);
+    }
+
+private:
+    size_t size_;
+    std::vector<uint64_t> words_;
+    std::vector<uint64_t> summary_;
+};
@@ -1,54 +1,87 @@
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <thread>
+#include <vector>
+#include "lock_free_list.h"
 
-struct Node {
-    int value;
-    Node* next; // raw pointer is fine here
-    Node(int v) : value(v), next(nullptr) {}
-};
-
-class LockFreeList {
-    std::atomic<Node*> head;
-
-public:
-    LockFreeList() : head(nullptr) {}
-
-    void insert(int val) {
-        Node* newNode = new Node(val);
-        Node* oldHead;
-
-        // try until CAS succeeds
-        do {
-            oldHead = head.load();
-            newNode->next = oldHead;
-        } while (!head.compare_exchange_strong(oldHead, newNode));
-    }
-
-    void print() {
-        Node* curr = head.load();
-        while (curr) {
-            std::cout << curr->value << " ";
-            curr = curr->next;
-        }
-        std::cout << "\n";
-    }
-};
-
-int main() {
-    LockFreeList list;
+// Two writers insert concurrently, then the list is printed in key order.
+// LockFreeList (lock_free_list.h) also supports remove/find and reclaims
+// removed nodes safely; see contention() for a mixed workload.
+void demo() {
+    LockFreeList<int> list;
 
     std::thread t1([&]() {
-        for (int i = 1; i <= 5; i++) list.insert(i * 10);
+        auto session = list.session();
+        for (int i = 1; i <= 5; i++) list.insert(session, i * 10, i * 10);
     });
 
     std::thread t2([&]() {
-        for (int i = 1; i <= 5; i++) list.insert(i * 100);
+        auto session = list.session();
+        for (int i = 1; i <= 5; i++) list.insert(session, i * 100, i * 100);
     });
 
     t1.join();
     t2.join();
 
-    list.print();
+    auto session = list.session();
+    list.remove(session, 500);
+    list.for_each(session, [](uint64_t, int value) { std::cout << value << " "; });
+    std::cout << "\n";
+}
+
+// Registry-style workload: mostly scans by key, some churn.
+// Each thread does 90% find, 5% insert, 5% remove over a shared key range.
+void contention(size_t threads, uint64_t ops_per_thread) {
+    const uint64_t key_range = 1024;
+    LockFreeList<uint64_t> list;
+    {
+        auto session = list.session();
+        for (uint64_t key = 0; key < key_range; key += 2) list.insert(session, key, key);
+    }
+
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            auto session = list.session();
+            uint64_t state = 0x9E3779B97F4A7C15ull * (t + 1);
+            uint64_t value = 0;
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (uint64_t i = 0; i < ops_per_thread; i++) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                const uint64_t key = state % key_range;
+                const uint64_t dice = (state >> 32) % 100;
+                if (dice < 90) {
+                    list.find(session, key, value);
+                } else if (dice < 95) {
+                    list.insert(session, key, key);
+                } else {
+                    list.remove(session, key);
+                }
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) worker.join();
+    auto end = std::chrono::steady_clock::now();
+
+    const double us = std::chrono::duration<double, std::micro>(end - start).count();
+    std::cout << threads << " threads: "
+              << static_cast<double>(threads * ops_per_thread) / us << " Mops/s, "
+              << list.allocated_nodes() << " nodes allocated\n";
 }
 
+int main() {
+    demo();
+
+    std::cout << "Contention (90% find / 5% insert / 5% remove, 1024 keys)\n";
+    for (size_t threads : {1, 2, 4, 8, 16, 32}) {
+        contention(threads, 200000);
+    }
+}
@@ -0,0 +1,289 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Sorted lock-free set of (key, value) pairs: the Harris-Michael list.
+// insert/remove are CAS-based; find/for_each only load, so many reader
+// threads can scan it while writers mutate it.
+//
+// Removed nodes are reclaimed with epoch-based reclamation: a node unlinked
+// while the global epoch is e goes back to its thread's node pool once the
+// epoch reaches e + 2, by which time no thread can still be reading it.
+// Nodes come from per-session free lists refilled from chunked slabs, so
+// steady-state inserts never call `new`.
+//
+// Every thread works through its own Session (see session()).
+template <typename Value>
+class LockFreeList {
+    struct Node {
+        uint64_t key;
+        Value value;
+        std::atomic<uintptr_t> next; // Low bit set = logically removed
+    };
+
+    static constexpr size_t kChunkNodes = 1024;
+    static constexpr size_t kAdvanceEvery = 64;
+
+    // Per-thread reclamation state, on its own cache line
+    struct alignas(64) Participant {
+        std::atomic<bool> in_use{false};
+        std::atomic<uint64_t> local_epoch{0}; // (epoch << 1) | 1 while inside an operation
+        std::vector<Node*> limbo[3];          // Retired nodes, by epoch % 3
+        uint64_t limbo_epoch[3] = {0, 0, 0};
+        Node* free_head = nullptr;
+        size_t retired_since_advance = 0;
+    };
+
+public:
+    // A thread's handle on the list; not shareable between threads
+    class Session {
+    public:
+        Session(Session&& other) noexcept : self_(other.self_) { other.self_ = nullptr; }
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+        ~Session() {
+            if (self_ != nullptr) self_->in_use.store(false, std::memory_order_release);
+        }
+
+        bool valid() const { return self_ != nullptr; }
+
+    private:
+        friend class LockFreeList;
+        explicit Session(Participant* self) : self_(self) {}
+        Participant* self_;
+    };
+
+    explicit LockFreeList(size_t max_sessions = 64) : participants_(max_sessions) {}
+
+    LockFreeList(const LockFreeList&) = delete;
+    LockFreeList& operator=(const LockFreeList&) = delete;
+
+    // Nodes live in chunks_, so nothing needs freeing one by one
+    ~LockFreeList() = default;
+
+    // Claim a participant slot for the calling thread
+    // @return an invalid session if max_sessions are already in use
+    Session session() {
+        for (Participant& p : participants_) {
+            bool expected = false;
+            if (!p.in_use.load(std::memory_order_relaxed) &&
+                p.in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return Session(&p);
+            }
+        }
+        return Session(nullptr);
+    }
+
+    // @return false if the key is already present
+    bool insert(Session& session, uint64_t key, const Value& value) {
+        Participant& self = *session.self_;
+        Guard guard(*this, self);
+        Node* node = nullptr;
+        for (;;) {
+            std::atomic<uintptr_t>* prev;
+            Node* curr;
+            if (search(self, key, prev, curr)) {
+                if (node != nullptr) recycle(self, node); // Never published
+                return false;
+            }
+            if (node == nullptr) {
+                node = allocate(self);
+                node->key = key;
+                node->value = value;
+            }
+            node->next.store(reinterpret_cast<uintptr_t>(curr), std::memory_order_relaxed);
+            uintptr_t expected = reinterpret_cast<uintptr_t>(curr);
+            if (prev->compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(node),
+                                              std::memory_order_release, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    // @return false if the key is not present
+    bool remove(Session& session, uint64_t key) {
+        Participant& self = *session.self_;
+        Guard guard(*this, self);
+        for (;;) {
+            std::atomic<uintptr_t>* prev;
+            Node* curr;
+            if (!search(self, key, prev, curr)) {
+                return false;
+            }
+            // Logical removal: mark curr's next pointer
+            uintptr_t succ = curr->next.load(std::memory_order_acquire);
+            if (marked(succ)) {
+                continue; // Another remover won; search() will unlink it
+            }
+            if (!curr->next.compare_exchange_strong(succ, succ | 1, std::memory_order_acq_rel,
+                                                    std::memory_order_relaxed)) {
+                continue;
+            }
+            // Physical removal; if it fails a later search() finishes the job
+            uintptr_t expected = reinterpret_cast<uintptr_t>(curr);
+            if (prev->compare_exchange_strong(expected, succ, std::memory_order_acq_rel,
+                                              std::memory_order_relaxed)) {
+                retire(self, curr);
+            } else {
+                search(self, key, prev, curr);
+            }
+            return true;
+        }
+    }
+
+    // Read-only lookup; copies the value out while the node is protected
+    bool find(Session& session, uint64_t key, Value& value) {
+        Guard guard(*this, *session.self_);
+        Node* curr = pointer(head_.load(std::memory_order_acquire));
+        while (curr != nullptr && curr->key < key) {
+            curr = pointer(curr->next.load(std::memory_order_acquire));
+        }
+        if (curr == nullptr || curr->key != key || marked(curr->next.load(std::memory_order_acquire))) {
+            return false;
+        }
+        value = curr->value;
+        return true;
+    }
+
+    // Visit live entries in key order; fn(key, value) must not call back into the list
+    template <typename Fn>
+    void for_each(Session& session, Fn&& fn) {
+        Guard guard(*this, *session.self_);
+        for (Node* curr = pointer(head_.load(std::memory_order_acquire)); curr != nullptr;) {
+            const uintptr_t next = curr->next.load(std::memory_order_acquire);
+            if (!marked(next)) fn(curr->key, static_cast<const Value&>(curr->value));
+            curr = pointer(next);
+        }
+    }
+
+    // Nodes carved from slabs so far (live, retired and pooled)
+    size_t allocated_nodes() const {
+        std::lock_guard<std::mutex> lock(chunks_mutex_);
+        return chunks_.size() * kChunkNodes;
+    }
+
+private:
+    // Marks the calling thread as active in the current epoch for its lifetime
+    struct Guard {
+        Guard(LockFreeList& list, Participant& self) : self_(self) {
+            const uint64_t epoch = list.global_epoch_.load(std::memory_order_seq_cst);
+            self_.local_epoch.store((epoch << 1) | 1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        ~Guard() { self_.local_epoch.store(0, std::memory_order_release); }
+        Participant& self_;
+    };
+
+    static Node* pointer(uintptr_t p) { return reinterpret_cast<Node*>(p & ~uintptr_t{1}); }
+    static bool marked(uintptr_t p) { return (p & 1) != 0; }
+
+    // Find the first node with node->key >= key, unlinking marked nodes on the way
+    // @return whether that node holds key; prev is the link that points at curr
+    bool search(Participant& self, uint64_t key, std::atomic<uintptr_t>*& prev, Node*& curr) {
+    retry:
+        prev = &head_;
+        uintptr_t link = prev->load(std::memory_order_acquire);
+        for (;;) {
+            curr = pointer(link);
+            if (curr == nullptr) {
+                return false;
+            }
+            const uintptr_t succ = curr->next.load(std::memory_order_acquire);
+            if (marked(succ)) {
+                uintptr_t expected = reinterpret_cast<uintptr_t>(curr);
+                if (!prev->compare_exchange_strong(expected, succ & ~uintptr_t{1}, std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed)) {
+                    goto retry; // prev changed or was itself marked
+                }
+                retire(self, curr);
+                link = succ & ~uintptr_t{1};
+                continue;
+            }
+            if (curr->key >= key) {
+                return curr->key == key;
+            }
+            prev = &curr->next;
+            link = succ;
+        }
+    }
+
+    Node* allocate(Participant& self) {
+        if (self.free_head == nullptr) {
+            reclaim(self);
+        }
+        if (self.free_head == nullptr) {
+            // Slow path: carve a new slab into this session's free list
+            auto chunk = std::make_unique<Node[]>(kChunkNodes);
+            for (size_t i = 0; i < kChunkNodes; ++i) {
+                recycle(self, &chunk[i]);
+            }
+            std::lock_guard<std::mutex> lock(chunks_mutex_);
+            chunks_.push_back(std::move(chunk));
+        }
+        Node* node = self.free_head;
+        self.free_head = pointer(node->next.load(std::memory_order_relaxed));
+        return node;
+    }
+
+    void recycle(Participant& self, Node* node) {
+        node->next.store(reinterpret_cast<uintptr_t>(self.free_head), std::memory_order_relaxed);
+        self.free_head = node;
+    }
+
+    void retire(Participant& self, Node* node) {
+        const uint64_t epoch = global_epoch_.load(std::memory_order_seq_cst);
+        const size_t bucket = epoch % 3;
+        if (self.limbo_epoch[bucket] != epoch) {
+            // Same bucket, three or more epochs ago: already safe to reuse
+            flush(self, bucket);
+            self.limbo_epoch[bucket] = epoch;
+        }
+        self.limbo[bucket].push_back(node);
+        if (++self.retired_since_advance >= kAdvanceEvery) {
+            self.retired_since_advance = 0;
+            try_advance();
+        }
+    }
+
+    // Move every limbo bucket that is two epochs old into the free list
+    void reclaim(Participant& self) {
+        try_advance();
+        const uint64_t epoch = global_epoch_.load(std::memory_order_seq_cst);
+        for (size_t bucket = 0; bucket < 3; ++bucket) {
+            if (self.limbo_epoch[bucket] + 2 <= epoch) {
+                flush(self, bucket);
+            }
+        }
+    }
+
+    void flush(Participant& self, size_t bucket) {
+        for (Node* node : self.limbo[bucket]) {
+            recycle(self, node);
+        }
+        self.limbo[bucket].clear();
+    }
+
+    // Advance the epoch if every active thread has observed the current one
+    void try_advance() {
+        uint64_t epoch = global_epoch_.load(std::memory_order_seq_cst);
+        for (const Participant& p : participants_) {
+            const uint64_t local = p.local_epoch.load(std::memory_order_seq_cst);
+            if ((local & 1) && (local >> 1) != epoch) {
+                return;
+            }
+        }
+        global_epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+    }
+
+    alignas(64) std::atomic<uintptr_t> head_{0};
+    alignas(64) std::atomic<uint64_t> global_epoch_{0};
+    std::vector<Participant> participants_;
+
+    mutable std::mutex chunks_mutex_;
+    std::vector<std::unique_ptr<Node[]>> chunks_;
+};
@@ -1,8 +1,37 @@
 #include "order_book.h"
+#include "ladder_order_book.h"
+#include "book_manager.h"
+#include "numa_placement.h"
+#include "stage_pipeline.h"
+#include "pool_ptr.h"
+#include "feed_handler.h"
+#include "feed_capture.h"
+#include "multicast_publisher.h"
+#include "tick_store.h"
+#include "latency_histogram.h"
+#include "lockFreeWaitFree/lock_free_list.h"
+#include "SPSC_QUEUES/spsc_q1.cpp"
+#include "SPSC_QUEUES/spsc_q2.cpp"
+#include "SPSC_QUEUES/spsc_q3.cpp"
+#include "SPSC_QUEUES/mpsc_q.cpp"
+#include "SPSC_QUEUES/spsc_q4.cpp"
+#include "SPSC_QUEUES/spsc_shm.cpp"
 #include <iostream>
 #include <iomanip>
 #include <chrono>
+#include <cmath>
 #include <cassert>
+#include <algorithm>
+#include <array>
+#include <map>
+#include <thread>
+#include <type_traits>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
 
 // Helper function to get current timestamp in nanoseconds
 uint64_t get_timestamp_ns() {
@@ -12,9 +41,10 @@ uint64_t get_timestamp_ns() {
 }
 
 // Test basic add order functionality
+template <typename Book>
 void test_add_orders() {
     std::cout << "\n=== Test: Add Orders ===" << std::endl;
-    OrderBook book;
+    Book book;
     
     // Add some buy orders
     Order order1 = {1, true, 100.0, 50, get_timestamp_ns()};
@@ -56,9 +86,10 @@ void test_add_orders() {
 }
 
 // Test cancel order functionality
+template <typename Book>
 void test_cancel_order() {
     std::cout << "\n=== Test: Cancel Order ===" << std::endl;
-    OrderBook book;
+    Book book;
     
     Order order1 = {1, true, 100.0, 50, get_timestamp_ns()};
     Order order2 = {2, true, 100.0, 30, get_timestamp_ns()};
@@ -93,9 +124,10 @@ void test_cancel_order() {
 }
 
 // Test amend order functionality
+template <typename Book>
 void test_amend_order() {
     std::cout << "\n=== Test: Amend Order ===" << std::endl;
-    OrderBook book;
+    Book book;
     
     Order order1 = {1, true, 100.0, 50, get_timestamp_ns()};
     Order order2 = {2, false, 101.0, 40, get_timestamp_ns()};
@@ -136,9 +168,10 @@ void test_amend_order() {
 }
 
 // Test snapshot with different depths
+template <typename Book>
 void test_snapshot_depth() {
     std::cout << "\n=== Test: Snapshot Depth ===" << std::endl;
-    OrderBook book;
+    Book book;
     
     // Add multiple price levels
     for (int i = 0; i < 10; i++) {
@@ -168,9 +201,10 @@ void test_snapshot_depth() {
 }
 
 // Test FIFO priority within price level
+template <typename Book>
 void test_fifo_priority() {
     std::cout << "\n=== Test: FIFO Priority ===" << std::endl;
-    OrderBook book;
+    Book book;
     
     // Add multiple orders at the same price
     Order order1 = {1, true, 100.0, 50, get_timestamp_ns()};
@@ -199,10 +233,43 @@ void test_fifo_priority() {
     std::cout << "✓ FIFO priority test passed" << std::endl;
 }
 
+// Test tick-based price keys
+template <typename Book>
+void test_tick_prices() {
+    std::cout << "\n=== Test: Tick Prices ===" << std::endl;
+    Book book({0.25});
+    
+    // Prices that differ only by floating-point noise share a level
+    Order order1 = {1, true, 100.25, 50, get_timestamp_ns()};
+    Order order2 = {2, true, 100.0 + 0.1 + 0.15, 30, get_timestamp_ns()};
+    book.add_order(order1);
+    book.add_order(order2);
+    
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(5, bids, asks);
+    assert(bids.size() == 1);
+    assert(bids[0].price == 100.25);
+    assert(bids[0].total_quantity == 80);
+    
+    // Rounding noise on amend is a quantity change, not a re-price
+    bool result = book.amend_order(1, 100.25000000001, 60);
+    assert(result == true);
+    book.get_snapshot(5, bids, asks);
+    assert(bids.size() == 1);
+    assert(bids[0].total_quantity == 90);
+    
+    // Prices snap to the instrument's tick grid
+    assert(book.tick_scale().to_ticks(100.25) == 401);
+    assert(book.tick_scale().to_price(401) == 100.25);
+    
+    std::cout << "✓ Tick prices test passed" << std::endl;
+}
+
 // Performance test
+template <typename Book>
 void test_performance() {
     std::cout << "\n=== Test: Performance ===" << std::endl;
-    OrderBook book;
+    Book book;
     
     const int num_orders = 10000;
     
@@ -247,21 +314,3137 @@ void test_performance() {
     std::cout << "Average: " << std::fixed << std::setprecision(3)
               << static_cast<double>(duration.count()) / 1000 << " µs per snapshot" << std::endl;
     
+    // Fixed-capacity snapshot performance, where the book supports it
+    if constexpr (std::is_same_v<Book, OrderBook>) {
+        std::array<PriceLevel, 10> bid_array, ask_array;
+        size_t levels = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < 1000; i++) {
+            levels += book.get_snapshot(bid_array, ask_array).asks;
+        }
+        end = std::chrono::high_resolution_clock::now();
+        duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        assert(levels == 1000 * 10);
+        std::cout << "1000 array snapshots in " << duration.count() << " µs" << std::endl;
+    }
+    
     std::cout << "✓ Performance test completed" << std::endl;
 }
 
+// Test that the ladder slides its window and rejects prices beyond the band
+void test_ladder_band() {
+    std::cout << "\n=== Test: Ladder Band ===" << std::endl;
+    LadderOrderBook book({1.0, 64});
+    
+    // Window follows the first order, then slides to fit later ones
+    bool result = book.add_order({1, true, 1000.0, 10, get_timestamp_ns()});
+    assert(result);
+    result = book.add_order({2, false, 1040.0, 10, get_timestamp_ns()});
+    assert(result);
+    result = book.add_order({3, true, 980.0, 10, get_timestamp_ns()});
+    assert(result);
+    
+    // Occupied span 980..1050 does not fit in 64 ticks
+    result = book.add_order({4, false, 1050.0, 10, get_timestamp_ns()});
+    assert(!result);
+    
+    // A rejected re-price leaves the order where it was
+    result = book.amend_order(2, 1050.0, 10);
+    assert(!result);
+    
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(5, bids, asks);
+    assert(bids.size() == 2 && bids[0].price == 1000.0 && bids[1].price == 980.0);
+    assert(asks.size() == 1 && asks[0].price == 1040.0);
+    
+    // Once the low bid is gone the window can slide up
+    result = book.cancel_order(3);
+    assert(result);
+    result = book.add_order({4, false, 1050.0, 10, get_timestamp_ns()});
+    assert(result);
+    book.get_snapshot(5, bids, asks);
+    assert(bids.size() == 1 && bids[0].price == 1000.0);
+    assert(asks.size() == 2 && asks[0].price == 1040.0 && asks[1].price == 1050.0);
+    
+    // Emptying the best level promotes the next one
+    result = book.cancel_order(2);
+    assert(result);
+    book.get_snapshot(5, bids, asks);
+    assert(asks.size() == 1 && asks[0].price == 1050.0);
+    
+    std::cout << "✓ Ladder band test passed" << std::endl;
+}
+
+// Test pool slot reuse and intrusive queue links
+void test_order_pool() {
+    std::cout << "\n=== Test: Order Pool ===" << std::endl;
+    OrderPool pool(2);
+    OrderQueue queue;
+    
+    OrderHandle a = pool.allocate();
+    OrderHandle b = pool.allocate();
+    OrderHandle c = pool.allocate(); // Grows past the preallocated capacity
+    assert(pool.capacity() >= 3 && pool.size() == 3);
+    queue.push_back(pool, a);
+    queue.push_back(pool, b);
+    queue.push_back(pool, c);
+    
+    // Unlink from the middle keeps FIFO order of the rest
+    queue.unlink(pool, b);
+    assert(queue.head == a && pool[a].next == c && pool[c].prev == a && queue.tail == c);
+    
+    // Released slots are reused most recent first
+    pool.release(b);
+    const OrderHandle reused = pool.allocate();
+    assert(reused == b);
+    assert(pool.size() == 3);
+    
+    queue.unlink(pool, a);
+    queue.unlink(pool, c);
+    assert(queue.empty() && queue.tail == kNullOrder);
+    
+    std::cout << "✓ Order pool test passed" << std::endl;
+}
+
+// Test arena alignment, chaining, marks and the pool and allocator on top
+void test_arena() {
+    std::cout << "\n=== Test: Arena ===" << std::endl;
+    Arena arena(ArenaConfig{64 << 10, ArenaPages::Normal, true});
+    assert(arena.stats().chunks == 0); // Nothing mapped before first use
+    
+    char* byte = static_cast<char*>(arena.allocate(1, 1));
+    void* line = arena.allocate(100, 64);
+    assert(byte && line && reinterpret_cast<uintptr_t>(line) % 64 == 0);
+    *byte = 1;
+    
+    // Chains a new chunk when one fills, and maps oversized requests whole
+    const Arena::Mark mark = arena.mark();
+    for (int i = 0; i < 100; i++) {
+        void* page = arena.allocate(4096, 16);
+        assert(page);
+    }
+    void* big = arena.allocate(1 << 20, 4096);
+    assert(big && reinterpret_cast<uintptr_t>(big) % 4096 == 0 && arena.stats().chunks >= 3);
+    std::memset(big, 0xab, 1 << 20);
+    const ArenaStats grown = arena.stats();
+    
+    // Rewinding releases everything after the mark but keeps chunks mapped
+    arena.rewind(mark);
+    assert(arena.stats().bytes_used < 4096 && arena.stats().chunks == grown.chunks);
+    {
+        ArenaScope scratch(arena);
+        for (int i = 0; i < 100; i++) {
+            void* page = arena.allocate(4096, 16);
+            assert(page);
+        }
+        assert(arena.stats().bytes_used > 100 * 4096);
+    }
+    assert(arena.stats().bytes_used < 4096);
+    void* big_again = arena.allocate(1 << 20, 4096);
+    assert(big_again == big && arena.stats().chunks == grown.chunks);
+    
+    // Small frees are recycled for the same size
+    void* node = arena.allocate(48, 8);
+    arena.deallocate(node, 48);
+    void* recycled = arena.allocate(40, 8);
+    assert(recycled == node);
+    arena.reset();
+    assert(arena.stats().bytes_used == 0 && arena.stats().bytes_mapped == grown.bytes_mapped);
+    
+    // Hugepage chunks are whole 2 MiB pages; without a reserved pool they fall back to THP
+    Arena huge(ArenaConfig{64 << 10, ArenaPages::Huge, true});
+    std::memset(huge.allocate(100000, 64), 1, 100000);
+    assert(huge.stats().chunks == 1 && huge.stats().bytes_mapped == 2 << 20);
+    
+    // Typed pool: LIFO reuse, blocks carved from the arena
+    ArenaPool<Order> orders(arena, 4);
+    std::vector<Order*> live;
+    for (uint64_t id = 1; id <= 10; id++) live.push_back(orders.create(Order{id, true, 100.0, id, id}));
+    assert(orders.size() == 10 && orders.capacity() == 12);
+    for (size_t i = 0; i < live.size(); i++) {
+        assert(live[i]->order_id == i + 1 && reinterpret_cast<uintptr_t>(live[i]) % alignof(Order) == 0);
+    }
+    orders.destroy(live[3]);
+    Order* reused = orders.create(Order{99, false, 101.0, 1, 1});
+    assert(reused == live[3] && orders.size() == 10);
+    
+    // std::allocator adapter: Fifo3 and a book's level maps on the arena
+    Fifo3<uint64_t, ArenaAllocator<uint64_t>> fifo(1024, ArenaAllocator<uint64_t>(&arena));
+    for (uint64_t i = 0; i < 1000; i++) {
+        const bool pushed = fifo.push(i);
+        assert(pushed);
+    }
+    uint64_t value = 0;
+    for (uint64_t i = 0; i < 1000; i++) {
+        const bool popped = fifo.pop(value);
+        assert(popped && value == i);
+    }
+    
+    // With no arena the heap path keeps over-aligned nodes aligned, as
+    // std::allocator would (level headers are alignas(64))
+    struct alignas(64) Line {
+        uint64_t value = 0;
+    };
+    std::map<int, Line, std::less<int>, ArenaAllocator<std::pair<const int, Line>>> heap_map;
+    for (int i = 0; i < 64; i++) heap_map[i].value = static_cast<uint64_t>(i);
+    for (const auto& entry : heap_map) assert(reinterpret_cast<uintptr_t>(&entry.second) % alignof(Line) == 0);
+    
+    Arena level_arena(ArenaConfig{256 << 10, ArenaPages::Normal, false});
+    OrderBookConfig config;
+    config.arena = &level_arena;
+    OrderBook book(config);
+    OrderBook reference;
+    for (uint64_t id = 1; id <= 20000; id++) {
+        const bool is_buy = id % 2 == 0;
+        const Order order{id, is_buy, is_buy ? 99.0 - (id % 500) * 0.01 : 101.0 + (id % 500) * 0.01, 10, id};
+        book.add_order(order);
+        reference.add_order(order);
+        if (id > 1000 && id % 3 == 0) {
+            book.cancel_order(id - 1000);
+            reference.cancel_order(id - 1000);
+        }
+    }
+    assert(book.snapshot_bytes() == reference.snapshot_bytes());
+    std::vector<PriceLevel> bids, asks, ref_bids, ref_asks;
+    book.get_snapshot(1000, bids, asks);
+    reference.get_snapshot(1000, ref_bids, ref_asks);
+    assert(bids.size() == ref_bids.size() && asks.size() == ref_asks.size());
+    for (size_t i = 0; i < bids.size(); i++) assert(bids[i].total_quantity == ref_bids[i].total_quantity);
+    
+    // Level churn reuses freed map nodes instead of growing the arena every round
+    const size_t used = level_arena.stats().bytes_used;
+    for (int round = 0; round < 10; round++) {
+        for (uint64_t i = 0; i < 500; i++) book.add_order({100000 + i, true, 90.0 - i * 0.01, 1, 0});
+        for (uint64_t i = 0; i < 500; i++) {
+            const bool cancelled = book.cancel_order(100000 + i);
+            assert(cancelled);
+        }
+    }
+    assert(level_arena.stats().bytes_used <= used + 500 * 256); // One round's worth
+    
+    std::cout << "✓ Arena test passed" << std::endl;
+}
+
+// Test pool-backed owning pointers recycle into their arena
+void test_pool_ptr() {
+    std::cout << "\n=== Test: Pool Pointers ===" << std::endl;
+    Arena arena(ArenaConfig{64 << 10, ArenaPages::Normal, true});
+    static_assert(sizeof(UniquePtr<Order>) == sizeof(Order*), "empty deleters take no space");
+    
+    // Unique ownership back to the pool's free list
+    ArenaPool<Order> orders(arena, 4);
+    Order* first = nullptr;
+    {
+        auto order = make_unique_in(orders, Order{1, true, 100.0, 10, 1});
+        assert(order && order->order_id == 1 && orders.size() == 1);
+        first = order.get();
+        auto moved = std::move(order);
+        assert(!order && moved.get() == first);
+    }
+    assert(orders.size() == 0);
+    {
+        auto reused = make_unique_in(orders, Order{2, true, 100.0, 10, 2});
+        assert(reused.get() == first); // LIFO reuse
+    }
+    {
+        auto buffer = make_unique_in<std::array<char, 200>>(arena);
+        first = reinterpret_cast<Order*>(buffer.get());
+    }
+    void* recycled = arena.allocate(200, 8);
+    assert(recycled == first); // Back on the arena's free list
+    
+    struct Image : RefCounted<Image, LocalCount> {
+        explicit Image(int& live) : live(live) { live++; }
+        ~Image() { live--; }
+        int& live;
+        PriceLevel bids[8];
+    };
+    int live = 0;
+    ArenaPool<Image> images(arena, 4);
+    {
+        IntrusivePtr<Image> image = make_intrusive_in(images, live);
+        IntrusivePtr<Image> reader = image;
+        assert(image->use_count() == 2 && live == 1 && images.size() == 1);
+        image.reset();
+        assert(reader->use_count() == 1 && live == 1);
+    }
+    assert(live == 0 && images.size() == 0);
+    
+    // Atomic counts: readers on other threads drop the last references
+    struct SharedImage : RefCounted<SharedImage> {
+        explicit SharedImage(std::atomic<int>& live) : live(live) { live++; }
+        ~SharedImage() { live--; }
+        std::atomic<int>& live;
+        uint64_t sequence = 7;
+    };
+    std::atomic<int> shared_live{0};
+    {
+        IntrusivePtr<SharedImage> image = make_intrusive_in<SharedImage>(arena, shared_live);
+        std::vector<std::thread> readers;
+        std::atomic<uint64_t> seen{0};
+        for (int t = 0; t < 2; t++) {
+            readers.emplace_back([copy = image, &seen]() mutable {
+                for (int i = 0; i < 10000; i++) {
+                    IntrusivePtr<SharedImage> local = copy;
+                    seen.fetch_add(local->sequence, std::memory_order_relaxed);
+                }
+                copy.reset();
+            });
+        }
+        image.reset();
+        for (auto& reader : readers) reader.join();
+        assert(seen.load() == 2 * 10000 * 7);
+    }
+    assert(shared_live.load() == 0);
+    
+    // From new: the last release deletes
+    IntrusivePtr<SharedImage> heap(new SharedImage(shared_live));
+    assert(heap->use_count() == 1 && shared_live.load() == 1);
+    heap.reset();
+    assert(shared_live.load() == 0);
+    
+    std::cout << "✓ Pool pointers test passed" << std::endl;
+}
+
+// Test warm-up leaves an empty, unpublished, ungrown book and prefaulting arenas
+void test_warm_up() {
+    std::cout << "\n=== Test: Warm-Up ===" << std::endl;
+    Fifo3<BookEvent> ring(64);
+    FifoEventSink<Fifo3<BookEvent>> sink(ring);
+    OrderBookConfig config;
+    config.order_capacity = 1 << 14;
+    config.id_index = OrderIdIndexMode::Direct;
+    config.first_order_id = 1000;
+    OrderBook book(config);
+    book.set_event_sink(&sink);
+    const void* slab = book.order_storage();
+    const uint64_t depth_sequence = book.depth_sequence();
+    
+    bool result = book.warm_up();
+    assert(result);
+    assert(ring.empty() && book.snapshot_bytes() == sizeof(SnapshotHeader));
+    assert(book.order_storage() == slab); // Filled to capacity, never grown
+    assert(book.depth_sequence() != depth_sequence);
+    
+    // Live afterwards as before, events included
+    book.add_order({1000, true, 100.0, 10, 1});
+    BookEvent event;
+    result = ring.pop(event);
+    assert(result && event.type == BookEventType::OrderAdd && event.sequence == 1);
+    result = book.warm_up();
+    assert(!result); // Only an empty book
+    result = book.cancel_order(1000);
+    assert(result);
+    
+    WarmupConfig warmup;
+    warmup.orders = 1000;
+    warmup.levels = 16;
+    warmup.cycles = 1;
+    warmup.lock_memory = true;
+    Arena arena(ArenaConfig{64 << 10, ArenaPages::Normal, false, -1, true});
+    OrderBookConfig arena_config;
+    arena_config.arena = &arena;
+    OrderBook arena_book(arena_config);
+    const bool locked = arena_book.warm_up(warmup); // mlock may exceed RLIMIT_MEMLOCK
+    const size_t warmed = arena.stats().bytes_used;
+    assert(warmed > 0 && arena_book.snapshot_bytes() == sizeof(SnapshotHeader));
+    for (uint64_t id = 1; id <= 8; id++) arena_book.add_order({id, id % 2 == 0, 100.0 + id, 1, id});
+    assert(arena.stats().bytes_used == warmed); // Level nodes come back from the free lists
+    
+    // Reserved chunks are mapped (and populated) ahead of the allocations
+    Arena reserved(ArenaConfig{64 << 10, ArenaPages::Normal, true, -1, true});
+    result = reserved.reserve(1 << 20);
+    assert(result && reserved.stats().chunks == 1 && reserved.stats().bytes_used == 0);
+    for (int i = 0; i < 16; i++) {
+        void* block = reserved.allocate(60000, 64);
+        assert(block);
+    }
+    assert(reserved.stats().chunks == 1);
+    std::cout << "Warmed " << warmup.orders << " orders; memory " << (locked ? "locked" : "not locked") << std::endl;
+    
+    std::cout << "✓ Warm-up test passed" << std::endl;
+}
+
+// Test the flat order-id index in both modes
+void test_order_index() {
+    std::cout << "\n=== Test: Order Index ===" << std::endl;
+    
+    // Hashed: insert enough to chain probe runs, erase every other, re-find
+    OrderIdIndex<uint64_t> hashed(64);
+    for (uint64_t id = 0; id < 1000; id++) {
+        hashed.insert(id * 7919, id);
+    }
+    assert(hashed.size() == 1000);
+    for (uint64_t id = 0; id < 1000; id += 2) {
+        const bool erased = hashed.erase(id * 7919);
+        assert(erased);
+    }
+    assert(hashed.size() == 500);
+    for (uint64_t id = 0; id < 1000; id++) {
+        uint64_t* value = hashed.get(id * 7919);
+        assert((id % 2 == 0) ? value == nullptr : (value != nullptr && *value == id));
+    }
+    hashed.insert(7919, 42); // Overwrite keeps size
+    assert(hashed.size() == 500 && *hashed.get(7919) == 42);
+    
+    // Direct: slot is the id offset from the base
+    OrderIdIndex<uint64_t> direct(16, OrderIdIndexMode::Direct, 1000);
+    direct.insert(1000, 1);
+    direct.insert(1020, 2); // Beyond capacity grows the table
+    assert(direct.find(1020) == 20 && *direct.get(1000) == 1);
+    assert(direct.find(999) == OrderIdIndex<uint64_t>::npos);
+    bool erased = direct.erase(1000);
+    const bool erased_again = direct.erase(1000);
+    assert(erased && !erased_again && direct.size() == 1);
+    
+    // A rolling id stream slides the window instead of growing it
+    OrderIdIndex<uint64_t> rolling(16, OrderIdIndexMode::Direct, 1);
+    for (uint64_t id = 1; id <= 100000; id++) {
+        rolling.insert(id, id);
+        if (id > 12) {
+            erased = rolling.erase(id - 12);
+            assert(erased);
+        }
+    }
+    assert(rolling.mode() == OrderIdIndexMode::Direct && rolling.size() == 12);
+    const OrderIdIndex<uint64_t> presized(16, OrderIdIndexMode::Direct, 1);
+    assert(rolling.bytes() <= 4 * presized.bytes() && *rolling.get(100000) == 100000);
+    assert(rolling.find(88000) == OrderIdIndex<uint64_t>::npos);
+    
+    // Ids below the window or too sparse for it fall back to hashing
+    direct.insert(5, 3);
+    assert(direct.mode() == OrderIdIndexMode::Hashed && direct.size() == 2);
+    assert(*direct.get(5) == 3 && *direct.get(1020) == 2);
+    OrderIdIndex<uint64_t> sparse(16, OrderIdIndexMode::Direct, 1);
+    sparse.insert(1, 1);
+    sparse.insert(uint64_t{1} << 40, 2);
+    assert(sparse.mode() == OrderIdIndexMode::Hashed && sparse.bytes() < 4096);
+    assert(*sparse.get(1) == 1 && *sparse.get(uint64_t{1} << 40) == 2);
+    
+    // A book on a direct-indexed id space behaves the same
+    OrderBookConfig config;
+    config.id_index = OrderIdIndexMode::Direct;
+    config.first_order_id = 1;
+    OrderBook book(config);
+    book.add_order({1, true, 100.0, 50, get_timestamp_ns()});
+    book.add_order({2, true, 100.0, 30, get_timestamp_ns()});
+    bool result = book.cancel_order(1);
+    assert(result);
+    result = book.cancel_order(1);
+    assert(!result);
+    result = book.amend_order(2, 100.0, 10);
+    assert(result);
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(5, bids, asks);
+    assert(bids.size() == 1 && bids[0].total_quantity == 10);
+    
+    std::cout << "✓ Order index test passed" << std::endl;
+}
+
+// Test crossing orders execute against resting liquidity
+void test_matching() {
+    std::cout << "\n=== Test: Matching ===" << std::endl;
+    // Side rules are compile-time: bids rank high first, asks low first
+    static_assert(SideTraits<Side::Buy>::better(101, 100) && SideTraits<Side::Sell>::better(100, 101));
+    static_assert(SideTraits<Side::Sell>::crossed_by(100, 100) && !SideTraits<Side::Sell>::crossed_by(101, 100));
+    static_assert(SideTraits<Side::Buy>::crossed_by(100, 99) && SideTraits<Side::Buy>::opposite == Side::Sell);
+    OrderBook book;
+    
+    book.add_order({1, false, 101.0, 30, get_timestamp_ns()});
+    book.add_order({2, false, 101.0, 20, get_timestamp_ns()});
+    book.add_order({3, false, 102.0, 50, get_timestamp_ns()});
+    book.add_order({4, true, 99.0, 40, get_timestamp_ns()});
+    
+    // Fills go to a preallocated buffer; the callback never allocates
+    Fill fills[8];
+    size_t fill_count = 0;
+    auto on_fill = [&](const Fill& fill) { fills[fill_count++] = fill; };
+    
+    // Non-crossing order just rests
+    MatchResult result = book.match_order({5, true, 100.0, 10, get_timestamp_ns()}, on_fill);
+    assert(result.filled == 0 && result.status == MatchStatus::Rested);
+    assert(fill_count == 0);
+    
+    // Buy 70 @ 102 takes 101 in time priority, then part of 102
+    result = book.match_order({6, true, 102.0, 70, get_timestamp_ns()}, on_fill);
+    assert(result.filled == 70 && result.status == MatchStatus::Filled);
+    assert(fill_count == 3);
+    assert(fills[0].maker_order_id == 1 && fills[0].quantity == 30 && fills[0].price == 101.0);
+    assert(fills[1].maker_order_id == 2 && fills[1].quantity == 20);
+    assert(fills[2].maker_order_id == 3 && fills[2].quantity == 20 && fills[2].price == 102.0);
+    assert(fills[2].taker_order_id == 6);
+    
+    // Filled makers are gone; the partially filled one keeps its remainder
+    const bool cancelled = book.cancel_order(1);
+    assert(!cancelled);
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(5, bids, asks);
+    assert(asks.size() == 1 && asks[0].price == 102.0 && asks[0].total_quantity == 30);
+    
+    // Sell 60 @ 99 sweeps the bids and rests 10 @ 99 on the ask side
+    fill_count = 0;
+    result = book.match_order({7, false, 99.0, 60, get_timestamp_ns()}, on_fill);
+    assert(result.filled == 50 && result.status == MatchStatus::Rested);
+    assert(fills[0].maker_order_id == 5 && fills[0].price == 100.0);
+    assert(fills[1].maker_order_id == 4 && fills[1].quantity == 40);
+    book.get_snapshot(5, bids, asks);
+    assert(bids.empty());
+    assert(asks.size() == 2 && asks[0].price == 99.0 && asks[0].total_quantity == 10);
+    
+    std::cout << "✓ Matching test passed" << std::endl;
+}
+
+// Test self-trade prevention and per-account limits inside match_order
+void test_pre_trade() {
+    std::cout << "\n=== Test: Pre-Trade Checks ===" << std::endl;
+    auto resting = [](SelfTradePrevention mode) {
+        OrderBookConfig config;
+        config.self_trade = mode;
+        OrderBook book(config);
+        book.add_order({1, false, 101.0, 10, get_timestamp_ns(), TimeInForce::GoodTillCancel, OrderType::Limit, 7});
+        book.add_order({2, false, 101.0, 10, get_timestamp_ns(), TimeInForce::GoodTillCancel, OrderType::Limit, 8});
+        return book;
+    };
+    auto no_fills = [](const Fill&) {};
+    std::vector<PriceLevel> bids, asks;
+    const Order buy{10, true, 101.0, 15, get_timestamp_ns(), TimeInForce::GoodTillCancel, OrderType::Limit, 7};
+    
+    // Account 7 buying into its own resting sell under each policy
+    OrderBook allow = resting(SelfTradePrevention::None);
+    MatchResult result = allow.match_order(buy, no_fills);
+    assert(result.status == MatchStatus::Filled);
+    
+    OrderBook taker = resting(SelfTradePrevention::CancelTaker);
+    result = taker.match_order(buy, no_fills);
+    assert(result.filled == 0 && result.status == MatchStatus::Cancelled && result.reason == RejectReason::SelfTrade);
+    taker.get_snapshot(5, bids, asks);
+    assert(bids.empty() && asks.size() == 1 && asks[0].total_quantity == 20);
+    
+    OrderBook maker = resting(SelfTradePrevention::CancelMaker);
+    result = maker.match_order(buy, no_fills);
+    assert(result.filled == 10 && result.status == MatchStatus::Rested);
+    maker.get_snapshot(5, bids, asks);
+    assert(asks.empty() && bids.size() == 1 && bids[0].total_quantity == 5);
+    
+    OrderBook both = resting(SelfTradePrevention::CancelBoth);
+    result = both.match_order(buy, no_fills);
+    assert(result.filled == 0 && result.reason == RejectReason::SelfTrade);
+    both.get_snapshot(5, bids, asks);
+    assert(bids.empty() && asks.size() == 1 && asks[0].total_quantity == 10);
+    
+    // Fill-or-kill counts only what it could actually trade with
+    Order fok = buy;
+    fok.quantity = 10;
+    fok.tif = TimeInForce::FillOrKill;
+    OrderBook fok_taker = resting(SelfTradePrevention::CancelTaker);
+    result = fok_taker.match_order(fok, no_fills);
+    assert(result.reason == RejectReason::FillOrKill);
+    OrderBook fok_maker = resting(SelfTradePrevention::CancelMaker);
+    result = fok_maker.match_order(fok, no_fills);
+    assert(result.status == MatchStatus::Filled);
+    fok.quantity = 11;
+    OrderBook fok_short = resting(SelfTradePrevention::CancelMaker);
+    result = fok_short.match_order(fok, no_fills);
+    assert(result.reason == RejectReason::FillOrKill);
+    fok_short.get_snapshot(5, bids, asks);
+    assert(asks.size() == 1 && asks[0].total_quantity == 20); // Untouched
+    
+    // Accounts survive a snapshot round trip
+    OrderBook saved = resting(SelfTradePrevention::CancelTaker);
+    std::vector<char> image(saved.snapshot_bytes());
+    saved.write_snapshot(image.data(), image.size());
+    OrderBookConfig stp_config;
+    stp_config.self_trade = SelfTradePrevention::CancelTaker;
+    OrderBook restored(stp_config);
+    const bool restored_ok = restored.restore_snapshot(image.data(), image.size());
+    assert(restored_ok);
+    result = restored.match_order(buy, no_fills);
+    assert(result.reason == RejectReason::SelfTrade);
+    
+    // Per-account limits and the price band
+    AccountRiskTable risk(16);
+    risk.set(3, AccountLimits{100, 5000.0});
+    OrderBookConfig config;
+    config.risk = &risk;
+    config.price_band_ticks = 100; // $1.00 through the best
+    OrderBook book(config);
+    book.add_order({1, false, 50.0, 200, get_timestamp_ns()});
+    book.add_order({2, false, 52.0, 200, get_timestamp_ns()});
+    Order order{20, true, 50.0, 101, get_timestamp_ns()};
+    order.account = 3;
+    result = book.match_order(order, no_fills);
+    assert(result.reason == RejectReason::OrderQuantity);
+    order.quantity = 100;
+    order.price = 50.5;
+    result = book.match_order(order, no_fills);
+    assert(result.reason == RejectReason::Notional); // 5050 > 5000
+    order.price = 50.0;
+    result = book.match_order(order, no_fills);
+    assert(result.status == MatchStatus::Filled);
+    order.order_id = 21;
+    order.account = 4; // Table defaults: no per-order limits
+    order.price = 51.5;
+    result = book.match_order(order, no_fills);
+    assert(result.reason == RejectReason::PriceBand); // Best 50, band to 51
+    
+    // A market order stops at the band edge instead of sweeping on
+    Order market{22, true, 0.0, 300, get_timestamp_ns(), TimeInForce::ImmediateOrCancel, OrderType::Market};
+    result = book.match_order(market, no_fills);
+    assert(result.filled == 100 && result.status == MatchStatus::Cancelled);
+    book.get_snapshot(5, bids, asks);
+    assert(asks.size() == 1 && asks[0].price == 52.0);
+    
+    std::cout << "✓ Pre-trade checks test passed" << std::endl;
+}
+
+// Test IOC, FOK, post-only and market handling
+void test_order_types() {
+    std::cout << "\n=== Test: Order Types ===" << std::endl;
+    OrderBook book;
+    const auto IOC = TimeInForce::ImmediateOrCancel;
+    const auto FOK = TimeInForce::FillOrKill;
+    const auto GTC = TimeInForce::GoodTillCancel;
+    
+    book.add_order({1, false, 101.0, 30, get_timestamp_ns()});
+    book.add_order({2, false, 102.0, 30, get_timestamp_ns()});
+    
+    uint64_t executed = 0;
+    auto on_fill = [&](const Fill& fill) { executed += fill.quantity; };
+    std::vector<PriceLevel> bids, asks;
+    
+    // Post-only that would cross is rejected; one that doesn't rests
+    MatchResult result = book.match_order({3, true, 101.0, 10, get_timestamp_ns(), GTC, OrderType::PostOnly}, on_fill);
+    assert(result.status == MatchStatus::Rejected && executed == 0);
+    result = book.match_order({3, true, 100.0, 10, get_timestamp_ns(), GTC, OrderType::PostOnly}, on_fill);
+    assert(result.status == MatchStatus::Rested);
+    
+    // FOK larger than liquidity within its limit touches nothing
+    result = book.match_order({4, true, 101.0, 40, get_timestamp_ns(), FOK}, on_fill);
+    assert(result.status == MatchStatus::Rejected && executed == 0);
+    book.get_snapshot(5, bids, asks);
+    assert(asks[0].total_quantity == 30);
+    
+    // FOK that fits across two levels executes in full
+    result = book.match_order({5, true, 102.0, 40, get_timestamp_ns(), FOK}, on_fill);
+    assert(result.status == MatchStatus::Filled && result.filled == 40 && executed == 40);
+    
+    // IOC takes what crosses and cancels the rest
+    result = book.match_order({6, true, 102.0, 50, get_timestamp_ns(), IOC}, on_fill);
+    assert(result.status == MatchStatus::Cancelled && result.filled == 20);
+    book.get_snapshot(5, bids, asks);
+    assert(asks.empty() && bids.size() == 1 && bids[0].price == 100.0);
+    
+    // Market order ignores price and never rests
+    result = book.match_order({7, false, 0.0, 25, get_timestamp_ns(), GTC, OrderType::Market}, on_fill);
+    assert(result.status == MatchStatus::Cancelled && result.filled == 10);
+    book.get_snapshot(5, bids, asks);
+    assert(bids.empty() && asks.empty());
+    
+    // Post-only cannot be immediate
+    result = book.match_order({8, true, 100.0, 10, get_timestamp_ns(), IOC, OrderType::PostOnly}, on_fill);
+    assert(result.status == MatchStatus::Rejected);
+    
+    std::cout << "✓ Order types test passed" << std::endl;
+}
+
+// Test the incremental depth cache against a full walk of the book
+void test_depth_cache() {
+    std::cout << "\n=== Test: Depth Cache ===" << std::endl;
+    OrderBook book;
+    std::vector<PriceLevel> bids, asks, full_bids, full_asks;
+    
+    // Unchanged book: snapshot is a no-op
+    uint64_t sequence = book.depth_sequence();
+    book.add_order({1, true, 100.0, 10, get_timestamp_ns()});
+    bool changed = book.get_snapshot_if_changed(5, sequence, bids, asks);
+    assert(changed);
+    changed = book.get_snapshot_if_changed(5, sequence, bids, asks);
+    assert(!changed);
+    
+    // A change deep in the book leaves the top levels untouched
+    for (int i = 1; i <= 20; i++) {
+        book.add_order({static_cast<uint64_t>(1 + i), true, 100.0 - i, 10, get_timestamp_ns()});
+    }
+    changed = book.get_snapshot_if_changed(5, sequence, bids, asks);
+    assert(changed);
+    book.cancel_order(21); // 80.0, level 21
+    changed = book.get_snapshot_if_changed(5, sequence, bids, asks);
+    assert(!changed);
+    
+    // Pseudo-random churn; cached and full-walk snapshots must agree
+    uint64_t seed = 12345;
+    auto next = [&]() { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return seed >> 33; };
+    for (uint64_t id = 100; id < 5000; id++) {
+        uint64_t r = next();
+        if (r % 3 == 0) {
+            book.cancel_order(100 + next() % (id - 99));
+        } else if (r % 7 == 0) {
+            book.amend_order(100 + next() % (id - 99), 100.0 + static_cast<double>(next() % 40) - 20, 1 + next() % 50);
+        } else {
+            bool is_buy = next() % 2;
+            double price = 100.0 + static_cast<double>(next() % 40) - (is_buy ? 30 : 10);
+            book.match_order({id, is_buy, price, 1 + next() % 50, get_timestamp_ns()}, [](const Fill&) {});
+        }
+        
+        book.get_snapshot(DepthCache::kCapacity, bids, asks);
+        book.get_snapshot(100, full_bids, full_asks);
+        full_bids.resize(std::min(full_bids.size(), DepthCache::kCapacity));
+        full_asks.resize(std::min(full_asks.size(), DepthCache::kCapacity));
+        assert(bids.size() == full_bids.size() && asks.size() == full_asks.size());
+        for (size_t i = 0; i < bids.size(); i++) {
+            assert(bids[i].price == full_bids[i].price && bids[i].total_quantity == full_bids[i].total_quantity);
+        }
+        for (size_t i = 0; i < asks.size(); i++) {
+            assert(asks[i].price == full_asks[i].price && asks[i].total_quantity == full_asks[i].total_quantity);
+        }
+    }
+    
+    // Fixed-capacity snapshots agree with the vector API
+    book.get_snapshot(100, full_bids, full_asks);
+    std::array<PriceLevel, 8> bid_array, ask_array;
+    SnapshotDepth depth = book.get_snapshot(bid_array, ask_array);
+    assert(depth.bids == std::min<size_t>(8, full_bids.size()));
+    assert(depth.asks == std::min<size_t>(8, full_asks.size()));
+    for (size_t i = 0; i < depth.bids; i++) {
+        assert(bid_array[i].price == full_bids[i].price && bid_array[i].total_quantity == full_bids[i].total_quantity);
+    }
+    std::array<PriceLevel, 64> deep_bids, deep_asks;
+    depth = book.get_snapshot(deep_bids, deep_asks);
+    assert(depth.bids == std::min<size_t>(64, full_bids.size()));
+    assert(depth.asks == std::min<size_t>(64, full_asks.size()));
+    assert(depth.asks == 0 || deep_asks[depth.asks - 1].price == full_asks[depth.asks - 1].price);
+    
+    std::cout << "✓ Depth cache test passed" << std::endl;
+}
+
+// Test vector depth kernels against the scalar ones and the book queries
+// against a full walk of the levels
+void test_depth_queries() {
+    std::cout << "\n=== Test: Depth Queries (" << simd_level_name(depth_simd_level()) << ") ===" << std::endl;
+    uint64_t seed = 777;
+    auto next = [&]() { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return seed >> 33; };
+    
+    // Every kernel level agrees with scalar on every length, tails included
+    const DepthKernels& scalar = depth_kernels(SimdLevel::Scalar);
+    for (SimdLevel level : {SimdLevel::Avx2, SimdLevel::Avx512}) {
+        const DepthKernels& kernels = depth_kernels(level);
+        for (size_t count = 0; count <= 37; count++) {
+            Ticks prices[40];
+            uint64_t quantities[40], expected[40], actual[40];
+            for (size_t i = 0; i < count; i++) {
+                prices[i] = 10000 - static_cast<Ticks>(i * 2);
+                quantities[i] = 1 + next() % 1000;
+            }
+            const Ticks bound = 10000 - static_cast<Ticks>(next() % 80);
+            assert(kernels.sum_within(prices, quantities, count, bound, true) ==
+                   scalar.sum_within(prices, quantities, count, bound, true));
+            assert(kernels.sum_within(prices, quantities, count, bound, false) ==
+                   scalar.sum_within(prices, quantities, count, bound, false));
+            scalar.prefix_sum(quantities, count, expected);
+            kernels.prefix_sum(quantities, count, actual);
+            assert(std::equal(expected, expected + count, actual));
+            const uint64_t target = next() % (count * 1000 + 1);
+            assert(kernels.count_below(expected, count, target) == scalar.count_below(expected, count, target));
+            assert(kernels.notional(prices, quantities, count) == scalar.notional(prices, quantities, count));
+        }
+    }
+    
+    OrderBook book;
+    assert(book.quantity_within(true, 10) == 0);
+    assert(book.vwap_to_size(false, 10).filled == 0);
+    
+    // 40 levels a side, so queries run past the cached depth
+    uint64_t id = 1;
+    for (int level = 0; level < 40; level++) {
+        for (int n = 0; n < 3; n++) {
+            book.add_order({id++, true, 99.99 - level * 0.01, 1 + next() % 100, get_timestamp_ns()});
+            book.add_order({id++, false, 100.01 + level * 0.01, 1 + next() % 100, get_timestamp_ns()});
+        }
+    }
+    for (int round = 0; round < 200; round++) {
+        book.cancel_order(1 + next() % (id - 1));
+        std::vector<PriceLevel> bids, asks;
+        book.get_snapshot(100, bids, asks);
+        for (bool is_buy : {true, false}) {
+            const std::vector<PriceLevel>& side = is_buy ? bids : asks;
+            const Ticks best = static_cast<Ticks>(std::llround(side[0].price * 100));
+            
+            const Ticks ticks = static_cast<Ticks>(next() % 45);
+            uint64_t within = 0;
+            for (const PriceLevel& level : side) {
+                const Ticks price = static_cast<Ticks>(std::llround(level.price * 100));
+                if ((is_buy ? best - price : price - best) <= ticks) within += level.total_quantity;
+            }
+            assert(book.quantity_within(is_buy, ticks) == within);
+            
+            uint64_t cumulative[64];
+            const size_t written = book.cumulative_depth(is_buy, cumulative, 30);
+            assert(written == std::min<size_t>(30, side.size()));
+            uint64_t running = 0;
+            for (size_t i = 0; i < written; i++) {
+                running += side[i].total_quantity;
+                assert(cumulative[i] == running);
+            }
+            
+            const uint64_t size = 1 + next() % 3000;
+            double notional = 0;
+            uint64_t filled = 0;
+            for (const PriceLevel& level : side) {
+                const uint64_t take = std::min(size - filled, level.total_quantity);
+                notional += level.price * static_cast<double>(take);
+                filled += take;
+                if (filled == size) break;
+            }
+            const DepthVwap vwap = book.vwap_to_size(is_buy, size);
+            assert(vwap.filled == filled);
+            assert(std::fabs(vwap.price - notional / static_cast<double>(filled)) < 1e-9);
+        }
+    }
+    
+    std::cout << "✓ Depth queries test passed" << std::endl;
+}
+
+// Test indexed queue positions against a walk of the level
+void test_queue_position() {
+    std::cout << "\n=== Test: Queue Position ===" << std::endl;
+    OrderBookConfig indexed_config;
+    indexed_config.queue_positions = true;
+    OrderBook indexed(indexed_config);
+    OrderBook walked;
+    
+    QueuePosition position{};
+    assert(!indexed.queue_ahead(1, position));
+    for (OrderBook* book : {&indexed, &walked}) {
+        book->add_order({1, true, 100.0, 10, get_timestamp_ns()});
+        book->add_order({2, true, 100.0, 20, get_timestamp_ns()});
+        book->add_order({3, true, 100.0, 30, get_timestamp_ns()});
+        book->amend_order(1, 100.0, 4); // Down: keeps its place
+        book->cancel_order(2);
+        book->amend_order(3, 100.0, 35); // Up: to the back
+        book->add_order({4, true, 100.0, 5, get_timestamp_ns()});
+        assert(book->queue_ahead(4, position));
+        assert(position.quantity_ahead == 39 && position.quantity == 5 && position.level_quantity == 44);
+        assert(book->queue_ahead(1, position) && position.quantity_ahead == 0);
+    }
+    
+    // Churn with fills, re-prices and enough joins to renumber levels
+    uint64_t seed = 4242;
+    auto next = [&]() { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return seed >> 33; };
+    auto compare = [&](OrderBook& a, OrderBook& b, uint64_t last_id) {
+        for (uint64_t id = 1; id <= last_id; id++) {
+            QueuePosition left{}, right{};
+            const bool found = a.queue_ahead(id, left);
+            assert(found == b.queue_ahead(id, right));
+            uint64_t resting = 0;
+            assert(a.resting_quantity(id, resting) == found);
+            if (!found) continue;
+            assert(resting == left.quantity);
+            assert(left.quantity_ahead == right.quantity_ahead && left.quantity == right.quantity &&
+                   left.level_quantity == right.level_quantity);
+            assert(left.quantity_ahead + left.quantity <= left.level_quantity);
+        }
+    };
+    uint64_t id = 5;
+    for (; id < 6000; id++) {
+        const uint64_t r = next();
+        const uint64_t target = 1 + next() % id;
+        const double price = 100.0 + static_cast<double>(next() % 10) * 0.01;
+        const uint64_t quantity = 1 + next() % 40;
+        const bool is_buy = next() % 2;
+        for (OrderBook* book : {&indexed, &walked}) {
+            if (r % 4 == 0) {
+                book->cancel_order(target);
+            } else if (r % 5 == 0) {
+                book->amend_order(target, price - (is_buy ? 0.1 : 0.0), quantity);
+            } else {
+                book->match_order({id, is_buy, is_buy ? price - 0.05 : price, quantity, get_timestamp_ns()},
+                                  [](const Fill&) {});
+            }
+        }
+        if (id % 500 == 0) compare(indexed, walked, id);
+    }
+    compare(indexed, walked, id);
+    
+    // A restored book rebuilds its indexes from the image
+    std::vector<char> image(indexed.snapshot_bytes());
+    indexed.write_snapshot(image.data(), image.size());
+    OrderBook restored(indexed_config);
+    const bool restored_ok = restored.restore_snapshot(image.data(), image.size());
+    assert(restored_ok);
+    compare(restored, walked, id);
+    
+    std::cout << "✓ Queue position test passed" << std::endl;
+}
+
+// Test top-of-book statistics and the rolling trade window
+void test_book_stats() {
+    std::cout << "\n=== Test: Book Stats ===" << std::endl;
+    OrderBookConfig config;
+    config.trade_window_ns = 64000; // 64 buckets of 1 us
+    OrderBook book(config);
+    
+    TopStats top = book.top_of_book();
+    assert(top.bid_quantity == 0 && top.mid == 0.0);
+    book.add_order({1, true, 99.0, 300, 0});
+    book.add_order({2, false, 101.0, 100, 0});
+    top = book.top_of_book();
+    assert(top.bid == 99.0 && top.ask == 101.0 && top.spread == 2.0 && top.mid == 100.0);
+    assert(top.imbalance == 0.5);
+    assert(std::fabs(top.microprice - 100.5) < 1e-12); // (99 * 100 + 101 * 300) / 400
+    
+    auto no_fills = [](const Fill&) {};
+    book.add_order({3, false, 102.0, 1000, 0});
+    book.match_order({10, true, 101.0, 40, 1000}, no_fills);  // 40 @ 101
+    book.match_order({11, true, 102.0, 100, 2000}, no_fills); // 60 @ 101, 40 @ 102
+    TradeWindowStats trades = book.trade_window();
+    assert(trades.volume == 140 && trades.trades == 3);
+    assert(std::fabs(trades.vwap - (101.0 * 100 + 102.0 * 40) / 140) < 1e-9);
+    assert(trades.last_price == 102.0);
+    
+    // 40 @ 101 at t = 1 us leaves once the window has moved 64 buckets on
+    book.advance_trade_window(64999);
+    assert(book.trade_window().volume == 140);
+    book.advance_trade_window(65000);
+    trades = book.trade_window();
+    assert(trades.volume == 100 && trades.trades == 2 && trades.start_ns == 2000);
+    book.advance_trade_window(10000000);
+    trades = book.trade_window();
+    assert(trades.volume == 0 && trades.vwap == 0.0 && trades.last_price == 102.0);
+    
+    // Disabled by default
+    OrderBook plain;
+    plain.add_order({1, false, 10.0, 5, 0});
+    plain.match_order({2, true, 10.0, 5, 1}, no_fills);
+    assert(plain.trade_window().volume == 0);
+    
+    std::cout << "✓ Book stats test passed" << std::endl;
+}
+
+// Test the resting-order layout and the compact-storage limits
+void test_compact_storage() {
+    std::cout << "\n=== Test: Compact Storage ===" << std::endl;
+    static_assert(sizeof(OrderNode) == (kCompactOrders ? 24 : 32), "node layout");
+    static_assert(sizeof(OrderColdData) == (kCompactOrders ? 20 : 24), "cold layout");
+    // Links are 32-bit handles; compact index entries keep 31 bits of them
+    static_assert(sizeof(OrderHandle) == 4 && sizeof(OrderQueue) == 8, "32-bit links");
+    static_assert(kMaxOrderCapacity == (kCompactOrders ? size_t{1} << 31 : size_t{kNullOrder}), "handle space");
+    // Checked in release builds too, before anything is allocated
+    auto rejects_capacity = [](auto make) {
+        try {
+            make();
+        } catch (const std::length_error&) {
+            return true;
+        }
+        return false;
+    };
+    OrderBookConfig too_big;
+    too_big.order_capacity = kMaxOrderCapacity + 1;
+    bool rejected = rejects_capacity([&] { OrderBook book(too_big); });
+    assert(rejected);
+    LadderOrderBookConfig ladder_too_big;
+    ladder_too_big.order_capacity = kMaxOrderCapacity + 1;
+    rejected = rejects_capacity([&] { LadderOrderBook book(ladder_too_big); });
+    assert(rejected);
+    assert(checked_order_capacity(kMaxOrderCapacity) == kMaxOrderCapacity);
+    
+    const uint64_t epoch = 1700000000000000000ull;
+    const uint64_t later = epoch + 3600000000000ull + 12345; // An hour and a bit in
+    const uint64_t decoded = decode_timestamp(encode_timestamp(later, epoch), epoch);
+    assert(decoded <= later && later - decoded < (uint64_t{1} << kTimestampShift));
+    assert(kCompactOrders || decoded == later);
+    
+    const uint64_t big = uint64_t{1} << 32;
+    assert(order_storable(100, 1000));
+    assert(order_storable(Ticks{1} << 40, big) == !kCompactOrders);
+    
+    OrderBookConfig config;
+    config.session_epoch_ns = epoch;
+    OrderBook book(config);
+    book.add_order({1, true, 99.0, 300, later});
+    book.add_order({2, false, 101.0, 100, epoch - 1}); // Before the epoch: clamps in compact builds
+    auto no_fills = [](const Fill&) {};
+    const MatchResult oversized = book.match_order({3, true, 99.0, big, later}, no_fills);
+    assert(kCompactOrders ? oversized.reason == RejectReason::OrderQuantity
+                          : oversized.status == MatchStatus::Rested);
+    bool result = book.amend_order(1, 99.0, big);
+    assert(result == !kCompactOrders);
+    result = book.amend_order(1, 98.0, 200);
+    assert(result);
+    
+    // Resting adds are refused the same way, leaving the book as it was
+    const uint64_t depth_before = book.depth_sequence();
+    result = book.add_order({4, true, 97.0, big, later});
+    assert(result == !kCompactOrders);
+    result = book.apply(BookOp{BookOpType::Add, {5, false, 1e12, 10, later}});
+    assert(result == !kCompactOrders);
+    QueuePosition refused;
+    assert(book.queue_ahead(4, refused) == !kCompactOrders && book.queue_ahead(5, refused) == !kCompactOrders);
+    assert(kCompactOrders ? book.depth_sequence() == depth_before : book.depth_sequence() > depth_before);
+    if (!kCompactOrders) {
+        result = book.cancel_order(4);
+        assert(result);
+        result = book.cancel_order(5);
+        assert(result);
+    }
+    
+    // Snapshots carry full timestamps; compact ones come back rounded down
+    std::vector<char> image(book.snapshot_bytes());
+    book.write_snapshot(image.data(), image.size());
+    OrderBook restored(config);
+    result = restored.restore_snapshot(image.data(), image.size());
+    assert(result);
+    QueuePosition position;
+    assert(restored.queue_ahead(1, position) && position.quantity == 200);
+    assert(restored.snapshot_bytes() == image.size());
+    std::vector<char> again(image.size());
+    restored.write_snapshot(again.data(), again.size());
+    assert(again == image);
+    
+    std::cout << "✓ Compact storage test passed" << std::endl;
+}
+
+// Test cancel_all through the per-account order lists
+void test_mass_cancel() {
+    std::cout << "\n=== Test: Mass Cancel ===" << std::endl;
+    OrderBookConfig config;
+    config.owner_orders = true;
+    OrderBook book(config);
+    
+    // Account 7 alone makes up the best bid (99) and best ask (101)
+    for (uint64_t id = 1; id <= 30; id++) {
+        Order order{id, id % 2 == 0, id % 2 == 0 ? 99.0 - static_cast<double>(id % 3) : 101.0 + static_cast<double>(id % 3),
+                    10, id};
+        order.account = id % 3 == 0 ? 7 : static_cast<uint32_t>(id % 5);
+        book.add_order(order);
+    }
+    assert(book.owner_order_count(7) == 10);
+    
+    // Orders leaving by cancel and by fill drop out of the list
+    bool result = book.cancel_order(3);
+    assert(result);
+    Order taker{100, true, 101.0, 10, 100};
+    taker.account = 9;
+    book.match_order(taker, [](const Fill&) {}); // Fills id 9, first at 101
+    assert(book.owner_order_count(7) == 8);
+    
+    Fifo3<BookEvent> ring(256);
+    FifoEventSink<Fifo3<BookEvent>> sink(ring);
+    book.set_event_sink(&sink);
+    const uint64_t depth_before = book.depth_sequence();
+    size_t cancelled = book.cancel_all(7);
+    assert(cancelled == 8);
+    cancelled = book.cancel_all(7);
+    assert(book.owner_order_count(7) == 0 && cancelled == 0);
+    assert(book.depth_sequence() == depth_before + 1);
+    
+    // Eight L3 cancels, then one L2 delete per emptied level
+    BookEvent event;
+    size_t cancels = 0, level_events = 0;
+    while (ring.pop(event)) {
+        if (event.type == BookEventType::OrderCancel) {
+            assert(level_events == 0);
+            cancels++;
+        } else {
+            assert(is_l2_event(event.type));
+            level_events++;
+        }
+    }
+    assert(cancels == 8 && level_events == 2);
+    assert(book.top_of_book().bid == 98.0 && book.top_of_book().ask == 102.0);
+    
+    // Nothing of account 7 is left; everyone else's is
+    size_t left = 0;
+    for (uint64_t id = 1; id <= 30; id++) {
+        QueuePosition position;
+        if (book.queue_ahead(id, position)) {
+            assert(id % 3 != 0);
+            left++;
+        }
+    }
+    assert(left == 20);
+    
+    // Without owner_orders there is no list
+    OrderBook plain;
+    Order order{1, true, 99.0, 10, 0};
+    order.account = 7;
+    plain.add_order(order);
+    cancelled = plain.cancel_all(7);
+    assert(cancelled == 0 && plain.owner_order_count(7) == 0);
+    
+    std::cout << "✓ Mass cancel test passed" << std::endl;
+}
+
+// Test good-till-time orders leave the book through the timer wheel
+void test_order_expiry() {
+    std::cout << "\n=== Test: Order Expiry ===" << std::endl;
+    
+    // The wheel alone: due order, cancel, and deadlines past its horizon
+    TimerWheel wheel(1, 4);
+    std::vector<uint32_t> expired;
+    const uint64_t horizon = uint64_t{1} << (TimerWheel::kSlotBits * TimerWheel::kLevels);
+    wheel.schedule(0, 70, 0);
+    wheel.schedule(1, 5, 0);
+    wheel.schedule(2, 3 * horizon + 17, 0);
+    wheel.schedule(3, 40, 0);
+    wheel.cancel(3);
+    assert(wheel.size() == 3 && !wheel.scheduled(3));
+    size_t due = wheel.advance(4, expired);
+    assert(due == 0);
+    due = wheel.advance(69, expired);
+    assert(due == 1 && expired[0] == 1);
+    due = wheel.advance(70, expired);
+    assert(due == 1 && expired[1] == 0);
+    due = wheel.advance(3 * horizon + 16, expired);
+    assert(due == 0 && wheel.scheduled(2));
+    due = wheel.advance(3 * horizon + 17, expired);
+    assert(due == 1 && expired[2] == 2);
+    assert(wheel.size() == 0);
+    // An idle wheel catches up to the entry time; handles past the presize grow it
+    wheel.schedule(9, 3 * horizon + 20, 3 * horizon + 18);
+    due = wheel.advance(3 * horizon + 19, expired);
+    assert(due == 0);
+    due = wheel.advance(3 * horizon + 20, expired);
+    assert(due == 1 && expired[3] == 9);
+    
+    OrderBookConfig config;
+    config.expiry_tick_ns = 1000;
+    config.owner_orders = true;
+    OrderBook book(config);
+    auto gtt = [](uint64_t id, bool is_buy, double price, uint64_t expire_ns) {
+        Order order{id, is_buy, price, 10, 0, TimeInForce::GoodTillTime};
+        order.account = 7;
+        order.expire_ns = expire_ns;
+        return order;
+    };
+    auto no_fills = [](const Fill&) {};
+    
+    // Deadlines round up to the tick: 1500 expires at 2000
+    MatchStatus status = book.match_order(gtt(1, true, 99.0, 1500), no_fills).status;
+    assert(status == MatchStatus::Rested);
+    status = book.match_order(gtt(2, true, 99.0, 2000), no_fills).status;
+    assert(status == MatchStatus::Rested);
+    status = book.match_order(gtt(3, true, 98.0, 5000), no_fills).status;
+    assert(status == MatchStatus::Rested);
+    status = book.match_order(gtt(4, false, 101.0, 5000), no_fills).status;
+    assert(status == MatchStatus::Rested);
+    status = book.match_order(gtt(5, false, 102.0, 9000), no_fills).status;
+    assert(status == MatchStatus::Rested);
+    Order post = gtt(6, false, 103.0, 3000);
+    post.type = OrderType::PostOnly;
+    status = book.match_order(post, no_fills).status;
+    assert(status == MatchStatus::Rested);
+    book.add_order(gtt(7, false, 104.0, 1000)); // add_order honours deadlines too
+    book.add_order({8, true, 97.0, 10, 0});     // GTC, never expires
+    assert(book.expiring_order_count() == 7);
+    
+    // Leaving by fill or cancel drops the deadline
+    status = book.match_order({20, true, 101.0, 10, 0, TimeInForce::ImmediateOrCancel}, no_fills).status;
+    assert(status == MatchStatus::Filled);
+    const bool cancelled = book.cancel_order(3);
+    assert(cancelled);
+    assert(book.expiring_order_count() == 5);
+    
+    Fifo3<BookEvent> ring(64);
+    FifoEventSink<Fifo3<BookEvent>> sink(ring);
+    book.set_event_sink(&sink);
+    size_t swept = book.expire_orders(999);
+    assert(swept == 0);
+    swept = book.expire_orders(1999);
+    assert(swept == 1); // Order 7
+    const uint64_t depth_before = book.depth_sequence();
+    swept = book.expire_orders(2000);
+    assert(swept == 2); // Both at 99, in one L2 delete
+    assert(book.depth_sequence() == depth_before + 1);
+    BookEvent event;
+    size_t cancels = 0, level_events = 0;
+    while (ring.pop(event)) {
+        if (event.type == BookEventType::OrderCancel) cancels++;
+        else level_events++;
+    }
+    assert(cancels == 3 && level_events == 2);
+    assert(book.top_of_book().bid == 97.0);
+    
+    // Amended orders keep their deadline; it expires with the owner list kept
+    const bool amended = book.amend_order(5, 102.5, 5);
+    assert(amended);
+    assert(book.owner_order_count(7) == 2);
+    swept = book.expire_orders(1000000);
+    assert(swept == 2);
+    assert(book.owner_order_count(7) == 0 && book.expiring_order_count() == 0);
+    assert(book.top_of_book().ask == 0.0 && book.top_of_book().bid == 97.0);
+    
+    // A deadline already passed rests until the next expire_orders
+    status = book.match_order(gtt(30, true, 96.0, 500), no_fills).status;
+    assert(status == MatchStatus::Rested);
+    swept = book.expire_orders(1000999);
+    assert(swept == 0);
+    swept = book.expire_orders(1001000);
+    assert(swept == 1);
+    
+    // Without expiry_tick_ns a deadline is rejected; no deadline rests as GTC
+    OrderBook plain;
+    MatchResult result = plain.match_order(gtt(1, true, 99.0, 1500), no_fills);
+    assert(result.status == MatchStatus::Rejected && result.reason == RejectReason::InvalidOrder);
+    status = plain.match_order(gtt(2, true, 99.0, 0), no_fills).status;
+    assert(status == MatchStatus::Rested);
+    swept = plain.expire_orders(UINT64_MAX);
+    assert(swept == 0 && plain.top_of_book().bid == 99.0);
+    
+    std::cout << "✓ Order expiry test passed" << std::endl;
+}
+
+// Test an auction call accumulates a crossed book and uncrosses at the
+// volume-maximising price in one batch
+void test_auction_uncross() {
+    std::cout << "\n=== Test: Auction Uncross ===" << std::endl;
+    OrderBook book;
+    auto no_fills = [](const Fill&) {};
+    book.begin_auction();
+    assert(book.in_auction());
+    
+    const Order orders[] = {
+        {1, true, 103.0, 30, 1}, {2, true, 102.0, 20, 2}, {3, true, 101.0, 40, 3}, {4, true, 100.0, 10, 4},
+        {5, false, 100.0, 20, 5}, {6, false, 101.0, 30, 6}, {7, false, 102.0, 30, 7}, {8, false, 104.0, 10, 8},
+    };
+    for (const Order& order : orders) {
+        const MatchStatus status = book.match_order(order, no_fills).status;
+        assert(status == MatchStatus::Rested);
+    }
+    assert(book.top_of_book().bid == 103.0 && book.top_of_book().ask == 100.0); // Crossed
+    
+    // 102 and 101 both trade 50; 102 leaves the smaller surplus (30 to sell)
+    AuctionUncross indicative = book.indicative_uncross();
+    assert(indicative.price == 102.0 && indicative.volume == 50 && indicative.imbalance == -30);
+    
+    // Levels outside the crossed range leave it alone; one inside moves it
+    book.add_order({9, true, 99.0, 5, 9});
+    assert(book.indicative_uncross().price == 102.0);
+    book.add_order({10, false, 101.0, 20, 10});
+    indicative = book.indicative_uncross();
+    assert(indicative.price == 101.0 && indicative.volume == 70 && indicative.imbalance == 20);
+    const bool cancelled = book.cancel_order(10);
+    assert(cancelled);
+    assert(book.indicative_uncross().price == 102.0);
+    
+    // Only orders that can wait for the uncross join the call
+    const MatchResult market = book.match_order({11, true, 0.0, 10, 11, TimeInForce::ImmediateOrCancel,
+                                                 OrderType::Market}, no_fills);
+    assert(market.status == MatchStatus::Rejected && market.reason == RejectReason::InvalidOrder);
+    MatchStatus status = book.match_order({12, true, 103.0, 10, 12, TimeInForce::ImmediateOrCancel}, no_fills).status;
+    assert(status == MatchStatus::Rejected);
+    
+    Fifo3<BookEvent> ring(64);
+    FifoEventSink<Fifo3<BookEvent>> sink(ring);
+    book.set_event_sink(&sink, kL2Events);
+    const uint64_t depth_before = book.depth_sequence();
+    std::vector<Fill> fills;
+    const AuctionUncross result = book.uncross(100, [&](const Fill& fill) { fills.push_back(fill); });
+    assert(result.price == 102.0 && result.volume == 50 && !book.in_auction());
+    assert(fills.size() == 3);
+    assert(fills[0].taker_order_id == 1 && fills[0].maker_order_id == 5 && fills[0].quantity == 20);
+    assert(fills[1].taker_order_id == 1 && fills[1].maker_order_id == 6 && fills[1].quantity == 10);
+    assert(fills[2].taker_order_id == 2 && fills[2].maker_order_id == 6 && fills[2].quantity == 20);
+    for (const Fill& fill : fills) assert(fill.price == 102.0);
+    assert(book.depth_sequence() == depth_before + 1);
+    
+    // One L2 delta per touched level: bids 103 and 102, asks 100 and 101
+    BookEvent event;
+    size_t level_events = 0;
+    while (ring.pop(event)) {
+        assert(event.type == BookEventType::LevelDelete);
+        level_events++;
+    }
+    assert(level_events == 4);
+    assert(book.top_of_book().bid == 101.0 && book.top_of_book().ask == 102.0);
+    assert(book.indicative_uncross().volume == 0);
+    
+    // Continuous matching resumes
+    status = book.match_order({13, true, 102.0, 5, 13}, no_fills).status;
+    assert(status == MatchStatus::Filled);
+    
+    // Remaining ties: all buy surplus takes the highest, none the middle (lower)
+    OrderBook buyers;
+    buyers.begin_auction();
+    buyers.add_order({1, true, 101.0, 20, 1});
+    buyers.add_order({2, false, 100.0, 10, 2});
+    indicative = buyers.indicative_uncross();
+    assert(indicative.price == 101.0 && indicative.volume == 10 && indicative.imbalance == 10);
+    OrderBook balanced;
+    balanced.begin_auction();
+    balanced.add_order({1, true, 102.0, 10, 1});
+    balanced.add_order({2, false, 100.0, 10, 2});
+    indicative = balanced.indicative_uncross();
+    assert(indicative.price == 100.0 && indicative.volume == 10 && indicative.imbalance == 0);
+    const AuctionUncross idle = OrderBook().uncross(0, no_fills);
+    assert(idle.volume == 0); // Not in a call
+    
+    // The curve kept across adds, cancels and amends matches one built from
+    // scratch after the same flow, whichever levels the changes hit
+    std::vector<BookOp> flow;
+    OrderBook kept;
+    kept.begin_auction();
+    uint64_t next_id = 1;
+    for (uint64_t i = 0; i < 400; i++) {
+        BookOp op{BookOpType::Add, {next_id, i % 2 == 0, 95.0 + static_cast<double>((i * 7) % 11), 5 + (i * 13) % 40, i}};
+        if (i % 5 == 3) {
+            op = BookOp{BookOpType::Cancel, {next_id - 1 - (i * 3) % (next_id - 1), true, 0.0, 0, 0}};
+        } else if (i % 5 == 4) {
+            op = BookOp{BookOpType::Amend, {next_id - 1 - (i * 5) % (next_id - 1), true,
+                                            95.0 + static_cast<double>((i * 3) % 11), 1 + i % 30, 0}};
+        } else {
+            next_id++;
+        }
+        flow.push_back(op);
+        kept.apply(op);
+        const AuctionUncross incremental = kept.indicative_uncross();
+        if (i % 40 != 39) continue;
+        OrderBook scratch;
+        scratch.begin_auction();
+        for (const BookOp& replayed : flow) scratch.apply(replayed);
+        const AuctionUncross rebuilt = scratch.indicative_uncross();
+        assert(rebuilt.volume > 0);
+        assert(incremental.price == rebuilt.price && incremental.volume == rebuilt.volume &&
+               incremental.imbalance == rebuilt.imbalance);
+    }
+    
+    std::cout << "✓ Auction uncross test passed" << std::endl;
+}
+
+// Test L2/L3 deltas are published through an SPSC ring
+void test_book_events() {
+    std::cout << "\n=== Test: Book Events ===" << std::endl;
+    Fifo3<BookEvent> ring(64);
+    FifoEventSink<Fifo3<BookEvent>> sink(ring);
+    OrderBook book;
+    book.set_event_sink(&sink);
+    
+    book.add_order({1, true, 100.0, 50, get_timestamp_ns()});  // L3 add, L2 add
+    book.add_order({2, true, 100.0, 30, get_timestamp_ns()});  // L3 add, L2 change
+    book.amend_order(1, 100.0, 40);                           // L3 modify, L2 change
+    book.cancel_order(2);                                     // L3 cancel, L2 change
+    book.match_order({3, false, 100.0, 40, get_timestamp_ns()}, [](const Fill&) {}); // L3 execute, L2 delete
+    
+    const BookEventType expected[] = {
+        BookEventType::OrderAdd, BookEventType::LevelAdd,
+        BookEventType::OrderAdd, BookEventType::LevelChange,
+        BookEventType::OrderModify, BookEventType::LevelChange,
+        BookEventType::OrderCancel, BookEventType::LevelChange,
+        BookEventType::OrderExecute, BookEventType::LevelDelete,
+    };
+    const uint64_t expected_total[] = {50, 80, 70, 40, 0};
+    
+    BookEvent event;
+    uint64_t l2_sequence = 0, l3_sequence = 0;
+    for (BookEventType type : expected) {
+        const bool popped = ring.pop(event);
+        assert(popped);
+        assert(event.type == type);
+        assert(event.price == 10000 && event.is_buy);
+        if (is_l2_event(type)) {
+            assert(event.sequence == ++l2_sequence);
+            assert(event.quantity == expected_total[l2_sequence - 1]);
+        } else {
+            assert(event.sequence == ++l3_sequence);
+        }
+    }
+    bool popped = ring.pop(event);
+    assert(!popped);
+    
+    // L2-only subscription
+    book.set_event_sink(&sink, kL2Events);
+    book.add_order({4, false, 101.0, 10, get_timestamp_ns()});
+    popped = ring.pop(event);
+    assert(popped && event.type == BookEventType::LevelAdd && event.sequence == 6);
+    popped = ring.pop(event);
+    assert(!popped);
+    assert(sink.dropped() == 0);
+    
+    std::cout << "✓ Book events test passed" << std::endl;
+}
+
+// Test routing ops to sharded books through per-worker rings
+void test_book_manager() {
+    std::cout << "\n=== Test: Book Manager ===" << std::endl;
+    BookManagerConfig config;
+    config.worker_count = 2;
+    config.ring_capacity = 1024;
+    BookManager manager(8, config);
+    assert(manager.worker_of(3) == 1);
+    manager.assign(3, 0); // Group symbol 3 with the even symbols
+    
+    manager.start();
+    uint64_t id = 1;
+    for (SymbolId symbol = 0; symbol < 8; symbol++) {
+        for (int i = 0; i < 100; i++) {
+            BookOp op{BookOpType::Add, {id++, i % 5 < 3, 100.0 + (i % 5), 10, get_timestamp_ns()}};
+            while (!manager.submit(symbol, op)) {}
+        }
+        // Cancel the first order of each symbol
+        BookOp cancel{BookOpType::Cancel, {id - 100, true, 0.0, 0, 0}};
+        while (!manager.submit(symbol, cancel)) {}
+    }
+    manager.stop();
+    
+    assert(manager.processed(0) + manager.processed(1) == 8 * 101);
+    assert(manager.processed(0) == 5 * 101); // Symbols 0, 2, 3, 4, 6
+    for (SymbolId symbol = 0; symbol < 8; symbol++) {
+        std::vector<PriceLevel> bids, asks;
+        manager.book(symbol).get_snapshot(10, bids, asks);
+        assert(bids.size() == 3 && asks.size() == 2);
+        assert(bids[0].price == 102.0 && bids[0].total_quantity == 200);
+        assert(bids[2].price == 100.0 && bids[2].total_quantity == 190);
+    }
+    
+    std::cout << "✓ Book manager test passed" << std::endl;
+}
+
+// Test decode -> book -> publish stages over pinned SPSC rings
+void test_stage_pipeline() {
+    std::cout << "\n=== Test: Stage Pipeline ===" << std::endl;
+    std::map<std::string, int> cpus;
+    bool parsed = parse_stage_cpus("decode=0,book=0,publish=-1", cpus);
+    assert(parsed);
+    assert(cpus.size() == 3 && cpus["book"] == 0 && cpus["publish"] == -1);
+    parsed = parse_stage_cpus("decode", cpus) || parse_stage_cpus("=1", cpus) || parse_stage_cpus("book=x", cpus);
+    assert(!parsed);
+    
+    StagePipelineConfig config;
+    config.ring_capacity = 16; // Small enough to back the decoder up
+    config.stage_cpus = cpus;
+    StagePipeline pipeline(config);
+    
+    constexpr uint64_t kOrders = 512;
+    OrderBook book;
+    uint64_t next_id = 1;
+    std::atomic<uint64_t> published{0};
+    std::atomic<uint64_t> last_bid_quantity{0};
+    
+    // Decode: one "packet" of two adds per poll until the feed runs dry
+    auto& ops = pipeline.add_source<BookOp>("decode", [&](PipelineOutput<BookOp>& out) {
+        if (next_id > kOrders) return false;
+        for (int i = 0; i < 2; i++, next_id++) {
+            out.push(BookOp{BookOpType::Add, {next_id, true, 100.0 - static_cast<double>(next_id % 8), 10, next_id}});
+        }
+        return true;
+    });
+    auto& deltas = pipeline.add_stage<TopStats>("book", ops, [&](const BookOp& op, PipelineOutput<TopStats>& out) {
+        book.apply(op);
+        out.push(book.top_of_book());
+    });
+    pipeline.add_sink("publish", deltas, [&](const TopStats& top) {
+        last_bid_quantity.store(top.bid_quantity, std::memory_order_relaxed);
+        published.fetch_add(1, std::memory_order_relaxed);
+    });
+    assert(pipeline.stage_count() == 3);
+    
+    pipeline.start();
+    while (published.load(std::memory_order_relaxed) < kOrders) std::this_thread::yield();
+    pipeline.stop();
+    
+    // Every order made it through, in order, and the counters add up
+    assert(last_bid_quantity.load() == kOrders / 8 * 10);
+    const StageStats decode = pipeline.stats(0);
+    const StageStats update = pipeline.stats(1);
+    const StageStats publish = pipeline.stats(2);
+    assert(decode.name == "decode" && decode.cpu == 0 && decode.processed == kOrders / 2);
+    assert(update.processed == kOrders && publish.processed == kOrders && publish.cpu == -1);
+    assert(update.queue_capacity == 16 && update.queue_high_water <= 16 && update.queue_depth == 0);
+    assert(update.service_p50_ns > 0.0 && update.service_max_ns >= update.service_p99_ns);
+    pipeline.print_stats();
+    
+    std::cout << "✓ Stage pipeline test passed" << std::endl;
+}
+
+// Test NUMA topology queries, node-bound arenas and the manager's placement
+void test_numa_placement() {
+    std::cout << "\n=== Test: NUMA Placement ===" << std::endl;
+    const int nodes = numa_node_count();
+    assert(nodes >= 1);
+    const int cpu0_node = numa_node_of_cpu(0);
+    assert(cpu0_node >= 0 && cpu0_node < nodes);
+    assert(numa_node_of_cpu(-1) == -1 && numa_node_of_cpu(1 << 20) == -1);
+    const int here = numa_current_node();
+    assert(here >= 0 && here < nodes);
+    
+    // A bound arena's chunks are touched on map, so they already have a node
+    Arena arena(ArenaConfig{1 << 20, ArenaPages::Normal, true, cpu0_node});
+    void* memory = arena.allocate(4096, 64);
+    const int memory_node = numa_node_of_address(memory);
+    const bool has_mempolicy = memory_node >= 0; // false on kernels without NUMA
+    assert(!has_mempolicy || memory_node == cpu0_node);
+    
+    // Books filled while stopped keep their contents when rehomed at start
+    BookManagerConfig config;
+    config.worker_count = 2;
+    config.ring_capacity = 1024;
+    config.worker_cpus = {0, 0};
+    config.numa_local = true;
+    BookManager manager(4, config);
+    assert(manager.worker_node(0) == cpu0_node && manager.book_node(0) == -1);
+    for (uint64_t id = 1; id <= 50; id++) manager.apply(id % 4, {BookOpType::Add, {id, true, 100.0, 10, id}});
+    manager.start();
+    for (SymbolId symbol = 0; symbol < 4; symbol++) {
+        assert(!has_mempolicy || manager.book_node(symbol) == cpu0_node);
+        while (!manager.submit(symbol, {BookOpType::Add, {1000 + symbol, false, 101.0, 5, 0}})) {}
+    }
+    assert(!has_mempolicy || manager.ring_node(1) == cpu0_node);
+    manager.print_placement();
+    manager.stop();
+    for (SymbolId symbol = 0; symbol < 4; symbol++) {
+        std::vector<PriceLevel> bids, asks;
+        manager.book(symbol).get_snapshot(5, bids, asks);
+        assert(bids.size() == 1 && bids[0].total_quantity == (symbol == 1 || symbol == 2 ? 130u : 120u));
+        assert(asks.size() == 1 && asks[0].total_quantity == 5);
+        const bool cancelled = manager.book(symbol).cancel_order(symbol == 0 ? 4 : symbol);
+        assert(cancelled);
+    }
+    
+    std::cout << "✓ NUMA placement test passed" << std::endl;
+}
+
+// Test readers on other threads only ever see whole published versions,
+// and the manager's workers keep each book's published top current
+void test_depth_publisher() {
+    std::cout << "\n=== Test: Depth Publisher ===" << std::endl;
+    OrderBook book;
+    DepthPublisher<4> publisher;
+    DepthPublisher<4>::View view;
+    const bool fresh = publisher.try_read(view);
+    assert(fresh && view.bid_count == 0 && publisher.version() == 0);
+    
+    book.add_order({1, true, 100.0, 10, 0});
+    book.add_order({2, false, 101.0, 10, 0});
+    const bool published = publisher.publish(book);
+    const bool republished = publisher.publish(book);
+    assert(published && !republished); // Unchanged: no new version
+    assert(publisher.version() == 1);
+    publisher.read(view);
+    assert(view.bid_count == 1 && view.ask_count == 1 && view.depth_sequence == book.depth_sequence());
+    assert(view.bids[0].price == 100.0 && view.asks[0].price == 101.0 && view.asks[0].total_quantity == 10);
+    
+    // The writer keeps best bid and best ask quantities equal at every
+    // publish; a torn read would break that
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> reads{0};
+    auto reader = [&] {
+        uint64_t last_version = 0;
+        DepthPublisher<4>::View seen;
+        while (!done.load(std::memory_order_acquire)) {
+            publisher.read(seen);
+            assert(seen.bid_count == seen.ask_count && seen.bid_count > 0);
+            assert(seen.bids[0].total_quantity == seen.asks[0].total_quantity);
+            const uint64_t version = publisher.version();
+            assert(version >= last_version);
+            last_version = version;
+            reads.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+    std::thread first(reader), second(reader);
+    uint64_t id = 10;
+    for (uint64_t i = 0; i < 20000; i++) {
+        const uint64_t quantity = 1 + i % 50;
+        book.amend_order(1, 100.0, quantity);
+        book.amend_order(2, 101.0, quantity);
+        if (i % 100 == 0) {
+            book.add_order({id, true, 99.0, 5, 0});
+            book.add_order({id + 1, false, 102.0, 5, 0});
+            id += 2;
+        }
+        publisher.publish(book);
+    }
+    while (reads.load(std::memory_order_relaxed) < 1000) std::this_thread::yield();
+    done.store(true, std::memory_order_release);
+    first.join();
+    second.join();
+    std::cout << publisher.version() << " versions published, " << reads.load() << " consistent reads" << std::endl;
+    
+    BookManagerConfig config;
+    config.publish_depth = true;
+    BookManager manager(2, config);
+    BookDepth::View top;
+    manager.depth(1).read(top);
+    assert(manager.publishes_depth() && top.bid_count == 0);
+    manager.start();
+    for (uint64_t order = 1; order <= 100; order++) {
+        while (!manager.submit(1, {BookOpType::Add, {order, true, 50.0 + (order % 20), 1, 0}})) {}
+    }
+    // Readable while the worker runs; converges on the final book
+    do {
+        manager.depth(1).read(top);
+    } while (top.bids[0].total_quantity != 5 || top.bid_count != 10);
+    assert(top.bids[0].price == 69.0);
+    manager.stop();
+    
+    std::cout << "✓ Depth publisher test passed" << std::endl;
+}
+
+// Test batched ops coalesce their L2 deltas
+void test_apply_batch() {
+    std::cout << "\n=== Test: Apply Batch ===" << std::endl;
+    Fifo3<BookEvent> ring(256);
+    FifoEventSink<Fifo3<BookEvent>> sink(ring);
+    OrderBook book;
+    book.add_order({1, true, 100.0, 50, get_timestamp_ns()});
+    book.add_order({2, true, 99.0, 50, get_timestamp_ns()});
+    book.set_event_sink(&sink, kL2Events);
+    
+    const uint64_t sequence = book.depth_sequence();
+    const BookOp ops[] = {
+        {BookOpType::Add, {3, true, 100.0, 10, 0}},     // 100: 60
+        {BookOpType::Add, {4, true, 100.0, 10, 0}},     // 100: 70
+        {BookOpType::Amend, {3, true, 100.0, 20, 0}},   // 100: 80
+        {BookOpType::Cancel, {2, true, 0.0, 0, 0}},     // 99 deleted
+        {BookOpType::Add, {5, false, 101.0, 10, 0}},    // 101 added...
+        {BookOpType::Cancel, {5, false, 0.0, 0, 0}},    // ...and gone again
+        {BookOpType::Add, {6, false, 102.0, 10, 0}},    // 102 added
+        {BookOpType::Cancel, {999, true, 0.0, 0, 0}},   // Unknown id
+    };
+    const size_t applied = book.apply_batch(ops, 8);
+    assert(applied == 7);
+    assert(book.depth_sequence() == sequence + 1);
+    
+    // One net event per touched level, in first-touch order
+    BookEvent event;
+    bool popped = ring.pop(event);
+    assert(popped && event.type == BookEventType::LevelChange && event.price == 10000 && event.quantity == 80);
+    popped = ring.pop(event);
+    assert(popped && event.type == BookEventType::LevelDelete && event.price == 9900);
+    popped = ring.pop(event);
+    assert(popped && event.type == BookEventType::LevelAdd && event.price == 10200 && event.quantity == 10);
+    popped = ring.pop(event);
+    assert(!popped);
+    
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(5, bids, asks);
+    assert(bids.size() == 1 && bids[0].total_quantity == 80);
+    assert(asks.size() == 1 && asks[0].price == 102.0);
+    
+    std::cout << "✓ Apply batch test passed" << std::endl;
+}
+
+// Test amends keep priority on quantity-down and re-price without cancel+add
+void test_amend_priority() {
+    std::cout << "\n=== Test: Amend Priority ===" << std::endl;
+    OrderBook book;
+    
+    book.add_order({1, true, 100.0, 50, get_timestamp_ns()});
+    book.add_order({2, true, 100.0, 30, get_timestamp_ns()});
+    book.add_order({3, true, 100.0, 20, get_timestamp_ns()});
+    bool result = book.amend_order(1, 100.0, 10);
+    assert(result); // Down: stays first
+    result = book.amend_order(2, 100.0, 40);
+    assert(result); // Up: moves behind 3
+    
+    // Re-price a lone level; its storage is re-keyed in place
+    book.add_order({4, true, 99.0, 25, get_timestamp_ns()});
+    result = book.amend_order(4, 98.0, 25);
+    assert(result);
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(5, bids, asks);
+    assert(bids.size() == 2);
+    assert(bids[0].price == 100.0 && bids[0].total_quantity == 70);
+    assert(bids[1].price == 98.0 && bids[1].total_quantity == 25);
+    
+    // Re-price onto an existing level joins its tail
+    book.add_order({5, true, 98.0, 5, get_timestamp_ns()});
+    result = book.amend_order(3, 98.0, 20);
+    assert(result);
+    
+    std::vector<uint64_t> makers;
+    book.match_order({6, false, 98.0, 100, get_timestamp_ns()},
+                     [&](const Fill& fill) { makers.push_back(fill.maker_order_id); });
+    const std::vector<uint64_t> expected = {1, 2, 4, 5, 3};
+    assert(makers == expected);
+    
+    book.get_snapshot(5, bids, asks);
+    assert(bids.empty() && asks.empty());
+    
+    std::cout << "✓ Amend priority test passed" << std::endl;
+}
+
+// Test Fifo4 across two threads and time it against Fifo3
+void test_spsc_queue() {
+    std::cout << "\n=== Test: SPSC Queue ===" << std::endl;
+    
+    Fifo4<int> small(4);
+    for (int i = 0; i < 4; i++) {
+        const bool pushed = small.push(i);
+        assert(pushed);
+    }
+    bool pushed = small.push(4);
+    assert(!pushed && small.full());
+    int value;
+    bool took = small.pop(value);
+    assert(took && value == 0);
+    pushed = small.push(4);
+    assert(pushed);
+    for (int i = 1; i <= 4; i++) {
+        took = small.pop(value);
+        assert(took && value == i);
+    }
+    took = small.pop(value);
+    assert(!took && small.empty());
+    
+    // In-place construct and consume
+    Fifo4<std::pair<uint64_t, double>> pairs(2);
+    pushed = pairs.emplace(1, 100.5);
+    assert(pushed);
+    auto* claimed = pairs.try_claim();
+    assert(claimed != nullptr && pairs.size() == 1);
+    new (claimed) std::pair<uint64_t, double>(2, 101.0);
+    pairs.publish();
+    auto* full = pairs.try_claim();
+    pushed = pairs.emplace(3, 0.0);
+    assert(full == nullptr && !pushed);
+    for (uint64_t id = 1; id <= 2; id++) {
+        auto* message = pairs.front();
+        assert(message != nullptr && message->first == id);
+        pairs.release();
+    }
+    assert(pairs.front() == nullptr);
+    
+    // Bursts wrap around the end of the ring
+    Fifo4<int> burst(8);
+    const int values[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    int popped[10];
+    size_t moved = burst.push_n(values, 6);
+    assert(moved == 6);
+    moved = burst.pop_n(popped, 5);
+    assert(moved == 5 && popped[4] == 4);
+    moved = burst.push_n(values + 6, 4);
+    assert(moved == 4); // Slots 6, 7, 0, 1
+    moved = burst.push_n(values, 10);
+    assert(moved == 3); // Only 3 free
+    moved = burst.pop_n(popped, 10);
+    assert(moved == 8);
+    assert(popped[0] == 5 && popped[4] == 9 && popped[5] == 0 && popped[7] == 2);
+    
+    // Claim-n stops at the end of the ring
+    size_t reserved = 0;
+    int* slots = burst.try_claim_n(8, reserved);
+    assert(slots != nullptr && reserved == 3);  // Cursor 13: slots 5, 6, 7
+    for (size_t i = 0; i < reserved; i++) slots[i] = 100 + static_cast<int>(i);
+    burst.publish_n(reserved);
+    moved = burst.pop_n(popped, 10);
+    assert(moved == 3 && popped[2] == 102);
+    
+    const uint64_t count = 200000;
+    auto run = [&](auto& ring) {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::thread producer([&] {
+            for (uint64_t i = 0; i < count; i++) {
+                while (!ring.push(i)) std::this_thread::yield();
+            }
+        });
+        uint64_t message;
+        for (uint64_t i = 0; i < count; i++) {
+            while (!ring.pop(message)) std::this_thread::yield();
+            assert(message == i);
+        }
+        producer.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    };
+    
+    Fifo3<uint64_t> fifo3(1024);
+    Fifo4<uint64_t> fifo4(1024);
+    auto fifo3_us = run(fifo3);
+    auto fifo4_us = run(fifo4);
+    std::cout << count << " messages, capacity 1024:" << std::endl;
+    std::cout << "  Fifo3: " << fifo3_us << " µs" << std::endl;
+    std::cout << "  Fifo4: " << fifo4_us << " µs" << std::endl;
+    
+    std::cout << "✓ SPSC queue test passed" << std::endl;
+}
+
+// Test the shared-memory ring between a creator and a forked attacher
+void test_shm_queue() {
+    std::cout << "\n=== Test: Shared-Memory Queue ===" << std::endl;
+    const std::string name = "lob_test_" + std::to_string(getpid());
+    
+    ShmFifo<BookOp> producer;
+    bool result = producer.create(name, 1024);
+    assert(result);
+    ShmFifo<BookOp> duplicate;
+    result = duplicate.create(name, 1024);
+    assert(!result); // Name already taken
+    ShmFifo<uint64_t> mismatched;
+    result = mismatched.attach(name);
+    assert(!result); // Element layout differs
+    ShmFifo<BookOp> missing;
+    result = missing.attach(name + "_missing");
+    assert(!result);
+    
+    const uint64_t count = 100000;
+    const pid_t child = fork();
+    if (child == 0) {
+        // Consumer process: rebuild the book from the ring
+        ShmFifo<BookOp> consumer;
+        if (!consumer.attach(name) || consumer.capacity() != 1024) _exit(1);
+        OrderBook book;
+        BookOp op;
+        for (uint64_t i = 0; i < count; i++) {
+            while (!consumer.pop(op)) std::this_thread::yield();
+            if (op.order.order_id != i) _exit(2);
+            book.apply(op);
+        }
+        std::vector<PriceLevel> bids, asks;
+        book.get_snapshot(1, bids, asks);
+        _exit(bids.size() == 1 && bids[0].total_quantity == count / 10 * 10 ? 0 : 3);
+    }
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint64_t i = 0; i < count; i++) {
+        BookOp op{BookOpType::Add, {i, true, 100.0 - static_cast<double>(i % 10) * 0.01, 10, 0}};
+        while (!producer.push(op)) std::this_thread::yield();
+    }
+    int status = 0;
+    const pid_t reaped = waitpid(child, &status, 0);
+    assert(reaped == child);
+    auto end = std::chrono::high_resolution_clock::now();
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(producer.empty());
+    std::cout << count << " ops across processes in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " µs" << std::endl;
+    
+    producer.close();
+    result = missing.attach(name);
+    assert(!result); // Creator removed the name
+    
+    std::cout << "✓ Shared-memory queue test passed" << std::endl;
+}
+
+// Test the lock-free list under concurrent churn and check node reuse
+void test_lock_free_list() {
+    std::cout << "\n=== Test: Lock-Free List ===" << std::endl;
+    LockFreeList<uint64_t> list(8);
+    {
+        auto session = list.session();
+        assert(session.valid());
+        bool result = list.insert(session, 20, 200) && list.insert(session, 10, 100);
+        assert(result);
+        result = list.insert(session, 10, 111);
+        assert(!result);
+        uint64_t value = 0;
+        assert(list.find(session, 10, value) && value == 100);
+        result = list.remove(session, 10) && !list.remove(session, 10);
+        assert(result);
+        assert(!list.find(session, 10, value));
+        result = list.insert(session, 5, 50) && list.insert(session, 30, 300);
+        assert(result);
+        std::vector<uint64_t> keys;
+        list.for_each(session, [&](uint64_t key, uint64_t) { keys.push_back(key); });
+        assert((keys == std::vector<uint64_t>{5, 20, 30}));
+        result = list.remove(session, 5) && list.remove(session, 20) && list.remove(session, 30);
+        assert(result);
+    }
+    
+    // Sessions are limited and returned on destruction
+    {
+        std::vector<LockFreeList<uint64_t>::Session> sessions;
+        for (int i = 0; i < 8; i++) sessions.push_back(list.session());
+        assert(!list.session().valid());
+    }
+    assert(list.session().valid());
+    
+    // Each thread churns its own keys while a reader scans
+    const uint64_t threads = 4, rounds = 64 * 300;
+    std::atomic<bool> done{false};
+    std::thread reader([&] {
+        auto session = list.session();
+        while (!done.load(std::memory_order_acquire)) {
+            uint64_t previous = 0;
+            list.for_each(session, [&](uint64_t key, uint64_t value) {
+                assert(key >= previous && value == key * 10);
+                previous = key;
+            });
+            std::this_thread::yield();
+        }
+    });
+    std::vector<std::thread> writers;
+    for (uint64_t t = 0; t < threads; t++) {
+        writers.emplace_back([&, t] {
+            auto session = list.session();
+            for (uint64_t i = 0; i < rounds; i++) {
+                const uint64_t key = (i % 64) * threads + t;
+                if (!list.insert(session, key, key * 10)) {
+                    const bool removed = list.remove(session, key);
+                    assert(removed);
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    done.store(true, std::memory_order_release);
+    reader.join();
+    
+    // rounds / 64 is even, so every key ends up removed again
+    auto session = list.session();
+    size_t live = 0;
+    list.for_each(session, [&](uint64_t, uint64_t) { live++; });
+    assert(live == 0);
+    
+    // Once no other thread is inside an operation, removed nodes are
+    // recycled rather than leaked: churn stays within the existing slabs
+    const size_t allocated = list.allocated_nodes();
+    for (uint64_t i = 0; i < 100000; i++) {
+        const bool churned = list.insert(session, i, i * 10) && list.remove(session, i);
+        assert(churned);
+    }
+    assert(list.allocated_nodes() <= allocated + 1024);
+    
+    std::cout << "✓ Lock-free list test passed (" << list.allocated_nodes() << " nodes allocated)" << std::endl;
+}
+
+// Test the wire format's builder, views and validation
+void test_feed_protocol() {
+    std::cout << "\n=== Test: Feed Protocol ===" << std::endl;
+    char buffer[kMaxFeedPacketSize];
+    FeedPacketBuilder builder(buffer, 7, 1000);
+    bool result = builder.add({BookOpType::Add, {42, true, 100.25, 300, 5}});
+    assert(result);
+    result = builder.trade(6, 42, 100.25, 100, false);
+    assert(result);
+    result = builder.add({BookOpType::Cancel, {42, false, 0.0, 0, 7}});
+    assert(result);
+    result = builder.heartbeat(8);
+    assert(!result); // Heartbeats travel alone
+    const size_t size = builder.finish();
+    assert(size == 16 + 32 + 32 + 19 && builder.next_sequence() == 1003);
+    assert(validate_feed_packet(buffer, size));
+    
+    const PacketView packet(buffer);
+    assert(packet.version() == kFeedVersion && packet.session() == 7);
+    assert(packet.sequence() == 1000 && packet.message_count() == 3);
+    const AddOrderView add(packet.messages());
+    assert(add.order_id() == 42 && add.price() == 10025000000 && add.quantity() == 300 && add.side() == 1);
+    const TradeView trade(packet.messages() + sizeof(wire::AddOrder));
+    assert(trade.maker_order_id() == 42 && trade.aggressor_side() == 0);
+    
+    BookOp op;
+    assert(decode_feed_message(MessageView(packet.messages()), op));
+    assert(op.type == BookOpType::Add && op.order.price == 100.25 && op.order.timestamp_ns == 5);
+    assert(!decode_feed_message(MessageView(packet.messages() + sizeof(wire::AddOrder)), op));
+    
+    // Truncation, wrong version and wrong message length are all rejected
+    assert(!validate_feed_packet(buffer, size - 1));
+    buffer[2] = 2;
+    assert(!validate_feed_packet(buffer, size));
+    buffer[2] = kFeedVersion;
+    buffer[16] = 31;
+    assert(!validate_feed_packet(buffer, size));
+    
+    // Heartbeats do not consume a sequence number
+    result = builder.heartbeat(9);
+    assert(result);
+    result = builder.add({BookOpType::Cancel, {1, false, 0.0, 0, 0}});
+    assert(!result);
+    const size_t heartbeat_size = builder.finish();
+    assert(heartbeat_size == 16 + 11 && builder.next_sequence() == 1003);
+    assert(validate_feed_packet(buffer, 27) && PacketView(buffer).sequence() == 1003);
+    
+    std::cout << "✓ Feed protocol test passed" << std::endl;
+}
+
+// Test the feed handler decodes packets from UDP datagrams and a TCP stream
+void test_feed_handler() {
+    std::cout << "\n=== Test: Feed Handler ===" << std::endl;
+    const BookOp ops[] = {
+        {BookOpType::Add, {1, true, 100.0, 50, 11}},
+        {BookOpType::Add, {2, true, 100.0, 30, 12}},
+        {BookOpType::Add, {3, false, 101.0, 20, 13}},
+        {BookOpType::Amend, {1, true, 100.0, 40, 0}},
+        {BookOpType::Cancel, {2, false, 0.0, 0, 0}},
+    };
+    
+    // One packet per op, back to back as they would appear on a stream
+    char wire[5 * kMaxFeedPacketSize];
+    size_t packet_sizes[5];
+    size_t wire_size = 0;
+    for (size_t i = 0; i < 5; i++) {
+        FeedPacketBuilder builder(wire + wire_size, 1, 1 + i);
+        builder.add(ops[i]);
+        packet_sizes[i] = builder.finish();
+        wire_size += packet_sizes[i];
+    }
+    
+    auto check = [](const OrderBook& book) {
+        std::vector<PriceLevel> bids, asks;
+        book.get_snapshot(5, bids, asks);
+        assert(bids.size() == 1 && bids[0].total_quantity == 40);
+        assert(asks.size() == 1 && asks[0].price == 101.0 && asks[0].total_quantity == 20);
+    };
+    
+    // Packet decode, and a malformed packet dropped whole
+    {
+        OrderBook book;
+        FeedHandler handler(book);
+        for (size_t i = 0, offset = 0; i < 5; offset += packet_sizes[i++]) {
+            const size_t applied = handler.on_packet(wire + offset, packet_sizes[i]);
+            assert(applied == 1);
+        }
+        check(book);
+        char bad[kMaxFeedPacketSize];
+        FeedPacketBuilder bad_builder(bad, 1, 10);
+        bad_builder.add({BookOpType::Add, {9, true, 99.0, 5, 0}});
+        const size_t bad_size = bad_builder.finish();
+        bad[bad_size - 1] = 'Z';
+        const size_t applied = handler.on_packet(bad, bad_size - 1);
+        assert(applied == 0);
+        assert(handler.stats().malformed == 1 && handler.stats().messages == 5);
+    }
+    
+    // UDP over loopback: one packet per datagram
+    auto run_udp = [&](FeedHandlerConfig config) {
+        OrderBook book;
+        config.port = 0;
+        FeedHandler handler(book, config);
+        if (!handler.open()) return false;
+        sockaddr_in addr{};
+        socklen_t length = sizeof(addr);
+        getsockname(handler.fd(), reinterpret_cast<sockaddr*>(&addr), &length);
+        
+        const int sender = socket(AF_INET, SOCK_DGRAM, 0);
+        for (size_t i = 0, offset = 0; i < 5; offset += packet_sizes[i++]) {
+            sendto(sender, wire + offset, packet_sizes[i], 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        }
+        close(sender);
+        for (int spins = 0; handler.stats().messages < 5 && spins < 100000; spins++) handler.poll();
+        assert(handler.stats().packets == 5);
+        check(book);
+        assert(handler.decode_latency().count() == 5);
+        return true;
+    };
+    
+    // TCP: packets split at awkward boundaries across sends
+    auto run_tcp = [&](FeedHandlerConfig config) {
+        const int listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        const bool bound = bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 && listen(listener, 1) == 0;
+        assert(bound);
+        socklen_t length = sizeof(addr);
+        getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &length);
+        
+        OrderBook book;
+        config.transport = FeedTransport::Tcp;
+        config.port = ntohs(addr.sin_port);
+        FeedHandler handler(book, config);
+        if (!handler.open()) {
+            close(listener);
+            return false;
+        }
+        const int server = accept(listener, nullptr, nullptr);
+        for (size_t offset = 0; offset < wire_size; offset += 7) {
+            send(server, wire + offset, std::min<size_t>(7, wire_size - offset), 0);
+            handler.poll();
+        }
+        for (int spins = 0; handler.stats().messages < 5 && spins < 100000; spins++) handler.poll();
+        check(book);
+        close(server);
+        for (int spins = 0; handler.is_open() && spins < 100000; spins++) handler.poll();
+        assert(!handler.is_open()); // Peer close is noticed
+        close(listener);
+        return true;
+    };
+    
+    FeedHandlerConfig config;
+    config.address = "127.0.0.1";
+    bool passed = run_udp(config) && run_tcp(config);
+    assert(passed);
+    
+    // io_uring needs Linux 6.0+ and may be disabled by policy; when it
+    // opens it must behave exactly like the socket backend
+    FeedBackend backend;
+    assert(parse_feed_backend("io_uring", backend) && backend == FeedBackend::IoUring);
+    assert(!parse_feed_backend("dpdk", backend));
+    config.backend = FeedBackend::IoUring;
+    config.ring_buffers = 64;
+    const bool uring = run_udp(config);
+    passed = run_tcp(config);
+    assert(passed == uring);
+    config.ring_buffers = 100; // Not a power of two
+    passed = run_udp(config);
+    assert(!passed);
+    
+    // AF_XDP on loopback runs in generic (SKB) mode and needs CAP_NET_ADMIN
+    // and CAP_BPF; without them open() fails and the case is skipped
+    config = FeedHandlerConfig{};
+    config.address = "127.0.0.1";
+    config.backend = FeedBackend::Xdp;
+    config.ring_buffers = 64;
+    config.xdp_device = "no-such-nic";
+    passed = run_udp(config);
+    assert(!passed);
+    config.xdp_device = "lo";
+    const bool xdp = run_udp(config);
+    passed = run_tcp(config);
+    assert(!passed); // UDP only
+    std::cout << "  io_uring backend: " << (uring ? "tested" : "unavailable, skipped") << std::endl;
+    std::cout << "  AF_XDP backend: " << (xdp ? "tested" : "unavailable, skipped") << std::endl;
+    
+    std::cout << "✓ Feed handler test passed" << std::endl;
+}
+
+// Test a sequence gap marks the book stale, buffers, and recovers from a
+// snapshot built on a side thread without blocking the live path
+void test_feed_recovery() {
+    std::cout << "\n=== Test: Feed Gap Recovery ===" << std::endl;
+    // One op per message sequence number; 3 is lost on the wire
+    const BookOp ops[] = {
+        {BookOpType::Add, {1, true, 100.0, 10, 0}},
+        {BookOpType::Add, {2, false, 101.0, 5, 0}},
+        {BookOpType::Add, {3, true, 99.0, 7, 0}},
+        {BookOpType::Cancel, {1, true, 0.0, 0, 0}},
+        {BookOpType::Amend, {2, false, 101.0, 3, 0}},
+        {BookOpType::Add, {4, true, 100.5, 1, 0}},
+    };
+    char packets[6][kMaxFeedPacketSize];
+    size_t sizes[6];
+    for (size_t i = 0; i < 6; i++) {
+        FeedPacketBuilder builder(packets[i], 1, 1 + i);
+        builder.add(ops[i]);
+        sizes[i] = builder.finish();
+    }
+    auto send = [&](FeedHandler& handler, uint64_t sequence) {
+        handler.on_packet(packets[sequence - 1], sizes[sequence - 1]);
+    };
+    auto snapshot_at_4 = [](FeedSnapshot& snapshot) {
+        snapshot.sequence = 4;
+        snapshot.orders = {{3, true, 99.0, 7, 0}, {2, false, 101.0, 5, 0}};
+    };
+    auto top = [](const OrderBook& book, std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) {
+        book.get_snapshot(5, bids, asks);
+    };
+    std::vector<PriceLevel> bids, asks;
+    
+    // Snapshot arrives while live packets keep flowing. The live book's
+    // arena is single-threaded, so the recovery thread must not touch it
+    {
+        ArenaConfig arena_config;
+        arena_config.thread_safe = false;
+        Arena level_arena(arena_config);
+        OrderBookConfig book_config;
+        book_config.arena = &level_arena;
+        OrderBook book(book_config);
+        FeedHandler handler(book);
+        std::atomic<bool> release{false};
+        handler.set_snapshot_source([&](FeedSnapshot& snapshot) {
+            while (!release.load()) std::this_thread::yield();
+            snapshot_at_4(snapshot);
+            return true;
+        });
+        send(handler, 1);
+        send(handler, 2);
+        assert(!handler.stale() && handler.expected_sequence() == 3);
+        send(handler, 4); // Gap: 3 never arrives
+        assert(handler.stale() && handler.recovering() && handler.stats().gaps == 1);
+        send(handler, 5);
+        send(handler, 5); // Duplicates are harmless while buffered
+        top(book, bids, asks);
+        assert(bids.size() == 1 && bids[0].price == 100.0 && asks[0].total_quantity == 5); // Untouched, stale
+        const size_t arena_used = level_arena.stats().bytes_used;
+        
+        release.store(true);
+        for (int spins = 0; handler.recovering() && spins < 1000000; spins++) {
+            handler.poll();
+            std::this_thread::yield();
+        }
+        assert(!handler.stale() && handler.stats().recoveries == 1 && handler.expected_sequence() == 6);
+        assert(level_arena.stats().bytes_used == arena_used && book.config().arena == nullptr);
+        top(book, bids, asks);
+        assert(bids.size() == 1 && bids[0].price == 99.0 && asks[0].total_quantity == 3);
+        
+        send(handler, 6);
+        send(handler, 6);
+        top(book, bids, asks);
+        assert(bids.size() == 2 && bids[0].price == 100.5 && handler.stats().duplicates == 1);
+    }
+    
+    // A snapshot older than the buffer leaves a hole and is refetched; a
+    // full buffer drops its oldest packet
+    {
+        OrderBook book;
+        FeedHandlerConfig config;
+        config.recovery_buffer = 2;
+        FeedHandler handler(book, config);
+        std::atomic<int> calls{0};
+        handler.set_snapshot_source([&](FeedSnapshot& snapshot) {
+            if (calls.fetch_add(1) == 0) {
+                snapshot.sequence = 1; // Too old: 2 and 3 are in neither
+                snapshot.orders = {{1, true, 100.0, 10, 0}};
+                return true;
+            }
+            snapshot_at_4(snapshot);
+            return true;
+        });
+        send(handler, 1);
+        send(handler, 4);
+        send(handler, 5);
+        send(handler, 6); // Evicts 4, which the good snapshot covers
+        assert(handler.stats().overflowed == 1);
+        for (int spins = 0; handler.recovering() && spins < 1000000; spins++) {
+            handler.poll();
+            std::this_thread::yield();
+        }
+        assert(calls.load() == 2 && handler.stats().recoveries == 1 && handler.expected_sequence() == 7);
+        top(book, bids, asks);
+        assert(bids.size() == 2 && bids[0].price == 100.5 && bids[1].price == 99.0 && asks[0].total_quantity == 3);
+    }
+    
+    // No snapshot source: the gap is counted and the book stays stale
+    {
+        OrderBook book;
+        FeedHandler handler(book);
+        send(handler, 1);
+        send(handler, 4);
+        assert(handler.stale() && !handler.recovering() && handler.stats().gaps == 1);
+        assert(handler.expected_sequence() == 5);
+    }
+    
+    std::cout << "✓ Feed gap recovery test passed" << std::endl;
+}
+
+// Test a capture file is walked packet by packet and stops at a torn tail
+void test_feed_capture() {
+    std::cout << "\n=== Test: Feed Capture ===" << std::endl;
+    char path[] = "/tmp/feed_capture_XXXXXX";
+    const int fd = mkstemp(path);
+    assert(fd >= 0);
+    
+    char buffer[kMaxFeedPacketSize];
+    FeedPacketBuilder builder(buffer, 1, 1);
+    size_t written = 0;
+    for (uint64_t id = 1; id <= 10; id++) {
+        builder.add({BookOpType::Add, {id, id % 2 == 0, 100.0 + static_cast<double>(id), 100, id}});
+        builder.add({BookOpType::Cancel, {id, false, 0.0, 0, id}});
+        const size_t size = builder.finish();
+        const ssize_t bytes = write(fd, buffer, size);
+        assert(bytes == static_cast<ssize_t>(size));
+        written += size;
+    }
+    // A packet cut off mid-write
+    builder.add({BookOpType::Add, {11, true, 111.0, 100, 11}});
+    const ssize_t torn = write(fd, buffer, 20);
+    assert(torn == 20);
+    close(fd);
+    
+    FeedCapture capture;
+    bool opened = capture.open(path);
+    assert(opened);
+    assert(capture.size() == written + 20);
+    size_t packets = 0;
+    uint64_t next = 1;
+    const size_t walked = capture.for_each_packet([&](const PacketView& packet) {
+        assert(packet.sequence() == next && packet.message_count() == 2);
+        next += packet.message_count();
+        packets++;
+    });
+    assert(packets == 10 && walked == written);
+    
+    // Replayed through apply_batch the book ends empty
+    OrderBook book;
+    BookOp ops[kMaxFeedMessages];
+    capture.for_each_packet([&](const PacketView& packet) {
+        const char* message = packet.messages();
+        size_t count = 0;
+        for (size_t i = 0; i < packet.message_count(); i++) {
+            const MessageView view(message);
+            message += view.length();
+            if (decode_feed_message(view, ops[count])) count++;
+        }
+        book.apply_batch(ops, count);
+    });
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(10, bids, asks);
+    assert(bids.empty() && asks.empty());
+    
+    capture.close();
+    assert(!capture.is_open());
+    unlink(path);
+    opened = capture.open(path);
+    assert(!opened);
+    
+    std::cout << "✓ Feed capture test passed" << std::endl;
+}
+
+// Test the multicast publisher: every delta arrives in sequence and
+// rebuilds the levels, sends are batched, and the conflated channel
+// carries the top levels with far fewer messages
+void test_multicast_publisher() {
+    std::cout << "\n=== Test: Multicast Publisher ===" << std::endl;
+    // Unicast loopback stands in for the groups
+    auto bind_receiver = [](uint16_t& port) {
+        const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        const int buffer = 8 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        const int bound = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        assert(bound == 0);
+        socklen_t length = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &length);
+        port = ntohs(addr.sin_port);
+        return fd;
+    };
+    MulticastPublisherConfig config;
+    const int delta_fd = bind_receiver(config.port);
+    const int conflated_fd = bind_receiver(config.conflated_port);
+    config.group = "127.0.0.1";
+    config.conflated_group = "127.0.0.1";
+    config.batch = 4;
+    config.conflated_depth = 3;
+    config.conflation_interval_ns = 1000;
+    config.heartbeat_interval_ns = 1000000;
+    
+    OrderBook book;
+    Fifo3<BookEvent> ring(1 << 14);
+    FifoEventSink<Fifo3<BookEvent>> sink(ring);
+    book.set_event_sink(&sink, kL2Events);
+    MulticastPublisher publisher(book.tick_scale(), config);
+    const bool opened = publisher.open();
+    assert(opened);
+    
+    uint64_t now = 1;
+    for (uint64_t i = 0; i < 3000; i++) {
+        const uint64_t id = i + 1;
+        const bool is_buy = i % 2 == 0;
+        const double price = is_buy ? 99.0 - (i % 9) * 0.01 : 99.05 + (i % 8) * 0.01;
+        book.add_order(Order{id, is_buy, price, 10 + i % 5, i});
+        if (i % 3 == 2) book.cancel_order(id - 1);
+        if (i % 7 == 6) book.amend_order(id - 4, price, 5);
+        if (i % 40 == 39) {
+            publisher.drain(ring, now);
+            now += 300; // A conflated image every few drains
+        }
+    }
+    publisher.drain(ring, now + 1000);
+    
+    // Read both channels back as a subscriber would
+    struct Subscriber {
+        std::map<std::pair<bool, int64_t>, uint64_t> levels;
+        uint64_t next_sequence = 1;
+        uint64_t messages = 0;
+        uint64_t heartbeats = 0;
+    };
+    auto receive = [](int fd, Subscriber& subscriber) {
+        char datagram[kMaxFeedPacketSize];
+        for (int idle = 0; idle < 200;) {
+            const ssize_t size = recv(fd, datagram, sizeof(datagram), MSG_DONTWAIT);
+            if (size <= 0) {
+                idle++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            assert(validate_feed_packet(datagram, static_cast<size_t>(size)));
+            const PacketView packet(datagram);
+            assert(packet.sequence() == subscriber.next_sequence);
+            const char* message = packet.messages();
+            for (size_t i = 0; i < packet.message_count(); i++, message += MessageView(message).length()) {
+                if (MessageView(message).type() == FeedMessageType::Heartbeat) {
+                    subscriber.heartbeats++;
+                    continue;
+                }
+                assert(MessageView(message).type() == FeedMessageType::LevelUpdate);
+                const LevelUpdateView update(message);
+                const auto key = std::make_pair(update.side() == 1, update.price());
+                if (update.update() == static_cast<uint8_t>(BookEventType::LevelDelete)) {
+                    const size_t erased = subscriber.levels.erase(key);
+                    assert(erased == 1);
+                } else {
+                    subscriber.levels[key] = update.quantity();
+                }
+                subscriber.next_sequence++;
+                subscriber.messages++;
+            }
+        }
+    };
+    Subscriber deltas, conflated;
+    receive(delta_fd, deltas);
+    receive(conflated_fd, conflated);
+    close(delta_fd);
+    close(conflated_fd);
+    
+    const MulticastStats& stats = publisher.stats();
+    assert(stats.send_failures == 0 && stats.gaps == 0);
+    assert(deltas.messages == stats.messages && deltas.messages == stats.events);
+    assert(conflated.messages == stats.conflated_messages);
+    assert(stats.syscalls * 2 < stats.packets); // Batched
+    assert(conflated.messages * 5 < deltas.messages);
+    assert(deltas.heartbeats + conflated.heartbeats == stats.heartbeats);
+    std::cout << stats.events << " deltas in " << stats.packets << " packets over " << stats.syscalls
+              << " sendmmsg calls; conflated top-" << config.conflated_depth << ": "
+              << stats.conflated_messages << " updates" << std::endl;
+    
+    // The delta channel rebuilds every level; the conflated one the top
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(1000, bids, asks);
+    assert(deltas.levels.size() == bids.size() + asks.size());
+    size_t rank = 0;
+    for (const PriceLevel& level : bids) {
+        const auto key = std::make_pair(true, feed_from_price(level.price));
+        assert(deltas.levels.at(key) == level.total_quantity);
+        if (rank++ < config.conflated_depth) assert(conflated.levels.at(key) == level.total_quantity);
+    }
+    rank = 0;
+    for (const PriceLevel& level : asks) {
+        const auto key = std::make_pair(false, feed_from_price(level.price));
+        assert(deltas.levels.at(key) == level.total_quantity);
+        if (rank++ < config.conflated_depth) assert(conflated.levels.at(key) == level.total_quantity);
+    }
+    assert(conflated.levels.size() == std::min(bids.size(), config.conflated_depth) +
+                                           std::min(asks.size(), config.conflated_depth));
+    
+    MulticastPublisherConfig bad;
+    bad.group = "not-an-address";
+    const bool bad_opened = MulticastPublisher(TickScale(), bad).open();
+    assert(!bad_opened);
+    std::cout << "✓ Multicast publisher test passed" << std::endl;
+}
+
+// Test the journal records every book call across segment rotations and
+// replays into an identical book, continuing its sequence on reopen
+void test_book_journal() {
+    std::cout << "\n=== Test: Book Journal ===" << std::endl;
+    char dir[] = "/tmp/book_journal_XXXXXX";
+    const char* made = mkdtemp(dir);
+    assert(made != nullptr);
+    JournalConfig config;
+    config.path = std::string(dir) + "/book.journal";
+    config.segment_bytes = sizeof(JournalSegmentHeader) + 100 * sizeof(JournalRecord); // Rotate often
+    config.flush_interval_us = 200;
+    
+    auto run_flow = [](OrderBook& book, uint64_t first_id, size_t count) {
+        uint64_t filled = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            const uint64_t id = first_id + i;
+            const bool is_buy = i % 2 == 0;
+            const double price = is_buy ? 99.0 + (i % 7) * 0.01 : 99.05 + (i % 5) * 0.01;
+            if (i % 11 == 10) {
+                // Crossing IOC order: fills depend on the book, replay must match
+                book.match_order(Order{id, is_buy, price, 150, id, TimeInForce::ImmediateOrCancel},
+                                 [&](const Fill& fill) { filled += fill.quantity; });
+            } else {
+                book.add_order(Order{id, is_buy, price, 100, id});
+            }
+            if (i % 3 == 2) book.cancel_order(id - 1);
+            if (i % 5 == 4) book.amend_order(id - 2, price, 300);
+        }
+        return filled;
+    };
+    
+    OrderBook live;
+    {
+        BookJournal journal(config);
+        const bool opened = journal.open();
+        assert(opened);
+        live.set_journal(&journal);
+        run_flow(live, 1, 1000);
+        const bool cancelled = live.cancel_order(999999);
+        assert(!cancelled); // Misses change nothing and are not journaled
+        // Nor do rejected matches, whichever check turns them away
+        const uint64_t before_rejects = journal.sequence();
+        auto no_fills = [](const Fill&) {};
+        Order post_only{900001, true, 200.0, 10, 1, TimeInForce::GoodTillCancel, OrderType::PostOnly};
+        RejectReason reason = live.match_order(post_only, no_fills).reason;
+        assert(reason == RejectReason::PostOnlyCross);
+        Order fok{900002, true, 200.0, 1000000000, 1, TimeInForce::FillOrKill};
+        reason = live.match_order(fok, no_fills).reason;
+        assert(reason == RejectReason::FillOrKill);
+        Order gtt{900003, true, 1.0, 10, 1, TimeInForce::GoodTillTime};
+        gtt.expire_ns = 2; // This book has no expiry wheel
+        reason = live.match_order(gtt, no_fills).reason;
+        assert(reason == RejectReason::InvalidOrder);
+        assert(journal.sequence() == before_rejects);
+        const MatchStatus status =
+            live.match_order(Order{900004, false, 1.0, 1, 1, TimeInForce::ImmediateOrCancel}, no_fills).status;
+        assert(status == MatchStatus::Filled);
+        assert(journal.sequence() == before_rejects + 1);
+        live.set_journal(nullptr);
+        journal.close();
+        
+        const JournalStats stats = journal.stats();
+        assert(stats.records == journal.sequence() && stats.durable_sequence == stats.records);
+        assert(stats.segments > 10 && stats.dropped == 0 && stats.flushes > 0);
+        std::cout << stats.records << " records in " << stats.segments << " segments, "
+                  << stats.rotation_stalls << " rotation stalls" << std::endl;
+    }
+    const bool appended = BookJournal().append(JournalOp::Add, 1, true, 1.0, 1, 0);
+    assert(!appended); // Never opened
+    
+    // Reopening continues the sequence in a fresh segment
+    uint64_t first_run = 0;
+    BookJournal::read(config.path, [&](const JournalRecord& record) { first_run = record.sequence; });
+    {
+        BookJournal journal(config);
+        const bool opened = journal.open();
+        assert(opened && journal.sequence() == first_run);
+        live.set_journal(&journal);
+        run_flow(live, 5000, 300);
+        live.set_journal(nullptr);
+    }
+    
+    OrderBook recovered;
+    const uint64_t replayed = BookJournal::replay(config.path, recovered);
+    assert(replayed > first_run);
+    std::vector<PriceLevel> live_bids, live_asks, bids, asks;
+    live.get_snapshot(100, live_bids, live_asks);
+    recovered.get_snapshot(100, bids, asks);
+    assert(bids.size() == live_bids.size() && asks.size() == live_asks.size() && !bids.empty());
+    for (size_t i = 0; i < bids.size(); i++) {
+        assert(bids[i].price == live_bids[i].price && bids[i].total_quantity == live_bids[i].total_quantity);
+    }
+    for (size_t i = 0; i < asks.size(); i++) {
+        assert(asks[i].price == live_asks[i].price && asks[i].total_quantity == live_asks[i].total_quantity);
+    }
+    
+    // Snapshot plus the records after it: a partial replay on top
+    OrderBook partial;
+    const uint64_t tail = BookJournal::replay(config.path, partial, replayed - 10);
+    assert(tail == 10);
+    
+    // A torn tail: replay stops at the first record out of sequence
+    const std::string last = config.path + ".000001";
+    const int fd = open(last.c_str(), O_RDWR);
+    assert(fd >= 0);
+    const uint64_t zero = 0;
+    const ssize_t torn = pwrite(fd, &zero, sizeof(zero), sizeof(JournalSegmentHeader) + 50 * sizeof(JournalRecord));
+    assert(torn == 8);
+    close(fd);
+    const uint64_t intact = BookJournal::read(config.path, [](const JournalRecord&) {});
+    assert(intact == 50);
+    
+    std::filesystem::remove_all(dir);
+    std::cout << "✓ Book journal test passed" << std::endl;
+}
+
+// Test a binary snapshot restores every level and each level's FIFO order,
+// rejects damaged images, and restores a large book quickly
+void test_book_snapshot() {
+    std::cout << "\n=== Test: Book Snapshot ===" << std::endl;
+    OrderBook book;
+    for (uint64_t id = 1; id <= 2000; id++) {
+        const bool is_buy = id % 2 == 0;
+        book.add_order({id, is_buy, is_buy ? 99.0 - (id % 13) * 0.01 : 100.0 + (id % 11) * 0.01, 10 + id % 7, id});
+    }
+    for (uint64_t id = 3; id <= 2000; id += 9) book.cancel_order(id);
+    for (uint64_t id = 4; id <= 2000; id += 17) book.amend_order(id, 98.95, 500); // Moves to the back
+    
+    std::vector<char> image(book.snapshot_bytes());
+    size_t bytes = book.write_snapshot(image.data(), image.size() - 1);
+    assert(bytes == 0);
+    bytes = book.write_snapshot(image.data(), image.size(), 77);
+    assert(bytes == image.size());
+    
+    // Restoring into a book with a sink republishes the contents as deltas
+    Fifo3<BookEvent> ring(256);
+    FifoEventSink<Fifo3<BookEvent>> sink(ring);
+    OrderBook restored;
+    restored.set_event_sink(&sink, kL2Events);
+    uint64_t sequence = 0;
+    bool result = restored.restore_snapshot(image.data(), image.size(), &sequence);
+    assert(result && sequence == 77);
+    BookEvent event;
+    const bool popped = ring.pop(event);
+    assert(popped && event.type == BookEventType::LevelAdd && event.sequence == 1);
+    
+    std::vector<PriceLevel> bids, asks, restored_bids, restored_asks;
+    book.get_snapshot(100, bids, asks);
+    restored.get_snapshot(100, restored_bids, restored_asks);
+    assert(bids.size() == restored_bids.size() && asks.size() == restored_asks.size());
+    for (size_t i = 0; i < bids.size(); i++) {
+        assert(bids[i].price == restored_bids[i].price && bids[i].total_quantity == restored_bids[i].total_quantity);
+    }
+    for (size_t i = 0; i < asks.size(); i++) {
+        assert(asks[i].price == restored_asks[i].price && asks[i].total_quantity == restored_asks[i].total_quantity);
+    }
+    
+    // Time priority survives: sweeping both books fills makers in the same order
+    std::vector<uint64_t> makers, restored_makers;
+    book.match_order({9000, false, 0.0, 100000, 0, TimeInForce::ImmediateOrCancel, OrderType::Market},
+                     [&](const Fill& fill) { makers.push_back(fill.maker_order_id); });
+    restored.match_order({9000, false, 0.0, 100000, 0, TimeInForce::ImmediateOrCancel, OrderType::Market},
+                         [&](const Fill& fill) { restored_makers.push_back(fill.maker_order_id); });
+    assert(!makers.empty() && makers == restored_makers);
+    result = restored.cancel_order(1) && !restored.cancel_order(3);
+    assert(result); // Index rebuilt too
+    
+    // Damaged images leave the book as it was
+    OrderBook target;
+    target.add_order({1, true, 50.0, 10, 0});
+    result = target.restore_snapshot(image.data(), image.size() - sizeof(SnapshotOrder));
+    assert(!result);
+    std::vector<char> damaged = image;
+    reinterpret_cast<SnapshotLevel*>(damaged.data() + sizeof(SnapshotHeader))->total_quantity++;
+    result = target.restore_snapshot(damaged.data(), damaged.size());
+    assert(!result);
+    OrderBookConfig coarse;
+    coarse.tick_size = 0.05;
+    result = OrderBook(coarse).restore_snapshot(image.data(), image.size());
+    assert(!result);
+    result = target.cancel_order(1);
+    assert(result);
+    
+    // Bulk restore of a large book through a file
+    constexpr uint64_t kOrders = 1000000;
+    OrderBookConfig config;
+    config.order_capacity = kOrders;
+    OrderBook large(config);
+    for (uint64_t id = 1; id <= kOrders; id++) {
+        const bool is_buy = id % 2 == 0;
+        large.add_order({id * 7919, is_buy, is_buy ? 90.0 - (id % 500) * 0.01 : 110.0 + (id % 500) * 0.01, 100, id});
+    }
+    char path[] = "/tmp/book_snapshot_XXXXXX";
+    const int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    result = large.save_snapshot(path, 5);
+    assert(result);
+    
+    OrderBook reloaded;
+    const auto start = std::chrono::high_resolution_clock::now();
+    result = reloaded.load_snapshot(path, &sequence);
+    assert(result && sequence == 5);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    unlink(path);
+    assert(reloaded.snapshot_bytes() == large.snapshot_bytes());
+    result = reloaded.cancel_order(7919 * 12345) && !reloaded.cancel_order(7919 * 12345);
+    assert(result);
+    std::cout << "Restored " << kOrders << " orders in " << elapsed << " ms" << std::endl;
+    
+    std::cout << "✓ Book snapshot test passed" << std::endl;
+}
+
+// Test histogram buckets stay within their relative error bound
+void test_latency_histogram() {
+    std::cout << "\n=== Test: Latency Histogram ===" << std::endl;
+    LatencyHistogram histogram;
+    assert(histogram.percentile(50) == 0 && histogram.count() == 0);
+    for (uint64_t v = 1; v <= 1000; v++) histogram.record(v);
+    assert(histogram.count() == 1000 && histogram.min() == 1 && histogram.max() == 1000);
+    assert(histogram.mean() == 500.5);
+    
+    // Exact below 64, within 1/32 above
+    assert(histogram.percentile(5) == 50);
+    const uint64_t p50 = histogram.percentile(50), p99 = histogram.percentile(99);
+    assert(p50 >= 500 && p50 <= 500 + 500 / 32);
+    assert(p99 >= 990 && p99 <= 990 + 990 / 32);
+    assert(histogram.percentile(100) == 1000);
+    
+    // Buckets are monotonic across magnitude boundaries
+    for (uint64_t v = 1; v < (1u << 20); v = v * 3 / 2 + 1) {
+        assert(LatencyHistogram::bucket_index(v) <= LatencyHistogram::bucket_index(v + 1));
+    }
+    
+    LatencyHistogram other;
+    other.record(1u << 30);
+    histogram.merge(other);
+    assert(histogram.count() == 1001 && histogram.max() == (1u << 30));
+    histogram.reset();
+    assert(histogram.count() == 0 && histogram.max() == 0);
+    
+    std::cout << "✓ Latency histogram test passed" << std::endl;
+}
+
+// Test the atomic histogram matches the plain one, and the book's
+// instrumentation counts what it sees when compiled in
+void test_book_metrics() {
+    std::cout << "\n=== Test: Book Metrics ===" << std::endl;
+    LatencyHistogram plain, copied;
+    AtomicLatencyHistogram shared;
+    for (uint64_t value = 1; value < 100000; value = value * 3 / 2 + 1) {
+        plain.record(value);
+        shared.record(value);
+    }
+    shared.snapshot(copied);
+    assert(copied.count() == plain.count() && copied.max() == plain.max() && copied.min() == plain.min());
+    assert(copied.percentile(50) == plain.percentile(50) && copied.percentile(99.9) == plain.percentile(99.9));
+    shared.reset();
+    shared.snapshot(copied);
+    assert(copied.count() == 0 && shared.count() == 0);
+    
+    const double ticks_per_ns = tsc_ticks_per_ns();
+    assert(ticks_per_ns > 0.1 && ticks_per_ns < 10.0);
+    BookMetrics metrics;
+    metrics.record(BookMetric::Add, static_cast<uint64_t>(100 * ticks_per_ns));
+    const BookMetricSummary summary = metrics.summary(BookMetric::Add);
+    assert(summary.count == 1 && summary.max_ns > 95 && summary.max_ns < 105);
+    
+    OrderBook book;
+    book.add_order({1, true, 100.0, 10, 0});
+    book.add_order({2, true, 100.0, 10, 0});
+    book.add_order({3, false, 101.0, 10, 0});
+    book.amend_order(1, 99.0, 10);
+    book.cancel_order(3);
+    book.cancel_order(42);
+    std::vector<PriceLevel> bids, asks;
+    book.get_snapshot(5, bids, asks);
+    if (BookMetrics* instrumented = book.metrics()) {
+        assert(instrumented->summary(BookMetric::Add).count == 3);
+        assert(instrumented->summary(BookMetric::Cancel).count == 2);
+        assert(instrumented->summary(BookMetric::Amend).count == 1);
+        assert(instrumented->summary(BookMetric::Snapshot).count == 1);
+        assert(instrumented->levels_created() == 3 && instrumented->levels_erased() == 1);
+        assert(instrumented->lookups_missed() == 1);
+        instrumented->print();
+    } else {
+        std::cout << "OrderBook instrumentation compiled out (build with ORDERBOOK_METRICS)" << std::endl;
+    }
+    
+    std::cout << "✓ Book metrics test passed" << std::endl;
+}
+
+// Time push/pop bursts on one thread: the per-message instruction and
+// Test Fifo3 consumers blocking through each wait strategy
+void test_spsc_wait() {
+    std::cout << "\n=== Test: SPSC Wait Strategies ===" << std::endl;
+    constexpr uint64_t kItems = 2000;
+    
+    // Producer sleeps now and then so parking consumers actually park
+    auto run = [&](auto& wait) {
+        Fifo3<uint64_t> ring(64);
+        std::thread producer([&] {
+            for (uint64_t i = 1; i <= kItems; i++) {
+                while (!ring.push(i, wait)) __builtin_ia32_pause();
+                if (i % 500 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        });
+        uint64_t value = 0;
+        for (uint64_t expected = 1; expected <= kItems; expected++) {
+            const bool popped = ring.pop_wait(value, wait);
+            assert(popped && value == expected);
+        }
+        producer.join();
+        
+        // Stopping releases a consumer waiting on an empty ring
+        std::thread stopper([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            wait.stop();
+        });
+        const bool popped = ring.pop_wait(value, wait);
+        assert(!popped);
+        stopper.join();
+    };
+    
+    BusySpinWait spin;
+    run(spin);
+    SpinYieldWait yield(16);
+    run(yield);
+    SpinParkWait park(64);
+    run(park);
+    assert(park.parks() > 0);
+    std::cout << "Consumer parked " << park.parks() << " times" << std::endl;
+    
+    // A wake landing between the consumer's re-check and its FUTEX_WAIT
+    // must still release it; a lost wake hangs here. The re-check itself
+    // notifies, which pins the wake into that window.
+    SpinParkWait pinned(0);
+    const bool running = pinned.idle(0, [&] {
+        pinned.notify();
+        return false;
+    });
+    assert(running);
+    // And racing stops, in a loop
+    for (int round = 0; round < 2000; round++) {
+        SpinParkWait parking(0);
+        Fifo3<uint64_t> empty(8);
+        std::thread consumer([&] {
+            uint64_t unused = 0;
+            const bool popped = empty.pop_wait(unused, parking);
+            assert(!popped);
+        });
+        if (round % 2 == 0) std::this_thread::yield();
+        parking.stop();
+        consumer.join();
+    }
+    
+    std::cout << "✓ SPSC wait strategies test passed" << std::endl;
+}
+
+// barrier cost of each ring, with Fifo4 using push_n/pop_n
+void test_spsc_burst() {
+    std::cout << "\n=== Test: SPSC Burst Throughput ===" << std::endl;
+    const size_t total = 1 << 20;
+    uint64_t in[64], out[64];
+    for (size_t i = 0; i < 64; i++) in[i] = i;
+    
+    auto run = [&](size_t burst, auto&& push_burst, auto&& pop_burst) {
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t checksum = 0;
+        for (size_t sent = 0; sent < total; sent += burst) {
+            push_burst(burst);
+            pop_burst(burst);
+            checksum += out[burst - 1];
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        assert(checksum == (total / burst) * (burst - 1));
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        return static_cast<double>(total) * 1000.0 / static_cast<double>(ns ? ns : 1);
+    };
+    auto one_at_a_time = [&](size_t burst, auto& ring) {
+        return run(burst,
+                   [&](size_t n) { for (size_t i = 0; i < n; i++) ring.push(in[i]); },
+                   [&](size_t n) { for (size_t i = 0; i < n; i++) ring.pop(out[i]); });
+    };
+    
+    std::cout << "Burst   Fifo1     Fifo2     Fifo3     Fifo4_n   (M msgs/s)" << std::endl;
+    for (size_t burst : {1, 4, 16, 64}) {
+        Fifo1<uint64_t> fifo1(1024);
+        Fifo2<uint64_t> fifo2(1024);
+        Fifo3<uint64_t> fifo3(1024);
+        Fifo4<uint64_t> fifo4(1024);
+        const double r1 = one_at_a_time(burst, fifo1);
+        const double r2 = one_at_a_time(burst, fifo2);
+        const double r3 = one_at_a_time(burst, fifo3);
+        const double r4 = run(burst,
+                              [&](size_t n) { fifo4.push_n(in, n); },
+                              [&](size_t n) { fifo4.pop_n(out, n); });
+        std::cout << std::setw(5) << burst << std::fixed << std::setprecision(1)
+                  << std::setw(8) << r1 << std::setw(10) << r2
+                  << std::setw(10) << r3 << std::setw(10) << r4 << std::endl;
+    }
+    
+    std::cout << "✓ SPSC burst test passed" << std::endl;
+}
+
+// Test the MPSC ring keeps per-producer order, and time it against
+// one Fifo3 per producer polled round-robin
+void test_mpsc_queue() {
+    std::cout << "\n=== Test: MPSC Queue ===" << std::endl;
+    
+    // Single-threaded: full/empty edges and batched drain
+    MpscFifo<int> small(4);
+    for (int i = 0; i < 4; i++) {
+        const bool pushed = small.push(i);
+        assert(pushed);
+    }
+    bool pushed = small.push(4);
+    assert(!pushed && small.size() == 4);
+    int out[8];
+    size_t drained = small.try_pop_n(out, 3);
+    assert(drained == 3 && out[0] == 0 && out[2] == 2);
+    pushed = small.push(4) && small.push(5);
+    assert(pushed);
+    drained = small.try_pop_n(out, 8);
+    assert(drained == 3 && out[0] == 3 && out[2] == 5);
+    drained = small.try_pop_n(out, 8);
+    assert(drained == 0 && small.empty());
+    
+    const uint64_t producers = 3;
+    const uint64_t per_producer = 20000;
+    const uint64_t total = producers * per_producer;
+    
+    // Messages carry (producer, sequence); check each producer's stream is in order
+    auto run = [&](auto&& push, auto&& drain) {
+        std::vector<uint64_t> next(producers, 0);
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> threads;
+        for (uint64_t p = 0; p < producers; p++) {
+            threads.emplace_back([&, p] {
+                for (uint64_t i = 0; i < per_producer; i++) {
+                    while (!push(p, (p << 32) | i)) std::this_thread::yield();
+                }
+            });
+        }
+        uint64_t received = 0;
+        while (received < total) {
+            const uint64_t drained = drain([&](uint64_t message) {
+                const uint64_t p = message >> 32;
+                assert((message & 0xffffffff) == next[p]);
+                next[p]++;
+            });
+            if (drained == 0) std::this_thread::yield();
+            received += drained;
+        }
+        for (auto& thread : threads) thread.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    };
+    
+    MpscFifo<uint64_t> shared(1024);
+    auto mpsc_us = run(
+        [&](uint64_t, uint64_t message) { return shared.push(message); },
+        [&](auto&& on_message) {
+            uint64_t batch[64];
+            const size_t count = shared.try_pop_n(batch, 64);
+            for (size_t i = 0; i < count; i++) on_message(batch[i]);
+            return static_cast<uint64_t>(count);
+        });
+    
+    std::vector<std::unique_ptr<Fifo3<uint64_t>>> rings;
+    for (uint64_t p = 0; p < producers; p++) rings.push_back(std::make_unique<Fifo3<uint64_t>>(1024));
+    auto rings_us = run(
+        [&](uint64_t p, uint64_t message) { return rings[p]->push(message); },
+        [&](auto&& on_message) {
+            uint64_t count = 0, message;
+            for (auto& ring : rings) {
+                for (int i = 0; i < 64 && ring->pop(message); i++, count++) on_message(message);
+            }
+            return count;
+        });
+    
+    std::cout << total << " messages from " << producers << " producers:" << std::endl;
+    std::cout << "  MpscFifo (try_pop_n 64):   " << mpsc_us << " µs" << std::endl;
+    std::cout << "  " << producers << " x Fifo3 round-robin:   " << rings_us << " µs" << std::endl;
+    
+    std::cout << "✓ MPSC queue test passed" << std::endl;
+}
+
+// Run the shared API tests against one book implementation
+template <typename Book>
+void run_book_tests(const char* name) {
+    std::cout << "\n########## " << name << " ##########" << std::endl;
+    test_add_orders<Book>();
+    test_cancel_order<Book>();
+    test_amend_order<Book>();
+    test_snapshot_depth<Book>();
+    test_fifo_priority<Book>();
+    test_tick_prices<Book>();
+    test_performance<Book>();
+}
+
+// Test GoodTillTime deadlines survive every path that rebuilds a book:
+// snapshot restore (including onto itself, as NUMA re-homing does) and
+// journal replay
+void test_expiry_recovery() {
+    std::cout << "\n=== Test: Expiry Recovery ===" << std::endl;
+    OrderBookConfig config;
+    config.expiry_tick_ns = 1000;
+    auto gtt = [](uint64_t id, bool is_buy, double price, uint64_t expire_ns) {
+        Order order{id, is_buy, price, 10, 100, TimeInForce::GoodTillTime};
+        order.expire_ns = expire_ns;
+        return order;
+    };
+    auto no_fills = [](const Fill&) {};
+    auto fill = [&](OrderBook& book) {
+        MatchStatus status = book.match_order(gtt(1, true, 99.0, 5000), no_fills).status;
+        assert(status == MatchStatus::Rested);
+        status = book.match_order(gtt(2, false, 101.0, 9000), no_fills).status;
+        assert(status == MatchStatus::Rested);
+        book.add_order(gtt(3, true, 98.0, 7000));
+        book.add_order({4, true, 97.0, 10, 100}); // GTC
+        const size_t swept = book.expire_orders(3000);
+        assert(swept == 0);
+    };
+    auto drain = [](OrderBook& book) {
+        assert(book.expiring_order_count() == 3);
+        size_t swept = book.expire_orders(4999);
+        assert(swept == 0);
+        swept = book.expire_orders(5000);
+        assert(swept == 1);
+        swept = book.expire_orders(7000);
+        assert(swept == 1);
+        swept = book.expire_orders(9000);
+        assert(swept == 1);
+        assert(book.expiring_order_count() == 0 && book.top_of_book().bid == 97.0);
+        assert(book.top_of_book().ask == 0.0);
+    };
+    
+    OrderBook book(config);
+    fill(book);
+    std::vector<uint64_t> image((book.snapshot_bytes() + 7) / 8);
+    char* data = reinterpret_cast<char*>(image.data());
+    const size_t bytes = book.write_snapshot(data, image.size() * 8);
+    
+    OrderBook restored(config);
+    bool result = restored.restore_snapshot(data, bytes);
+    assert(result);
+    drain(restored);
+    OrderBook plain; // No wheel to hold the deadlines
+    result = plain.restore_snapshot(data, bytes);
+    assert(!result);
+    result = book.restore_snapshot(data, bytes);
+    assert(result); // In place
+    drain(book);
+    
+    char dir[] = "/tmp/expiry_journal_XXXXXX";
+    const char* made = mkdtemp(dir);
+    assert(made != nullptr);
+    JournalConfig journal_config;
+    journal_config.path = std::string(dir) + "/book.journal";
+    {
+        BookJournal journal(journal_config);
+        const bool opened = journal.open();
+        assert(opened);
+        OrderBook live(config);
+        live.set_journal(&journal);
+        fill(live);
+        live.set_journal(nullptr);
+    }
+    OrderBook replayed(config);
+    const uint64_t applied = BookJournal::replay(journal_config.path, replayed);
+    assert(applied > 0);
+    drain(replayed);
+    std::filesystem::remove_all(dir);
+    std::cout << "✓ Expiry recovery test passed" << std::endl;
+}
+
+// Test the tick store reads back every event it archived, skips blocks
+// outside a time range, rebuilds the book, packs well below a fixed-width
+// record and survives a torn tail
+void test_tick_store() {
+    std::cout << "\n=== Test: Tick Store ===" << std::endl;
+    char dir[] = "/tmp/tick_store_XXXXXX";
+    const char* made = mkdtemp(dir);
+    assert(made != nullptr);
+    TickStoreConfig config;
+    config.path = std::string(dir) + "/book.ticks";
+    config.block_records = 256;
+    
+    // Keep a copy of everything archived to compare against
+    struct TeeSink : BookEventSink {
+        TickStoreSink& store;
+        std::vector<TickRecord> records;
+        uint64_t now = 0;
+        explicit TeeSink(TickStoreSink& s) : store(s) {}
+        void publish(const BookEvent& e) override {
+            store.publish(e);
+            records.push_back(TickRecord{now, e.sequence, e.order_id, e.price, e.quantity, e.type, e.is_buy});
+        }
+    };
+    
+    TickStoreWriter writer(config);
+    bool result = writer.open();
+    assert(result);
+    TickStoreSink store(writer);
+    TeeSink tee(store);
+    OrderBook live;
+    live.set_event_sink(&tee);
+    for (uint64_t i = 0; i < 3000; i++) {
+        tee.now = 1000000 + i * 750;
+        store.set_time(tee.now);
+        const uint64_t id = i + 1;
+        const bool is_buy = i % 2 == 0;
+        const double price = is_buy ? 99.0 + (i % 7) * 0.01 : 99.05 + (i % 5) * 0.01;
+        if (i % 11 == 10) {
+            // Crossing order: partial and full executions, remainder rests
+            live.match_order(Order{id, is_buy, price + (is_buy ? 0.05 : -0.05), 250, tee.now},
+                             [](const Fill&) {});
+        } else {
+            live.add_order(Order{id, is_buy, price, 100 + i % 4 * 50, tee.now});
+        }
+        if (i % 3 == 2) live.cancel_order(id - 1);
+        if (i % 5 == 4) live.amend_order(id - 2, price, 60); // In place when it shrinks
+    }
+    live.set_event_sink(nullptr);
+    result = writer.close();
+    assert(result);
+    result = writer.append(tee.records.front());
+    assert(!result); // Closed
+    
+    const TickStoreStats stats = writer.stats();
+    assert(stats.records == tee.records.size() && stats.blocks == (stats.records + 255) / 256);
+    const double ratio = static_cast<double>(stats.records * sizeof(TickRecord)) / stats.bytes;
+    std::cout << stats.records << " events in " << stats.blocks << " blocks, " << stats.bytes << " bytes ("
+              << std::fixed << std::setprecision(1) << static_cast<double>(stats.bytes) / stats.records
+              << " B/event, " << ratio << "x smaller than fixed-width)" << std::endl;
+    assert(ratio > 3.0);
+    
+    TickStoreReader reader;
+    result = reader.open(config.path);
+    assert(result);
+    assert(reader.record_count() == stats.records && reader.block_count() == stats.blocks);
+    size_t next = 0;
+    reader.for_each([&](const TickRecord& r) {
+        const TickRecord& w = tee.records[next++];
+        assert(r.timestamp_ns == w.timestamp_ns && r.sequence == w.sequence && r.order_id == w.order_id);
+        assert(r.price == w.price && r.quantity == w.quantity && r.type == w.type && r.is_buy == w.is_buy);
+    });
+    assert(next == tee.records.size());
+    
+    // A time range decodes only the blocks that overlap it
+    const uint64_t from = 1000000 + 1000 * 750, to = 1000000 + 1400 * 750;
+    const uint64_t expected = std::count_if(tee.records.begin(), tee.records.end(), [&](const TickRecord& r) {
+        return r.timestamp_ns >= from && r.timestamp_ns <= to;
+    });
+    size_t overlapping = 0;
+    for (size_t i = 0; i < reader.block_count(); i++) {
+        overlapping += reader.block(i).max_timestamp_ns >= from && reader.block(i).min_timestamp_ns <= to;
+    }
+    const uint64_t in_range = reader.for_each([](const TickRecord&) {}, from, to);
+    assert(in_range == expected && overlapping < reader.block_count() / 2);
+    
+    // The L3 stream alone rebuilds the book
+    OrderBook rebuilt;
+    const uint64_t applied = reader.replay(rebuilt);
+    assert(applied > 0);
+    std::vector<PriceLevel> live_bids, live_asks, bids, asks;
+    live.get_snapshot(100, live_bids, live_asks);
+    rebuilt.get_snapshot(100, bids, asks);
+    assert(bids.size() == live_bids.size() && asks.size() == live_asks.size() && !bids.empty());
+    for (size_t i = 0; i < bids.size(); i++) {
+        assert(bids[i].price == live_bids[i].price && bids[i].total_quantity == live_bids[i].total_quantity);
+    }
+    for (size_t i = 0; i < asks.size(); i++) {
+        assert(asks[i].price == live_asks[i].price && asks[i].total_quantity == live_asks[i].total_quantity);
+    }
+    
+    // A torn tail loses only the block it cut
+    reader.close();
+    const int truncated = truncate(config.path.c_str(), static_cast<off_t>(stats.bytes - 5));
+    assert(truncated == 0);
+    result = reader.open(config.path);
+    assert(result && reader.block_count() == stats.blocks - 1);
+    reader.close();
+    result = reader.open(std::string(dir) + "/missing.ticks");
+    assert(!result);
+    
+    std::filesystem::remove_all(dir);
+    std::cout << "✓ Tick store test passed" << std::endl;
+}
+
 int main() {
     std::cout << "========================================" << std::endl;
     std::cout << "  Low-Latency Limit Order Book Tests" << std::endl;
     std::cout << "========================================" << std::endl;
     
     try {
-        test_add_orders();
-        test_cancel_order();
-        test_amend_order();
-        test_snapshot_depth();
-        test_fifo_priority();
-        test_performance();
+        run_book_tests<OrderBook>("OrderBook");
+        run_book_tests<LadderOrderBook>("LadderOrderBook");
+        test_ladder_band();
+        test_order_pool();
+        test_arena();
+        test_pool_ptr();
+        test_warm_up();
+        test_order_index();
+        test_matching();
+        test_order_types();
+        test_pre_trade();
+        test_depth_cache();
+        test_depth_queries();
+        test_queue_position();
+        test_book_stats();
+        test_compact_storage();
+        test_mass_cancel();
+        test_order_expiry();
+        test_auction_uncross();
+        test_book_events();
+        test_book_manager();
+        test_numa_placement();
+        test_stage_pipeline();
+        test_depth_publisher();
+        test_apply_batch();
+        test_amend_priority();
+        test_spsc_queue();
+        test_spsc_burst();
+        test_spsc_wait();
+        test_latency_histogram();
+        test_book_metrics();
+        test_mpsc_queue();
+        test_shm_queue();
+        test_lock_free_list();
+        test_feed_protocol();
+        test_feed_handler();
+        test_feed_recovery();
+        test_feed_capture();
+        test_multicast_publisher();
+        test_book_journal();
+        test_book_snapshot();
+        test_expiry_recovery();
+        test_tick_store();
         
         std::cout << "\n========================================" << std::endl;
         std::cout << "  ✓ All tests passed successfully!" << std::endl;
@@ -0,0 +1,209 @@
+#include "multicast_publisher.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace {
+
+bool resolve(const std::string& address, uint16_t port, sockaddr_in& out) {
+    out = sockaddr_in{};
+    out.sin_family = AF_INET;
+    out.sin_port = htons(port);
+    return ::inet_pton(AF_INET, address.c_str(), &out.sin_addr) == 1;
+}
+
+} // namespace
+
+MulticastPublisher::MulticastPublisher(const TickScale& ticks, const MulticastPublisherConfig& config)
+    : config_(config)
+    , ticks_(ticks) {
+    config_.batch = std::max<size_t>(config_.batch, 1);
+    deltas_.enabled = true;
+    conflated_.enabled = !config_.conflated_group.empty();
+    for (Channel* channel : {&deltas_, &conflated_}) {
+        if (!channel->enabled) continue;
+        channel->packets.resize(config_.batch * kMaxFeedPacketSize);
+        channel->lengths.reserve(config_.batch);
+    }
+    headers_.resize(2 * config_.batch);
+    iovecs_.resize(2 * config_.batch);
+    for (auto& header : headers_) std::memset(&header, 0, sizeof(header));
+    current_.reserve(config_.conflated_depth);
+}
+
+bool MulticastPublisher::open() {
+    close();
+    if (!resolve(config_.group, config_.port, deltas_.address)) return false;
+    if (conflated_.enabled && !resolve(config_.conflated_group, config_.conflated_port, conflated_.address)) {
+        return false;
+    }
+    in_addr interface{};
+    if (::inet_pton(AF_INET, config_.interface.c_str(), &interface) != 1) return false;
+
+    fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0) return false;
+    const int loopback = config_.loopback ? 1 : 0;
+    if (::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) != 0 ||
+        ::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &config_.ttl, sizeof(config_.ttl)) != 0 ||
+        ::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loopback, sizeof(loopback)) != 0) {
+        close();
+        return false;
+    }
+    // Best effort: capped without privileges
+    ::setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &config_.send_buffer, sizeof(config_.send_buffer));
+    return true;
+}
+
+void MulticastPublisher::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void MulticastPublisher::on_event(const BookEvent& event, uint64_t now_ns) {
+    if (!is_l2_event(event.type)) return;
+    stats_.events++;
+    if (expected_event_ != 0 && event.sequence != expected_event_) stats_.gaps++;
+    expected_event_ = event.sequence + 1;
+
+    append(deltas_, event.sequence, now_ns, event.is_buy, event.price, event.quantity, event.type);
+    stats_.messages++;
+
+    if (!conflated_.enabled) return;
+    if (event.is_buy) {
+        if (event.type == BookEventType::LevelDelete) {
+            bids_.erase(event.price);
+        } else {
+            bids_[event.price] = event.quantity;
+        }
+    } else {
+        if (event.type == BookEventType::LevelDelete) {
+            asks_.erase(event.price);
+        } else {
+            asks_[event.price] = event.quantity;
+        }
+    }
+    conflation_dirty_ = true;
+}
+
+void MulticastPublisher::flush(uint64_t now_ns) {
+    if (deltas_.builder.message_count() > 0) finish_packet(deltas_);
+
+    if (conflated_.enabled && conflation_dirty_ && now_ns >= next_conflation_ns_) {
+        conflate_side(bids_, sent_bids_, true, now_ns);
+        conflate_side(asks_, sent_asks_, false, now_ns);
+        if (conflated_.builder.message_count() > 0) finish_packet(conflated_);
+        conflation_dirty_ = false;
+        next_conflation_ns_ = now_ns + config_.conflation_interval_ns;
+    }
+
+    for (Channel* channel : {&deltas_, &conflated_}) {
+        if (channel->enabled && channel->lengths.empty() &&
+            now_ns - channel->last_send_ns >= config_.heartbeat_interval_ns) {
+            heartbeat(*channel, now_ns);
+        }
+    }
+    send_queued();
+}
+
+void MulticastPublisher::append(Channel& channel, uint64_t sequence, uint64_t now_ns, bool is_buy, Ticks price,
+                                uint64_t quantity, BookEventType type) {
+    // Messages of a packet are consecutive, so a gap starts a new one
+    if (channel.builder.message_count() > 0 && sequence != channel.next_sequence) finish_packet(channel);
+    const double wire_price = ticks_.to_price(price);
+    if (channel.builder.message_count() == 0 ||
+        !channel.builder.level(now_ns, is_buy, wire_price, quantity, type)) {
+        if (channel.builder.message_count() > 0) finish_packet(channel);
+        channel.builder = FeedPacketBuilder(&channel.packets[channel.lengths.size() * kMaxFeedPacketSize],
+                                            config_.session, sequence);
+        channel.builder.level(now_ns, is_buy, wire_price, quantity, type);
+    }
+    channel.next_sequence = sequence + 1;
+    channel.last_send_ns = now_ns;
+}
+
+void MulticastPublisher::finish_packet(Channel& channel) {
+    channel.lengths.push_back(channel.builder.finish());
+    if (channel.lengths.size() == config_.batch) send_queued(&channel);
+}
+
+void MulticastPublisher::heartbeat(Channel& channel, uint64_t now_ns) {
+    channel.builder = FeedPacketBuilder(&channel.packets[channel.lengths.size() * kMaxFeedPacketSize],
+                                        config_.session, channel.next_sequence);
+    channel.builder.heartbeat(now_ns);
+    channel.last_send_ns = now_ns;
+    stats_.heartbeats++;
+    finish_packet(channel);
+}
+
+void MulticastPublisher::send_queued(Channel* only) {
+    size_t count = 0;
+    for (Channel* channel : {&deltas_, &conflated_}) {
+        if (only != nullptr && channel != only) continue;
+        for (size_t i = 0; i < channel->lengths.size(); i++) {
+            iovecs_[count].iov_base = &channel->packets[i * kMaxFeedPacketSize];
+            iovecs_[count].iov_len = channel->lengths[i];
+            msghdr& header = headers_[count].msg_hdr;
+            header.msg_name = &channel->address;
+            header.msg_namelen = sizeof(channel->address);
+            header.msg_iov = &iovecs_[count];
+            header.msg_iovlen = 1;
+            count++;
+        }
+        channel->lengths.clear();
+    }
+    if (fd_ < 0) {
+        stats_.send_failures += count;
+        return;
+    }
+
+    size_t sent = 0;
+    while (sent < count) {
+        const int result = ::sendmmsg(fd_, &headers_[sent], static_cast<unsigned>(count - sent), MSG_DONTWAIT);
+        stats_.syscalls++;
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            // The first datagram was refused (e.g. a full send buffer): drop
+            // it, subscribers see the gap, and carry on with the rest
+            stats_.send_failures++;
+            sent++;
+            continue;
+        }
+        sent += static_cast<size_t>(result);
+        stats_.packets += static_cast<uint64_t>(result);
+    }
+}
+
+template <typename Levels>
+void MulticastPublisher::conflate_side(const Levels& levels, Top& sent, bool is_buy, uint64_t now_ns) {
+    current_.clear();
+    for (auto it = levels.begin(); it != levels.end() && current_.size() < config_.conflated_depth; ++it) {
+        current_.emplace_back(it->first, it->second);
+    }
+
+    // Both tops are best first: one merge finds what left, arrived or changed
+    const auto better = [is_buy](Ticks a, Ticks b) { return is_buy ? a > b : a < b; };
+    const auto send = [&](Ticks price, uint64_t quantity, BookEventType type) {
+        append(conflated_, conflated_.next_sequence, now_ns, is_buy, price, quantity, type);
+        stats_.conflated_messages++;
+    };
+    size_t old = 0, now = 0;
+    while (old < sent.size() || now < current_.size()) {
+        if (now == current_.size() || (old < sent.size() && better(sent[old].first, current_[now].first))) {
+            send(sent[old++].first, 0, BookEventType::LevelDelete);
+        } else if (old == sent.size() || better(current_[now].first, sent[old].first)) {
+            send(current_[now].first, current_[now].second, BookEventType::LevelAdd);
+            now++;
+        } else {
+            if (current_[now].second != sent[old].second) {
+                send(current_[now].first, current_[now].second, BookEventType::LevelChange);
+            }
+            old++;
+            now++;
+        }
+    }
+    sent.swap(current_);
+}
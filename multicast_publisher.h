@@ -0,0 +1,152 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "book_events.h"
+#include "feed_protocol.h"
+#include "price.h"
+
+// Publishes one book's L2 deltas to any number of subscribers over UDP
+// multicast, so the cost of fanout is one send per packet whatever the
+// subscriber count. Fed from the delta ring (a Fifo3<BookEvent> behind a
+// FifoEventSink subscribed to kL2Events) by drain() on the publisher's own
+// thread.
+//
+// Packets use the order-feed framing (feed_protocol.h) with LevelUpdate
+// messages, so subscribers reuse validate_feed_packet and see loss per
+// message from the sequence numbers. Finished packets are queued and sent
+// `batch` at a time with one sendmmsg, across both channels:
+//
+// - Delta channel: every L2 event, in order. Message sequences are the
+//   book's L2 event sequences, so an event the ring dropped shows up
+//   downstream as a gap rather than a silently wrong level
+// - Conflated channel (optional): the top conflated_depth levels of each
+//   side, at most once per conflation_interval_ns. Updates within the
+//   interval are coalesced per level: a subscriber gets each changed level
+//   once, with its latest total, deletes for levels that left the top, and
+//   nothing for a level that moved and came back. Its sequence is its own
+//
+// The conflated view is kept from the deltas alone, in a private mirror of
+// the levels, so the publisher never reads the book. An idle channel sends
+// a heartbeat carrying its next sequence every heartbeat_interval_ns. Sends
+// never block: a packet the kernel refuses is dropped and counted.
+struct MulticastPublisherConfig {
+    std::string group = "239.1.2.1";   // Delta channel destination
+    uint16_t port = 6001;
+    std::string conflated_group;       // Conflated channel destination; empty = off
+    uint16_t conflated_port = 6002;
+    std::string interface = "0.0.0.0"; // IP_MULTICAST_IF
+    int ttl = 1;                       // IP_MULTICAST_TTL
+    bool loopback = false;             // IP_MULTICAST_LOOP: deliver to this host as well
+    uint32_t session = 1;
+    size_t batch = 32;                 // Packets per sendmmsg
+    int send_buffer = 4 << 20;         // SO_SNDBUF
+    size_t conflated_depth = 10;       // Levels per side on the conflated channel
+    uint64_t conflation_interval_ns = 100000000;   // 100 ms
+    uint64_t heartbeat_interval_ns = 1000000000;   // 1 s
+};
+
+struct MulticastStats {
+    uint64_t events = 0;             // L2 events taken
+    uint64_t gaps = 0;               // Breaks in their sequence (events dropped upstream)
+    uint64_t messages = 0;           // Level updates sent on the delta channel
+    uint64_t conflated_messages = 0; // Level updates sent on the conflated channel
+    uint64_t packets = 0;            // Datagrams handed to the kernel, heartbeats included
+    uint64_t heartbeats = 0;
+    uint64_t syscalls = 0;           // sendmmsg calls
+    uint64_t send_failures = 0;      // Datagrams the kernel refused, dropped
+};
+
+class MulticastPublisher {
+public:
+    // ticks converts event prices to wire prices; use the book's tick_scale()
+    explicit MulticastPublisher(const TickScale& ticks,
+                                const MulticastPublisherConfig& config = MulticastPublisherConfig{});
+    ~MulticastPublisher() { close(); }
+
+    MulticastPublisher(const MulticastPublisher&) = delete;
+    MulticastPublisher& operator=(const MulticastPublisher&) = delete;
+
+    // Create the sending socket and resolve both destinations
+    // @return false if an address is invalid or any required call failed
+    bool open();
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+
+    // Take whatever the ring holds (up to max events), then flush(now_ns)
+    // @return events taken
+    template <typename Fifo>
+    size_t drain(Fifo& ring, uint64_t now_ns, size_t max = SIZE_MAX) {
+        size_t taken = 0;
+        BookEvent event;
+        while (taken < max && ring.pop(event)) {
+            on_event(event, now_ns);
+            taken++;
+        }
+        flush(now_ns);
+        return taken;
+    }
+
+    // Queue one event on the delta channel; L3 events are ignored
+    void on_event(const BookEvent& event, uint64_t now_ns);
+
+    // Close the open packets, run the conflated channel and heartbeats if
+    // they are due, and send everything queued
+    void flush(uint64_t now_ns);
+
+    const MulticastStats& stats() const { return stats_; }
+
+private:
+    struct Channel {
+        sockaddr_in address{};
+        std::vector<char> packets;   // batch slots of kMaxFeedPacketSize
+        std::vector<size_t> lengths; // Of the finished packets, queued for sendmmsg
+        FeedPacketBuilder builder{nullptr, 0, 1};
+        uint64_t next_sequence = 1;  // Of the next message
+        uint64_t last_send_ns = 0;
+        bool enabled = false;
+    };
+
+    // Levels best first, with their totals
+    using BidLevels = std::map<Ticks, uint64_t, std::greater<Ticks>>;
+    using AskLevels = std::map<Ticks, uint64_t>;
+    using Top = std::vector<std::pair<Ticks, uint64_t>>;
+
+    void append(Channel& channel, uint64_t sequence, uint64_t now_ns, bool is_buy, Ticks price, uint64_t quantity,
+                BookEventType type);
+    void finish_packet(Channel& channel);
+    void heartbeat(Channel& channel, uint64_t now_ns);
+    // Send the finished packets of one channel, or of both in one call
+    void send_queued(Channel* only = nullptr);
+
+    // Send the difference between the last conflated top and the mirror's
+    template <typename Levels>
+    void conflate_side(const Levels& levels, Top& sent, bool is_buy, uint64_t now_ns);
+
+    MulticastPublisherConfig config_;
+    TickScale ticks_;
+    int fd_ = -1;
+    Channel deltas_;
+    Channel conflated_;
+    std::vector<struct mmsghdr> headers_;
+    std::vector<struct iovec> iovecs_;
+
+    // Conflated channel state
+    BidLevels bids_;
+    AskLevels asks_;
+    Top sent_bids_;
+    Top sent_asks_;
+    Top current_;
+    bool conflation_dirty_ = false;
+    uint64_t next_conflation_ns_ = 0;
+
+    uint64_t expected_event_ = 0; // Next L2 sequence; 0 = none seen yet
+    MulticastStats stats_;
+};
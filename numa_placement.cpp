@@ -0,0 +1,77 @@
+#include "numa_placement.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <linux/mempolicy.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr unsigned long kMaxNodes = 1024;
+
+} // namespace
+
+int numa_node_count() {
+    // "0", "0-1" or "0,2-3": the count is one past the last id listed
+    FILE* file = std::fopen("/sys/devices/system/node/online", "r");
+    if (!file) return 1;
+    char list[256] = {};
+    const bool read = std::fgets(list, sizeof(list), file) != nullptr;
+    std::fclose(file);
+    if (!read) return 1;
+    int last = 0;
+    for (const char* p = list; *p;) {
+        char* end = nullptr;
+        const long id = std::strtol(p, &end, 10);
+        if (end == p) {
+            p++;
+            continue;
+        }
+        if (id > last) last = static_cast<int>(id);
+        p = end;
+    }
+    return last + 1;
+}
+
+int numa_node_of_cpu(int cpu) {
+    if (cpu < 0) return -1;
+    // Each cpuN directory holds a nodeK link to the node it belongs to
+    const std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/node";
+    const int nodes = numa_node_count();
+    struct stat info;
+    for (int node = 0; node < nodes; node++) {
+        if (::stat((base + std::to_string(node)).c_str(), &info) == 0) return node;
+    }
+    // No NUMA sysfs at all: a single node, if the CPU exists
+    const std::string cpu_dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    if (::stat("/sys/devices/system/node", &info) != 0 && ::stat(cpu_dir.c_str(), &info) == 0) return 0;
+    return -1;
+}
+
+int numa_current_node() {
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return -1;
+    return static_cast<int>(node);
+}
+
+bool numa_bind(void* address, size_t bytes, int node) {
+    if (node < 0 || static_cast<unsigned long>(node) >= kMaxNodes || bytes == 0) return false;
+    const uintptr_t page = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+    const uintptr_t start = reinterpret_cast<uintptr_t>(address) & ~(page - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(address) + bytes + page - 1) & ~(page - 1);
+
+    unsigned long mask[kMaxNodes / (8 * sizeof(unsigned long))] = {};
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    // Preferred rather than bound: a full node spills instead of failing the fault
+    return ::syscall(SYS_mbind, start, end - start, MPOL_PREFERRED, mask, kMaxNodes, 0) == 0;
+}
+
+int numa_node_of_address(const void* address) {
+    int node = -1;
+    if (::syscall(SYS_get_mempolicy, &node, nullptr, 0, address, MPOL_F_NODE | MPOL_F_ADDR) != 0) return -1;
+    return node;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+
+// NUMA topology and page placement through sysfs and the raw mbind /
+// get_mempolicy / getcpu syscalls, so nothing links against libnuma. On a
+// kernel without NUMA support every host looks like a single node 0 and
+// binding is a no-op.
+
+// Nodes online (highest online id + 1); 1 when sysfs has no node directory
+int numa_node_count();
+
+// Node CPU cpu belongs to, or -1 if unknown
+int numa_node_of_cpu(int cpu);
+
+// Node of the CPU the calling thread is running on
+int numa_current_node();
+
+// Prefer node for the pages of [address, address + bytes) that are not yet
+// faulted in; the range is widened to whole pages. @return false if the
+// kernel refused (no such node, or no NUMA support)
+bool numa_bind(void* address, size_t bytes, int node);
+
+// Node holding the page at address (faulting it in as a read would if it
+// is not yet), or -1 on error
+int numa_node_of_address(const void* address);
@@ -1,153 +1,665 @@
 #include "order_book.h"
-#include <iostream>
-#include <iomanip>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-void OrderBook::add_order(const Order& order) {
-    // Get or create the price level
-    PriceLevelData* price_level = nullptr;
-    
+OrderBook::OrderBook(const OrderBookConfig& config)
+    : config_(config)
+    , ticks_(config.tick_size)
+    , pool_(config.order_capacity)
+    , bids_(LevelAllocator(config.arena))
+    , asks_(LevelAllocator(config.arena))
+    , epoch_ns_(config.session_epoch_ns)
+    , order_lookup_(config.order_capacity, config.id_index, config.first_order_id)
+    , trades_(config.trade_window_ns)
+    , expiry_(config.expiry_tick_ns, config.order_capacity) {}
+
+bool OrderBook::add_order(const Order& order) {
+    BOOK_METRIC_TIMER(*metrics_, BookMetric::Add);
+    // Convert to ticks once; all internal keys are integers
+    const Ticks price = ticks_.to_ticks(order.price);
+    if (BOOK_UNLIKELY(!order_storable(price, order.quantity))) {
+        return false;
+    }
+    record_journal(JournalOp::Add, order);
     if (order.is_buy) {
-        auto& level = bids_[order.price];
-        level.price = order.price;
-        price_level = &level;
+        rest_order<Side::Buy>(order, price);
     } else {
-        auto& level = asks_[order.price];
-        level.price = order.price;
-        price_level = &level;
+        rest_order<Side::Sell>(order, price);
     }
+    return true;
+}
+
+template <Side S>
+void OrderBook::rest_order(const Order& order, Ticks price) {
+    constexpr bool is_buy = SideTraits<S>::is_buy;
+
+    // Get or create the price level
+    PriceLevelData& price_level = levels<S>()[price];
+    price_level.price = price;
     
-    // Add the order to the FIFO queue at this price level
-    price_level->orders.push_back(order);
-    
-    // Get iterator to the newly added order
-    auto list_iter = std::prev(price_level->orders.end());
+    // Take a pool slot and append it to the FIFO queue at this price level
+    const bool new_level = price_level.orders.empty();
+    OrderHandle slot = pool_.allocate();
+    OrderNode& node = pool_[slot];
+    node.order_id = order.order_id;
+    node.quantity = static_cast<NodeQuantity>(order.quantity);
+    node.price = static_cast<NodeTicks>(price);
+    OrderColdData& cold = pool_.cold(slot);
+    cold.timestamp = store_timestamp(order.timestamp_ns);
+    cold.account = order.account;
+    owner_link(slot, order.account);
+    expiry_schedule(slot, order);
+    queue_join(price_level, slot);
+    price_level.orders.push_back(pool_, slot);
     
     // Update total quantity
-    price_level->total_quantity += order.quantity;
+    price_level.total_quantity += order.quantity;
+    emit(BookEventType::OrderAdd, is_buy, price, order.quantity, order.order_id);
+    if (new_level) {
+        level_added<S>(price_level);
+    } else {
+        level_changed<S>(price_level);
+    }
     
     // Add to lookup table
     OrderLocation location;
-    location.is_buy = order.is_buy;
-    location.price = order.price;
-    location.list_iter = list_iter;
-    order_lookup_[order.order_id] = location;
+    location.slot = slot;
+    location.is_buy = is_buy;
+    order_lookup_.insert(order.order_id, location);
 }
 
 bool OrderBook::cancel_order(uint64_t order_id) {
+    BOOK_METRIC_TIMER(*metrics_, BookMetric::Cancel);
     // Look up the order
-    auto lookup_it = order_lookup_.find(order_id);
-    if (lookup_it == order_lookup_.end()) {
+    size_t lookup_slot = order_lookup_.find(order_id);
+    if (BOOK_UNLIKELY(lookup_slot == OrderIdIndex<OrderLocation>::npos)) {
+        BOOK_METRIC_COUNT(*metrics_, lookup_missed);
         return false; // Order not found
     }
     
-    const OrderLocation& location = lookup_it->second;
+    const OrderLocation location = order_lookup_.value_at(lookup_slot);
     
-    // Get the order from the list
-    const Order& order = *location.list_iter;
+    // Get the order from the pool
+    const OrderNode& order = pool_[location.slot];
+    if (journal_) journal_->append(JournalOp::Cancel, order_id, location.is_buy, 0.0, 0, 0);
+    emit(BookEventType::OrderCancel, location.is_buy, order.price, order.quantity, order_id);
     
     if (location.is_buy) {
-        // Handle bids
-        auto price_it = bids_.find(location.price);
-        if (price_it == bids_.end()) {
-            return false; // Should not happen
-        }
-        
-        auto& price_level = price_it->second;
-        
-        // Update total quantity
-        price_level.total_quantity -= order.quantity;
-        
-        // Remove the order from the list
-        price_level.orders.erase(location.list_iter);
-        
-        // If the price level is now empty, remove it
-        if (price_level.orders.empty()) {
-            bids_.erase(price_it);
-        }
+        unlink_order<Side::Buy>(location.slot);
     } else {
-        // Handle asks
-        auto price_it = asks_.find(location.price);
-        if (price_it == asks_.end()) {
-            return false; // Should not happen
-        }
-        
-        auto& price_level = price_it->second;
-        
-        // Update total quantity
-        price_level.total_quantity -= order.quantity;
-        
-        // Remove the order from the list
-        price_level.orders.erase(location.list_iter);
-        
-        // If the price level is now empty, remove it
-        if (price_level.orders.empty()) {
-            asks_.erase(price_it);
-        }
+        unlink_order<Side::Sell>(location.slot);
     }
     
-    // Remove from lookup table
-    order_lookup_.erase(lookup_it);
+    // Return the slot and remove from lookup table
+    owner_unlink(location.slot);
+    expiry_cancel(location.slot);
+    pool_.release(location.slot);
+    order_lookup_.erase_at(lookup_slot);
     
     return true;
 }
 
+template <Side S>
+void OrderBook::unlink_order(OrderHandle slot) {
+    auto& side = levels<S>();
+    const OrderNode& order = pool_[slot];
+    const Ticks price = order.price;
+    auto price_it = side.find(price);
+    auto& price_level = price_it->second;
+    
+    // Update total quantity
+    price_level.total_quantity -= order.quantity;
+    queue_reduce(price_level, slot, order.quantity);
+    
+    // Unlink the order from the level queue
+    price_level.orders.unlink(pool_, slot);
+    
+    // If the price level is now empty, remove it
+    if (price_level.orders.empty()) {
+        side.erase(price_it);
+        level_erased<S>(price);
+    } else {
+        level_changed<S>(price_level);
+    }
+}
+
 bool OrderBook::amend_order(uint64_t order_id, double new_price, uint64_t new_quantity) {
+    BOOK_METRIC_TIMER(*metrics_, BookMetric::Amend);
     // Look up the order
-    auto lookup_it = order_lookup_.find(order_id);
-    if (lookup_it == order_lookup_.end()) {
+    size_t lookup_slot = order_lookup_.find(order_id);
+    if (BOOK_UNLIKELY(lookup_slot == OrderIdIndex<OrderLocation>::npos)) {
+        BOOK_METRIC_COUNT(*metrics_, lookup_missed);
         return false; // Order not found
     }
     
-    const OrderLocation& location = lookup_it->second;
-    Order& order = *location.list_iter;
+    // The node stays in the same pool slot, so the index entry is never touched
+    const OrderLocation location = order_lookup_.value_at(lookup_slot);
+    const Ticks price = ticks_.to_ticks(new_price);
+    if (BOOK_UNLIKELY(!order_storable(price, new_quantity))) {
+        return false; // Does not fit a compact node
+    }
+    if (journal_) journal_->append(JournalOp::Amend, order_id, location.is_buy, new_price, new_quantity, 0);
+    if (location.is_buy) {
+        amend_in<Side::Buy>(location.slot, price, new_quantity);
+    } else {
+        amend_in<Side::Sell>(location.slot, price, new_quantity);
+    }
+    return true;
+}
+
+size_t OrderBook::cancel_all(uint32_t account) {
+    if (!config_.owner_orders || account == 0 || account >= owners_.size()) return 0;
+    OwnerOrders& owner = owners_[account];
+    if (owner.head == kNullOrder) return 0;
+
+    // Level deltas are coalesced as for a batch, unless already inside one
+    const Coalescing coalescing = begin_coalescing();
+    size_t cancelled = 0;
+    for (OrderHandle slot = owner.head; slot != kNullOrder;) {
+        const OrderHandle next = pool_.cold(slot).owner_next;
+        // The whole list goes, so no per-order owner unlink
+        expiry_cancel(slot);
+        cancel_resting(slot, order_lookup_.find(pool_[slot].order_id));
+        slot = next;
+        cancelled++;
+    }
+    owner.head = kNullOrder;
+    owner.count = 0;
+    end_coalescing(coalescing);
+    return cancelled;
+}
+
+size_t OrderBook::expire_orders(uint64_t now_ns) {
+    expired_.clear();
+    if (expiry_.advance(now_ns, expired_) == 0) return 0;
+
+    // The wheel has already dropped these deadlines
+    const Coalescing coalescing = begin_coalescing();
+    for (const OrderHandle slot : expired_) {
+        owner_unlink(slot);
+        cancel_resting(slot, order_lookup_.find(pool_[slot].order_id));
+    }
+    end_coalescing(coalescing);
+    return expired_.size();
+}
+
+void OrderBook::cancel_resting(OrderHandle slot, size_t lookup_slot) {
+    const OrderNode& order = pool_[slot];
+    const uint64_t order_id = order.order_id;
+    const bool is_buy = order_lookup_.value_at(lookup_slot).is_buy;
+    if (journal_) journal_->append(JournalOp::Cancel, order_id, is_buy, 0.0, 0, 0);
+    emit(BookEventType::OrderCancel, is_buy, order.price, order.quantity, order_id);
+    if (is_buy) {
+        unlink_order<Side::Buy>(slot);
+    } else {
+        unlink_order<Side::Sell>(slot);
+    }
+    pool_.release(slot);
+    order_lookup_.erase_at(lookup_slot);
+}
+
+void OrderBook::begin_auction() {
+    if (in_auction_) return;
+    if (journal_) journal_->append(JournalOp::Auction, 0, false, 0.0, 0, 0);
+    in_auction_ = true;
+    auction_dirty_ = auction_rebuild_ = true;
+}
+
+MatchResult OrderBook::auction_order(const Order& order) {
+    using TIF = TimeInForce;
+    // Only orders that can wait for the uncross join the call
+    const bool good_till = order.tif == TIF::GoodTillCancel ||
+                           (order.tif == TIF::GoodTillTime && (order.expire_ns == 0 || expiry_.enabled()));
+    if (order.type != OrderType::Limit || !good_till) {
+        return MatchResult{0, MatchStatus::Rejected, RejectReason::InvalidOrder};
+    }
+    Ticks limit = ticks_.to_ticks(order.price);
+    if (BOOK_UNLIKELY(!order_storable(0, order.quantity))) {
+        return MatchResult{0, MatchStatus::Rejected, RejectReason::OrderQuantity};
+    }
+    if (BOOK_UNLIKELY(!order_storable(limit, 0))) {
+        return MatchResult{0, MatchStatus::Rejected, RejectReason::InvalidOrder};
+    }
+    if (config_.risk || config_.price_band_ticks > 0) {
+        const RejectReason reason = order.is_buy ? pre_trade_check<OrderType::Limit, Side::Buy>(order, limit)
+                                                 : pre_trade_check<OrderType::Limit, Side::Sell>(order, limit);
+        if (BOOK_UNLIKELY(reason != RejectReason::None)) {
+            return MatchResult{0, MatchStatus::Rejected, reason};
+        }
+    }
+    record_journal(JournalOp::Match, order);
+    if (order.is_buy) {
+        rest_order<Side::Buy>(order, limit);
+    } else {
+        rest_order<Side::Sell>(order, limit);
+    }
+    return MatchResult{0, MatchStatus::Rested};
+}
+
+AuctionUncross OrderBook::indicative_uncross() const {
+    if (!in_auction_) return AuctionUncross{}; // Continuous matching never crosses
+    if (auction_dirty_) refresh_uncross();
+    return auction_;
+}
+
+void OrderBook::build_auction_curve() const {
+    auction_rebuild_ = false;
+    auction_curve_.clear();
+    if (bids_.empty() || asks_.empty()) return;
+    const Ticks best_bid = bids_.begin()->first;
+    const Ticks best_ask = asks_.begin()->first;
+    if (best_bid < best_ask) return;
+
+    // Candidates are the level prices in [best_ask, best_bid]. Walking them
+    // from the top, demand (bids at or above) only grows and supply (asks at
+    // or below) only shrinks, so one pass fills the curve.
+    uint64_t supply = 0;
+    auto ask_end = asks_.begin();
+    for (; ask_end != asks_.end() && ask_end->first <= best_bid; ++ask_end) {
+        supply += ask_end->second.total_quantity;
+    }
+    uint64_t demand = 0;
+    auto bid_it = bids_.begin();
+    auto ask_it = std::make_reverse_iterator(ask_end);
+    for (;;) {
+        const bool has_bid = bid_it != bids_.end() && bid_it->first >= best_ask;
+        const bool has_ask = ask_it != asks_.rend();
+        if (!has_bid && !has_ask) break;
+        const Ticks price = !has_ask || (has_bid && bid_it->first > ask_it->first) ? bid_it->first : ask_it->first;
+        AuctionPoint point{price, 0, 0, 0, supply};
+        if (has_bid && bid_it->first == price) {
+            point.bid = bid_it->second.total_quantity;
+            demand += point.bid;
+            ++bid_it;
+        }
+        point.demand = demand;
+        if (has_ask && ask_it->first == price) {
+            point.ask = ask_it->second.total_quantity;
+            supply -= point.ask;
+            ++ask_it;
+        }
+        auction_curve_.push_back(point);
+    }
+}
+
+template <Side S>
+void OrderBook::auction_update(Ticks price, uint64_t total) {
+    constexpr bool is_buy = SideTraits<S>::is_buy;
+    if (auction_curve_.empty()) {
+        // Not crossed: only a level the opposite best reaches starts a cross
+        const auto& opposite = levels<SideTraits<S>::opposite>();
+        if (!opposite.empty() && SideTraits<SideTraits<S>::opposite>::crossed_by(opposite.begin()->first, price)) {
+            auction_dirty_ = auction_rebuild_ = true;
+        }
+        return;
+    }
+    // The curve spans [best ask, best bid]; the ends are this side's best
+    // and the opposite's, and only this side's can move here
+    const Ticks own_best = is_buy ? auction_curve_.front().price : auction_curve_.back().price;
+    const Ticks far_end = is_buy ? auction_curve_.back().price : auction_curve_.front().price;
+    if (SideTraits<S>::better(far_end, price)) return; // Reaches no opposite order
+    if (SideTraits<S>::better(price, own_best) || (price == own_best && total == 0)) {
+        auction_dirty_ = auction_rebuild_ = true;
+        return;
+    }
+
+    auto it = std::lower_bound(auction_curve_.begin(), auction_curve_.end(), price,
+                               [](const AuctionPoint& point, Ticks p) { return point.price > p; });
+    if (it == auction_curve_.end() || it->price != price) {
+        if (total == 0) return;
+        // A new candidate inside the range: nothing lies between it and its
+        // neighbours, so it inherits demand from above and supply from below
+        it = auction_curve_.insert(it, AuctionPoint{price, 0, 0, std::prev(it)->demand, it->supply});
+    }
+    uint64_t& level_total = is_buy ? it->bid : it->ask;
+    const uint64_t old_total = level_total;
+    level_total = total;
+    // Bids count toward demand at and below their price, asks toward
+    // supply at and above it
+    if (is_buy) {
+        for (auto point = it; point != auction_curve_.end(); ++point) point->demand = point->demand - old_total + total;
+    } else {
+        for (auto point = it;; --point) {
+            point->supply = point->supply - old_total + total;
+            if (point == auction_curve_.begin()) break;
+        }
+    }
+    if (it->bid == 0 && it->ask == 0) auction_curve_.erase(it);
+    auction_dirty_ = true;
+}
+
+void OrderBook::refresh_uncross() const {
+    auction_dirty_ = false;
+    auction_ = AuctionUncross{};
+    auction_price_ = 0;
+    if (auction_rebuild_) build_auction_curve();
+    if (auction_curve_.empty()) return;
+
+    uint64_t best_volume = 0;
+    uint64_t best_surplus = 0;
+    bool buy_surplus = true;  // On every tie so far
+    bool sell_surplus = true;
+    auction_ties_.clear();
+    for (const AuctionPoint& point : auction_curve_) {
+        const uint64_t demand = point.demand;
+        const uint64_t supply = point.supply;
+        const uint64_t volume = demand < supply ? demand : supply;
+        const uint64_t surplus = demand < supply ? supply - demand : demand - supply;
+        if (volume > best_volume || (volume == best_volume && surplus < best_surplus)) {
+            best_volume = volume;
+            best_surplus = surplus;
+            buy_surplus = sell_surplus = true;
+            auction_ties_.clear();
+        }
+        if (volume == best_volume && surplus == best_surplus) {
+            const int64_t imbalance = static_cast<int64_t>(demand) - static_cast<int64_t>(supply);
+            auction_ties_.push_back(AuctionTie{point.price, imbalance});
+            buy_surplus &= demand > supply;
+            sell_surplus &= demand < supply;
+        }
+    }
+
+    // Every candidate trades something: the best bid and ask both reach it
+    const size_t pick = buy_surplus ? 0 : sell_surplus ? auction_ties_.size() - 1 : auction_ties_.size() / 2;
+    auction_price_ = auction_ties_[pick].price;
+    auction_.price = ticks_.to_price(auction_price_);
+    auction_.volume = best_volume;
+    auction_.imbalance = auction_ties_[pick].imbalance;
+}
+
+template <Side S>
+void OrderBook::auction_fill(uint64_t quantity) {
+    auto& side = levels<S>();
+    auto price_it = side.begin();
+    PriceLevelData& price_level = price_it->second;
+    const OrderHandle slot = price_level.orders.head;
+    OrderNode& order = pool_[slot];
+    queue_reduce(price_level, slot, quantity);
+    order.quantity -= quantity;
+    price_level.total_quantity -= quantity;
+    emit(BookEventType::OrderExecute, SideTraits<S>::is_buy, price_level.price, quantity, order.order_id);
+
+    if (order.quantity == 0) {
+        order_lookup_.erase(order.order_id);
+        price_level.orders.unlink(pool_, slot);
+        owner_unlink(slot);
+        expiry_cancel(slot);
+        pool_.release(slot);
+    }
+    if (price_level.orders.empty()) {
+        const Ticks price = price_level.price;
+        side.erase(price_it);
+        level_erased<S>(price);
+    } else {
+        level_changed<S>(price_level);
+    }
+}
+
+template void OrderBook::auction_fill<Side::Buy>(uint64_t);
+template void OrderBook::auction_fill<Side::Sell>(uint64_t);
+
+void OrderBook::end_coalescing(const Coalescing& coalescing) {
+    if (coalescing.outer_batch) return; // The enclosing batch flushes
+    batching_ = false;
+    flush_pending_levels();
+    if (depth_sequence_ != coalescing.depth_sequence) {
+        depth_sequence_ = coalescing.depth_sequence + 1;
+    }
+}
+
+void OrderBook::grow_owners(uint32_t account) {
+    owners_.resize(std::max<size_t>(static_cast<size_t>(account) + 1, owners_.size() * 2));
+}
+
+template <Side S>
+void OrderBook::amend_in(OrderHandle slot, Ticks new_price, uint64_t new_quantity) {
+    constexpr bool is_buy = SideTraits<S>::is_buy;
+    auto& side = levels<S>();
+    OrderNode& order = pool_[slot];
+    auto price_it = side.find(order.price);
+    PriceLevelData& price_level = price_it->second;
     
-    // Check if price is changing
-    if (order.price != new_price) {
-        // Price change: treat as cancel + add
-        Order new_order = order;
-        new_order.price = new_price;
-        new_order.quantity = new_quantity;
-        
-        // Cancel the old order
-        cancel_order(order_id);
-        
-        // Add the new order
-        add_order(new_order);
-    } else {
-        // Only quantity is changing: update in place
-        if (location.is_buy) {
-            auto price_it = bids_.find(location.price);
-            if (price_it == bids_.end()) {
-                return false; // Should not happen
-            }
-            
-            auto& price_level = price_it->second;
-            
-            // Update total quantity at price level
+    // Check if price is changing (in ticks, so rounding noise is not a change)
+    if (order.price == new_price) {
+        if (new_quantity <= order.quantity) {
+            // Quantity down: update in place and keep queue priority
             price_level.total_quantity = price_level.total_quantity - order.quantity + new_quantity;
-            
-            // Update the order
-            order.quantity = new_quantity;
+            queue_reduce(price_level, slot, order.quantity - new_quantity);
+            order.quantity = static_cast<NodeQuantity>(new_quantity);
+            emit(BookEventType::OrderModify, is_buy, new_price, new_quantity, order.order_id);
         } else {
-            auto price_it = asks_.find(location.price);
-            if (price_it == asks_.end()) {
-                return false; // Should not happen
-            }
-            
-            auto& price_level = price_it->second;
-            
-            // Update total quantity at price level
+            // Quantity up: move to the back of the same queue
+            emit(BookEventType::OrderCancel, is_buy, new_price, order.quantity, order.order_id);
             price_level.total_quantity = price_level.total_quantity - order.quantity + new_quantity;
-            
-            // Update the order
-            order.quantity = new_quantity;
+            queue_reduce(price_level, slot, order.quantity);
+            order.quantity = static_cast<NodeQuantity>(new_quantity);
+            price_level.orders.unlink(pool_, slot);
+            queue_join(price_level, slot);
+            price_level.orders.push_back(pool_, slot);
+            emit(BookEventType::OrderAdd, is_buy, new_price, new_quantity, order.order_id);
         }
+        level_changed<S>(price_level);
+        return;
     }
     
-    return true;
+    // Re-price: move the node between levels without touching the pool or index
+    const Ticks old_price = order.price;
+    emit(BookEventType::OrderCancel, is_buy, old_price, order.quantity, order.order_id);
+    price_level.total_quantity -= order.quantity;
+    queue_reduce(price_level, slot, order.quantity);
+    price_level.orders.unlink(pool_, slot);
+    
+    auto new_it = side.find(new_price);
+    if (price_level.orders.empty()) {
+        if (new_it == side.end()) {
+            // Old level emptied and the new one is absent: re-key its map node
+            auto node = side.extract(price_it);
+            level_erased<S>(old_price);
+            node.key() = new_price;
+            node.mapped().price = new_price;
+            new_it = side.insert(std::move(node)).position;
+        } else {
+            side.erase(price_it);
+            level_erased<S>(old_price);
+        }
+    } else {
+        level_changed<S>(price_level);
+    }
+    
+    if (new_it == side.end()) {
+        new_it = side.emplace(new_price, PriceLevelData{}).first;
+        new_it->second.price = new_price;
+    }
+    
+    PriceLevelData& new_level = new_it->second;
+    const bool new_level_created = new_level.orders.empty();
+    order.price = static_cast<NodeTicks>(new_price);
+    order.quantity = static_cast<NodeQuantity>(new_quantity);
+    queue_join(new_level, slot);
+    new_level.orders.push_back(pool_, slot);
+    new_level.total_quantity += new_quantity;
+    emit(BookEventType::OrderAdd, is_buy, new_price, new_quantity, order.order_id);
+    if (new_level_created) {
+        level_added<S>(new_level);
+    } else {
+        level_changed<S>(new_level);
+    }
+}
+
+bool OrderBook::apply(const BookOp& op) {
+    switch (op.type) {
+    case BookOpType::Add:
+        return add_order(op.order);
+    case BookOpType::Cancel:
+        return cancel_order(op.order.order_id);
+    case BookOpType::Amend:
+        return amend_order(op.order.order_id, op.order.price, op.order.quantity);
+    }
+    return false;
+}
+
+template <Side S>
+void OrderBook::level_added(const PriceLevelData& level) {
+    BOOK_METRIC_COUNT(*metrics_, level_created);
+    auction_touch<S>(level.price, level.total_quantity);
+    depth_sequence_ += depth_cache<S>().template insert<S>(level.price, ticks_.to_price(level.price),
+                                                           level.total_quantity);
+    if (batching_) {
+        note_pending_level(SideTraits<S>::is_buy, level.price, false);
+    } else {
+        emit(BookEventType::LevelAdd, SideTraits<S>::is_buy, level.price, level.total_quantity);
+    }
+}
+
+template <Side S>
+void OrderBook::level_changed(const PriceLevelData& level) {
+    auction_touch<S>(level.price, level.total_quantity);
+    depth_sequence_ += depth_cache<S>().template update<S>(level.price, level.total_quantity);
+    if (batching_) {
+        note_pending_level(SideTraits<S>::is_buy, level.price, true);
+    } else {
+        emit(BookEventType::LevelChange, SideTraits<S>::is_buy, level.price, level.total_quantity);
+    }
+}
+
+template <Side S>
+void OrderBook::level_erased(Ticks price) {
+    BOOK_METRIC_COUNT(*metrics_, level_erased);
+    auction_touch<S>(price, 0);
+    depth_sequence_ += depth_cache<S>().template erase<S>(price, levels<S>().size());
+    if (batching_) {
+        note_pending_level(SideTraits<S>::is_buy, price, true);
+    } else {
+        emit(BookEventType::LevelDelete, SideTraits<S>::is_buy, price, 0);
+    }
+}
+
+// Matching (order_book.h) reaches these from both sides
+template void OrderBook::rest_order<Side::Buy>(const Order&, Ticks);
+template void OrderBook::rest_order<Side::Sell>(const Order&, Ticks);
+template void OrderBook::level_changed<Side::Buy>(const PriceLevelData&);
+template void OrderBook::level_changed<Side::Sell>(const PriceLevelData&);
+template void OrderBook::level_erased<Side::Buy>(Ticks);
+template void OrderBook::level_erased<Side::Sell>(Ticks);
+
+size_t OrderBook::apply_batch(const BookOp* ops, size_t count) {
+    // Far enough ahead to hide a miss, near enough to stay in L1. The
+    // second stage reads what the first brought in.
+    constexpr size_t kPrefetchDistance = 8;
+    constexpr size_t kTargetDistance = kPrefetchDistance / 2;
+
+    batching_ = true;
+    const uint64_t depth_sequence = depth_sequence_;
+
+    size_t applied = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i + kPrefetchDistance < count && ops[i + kPrefetchDistance].type != BookOpType::Add) {
+            order_lookup_.prefetch(ops[i + kPrefetchDistance].order.order_id);
+        }
+        if (i + kTargetDistance < count) {
+            prefetch_targets(ops[i + kTargetDistance]);
+        }
+        applied += apply(ops[i]);
+    }
+
+    // One consolidated top-of-book change for the whole batch
+    batching_ = false;
+    flush_pending_levels();
+    if (depth_sequence_ != depth_sequence) {
+        depth_sequence_ = depth_sequence + 1;
+    }
+    return applied;
+}
+
+void OrderBook::prefetch_targets(const BookOp& op) const {
+    bool is_buy = op.order.is_buy;
+    if (op.type != BookOpType::Add) {
+        const size_t lookup_slot = order_lookup_.find(op.order.order_id);
+        if (lookup_slot == OrderIdIndex<OrderLocation>::npos) return;
+        const OrderLocation location = order_lookup_.value_at(lookup_slot);
+        __builtin_prefetch(&pool_[location.slot], 1);
+        if (op.type == BookOpType::Cancel) return;
+        is_buy = location.is_buy;
+    }
+    const Ticks price = ticks_.to_ticks(op.order.price);
+    if (is_buy) {
+        prefetch_level<Side::Buy>(price);
+    } else {
+        prefetch_level<Side::Sell>(price);
+    }
+}
+
+template <Side S>
+void OrderBook::prefetch_level(Ticks price) const {
+    // The tree walk itself leaves the path to the level warm for the op
+    const auto it = levels<S>().find(price);
+    if (it == levels<S>().end()) return;
+    __builtin_prefetch(&it->second, 1);
+    if (!it->second.orders.empty()) __builtin_prefetch(&pool_[it->second.orders.tail], 1);
+}
+
+void OrderBook::note_pending_level(bool is_buy, Ticks price, bool existed) {
+    // A small linear set: batches touch a handful of distinct levels
+    for (size_t i = 0; i < pending_count_; i++) {
+        if (pending_levels_[i].price == price && pending_levels_[i].is_buy == is_buy) {
+            return; // Keep the state from the first touch
+        }
+    }
+    if (pending_count_ == kMaxPendingLevels) {
+        flush_pending_levels();
+    }
+    pending_levels_[pending_count_++] = PendingLevel{price, is_buy, existed};
+}
+
+void OrderBook::flush_pending_levels() {
+    // Emit each touched level's net change since the batch started
+    for (size_t i = 0; i < pending_count_; i++) {
+        const PendingLevel& pending = pending_levels_[i];
+        const PriceLevelData* level = nullptr;
+        if (pending.is_buy) {
+            auto it = bids_.find(pending.price);
+            if (it != bids_.end()) level = &it->second;
+        } else {
+            auto it = asks_.find(pending.price);
+            if (it != asks_.end()) level = &it->second;
+        }
+
+        if (level) {
+            emit(pending.existed ? BookEventType::LevelChange : BookEventType::LevelAdd,
+                 pending.is_buy, pending.price, level->total_quantity);
+        } else if (pending.existed) {
+            emit(BookEventType::LevelDelete, pending.is_buy, pending.price, 0);
+        }
+    }
+    pending_count_ = 0;
+}
+
+void OrderBook::set_event_sink(BookEventSink* sink, uint8_t streams) {
+    event_sink_ = sink;
+    event_streams_ = streams;
+}
+
+void OrderBook::refresh_depth() const {
+    if (bid_depth_.dirty()) bid_depth_.rebuild(bids_, ticks_);
+    if (ask_depth_.dirty()) ask_depth_.rebuild(asks_, ticks_);
 }
 
 void OrderBook::get_snapshot(size_t depth, std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const {
+    BOOK_METRIC_TIMER(*metrics_, BookMetric::Snapshot);
+    // Within the cached depth a snapshot is a straight copy of the cache
+    if (depth <= DepthCache::kCapacity) {
+        refresh_depth();
+        bids.assign(bid_depth_.levels(), bid_depth_.levels() + std::min(depth, bid_depth_.size()));
+        asks.assign(ask_depth_.levels(), ask_depth_.levels() + std::min(depth, ask_depth_.size()));
+        return;
+    }
+
     bids.clear();
     asks.clear();
     
@@ -157,7 +669,7 @@ void OrderBook::get_snapshot(size_t depth, std::vector<PriceLevel>& bids, std::v
         if (count >= depth) break;
         
         PriceLevel level;
-        level.price = price;
+        level.price = ticks_.to_price(price);
         level.total_quantity = price_level.total_quantity;
         bids.push_back(level);
         
@@ -170,7 +682,7 @@ void OrderBook::get_snapshot(size_t depth, std::vector<PriceLevel>& bids, std::v
         if (count >= depth) break;
         
         PriceLevel level;
-        level.price = price;
+        level.price = ticks_.to_price(price);
         level.total_quantity = price_level.total_quantity;
         asks.push_back(level);
         
@@ -178,28 +690,468 @@ void OrderBook::get_snapshot(size_t depth, std::vector<PriceLevel>& bids, std::v
     }
 }
 
-void OrderBook::print_book(size_t depth) const {
-    std::vector<PriceLevel> bids, asks;
+SnapshotDepth OrderBook::get_snapshot(PriceLevel* bids, size_t bid_capacity,
+                                      PriceLevel* asks, size_t ask_capacity) const {
+    BOOK_METRIC_TIMER(*metrics_, BookMetric::Snapshot);
+    SnapshotDepth filled{0, 0};
+    refresh_depth();
+
+    // Serve from the cache where it is deep enough, else walk the map
+    if (bid_capacity <= DepthCache::kCapacity) {
+        filled.bids = std::min(bid_capacity, bid_depth_.size());
+        std::copy_n(bid_depth_.levels(), filled.bids, bids);
+    } else {
+        for (auto it = bids_.begin(); it != bids_.end() && filled.bids < bid_capacity; ++it) {
+            bids[filled.bids++] = PriceLevel{ticks_.to_price(it->first), it->second.total_quantity};
+        }
+    }
+
+    if (ask_capacity <= DepthCache::kCapacity) {
+        filled.asks = std::min(ask_capacity, ask_depth_.size());
+        std::copy_n(ask_depth_.levels(), filled.asks, asks);
+    } else {
+        for (auto it = asks_.begin(); it != asks_.end() && filled.asks < ask_capacity; ++it) {
+            asks[filled.asks++] = PriceLevel{ticks_.to_price(it->first), it->second.total_quantity};
+        }
+    }
+    return filled;
+}
+
+bool OrderBook::get_snapshot_if_changed(size_t depth, uint64_t& sequence,
+                                        std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const {
+    // Deeper than the cache, changes are not tracked by the sequence
+    if (sequence == depth_sequence_ && depth <= DepthCache::kCapacity) {
+        return false;
+    }
     get_snapshot(depth, bids, asks);
-    
-    std::cout << "\n========== ORDER BOOK ==========" << std::endl;
-    std::cout << std::fixed << std::setprecision(2);
-    
-    // Print asks in reverse order (highest to lowest)
-    std::cout << "\n--- ASKS (Sell Orders) ---" << std::endl;
-    for (auto it = asks.rbegin(); it != asks.rend(); ++it) {
-        std::cout << "  " << std::setw(10) << it->total_quantity 
-                  << " @ $" << std::setw(8) << it->price << std::endl;
+    sequence = depth_sequence_;
+    return true;
+}
+
+uint64_t OrderBook::quantity_within(bool is_buy, Ticks ticks) const {
+    return is_buy ? quantity_within_in<Side::Buy>(ticks) : quantity_within_in<Side::Sell>(ticks);
+}
+
+size_t OrderBook::cumulative_depth(bool is_buy, uint64_t* out, size_t depth) const {
+    return is_buy ? cumulative_depth_in<Side::Buy>(out, depth) : cumulative_depth_in<Side::Sell>(out, depth);
+}
+
+DepthVwap OrderBook::vwap_to_size(bool is_buy, uint64_t quantity) const {
+    return is_buy ? vwap_to_size_in<Side::Buy>(quantity) : vwap_to_size_in<Side::Sell>(quantity);
+}
+
+template <Side S>
+uint64_t OrderBook::quantity_within_in(Ticks ticks) const {
+    DepthCache& cache = depth_cache<S>();
+    if (cache.dirty()) cache.rebuild(levels<S>(), ticks_);
+    const size_t count = cache.size();
+    if (count == 0) return 0;
+
+    constexpr bool is_buy = SideTraits<S>::is_buy;
+    const Ticks bound = is_buy ? cache.prices()[0] - ticks : cache.prices()[0] + ticks;
+    uint64_t total = depth_kernels().sum_within(cache.prices(), cache.quantities(), count, bound, is_buy);
+
+    // Deeper levels can only be inside the bound if the last cached one is
+    if (count == DepthCache::kCapacity && !SideTraits<S>::better(bound, cache.prices()[count - 1])) {
+        const auto& side = levels<S>();
+        for (auto it = std::next(side.begin(), DepthCache::kCapacity);
+             it != side.end() && !SideTraits<S>::better(bound, it->first); ++it) {
+            total += it->second.total_quantity;
+        }
     }
-    
-    std::cout << "\n--------------------------" << std::endl;
-    
-    // Print bids (highest to lowest)
-    std::cout << "--- BIDS (Buy Orders) ---" << std::endl;
-    for (const auto& bid : bids) {
-        std::cout << "  " << std::setw(10) << bid.total_quantity 
-                  << " @ $" << std::setw(8) << bid.price << std::endl;
+    return total;
+}
+
+template <Side S>
+size_t OrderBook::cumulative_depth_in(uint64_t* out, size_t depth) const {
+    DepthCache& cache = depth_cache<S>();
+    if (cache.dirty()) cache.rebuild(levels<S>(), ticks_);
+    size_t written = std::min(depth, cache.size());
+    depth_kernels().prefix_sum(cache.quantities(), written, out);
+
+    if (written < depth && cache.size() == DepthCache::kCapacity) {
+        const auto& side = levels<S>();
+        uint64_t running = out[written - 1];
+        for (auto it = std::next(side.begin(), DepthCache::kCapacity); it != side.end() && written < depth; ++it) {
+            running += it->second.total_quantity;
+            out[written++] = running;
+        }
     }
-    
-    std::cout << "==============================\n" << std::endl;
+    return written;
+}
+
+template <Side S>
+DepthVwap OrderBook::vwap_to_size_in(uint64_t quantity) const {
+    DepthCache& cache = depth_cache<S>();
+    if (cache.dirty()) cache.rebuild(levels<S>(), ticks_);
+    const DepthKernels& kernels = depth_kernels();
+    const size_t count = cache.size();
+    const Ticks* prices = cache.prices();
+
+    // Levels whose running total stays below quantity are taken whole
+    uint64_t cumulative[DepthCache::kCapacity];
+    kernels.prefix_sum(cache.quantities(), count, cumulative);
+    const size_t whole = kernels.count_below(cumulative, count, quantity);
+    double notional = kernels.notional(prices, cache.quantities(), whole);
+    uint64_t filled = whole ? cumulative[whole - 1] : 0;
+
+    if (whole < count) {
+        // The next level completes the size
+        notional += static_cast<double>(prices[whole]) * static_cast<double>(quantity - filled);
+        filled = quantity;
+    } else if (count == DepthCache::kCapacity) {
+        const auto& side = levels<S>();
+        for (auto it = std::next(side.begin(), DepthCache::kCapacity); it != side.end() && filled < quantity; ++it) {
+            const uint64_t take = std::min(quantity - filled, it->second.total_quantity);
+            notional += static_cast<double>(it->first) * static_cast<double>(take);
+            filled += take;
+        }
+    }
+    if (filled == 0) return DepthVwap{0.0, 0};
+    return DepthVwap{ticks_.to_price_fraction(notional / static_cast<double>(filled)), filled};
+}
+
+TopStats OrderBook::top_of_book() const {
+    TopStats top;
+    if (!bids_.empty()) {
+        top.bid = ticks_.to_price(bids_.begin()->first);
+        top.bid_quantity = bids_.begin()->second.total_quantity;
+    }
+    if (!asks_.empty()) {
+        top.ask = ticks_.to_price(asks_.begin()->first);
+        top.ask_quantity = asks_.begin()->second.total_quantity;
+    }
+    if (bids_.empty() || asks_.empty()) return top;
+
+    const double bid_quantity = static_cast<double>(top.bid_quantity);
+    const double ask_quantity = static_cast<double>(top.ask_quantity);
+    const double total = bid_quantity + ask_quantity;
+    top.mid = (top.bid + top.ask) / 2;
+    top.spread = top.ask - top.bid;
+    // Heavy bids pull the fair price towards the ask
+    top.microprice = (top.bid * ask_quantity + top.ask * bid_quantity) / total;
+    top.imbalance = (bid_quantity - ask_quantity) / total;
+    return top;
+}
+
+TradeWindowStats OrderBook::trade_window() const {
+    const TradeWindow::Totals& totals = trades_.totals();
+    const double vwap = totals.volume == 0 ? 0.0
+        : ticks_.to_price_fraction(static_cast<double>(totals.notional) / static_cast<double>(totals.volume));
+    return TradeWindowStats{totals.volume, totals.trades, vwap, ticks_.to_price(trades_.last_price()),
+                            trades_.start_ns()};
+}
+
+bool OrderBook::queue_ahead(uint64_t order_id, QueuePosition& position) const {
+    const size_t lookup_slot = order_lookup_.find(order_id);
+    if (lookup_slot == OrderIdIndex<OrderLocation>::npos) return false;
+    const OrderLocation& location = order_lookup_.value_at(lookup_slot);
+    return location.is_buy ? queue_ahead_in<Side::Buy>(location.slot, position)
+                           : queue_ahead_in<Side::Sell>(location.slot, position);
+}
+
+bool OrderBook::resting_quantity(uint64_t order_id, uint64_t& quantity) const {
+    const size_t lookup_slot = order_lookup_.find(order_id);
+    if (lookup_slot == OrderIdIndex<OrderLocation>::npos) return false;
+    quantity = pool_[order_lookup_.value_at(lookup_slot).slot].quantity;
+    return true;
+}
+
+template <Side S>
+bool OrderBook::queue_ahead_in(OrderHandle slot, QueuePosition& position) const {
+    const OrderNode& order = pool_[slot];
+    const PriceLevelData& level = levels<S>().find(order.price)->second;
+    position.quantity = order.quantity;
+    position.level_quantity = level.total_quantity;
+    if (config_.queue_positions) {
+        position.quantity_ahead = level.queue.ahead(pool_.cold(slot).queue_sequence);
+        return true;
+    }
+    uint64_t ahead = 0;
+    for (OrderHandle it = level.orders.head; it != slot; it = pool_[it].next) ahead += pool_[it].quantity;
+    position.quantity_ahead = ahead;
+    return true;
+}
+
+void OrderBook::renumber_queue(PriceLevelData& level) {
+    queue_scratch_.clear();
+    for (OrderHandle slot = level.orders.head; slot != kNullOrder; slot = pool_[slot].next) {
+        queue_scratch_.push_back(pool_[slot].quantity);
+        pool_.cold(slot).queue_sequence = static_cast<uint32_t>(queue_scratch_.size());
+    }
+    level.queue.rebuild(queue_scratch_.data(), queue_scratch_.size());
+}
+
+void OrderBook::replace_contents(OrderBook&& rebuilt) {
+    if (event_sink_) {
+        emit_side(bids_, true, false);
+        emit_side(asks_, false, false);
+    }
+
+    BookEventSink* const sink = event_sink_;
+    const uint8_t streams = event_streams_;
+    const uint64_t l2_sequence = l2_sequence_;
+    const uint64_t l3_sequence = l3_sequence_;
+    const uint64_t depth_sequence = depth_sequence_;
+    BookJournal* const journal = journal_;
+    const bool in_auction = in_auction_;
+#ifdef ORDERBOOK_METRICS
+    std::unique_ptr<BookMetrics> metrics = std::move(metrics_);
+#endif
+    *this = std::move(rebuilt);
+    journal_ = journal;
+    in_auction_ = in_auction;
+    auction_dirty_ = auction_rebuild_ = true;
+#ifdef ORDERBOOK_METRICS
+    metrics_ = std::move(metrics);
+#endif
+    event_sink_ = sink;
+    event_streams_ = streams;
+    l2_sequence_ = l2_sequence;
+    l3_sequence_ = l3_sequence;
+    depth_sequence_ = depth_sequence + 1; // get_snapshot_if_changed readers must re-read
+
+    if (event_sink_) {
+        emit_side(bids_, true, true);
+        emit_side(asks_, false, true);
+    }
+}
+
+template <typename Levels>
+void OrderBook::emit_side(const Levels& levels, bool is_buy, bool added) {
+    for (const auto& [price, level] : levels) {
+        if (added) emit(BookEventType::LevelAdd, is_buy, price, level.total_quantity);
+        for (OrderHandle slot = level.orders.head; slot != kNullOrder; slot = pool_[slot].next) {
+            const OrderNode& node = pool_[slot];
+            emit(added ? BookEventType::OrderAdd : BookEventType::OrderCancel, is_buy, price, node.quantity,
+                 node.order_id);
+        }
+        if (!added) emit(BookEventType::LevelDelete, is_buy, price, 0);
+    }
+}
+
+bool OrderBook::warm_up(const WarmupConfig& warmup) {
+    if (pool_.size() != 0) return false;
+
+    BookEventSink* const sink = event_sink_;
+    BookJournal* const journal = journal_;
+    event_sink_ = nullptr;
+    journal_ = nullptr;
+
+    // Ids inside the Direct-mode window; levels straddle an arbitrary mid
+    const size_t orders = std::min(warmup.orders ? warmup.orders : config_.order_capacity, pool_.capacity());
+    const size_t levels = std::max<size_t>(warmup.levels, 1);
+    const Ticks mid = Ticks{1} << 30;
+    for (size_t cycle = 0; cycle < warmup.cycles; cycle++) {
+        for (size_t i = 0; i < orders; i++) {
+            const bool is_buy = i % 2 == 0;
+            const Ticks offset = static_cast<Ticks>(1 + (i / 2) % levels);
+            add_order({config_.first_order_id + i, is_buy, ticks_.to_price(is_buy ? mid - offset : mid + offset), 1,
+                       0});
+        }
+        // Odd ids first, so cancels hit the middle of queues as well as heads
+        for (size_t i = 1; i < orders; i += 2) cancel_order(config_.first_order_id + i);
+        for (size_t i = 0; i < orders; i += 2) cancel_order(config_.first_order_id + i);
+    }
+
+    event_sink_ = sink;
+    journal_ = journal;
+    depth_sequence_++; // Readers of the warmed-up, empty top re-read once
+#ifdef ORDERBOOK_METRICS
+    metrics_->reset();
+#endif
+
+    if (!warmup.lock_memory) return true;
+    bool locked = true;
+    pool_.for_each_region([&](const void* data, size_t bytes) {
+        if (bytes && ::mlock(data, bytes) != 0) locked = false;
+    });
+    if (order_lookup_.bytes() && ::mlock(order_lookup_.data(), order_lookup_.bytes()) != 0) locked = false;
+    if (config_.arena && !config_.arena->lock()) locked = false;
+    return locked;
+}
+
+size_t OrderBook::snapshot_bytes() const {
+    return sizeof(SnapshotHeader) + (bids_.size() + asks_.size()) * sizeof(SnapshotLevel) +
+           pool_.size() * sizeof(SnapshotOrder);
+}
+
+size_t OrderBook::write_snapshot(char* out, size_t capacity, uint64_t sequence) const {
+    const size_t bytes = snapshot_bytes();
+    if (capacity < bytes) return 0;
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.version = kSnapshotVersion;
+    header.tick_size = ticks_.tick_size();
+    header.sequence = sequence;
+    header.order_count = pool_.size();
+    header.bid_levels = bids_.size();
+    header.ask_levels = asks_.size();
+    header.expiry_now_ns = expiry_.now_ns();
+    std::memcpy(out, &header, sizeof(header));
+
+    auto* level_out = reinterpret_cast<SnapshotLevel*>(out + sizeof(header));
+    auto* order_out = reinterpret_cast<SnapshotOrder*>(level_out + bids_.size() + asks_.size());
+    write_side(bids_, level_out, order_out);
+    write_side(asks_, level_out, order_out);
+    return bytes;
+}
+
+template <typename Levels>
+void OrderBook::write_side(const Levels& levels, SnapshotLevel*& level_out, SnapshotOrder*& order_out) const {
+    for (const auto& [price, level] : levels) {
+        const SnapshotOrder* const first = order_out;
+        for (OrderHandle slot = level.orders.head; slot != kNullOrder; slot = pool_[slot].next) {
+            const OrderNode& node = pool_[slot];
+            const OrderColdData& cold = pool_.cold(slot);
+            const uint64_t expire_ns = expiry_.deadline_ns(slot);
+            const TimeInForce tif = expire_ns != 0 ? TimeInForce::GoodTillTime : TimeInForce::GoodTillCancel;
+            *order_out++ = SnapshotOrder{node.order_id, node.quantity, decode_timestamp(cold.timestamp, epoch_ns_),
+                                         expire_ns, cold.account, static_cast<uint8_t>(tif), {}};
+        }
+        *level_out++ = SnapshotLevel{price, static_cast<uint64_t>(order_out - first), level.total_quantity};
+    }
+}
+
+bool OrderBook::restore_snapshot(const char* data, size_t size, uint64_t* sequence) {
+    if (size < sizeof(SnapshotHeader) || reinterpret_cast<uintptr_t>(data) % alignof(SnapshotOrder) != 0) {
+        return false;
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 ||
+        header.version != kSnapshotVersion || header.tick_size != ticks_.tick_size()) {
+        return false;
+    }
+    // Counts must account for every byte, without overflowing on garbage
+    const size_t records = (size - sizeof(header)) / sizeof(SnapshotLevel);
+    if (header.bid_levels > records || header.ask_levels > records || header.order_count > records ||
+        header.order_count > kMaxOrderCapacity ||
+        sizeof(header) + (header.bid_levels + header.ask_levels) * sizeof(SnapshotLevel) +
+                header.order_count * sizeof(SnapshotOrder) !=
+            size) {
+        return false;
+    }
+
+    OrderBookConfig config = config_;
+    config.order_capacity = std::min(kMaxOrderCapacity,
+                                     std::max<size_t>(config.order_capacity, header.order_count + header.order_count / 4));
+    OrderBook rebuilt(config);
+
+    const auto* levels = reinterpret_cast<const SnapshotLevel*>(data + sizeof(header));
+    const auto* orders = reinterpret_cast<const SnapshotOrder*>(levels + header.bid_levels + header.ask_levels);
+    const SnapshotOrder* const end = orders + header.order_count;
+    if (kCompactOrders && rebuilt.epoch_ns_ == 0 && orders != end) {
+        // An unset epoch starts at the earliest order, so no timestamp clamps
+        uint64_t earliest = orders->timestamp_ns;
+        for (const SnapshotOrder* order = orders; order != end; order++) {
+            earliest = std::min(earliest, order->timestamp_ns);
+        }
+        rebuilt.epoch_ns_ = earliest;
+    }
+    // Pick the expiry clock up where it was, so restored deadlines are not
+    // walked again from the earliest order's timestamp (the wheel is empty:
+    // this is a jump)
+    rebuilt.expiry_.advance(header.expiry_now_ns, rebuilt.expired_);
+    OrderHandle handle = rebuilt.pool_.allocate_run(header.order_count);
+    if (!rebuilt.restore_side(rebuilt.bids_, true, levels, header.bid_levels, orders, end, handle) ||
+        !rebuilt.restore_side(rebuilt.asks_, false, levels + header.bid_levels, header.ask_levels, orders, end,
+                              handle) ||
+        orders != end) {
+        return false;
+    }
+    rebuilt.bid_depth_.mark_dirty();
+    rebuilt.ask_depth_.mark_dirty();
+
+    replace_contents(std::move(rebuilt));
+    if (sequence) *sequence = header.sequence;
+    return true;
+}
+
+template <typename Levels>
+bool OrderBook::restore_side(Levels& levels, bool is_buy, const SnapshotLevel* records, uint64_t count,
+                             const SnapshotOrder*& next, const SnapshotOrder* end, OrderHandle& handle) {
+    // Far enough ahead to overlap the index misses of a bulk load
+    constexpr size_t kPrefetchDistance = 16;
+
+    for (uint64_t i = 0; i < count; i++) {
+        const SnapshotLevel& record = records[i];
+        // Levels arrive best first, i.e. in map order, so each append is O(1)
+        if (record.order_count == 0 || record.order_count > static_cast<uint64_t>(end - next) ||
+            (!levels.empty() && !levels.key_comp()(std::prev(levels.end())->first, record.price))) {
+            return false;
+        }
+        if (BOOK_UNLIKELY(!order_storable(record.price, 0))) return false;
+        auto level = levels.emplace_hint(levels.end(), record.price, PriceLevelData{});
+        PriceLevelData& data = level->second;
+        data.price = record.price;
+
+        // The level's orders take consecutive slots, linked in FIFO order
+        const OrderHandle first = handle;
+        const OrderHandle last = static_cast<OrderHandle>(first + record.order_count - 1);
+        for (OrderHandle slot = first; slot <= last; slot++, next++) {
+            if (end - next > static_cast<ptrdiff_t>(kPrefetchDistance)) {
+                order_lookup_.prefetch(next[kPrefetchDistance].order_id);
+            }
+            if (BOOK_UNLIKELY(!order_storable(record.price, next->quantity))) return false;
+            // A deadline needs a wheel to wait in; dropping it would make the order GTC
+            const bool expires = next->tif == static_cast<uint8_t>(TimeInForce::GoodTillTime) && next->expire_ns != 0;
+            if (BOOK_UNLIKELY(expires && !expiry_.enabled())) return false;
+            OrderNode& node = pool_[slot];
+            node.order_id = next->order_id;
+            node.quantity = static_cast<NodeQuantity>(next->quantity);
+            node.price = static_cast<NodeTicks>(record.price);
+            node.prev = slot == first ? kNullOrder : slot - 1;
+            node.next = slot == last ? kNullOrder : slot + 1;
+            pool_.cold(slot).timestamp = store_timestamp(next->timestamp_ns);
+            pool_.cold(slot).account = next->account;
+            owner_link(slot, next->account);
+            if (expires) expiry_.schedule(slot, next->expire_ns, next->timestamp_ns);
+            data.total_quantity += next->quantity;
+            order_lookup_.insert_new(next->order_id, OrderLocation{slot, is_buy});
+        }
+        data.orders.head = first;
+        data.orders.tail = last;
+        handle = last + 1;
+        if (config_.queue_positions) renumber_queue(data);
+        if (data.total_quantity != record.total_quantity) return false;
+    }
+    return true;
+}
+
+bool OrderBook::save_snapshot(const std::string& path, uint64_t sequence) const {
+    std::vector<char> image(snapshot_bytes());
+    write_snapshot(image.data(), image.size(), sequence);
+
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t done = 0;
+    while (done < image.size()) {
+        const ssize_t n = ::write(fd, image.data() + done, image.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return ::close(fd) == 0;
+}
+
+bool OrderBook::load_snapshot(const std::string& path, uint64_t* sequence) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+    const bool restored = restore_snapshot(static_cast<const char*>(map), size, sequence);
+    ::munmap(map, size);
+    return restored;
 }
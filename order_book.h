@@ -1,11 +1,42 @@
 #pragma once
 #include <cstdint>
 #include <vector>
+#include <array>
 #include <string>
 #include <map>
-#include <unordered_map>
-#include <list>
+#include <limits>
 #include <memory>
+#include "arena.h"
+#include "book_side.h"
+#include "branch_hints.h"
+#include "price.h"
+#include "order_pool.h"
+#include "order_index.h"
+#include "depth_cache.h"
+#include "depth_kernels.h"
+#include "queue_position.h"
+#include "risk_limits.h"
+#include "timer_wheel.h"
+#include "trade_window.h"
+#include "book_events.h"
+#include "book_journal.h"
+#include "book_metrics.h"
+#include "book_snapshot.h"
+
+// How long an order may rest
+enum class TimeInForce : uint8_t {
+    GoodTillCancel,    // Rest any unfilled remainder
+    ImmediateOrCancel, // Cancel any unfilled remainder
+    FillOrKill,        // Execute in full immediately or not at all
+    GoodTillTime       // Rest until Order::expire_ns (OrderBookConfig::expiry_tick_ns)
+};
+
+// Execution instruction
+enum class OrderType : uint8_t {
+    Limit,    // Execute at the limit price or better
+    Market,   // Execute at any price; never rests
+    PostOnly  // Rest only; rejected if it would cross
+};
 
 // Order structure with all required fields
 struct Order {
@@ -14,57 +45,1031 @@ struct Order {
     double price;          // Limit price
     uint64_t quantity;     // Remaining quantity
     uint64_t timestamp_ns; // Order entry timestamp in nanoseconds
+    TimeInForce tif = TimeInForce::GoodTillCancel;
+    OrderType type = OrderType::Limit;
+    uint32_t account = 0;  // Owner for self-trade prevention and limits; 0 = none
+    uint64_t expire_ns = 0; // GoodTillTime deadline on the timestamp_ns clock; 0 = none
+};
+
+// Execution of an incoming (taker) order against a resting (maker) order
+struct Fill {
+    uint64_t taker_order_id;
+    uint64_t maker_order_id;
+    double price;      // Maker's price
+    uint64_t quantity; // Executed quantity
+};
+
+// Book mutation carried through queues and batches
+enum class BookOpType : uint8_t {
+    Add,    // order: the order to rest
+    Cancel, // order.order_id
+    Amend   // order.order_id, order.price, order.quantity
+};
+
+struct BookOp {
+    BookOpType type;
+    Order order;
+};
+
+// Outcome of OrderBook::match_order
+enum class MatchStatus : uint8_t {
+    Rested,    // Remainder (possibly all of it) is resting in the book
+    Filled,    // Fully executed
+    Cancelled, // Remainder cancelled (IOC or market)
+    Rejected   // Nothing executed (post-only would cross, FOK not fillable)
+};
+
+struct MatchResult {
+    uint64_t filled;
+    MatchStatus status;
+    RejectReason reason = RejectReason::None; // Set for Rejected, and for a self-trade cancel
+};
+
+// Number of levels written by a fixed-capacity snapshot
+struct SnapshotDepth {
+    size_t bids;
+    size_t asks;
+};
+
+// Result of OrderBook::vwap_to_size
+struct DepthVwap {
+    double price;    // Average fill price; 0 when nothing is available
+    uint64_t filled; // Less than asked only when the side runs out
+};
+
+// Best levels and the statistics derived from them (OrderBook::top_of_book).
+// Derived fields are 0 unless both sides have a level.
+struct TopStats {
+    double bid = 0.0;
+    double ask = 0.0;
+    uint64_t bid_quantity = 0;
+    uint64_t ask_quantity = 0;
+    double mid = 0.0;
+    double microprice = 0.0; // Mid weighted towards the thinner side
+    double spread = 0.0;
+    double imbalance = 0.0;  // (bid_quantity - ask_quantity) / their sum, in [-1, 1]
+};
+
+// Fills over the rolling window (OrderBook::trade_window)
+struct TradeWindowStats {
+    uint64_t volume;
+    uint64_t trades;
+    double vwap;       // 0 without fills in the window
+    double last_price; // Latest fill, even if it has left the window; 0 before any
+    uint64_t start_ns; // The window covers [start_ns, latest timestamp seen]
+};
+
+// Equilibrium of an auction call (OrderBook::indicative_uncross / uncross)
+struct AuctionUncross {
+    double price = 0.0;    // Uncross price; 0 when nothing would trade
+    uint64_t volume = 0;   // Quantity that trades at it
+    int64_t imbalance = 0; // Bid minus ask quantity willing to trade at it
 };
 
-// PriceLevel represents a price level with aggregated volume
-struct PriceLevel {
-    double price;
-    uint64_t total_quantity;
+// Result of OrderBook::queue_ahead
+struct QueuePosition {
+    uint64_t quantity_ahead; // Resting before the order in time priority
+    uint64_t quantity;       // The order's own remaining quantity
+    uint64_t level_quantity; // Whole level, the order included
+};
+
+// Print aggregated levels, asks on top and bids below
+BOOK_COLD void print_levels(const std::vector<PriceLevel>& bids, const std::vector<PriceLevel>& asks);
+
+// Compact order storage, built with ORDERBOOK_COMPACT_ORDERS for very large
+// books: resting quantities and tick prices shrink to 32 bits and entry
+// timestamps to a 32-bit offset from the session epoch, so an order takes
+// a 24-byte node, a 20-byte cold record and a 16-byte id-index slot instead
+// of 32 + 24 + 24. The level price stays canonical in the map key and
+// PriceLevelData; nodes keep it only to find their level on cancel.
+// Orders that do not fit are rejected at entry (order_storable).
+#ifdef ORDERBOOK_COMPACT_ORDERS
+inline constexpr bool kCompactOrders = true;
+using NodeQuantity = uint32_t;
+using NodeTicks = int32_t;
+using StoredTimestamp = uint32_t;
+#else
+inline constexpr bool kCompactOrders = false;
+using NodeQuantity = uint64_t;
+using NodeTicks = Ticks;
+using StoredTimestamp = uint64_t;
+#endif
+
+// Compact timestamps count units of 2^kTimestampShift ns (8.192 us) from
+// the epoch, about 9.8 hours of range, clamped at both ends. Priority is
+// queue order, never time, so only snapshots see the rounding.
+inline constexpr unsigned kTimestampShift = 13;
+
+inline StoredTimestamp encode_timestamp(uint64_t timestamp_ns, uint64_t epoch_ns) {
+    if constexpr (kCompactOrders) {
+        if (timestamp_ns <= epoch_ns) return 0;
+        const uint64_t units = (timestamp_ns - epoch_ns) >> kTimestampShift;
+        return units > std::numeric_limits<StoredTimestamp>::max() ? std::numeric_limits<StoredTimestamp>::max()
+                                                                   : static_cast<StoredTimestamp>(units);
+    } else {
+        (void)epoch_ns;
+        return timestamp_ns;
+    }
+}
+
+inline uint64_t decode_timestamp(StoredTimestamp stored, uint64_t epoch_ns) {
+    if constexpr (kCompactOrders) {
+        return epoch_ns + (static_cast<uint64_t>(stored) << kTimestampShift);
+    } else {
+        (void)epoch_ns;
+        return stored;
+    }
+}
+
+// Whether a resting order at price with quantity fits the node; always
+// true outside compact builds
+inline bool order_storable(Ticks price, uint64_t quantity) {
+    if constexpr (kCompactOrders) {
+        return quantity <= std::numeric_limits<NodeQuantity>::max() &&
+               price >= std::numeric_limits<NodeTicks>::min() && price <= std::numeric_limits<NodeTicks>::max();
+    } else {
+        (void)price;
+        (void)quantity;
+        return true;
+    }
+}
+
+// Hot part of a resting order: everything matching and cancel touch,
+// two nodes per cache line. The side is kept in the id index.
+struct OrderNode {
+    uint64_t order_id;
+    NodeQuantity quantity;
+    NodeTicks price;
+    OrderHandle prev = kNullOrder;
+    OrderHandle next = kNullOrder;
+};
+
+// Cold part, read only by snapshots, self-trade checks and, with
+// OrderBookConfig::queue_positions / owner_orders, to keep the level's
+// queue index and the owner's order list
+struct OrderColdData {
+    StoredTimestamp timestamp;   // encode_timestamp(Order::timestamp_ns, session epoch)
+    uint32_t queue_sequence = 0; // Position key in QueuePositionIndex
+    uint32_t account = 0;        // Order::account, for self-trade prevention and cancel_all
+    OrderHandle owner_prev = kNullOrder; // Account's other resting orders
+    OrderHandle owner_next = kNullOrder;
+};
+
+using OrderPool = NodePool<OrderNode, OrderColdData>;
+
+// Layout budget: a regression here costs a cache line per order
+static_assert(sizeof(OrderNode) == (kCompactOrders ? 24 : 32), "OrderNode grew past its layout budget");
+static_assert(sizeof(OrderColdData) == (kCompactOrders ? 20 : 24), "OrderColdData grew past its layout budget");
+
+// Per-instrument book configuration
+struct OrderBookConfig {
+    double tick_size = 0.01;         // Minimum price increment of the instrument
+    size_t order_capacity = 1 << 16; // Order slots preallocated in the pool and id index
+    OrderIdIndexMode id_index = OrderIdIndexMode::Hashed;
+    uint64_t first_order_id = 0;     // Base id for OrderIdIndexMode::Direct
+    Arena* arena = nullptr;          // Backs the level maps if set; must outlive the book
+    bool queue_positions = false;    // Index every level so queue_ahead is O(log n), not a walk
+    bool owner_orders = false;       // List each account's resting orders for cancel_all
+    uint64_t trade_window_ns = 0;    // Rolling fill statistics over this window; 0 = off
+    uint64_t expiry_tick_ns = 0;     // Resolution of GoodTillTime expiry; 0 = GoodTillTime rejected
+
+    // Pre-trade controls in match_order (risk_limits.h); all off by default
+    SelfTradePrevention self_trade = SelfTradePrevention::None;
+    const AccountRiskTable* risk = nullptr; // Per-account limits; must outlive the book
+    Ticks price_band_ticks = 0;             // Max ticks through the opposite best; 0 = no band
+
+    // Compact builds store entry timestamps relative to this; 0 = the first
+    // order's timestamp
+    uint64_t session_epoch_ns = 0;
 };
 
-// Type alias for order list
-using OrderList = std::list<Order>;
+// Startup warm-up of an empty book (OrderBook::warm_up)
+struct WarmupConfig {
+    size_t orders = 0;        // Orders rested per cycle; 0 = order_capacity
+    size_t levels = 256;      // Price levels per side they spread over
+    size_t cycles = 2;        // Fill-then-cancel rounds
+    bool lock_memory = false; // mlock the slab, id index and level-map arena
+};
 
 class OrderBook {
 public:
-    OrderBook() = default;
+    // @throw std::length_error if config.order_capacity exceeds kMaxOrderCapacity
+    explicit OrderBook(const OrderBookConfig& config = OrderBookConfig{});
     ~OrderBook() = default;
 
+    // Handles index the book's own pool, so a move keeps every order valid
+    OrderBook(OrderBook&&) = default;
+    OrderBook& operator=(OrderBook&&) = default;
+
     // Insert a new order into the book
-    void add_order(const Order& order);
+    // @return false, leaving the book and journal untouched, if the order
+    // does not fit a node (order_storable); only compact builds can refuse
+    BOOK_HOT bool add_order(const Order& order);
+
+    // Match an incoming order against the opposite side in price-time
+    // priority, calling on_fill(const Fill&) for each execution in place,
+    // then handle the remainder per order.tif / order.type. Allocation-free
+    // apart from the resting insert.
+    template <typename OnFill>
+    MatchResult match_order(const Order& order, OnFill&& on_fill);
 
     // Cancel an existing order by its ID
-    bool cancel_order(uint64_t order_id);
+    BOOK_HOT bool cancel_order(uint64_t order_id);
 
     // Amend an existing order's price or quantity
-    bool amend_order(uint64_t order_id, double new_price, uint64_t new_quantity);
+    BOOK_HOT bool amend_order(uint64_t order_id, double new_price, uint64_t new_quantity);
+
+    // Cancel every resting order of a non-zero account (e.g. on a session
+    // disconnect) in one walk of its order list. Each order is journaled and
+    // published as an L3 cancel; L2 level deltas go out once per touched
+    // level at the end, as for apply_batch. Needs
+    // OrderBookConfig::owner_orders. @return orders cancelled
+    size_t cancel_all(uint32_t account);
+
+    // Resting orders of an account (owner_orders only)
+    size_t owner_order_count(uint32_t account) const {
+        return account < owners_.size() ? owners_[account].count : 0;
+    }
+
+    // Cancel every GoodTillTime order whose deadline is at or before now_ns,
+    // rounded up to OrderBookConfig::expiry_tick_ns. Call it from the book
+    // thread as time moves on; the cost is per tick passed plus per order
+    // expired, never a scan of the book. Cancels go out as for cancel_all.
+    // @return orders expired
+    size_t expire_orders(uint64_t now_ns);
+
+    // Resting orders with a pending deadline
+    size_t expiring_order_count() const { return expiry_.size(); }
+
+    // Auction call: from begin_auction() until uncross(), match_order rests
+    // GTC / GTT limit orders without matching, so the book may cross, and
+    // rejects every other type and time in force.
+    void begin_auction();
+    bool in_auction() const { return in_auction_; }
+
+    // Price that maximises executed volume over the crossed levels, then
+    // minimises the surplus; remaining ties go to the highest price with a
+    // buy surplus on every one, the lowest with a sell surplus, and the
+    // middle otherwise. Cached, and recomputed on the next read only after
+    // a crossed level changes, in one pass over the crossed levels. Zero
+    // outside a call.
+    AuctionUncross indicative_uncross() const;
+
+    // End the call: execute the indicative volume at its price in one
+    // batch, bids and asks each in price-time priority. on_fill(const Fill&)
+    // reports the buy as taker_order_id and the sell as maker_order_id.
+    // timestamp_ns stamps the fills in the trade window. Self-trade
+    // prevention does not apply.
+    template <typename OnFill>
+    AuctionUncross uncross(uint64_t timestamp_ns, OnFill&& on_fill);
+
+    // Apply one queued operation
+    // @return false if an add does not fit or a cancel/amend did not find its order
+    BOOK_HOT bool apply(const BookOp& op);
+
+    // Apply a packet's worth of operations in one call. Index slots, then
+    // the resting nodes and target levels they lead to, are prefetched ahead
+    // of use, and L2 deltas are coalesced per level and published once at
+    // the end of the batch. @return operations applied
+    BOOK_HOT size_t apply_batch(const BookOp* ops, size_t count);
 
     // Get a snapshot of top N bid and ask levels (aggregated quantities)
     void get_snapshot(size_t depth, std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const;
 
+    // Snapshot into caller-provided buffers; never allocates
+    SnapshotDepth get_snapshot(PriceLevel* bids, size_t bid_capacity,
+                               PriceLevel* asks, size_t ask_capacity) const;
+
+    // Snapshot with the depth fixed at compile time; within the cached depth
+    // this is two fixed-size copies
+    template <size_t Depth>
+    SnapshotDepth get_snapshot(std::array<PriceLevel, Depth>& bids, std::array<PriceLevel, Depth>& asks) const;
+
+    // Same as get_snapshot, but a no-op returning false when the top levels
+    // have not changed since sequence; updates sequence otherwise
+    bool get_snapshot_if_changed(size_t depth, uint64_t& sequence,
+                                 std::vector<PriceLevel>& bids, std::vector<PriceLevel>& asks) const;
+
+    // Bumped whenever any of the top DepthCache::kCapacity levels change
+    uint64_t depth_sequence() const { return depth_sequence_; }
+
+    // Depth queries for pre-trade risk checks. The top DepthCache::kCapacity
+    // levels are scanned with the widest kernels the CPU has (depth_kernels.h);
+    // a query that reaches past them walks the deeper levels in the map.
+    // is_buy selects the side queried: the bids are what a sell would hit.
+
+    // Quantity resting no more than ticks away from the side's best price
+    uint64_t quantity_within(bool is_buy, Ticks ticks) const;
+
+    // out[i] = quantity of the best i + 1 levels; @return levels written
+    size_t cumulative_depth(bool is_buy, uint64_t* out, size_t depth) const;
+
+    // Average price of taking quantity from the side, best level first
+    DepthVwap vwap_to_size(bool is_buy, uint64_t quantity) const;
+
+    // Best bid and ask with mid, microprice, spread and imbalance; O(1) from
+    // the first node of each level map, always current
+    TopStats top_of_book() const;
+
+    // Volume, trade count and VWAP of match_order fills over the last
+    // OrderBookConfig::trade_window_ns, ending at the latest fill or
+    // advance_trade_window() time; O(1)
+    TradeWindowStats trade_window() const;
+
+    // Let the window move on without a fill (e.g. from a timer)
+    void advance_trade_window(uint64_t now_ns) {
+        if (trades_.enabled()) trades_.advance(now_ns);
+    }
+
+    // Where a resting order stands in its level's FIFO queue. O(log n) from
+    // the level's QueuePositionIndex when OrderBookConfig::queue_positions is
+    // set; otherwise a walk of the orders ahead of it.
+    // @return false if the order is not in the book
+    bool queue_ahead(uint64_t order_id, QueuePosition& position) const;
+
+    // Remaining quantity of a resting order; O(1) through the id index,
+    // with or without queue_positions
+    // @return false if the order is not in the book
+    bool resting_quantity(uint64_t order_id, uint64_t& quantity) const;
+
     // Print current state of the order book
-    void print_book(size_t depth = 10) const;
+    BOOK_COLD void print_book(size_t depth = 10) const;
+
+    // Route L2 and/or L3 deltas to sink (nullptr disables publishing)
+    void set_event_sink(BookEventSink* sink, uint8_t streams = kL2Events | kL3Events);
+
+    // Journal every add/cancel/amend/match call to journal (nullptr stops).
+    // Only calls that change the book are recorded: a match is written once
+    // it has passed every check, so rejects never reach the journal, though
+    // an IOC that finds nothing to trade still does. apply/apply_batch go
+    // through the same calls.
+    void set_journal(BookJournal* journal) { journal_ = journal; }
+    BookJournal* journal() const { return journal_; }
+
+    // Per-op latency histograms and counters; nullptr unless compiled with
+    // ORDERBOOK_METRICS. Readable from any thread.
+    BookMetrics* metrics() const {
+#ifdef ORDERBOOK_METRICS
+        return metrics_.get();
+#else
+        return nullptr;
+#endif
+    }
+
+    // Price <-> tick conversion used at the API edge
+    const TickScale& tick_scale() const { return ticks_; }
+
+    const OrderBookConfig& config() const { return config_; }
+
+    // Run synthetic add/cancel cycles through the real add_order and
+    // cancel_order paths so the first live orders pay no page faults, cold
+    // caches or untrained branches: the slab and id index are filled to
+    // capacity, level-map nodes are allocated and left in the allocator's
+    // free lists, then the book is empty again. Nothing is published or
+    // journaled, and metrics are reset afterwards. Call before going live.
+    // @return false if the book is not empty, or lock_memory was asked for
+    // and mlock failed (e.g. RLIMIT_MEMLOCK); the warm-up itself still ran
+    BOOK_COLD bool warm_up(const WarmupConfig& warmup = WarmupConfig{});
+
+    // Start of the order slab, e.g. to see which NUMA node holds it
+    const void* order_storage() const { return pool_.data(); }
+
+    // Install the orders of a book rebuilt elsewhere (e.g. from a snapshot
+    // on another thread) in O(1). This book keeps its event sink and
+    // sequences; subscribers see the swap as deltas removing every old
+    // level/order and adding every new one.
+    void replace_contents(OrderBook&& rebuilt);
+
+    // Binary image of every level and order, each level's FIFO order kept
+    // (layout in book_snapshot.h); sequence is stored for the caller, e.g.
+    // the journal sequence the image covers
+    size_t snapshot_bytes() const;
+    // @return bytes written, or 0 if capacity is below snapshot_bytes()
+    size_t write_snapshot(char* out, size_t capacity, uint64_t sequence = 0) const;
+
+    // Replace the contents with an image from write_snapshot (8-byte
+    // aligned), through replace_contents. The pool and id index are
+    // presized from the header and filled in one pass: consecutive pool
+    // slots, levels appended in order, index inserts without load checks.
+    // @return false, leaving the book unchanged, if the image is malformed
+    // or was written with another tick size
+    BOOK_COLD bool restore_snapshot(const char* data, size_t size, uint64_t* sequence = nullptr);
+
+    // The same through a file: one write() of the image, and an mmap on restore
+    BOOK_COLD bool save_snapshot(const std::string& path, uint64_t sequence = 0) const;
+    BOOK_COLD bool load_snapshot(const std::string& path, uint64_t* sequence = nullptr);
 
 private:
-    // Internal structure to maintain orders at each price level
-    struct PriceLevelData {
-        double price;
-        OrderList orders; // FIFO queue of orders at this price
+    // Internal structure to maintain orders at each price level; one
+    // cache line so the header never straddles two
+    struct alignas(64) PriceLevelData {
+        Ticks price;
+        OrderQueue orders; // FIFO queue of orders at this price
         uint64_t total_quantity = 0;
+        QueuePositionIndex queue; // Empty unless config_.queue_positions
     };
+    static_assert(sizeof(PriceLevelData) == 64, "level header must fill exactly one cache line");
+
+    // Side S operations. The public entry points look at is_buy once and
+    // call the matching instantiation; below that nothing branches on side.
+
+    // Append an order to its level; price is already in ticks
+    template <Side S>
+    void rest_order(const Order& order, Ticks price);
+
+    // Take a resting order off its level, erasing the level if it empties;
+    // the pool slot and index entry are the caller's
+    template <Side S>
+    void unlink_order(OrderHandle slot);
+
+    // Amend an order resting on one side: re-price moves the node between
+    // levels in place; quantity down keeps priority, quantity up loses it
+    template <Side S>
+    void amend_in(OrderHandle slot, Ticks new_price, uint64_t new_quantity);
+
+    // Keep the top-N depth caches and L2 stream in step with a level change
+    template <Side S>
+    void level_added(const PriceLevelData& level);
+    template <Side S>
+    void level_changed(const PriceLevelData& level);
+    template <Side S>
+    void level_erased(Ticks price);
+    void refresh_depth() const;
+
+    // Queue-position upkeep; no-ops unless config_.queue_positions. Join
+    // before the node is appended to level.orders.
+    void queue_join(PriceLevelData& level, OrderHandle slot) {
+        if (!config_.queue_positions) return;
+        if (BOOK_UNLIKELY(level.queue.full())) renumber_queue(level);
+        pool_.cold(slot).queue_sequence = level.queue.append(pool_[slot].quantity);
+    }
+    void queue_reduce(PriceLevelData& level, OrderHandle slot, uint64_t quantity) {
+        if (config_.queue_positions) level.queue.reduce(pool_.cold(slot).queue_sequence, quantity);
+    }
+    BOOK_COLD void renumber_queue(PriceLevelData& level);
+
+    // Owner-list upkeep; no-ops unless config_.owner_orders. Link once the
+    // cold account is set, unlink before the slot is released.
+    void owner_link(OrderHandle slot, uint32_t account) {
+        if (!config_.owner_orders || account == 0) return;
+        if (BOOK_UNLIKELY(account >= owners_.size())) grow_owners(account);
+        OwnerOrders& owner = owners_[account];
+        OrderColdData& cold = pool_.cold(slot);
+        cold.owner_prev = kNullOrder;
+        cold.owner_next = owner.head;
+        if (owner.head != kNullOrder) pool_.cold(owner.head).owner_prev = slot;
+        owner.head = slot;
+        owner.count++;
+    }
+    void owner_unlink(OrderHandle slot) {
+        if (!config_.owner_orders) return;
+        const OrderColdData& cold = pool_.cold(slot);
+        if (cold.account == 0) return;
+        OwnerOrders& owner = owners_[cold.account];
+        if (cold.owner_prev != kNullOrder) {
+            pool_.cold(cold.owner_prev).owner_next = cold.owner_next;
+        } else {
+            owner.head = cold.owner_next;
+        }
+        if (cold.owner_next != kNullOrder) pool_.cold(cold.owner_next).owner_prev = cold.owner_prev;
+        owner.count--;
+    }
+    BOOK_COLD void grow_owners(uint32_t account);
+
+    // Deadline upkeep; a no-op for orders without one
+    void expiry_schedule(OrderHandle slot, const Order& order) {
+        if (order.tif == TimeInForce::GoodTillTime && order.expire_ns != 0 && expiry_.enabled()) {
+            expiry_.schedule(slot, order.expire_ns, order.timestamp_ns);
+        }
+    }
+    void expiry_cancel(OrderHandle slot) { expiry_.cancel(slot); }
+
+    // Remove a resting order found at lookup_slot: journal and publish the
+    // cancel, take it off its level and free it. The caller keeps the owner
+    // list; the deadline, if any, must already be gone.
+    void cancel_resting(OrderHandle slot, size_t lookup_slot);
+
+    // L2 coalescing over a multi-order cancel, unless already inside a batch
+    struct Coalescing {
+        bool outer_batch;
+        uint64_t depth_sequence;
+    };
+    Coalescing begin_coalescing() {
+        const Coalescing coalescing{batching_, depth_sequence_};
+        batching_ = true;
+        return coalescing;
+    }
+    void end_coalescing(const Coalescing& coalescing);
+
+    // match_order while in_auction_
+    MatchResult auction_order(const Order& order);
+
+    // Fold a level of side S, now at total (0 once erased), into the
+    // auction curve; a change that moves either best price rebuilds it
+    template <Side S>
+    void auction_touch(Ticks price, uint64_t total) {
+        if (BOOK_LIKELY(!in_auction_) || auction_rebuild_) return;
+        auction_update<S>(price, total);
+    }
+    template <Side S>
+    void auction_update(Ticks price, uint64_t total);
+    // Rebuild the curve from the levels if needed, then pick the price
+    void refresh_uncross() const;
+    void build_auction_curve() const;
+
+    // Execute quantity off the head of side S's best level at the uncross
+    template <Side S>
+    void auction_fill(uint64_t quantity);
+
+    // Stored form of an entry timestamp; the first order fixes an unset epoch
+    StoredTimestamp store_timestamp(uint64_t timestamp_ns) {
+        if (kCompactOrders && BOOK_UNLIKELY(epoch_ns_ == 0)) epoch_ns_ = timestamp_ns;
+        return encode_timestamp(timestamp_ns, epoch_ns_);
+    }
+
+    template <Side S>
+    bool queue_ahead_in(OrderHandle slot, QueuePosition& position) const;
+
+    // Side-resolved bodies of the depth queries
+    template <Side S>
+    uint64_t quantity_within_in(Ticks ticks) const;
+    template <Side S>
+    size_t cumulative_depth_in(uint64_t* out, size_t depth) const;
+    template <Side S>
+    DepthVwap vwap_to_size_in(uint64_t quantity) const;
+
+    // Snapshot image of one side's levels and orders
+    template <typename Levels>
+    void write_side(const Levels& levels, SnapshotLevel*& level_out, SnapshotOrder*& order_out) const;
+    // Rebuild one side from its level records; consumes orders from next
+    template <typename Levels>
+    bool restore_side(Levels& levels, bool is_buy, const SnapshotLevel* records, uint64_t count,
+                      const SnapshotOrder*& next, const SnapshotOrder* end, OrderHandle& handle);
+
+    // Publish every level (L2) and order (L3) on one side as added or removed
+    template <typename Levels>
+    void emit_side(const Levels& levels, bool is_buy, bool added);
+
+    // L2 coalescing while inside apply_batch
+    void note_pending_level(bool is_buy, Ticks price, bool existed);
+    void flush_pending_levels();
+
+    // apply_batch's second prefetch stage: the resting node of a cancel or
+    // amend (its index slot came in a stage earlier) and the level an add
+    // or amend lands on, with that level's tail node
+    void prefetch_targets(const BookOp& op) const;
+    template <Side S>
+    void prefetch_level(Ticks price) const;
+
+    // Publish one event to the sink if its stream is enabled
+    void emit(BookEventType type, bool is_buy, Ticks price, uint64_t quantity, uint64_t order_id = 0) {
+        if (!event_sink_) return;
+        const bool l2 = is_l2_event(type);
+        if (!(event_streams_ & (l2 ? kL2Events : kL3Events))) return;
+        const uint64_t sequence = l2 ? ++l2_sequence_ : ++l3_sequence_;
+        event_sink_->publish(BookEvent{sequence, order_id, price, quantity, type, is_buy});
+    }
+
+    // Record a call in the journal, if one is attached
+    void record_journal(JournalOp op, const Order& order) {
+        if (!journal_) return;
+        journal_->append(op, order.order_id, order.is_buy, order.price, order.quantity, order.timestamp_ns,
+                         static_cast<uint8_t>(order.tif), static_cast<uint8_t>(order.type), order.account,
+                         order.expire_ns);
+    }
+
+    // Matching path specialised at compile time for one order type / TIF
+    template <OrderType Type, TimeInForce Tif, typename OnFill>
+    MatchResult route(const Order& order, OnFill& on_fill);
+
+    // ... and for the side the incoming order is on
+    template <OrderType Type, TimeInForce Tif, Side S, typename OnFill>
+    MatchResult execute(const Order& order, OnFill& on_fill);
+
+    // Price band and account limits for an order entered on side S; a
+    // market order's limit is pulled in to the band edge
+    template <OrderType Type, Side S>
+    RejectReason pre_trade_check(const Order& order, Ticks& limit) const;
+
+    // Whether self-trade prevention applies to this incoming order
+    bool self_trade_checked(const Order& order) const {
+        return config_.self_trade != SelfTradePrevention::None && order.account != 0;
+    }
+
+    // Whether the best resting level on side S crosses limit
+    template <Side S>
+    bool crosses(Ticks limit) const;
+
+    // Resting quantity on side S crossing limit that order could trade
+    // with, counted until at least wanted
+    template <Side S>
+    uint64_t available(const Order& order, Ticks limit, uint64_t wanted) const;
+
+    // Execute against the best levels of side S while they cross limit.
+    // self_trade is set if self-trade prevention stopped the sweep.
+    template <Side S, typename OnFill>
+    uint64_t sweep(const Order& order, Ticks limit, OnFill& on_fill, bool& self_trade);
+
+    OrderBookConfig config_;
+    TickScale ticks_;
+
+    // Storage for every resting order; levels link into it by handle
+    OrderPool pool_;
+
+    // Level map nodes come from config.arena, or the heap without one
+    using LevelAllocator = ArenaAllocator<std::pair<const Ticks, PriceLevelData>>;
+
+    // One side's levels, best price first
+    template <Side S>
+    using SideLevels = std::map<Ticks, PriceLevelData, typename SideTraits<S>::Compare, LevelAllocator>;
 
     // Bids: highest price first (descending order)
-    std::map<double, PriceLevelData, std::greater<double>> bids_;
+    SideLevels<Side::Buy> bids_;
     
     // Asks: lowest price first (ascending order)
-    std::map<double, PriceLevelData, std::less<double>> asks_;
+    SideLevels<Side::Sell> asks_;
+
+    template <Side S>
+    SideLevels<S>& levels() {
+        if constexpr (S == Side::Buy) return bids_;
+        else return asks_;
+    }
+    template <Side S>
+    const SideLevels<S>& levels() const {
+        if constexpr (S == Side::Buy) return bids_;
+        else return asks_;
+    }
     
-    // Order lookup for O(1) access
+    // Order lookup for O(1) access through a flat, presized table
     struct OrderLocation {
+#ifdef ORDERBOOK_COMPACT_ORDERS
+        // Side packed into the handle's top bit; the pool stays below 2^31
+        OrderHandle slot : 31;
+        OrderHandle is_buy : 1;
+#else
+        OrderHandle slot; // Pool node; holds the level price
         bool is_buy;
-        double price;
-        OrderList::iterator list_iter;
+#endif
     };
+    static_assert(sizeof(OrderLocation) == (kCompactOrders ? 4 : 8), "id index values grew");
+
+    // Session epoch of stored timestamps (encode_timestamp)
+    uint64_t epoch_ns_;
     
-    std::unordered_map<uint64_t, OrderLocation> order_lookup_;
+    OrderIdIndex<OrderLocation> order_lookup_;
+
+    // Rolling fill totals; disabled unless config_.trade_window_ns
+    TradeWindow trades_;
+
+    // Resting orders of each account, indexed by account id, newest first
+    // (config_.owner_orders)
+    struct OwnerOrders {
+        OrderHandle head = kNullOrder;
+        uint32_t count = 0;
+    };
+    std::vector<OwnerOrders> owners_;
+
+    // GoodTillTime deadlines keyed by pool slot, and the slots of one
+    // expire_orders pass
+    TimerWheel expiry_;
+    std::vector<OrderHandle> expired_;
+
+    // Auction call state. The candidate prices (every level price in
+    // [best ask, best bid]) are kept with their cumulative demand (bids at
+    // or above) and supply (asks at or below), so a level change only adds
+    // its delta to the points it reaches. The uncross is picked again from
+    // the curve when a crossed level changes.
+    struct AuctionPoint {
+        Ticks price;
+        uint64_t bid;    // Level totals at this price
+        uint64_t ask;
+        uint64_t demand;
+        uint64_t supply;
+    };
+    bool in_auction_ = false;
+    mutable bool auction_dirty_ = false;   // Pick stale
+    mutable bool auction_rebuild_ = false; // Curve stale: a best price moved
+    mutable std::vector<AuctionPoint> auction_curve_; // Highest price first; empty = not crossed
+    mutable AuctionUncross auction_;
+    mutable Ticks auction_price_ = 0;
+    struct AuctionTie {
+        Ticks price;
+        int64_t imbalance;
+    };
+    mutable std::vector<AuctionTie> auction_ties_; // Equally good prices of one pass, highest first
+
+    // Queue quantities in order while a level's QueuePositionIndex is rebuilt
+    std::vector<uint64_t> queue_scratch_;
+
+    // Top-of-book depth, maintained on every change and rebuilt lazily when dirty
+    mutable DepthCache bid_depth_;
+    mutable DepthCache ask_depth_;
+
+    template <Side S>
+    DepthCache& depth_cache() const {
+        if constexpr (S == Side::Buy) return bid_depth_;
+        else return ask_depth_;
+    }
+    uint64_t depth_sequence_ = 0;
+
+    // Delta publication
+    BookEventSink* event_sink_ = nullptr;
+    uint8_t event_streams_ = 0;
+    uint64_t l2_sequence_ = 0;
+    uint64_t l3_sequence_ = 0;
+
+    BookJournal* journal_ = nullptr;
+
+#ifdef ORDERBOOK_METRICS
+    // Behind a pointer so the book stays movable
+    std::unique_ptr<BookMetrics> metrics_ = std::make_unique<BookMetrics>();
+#endif
+
+    // Levels touched by the current batch and whether each existed before it
+    struct PendingLevel {
+        Ticks price;
+        bool is_buy;
+        bool existed;
+    };
+    static constexpr size_t kMaxPendingLevels = 32;
+    PendingLevel pending_levels_[kMaxPendingLevels];
+    size_t pending_count_ = 0;
+    bool batching_ = false;
 };
+
+template <size_t Depth>
+SnapshotDepth OrderBook::get_snapshot(std::array<PriceLevel, Depth>& bids, std::array<PriceLevel, Depth>& asks) const {
+    if constexpr (Depth <= DepthCache::kCapacity) {
+        BOOK_METRIC_TIMER(*metrics_, BookMetric::Snapshot);
+        refresh_depth();
+        return SnapshotDepth{bid_depth_.copy_to<Depth>(bids.data()), ask_depth_.copy_to<Depth>(asks.data())};
+    } else {
+        return get_snapshot(bids.data(), Depth, asks.data(), Depth);
+    }
+}
+
+template <typename OnFill>
+MatchResult OrderBook::match_order(const Order& order, OnFill&& on_fill) {
+    using TIF = TimeInForce;
+    using Type = OrderType;
+
+    if (BOOK_UNLIKELY(in_auction_)) return auction_order(order);
+
+    // Resolve flags once here; each combination runs its own specialised path
+    switch (order.type) {
+    case Type::Limit:
+        switch (order.tif) {
+        case TIF::GoodTillCancel:    return route<Type::Limit, TIF::GoodTillCancel>(order, on_fill);
+        case TIF::ImmediateOrCancel: return route<Type::Limit, TIF::ImmediateOrCancel>(order, on_fill);
+        case TIF::FillOrKill:        return route<Type::Limit, TIF::FillOrKill>(order, on_fill);
+        case TIF::GoodTillTime:
+            // Rests like GTC; rest_order schedules the deadline
+            if (BOOK_UNLIKELY(order.expire_ns != 0 && !expiry_.enabled())) break;
+            return route<Type::Limit, TIF::GoodTillCancel>(order, on_fill);
+        }
+        break;
+    case Type::Market:
+        // A market order never rests, so GTC and GTT behave as IOC
+        if (order.tif == TIF::FillOrKill) {
+            return route<Type::Market, TIF::FillOrKill>(order, on_fill);
+        }
+        return route<Type::Market, TIF::ImmediateOrCancel>(order, on_fill);
+    case Type::PostOnly:
+        if (order.tif == TIF::GoodTillCancel ||
+            (order.tif == TIF::GoodTillTime && (order.expire_ns == 0 || expiry_.enabled()))) {
+            return route<Type::PostOnly, TIF::GoodTillCancel>(order, on_fill);
+        }
+        break; // Post-only cannot be immediate
+    }
+    return MatchResult{0, MatchStatus::Rejected, RejectReason::InvalidOrder};
+}
+
+template <typename OnFill>
+AuctionUncross OrderBook::uncross(uint64_t timestamp_ns, OnFill&& on_fill) {
+    if (!in_auction_) return AuctionUncross{};
+    if (journal_) journal_->append(JournalOp::Uncross, 0, false, 0.0, 0, timestamp_ns);
+    const AuctionUncross result = indicative_uncross();
+    const Ticks price = auction_price_;
+    in_auction_ = false;
+
+    // Best levels keep crossing the price until the volume is done
+    const Coalescing coalescing = begin_coalescing();
+    for (uint64_t remaining = result.volume; remaining > 0;) {
+        const OrderNode& bid = pool_[bids_.begin()->second.orders.head];
+        const OrderNode& ask = pool_[asks_.begin()->second.orders.head];
+        uint64_t quantity = bid.quantity < ask.quantity ? bid.quantity : ask.quantity;
+        if (remaining < quantity) quantity = remaining;
+        on_fill(Fill{bid.order_id, ask.order_id, result.price, quantity});
+        if (trades_.enabled()) trades_.record(timestamp_ns, price, quantity);
+        auction_fill<Side::Buy>(quantity);
+        auction_fill<Side::Sell>(quantity);
+        remaining -= quantity;
+    }
+    end_coalescing(coalescing);
+    return result;
+}
+
+template <OrderType Type, TimeInForce Tif, typename OnFill>
+MatchResult OrderBook::route(const Order& order, OnFill& on_fill) {
+    return order.is_buy ? execute<Type, Tif, Side::Buy>(order, on_fill)
+                        : execute<Type, Tif, Side::Sell>(order, on_fill);
+}
+
+template <OrderType Type, TimeInForce Tif, Side S, typename OnFill>
+MatchResult OrderBook::execute(const Order& order, OnFill& on_fill) {
+    constexpr Side Resting = SideTraits<S>::opposite;
+
+    // A market order's limit is the worst possible price for its side
+    Ticks limit;
+    if constexpr (Type == OrderType::Market) {
+        limit = SideTraits<S>::market_limit;
+    } else {
+        limit = ticks_.to_ticks(order.price);
+    }
+
+    // Compact nodes hold 32-bit quantities and tick prices
+    if constexpr (kCompactOrders) {
+        if (BOOK_UNLIKELY(!order_storable(0, order.quantity))) {
+            return MatchResult{0, MatchStatus::Rejected, RejectReason::OrderQuantity};
+        }
+        if (Type != OrderType::Market && BOOK_UNLIKELY(!order_storable(limit, 0))) {
+            return MatchResult{0, MatchStatus::Rejected, RejectReason::InvalidOrder};
+        }
+    }
+
+    // Checked in the same pass, before anything rests or trades
+    if (config_.risk || config_.price_band_ticks > 0) {
+        const RejectReason reason = pre_trade_check<Type, S>(order, limit);
+        if (BOOK_UNLIKELY(reason != RejectReason::None)) {
+            return MatchResult{0, MatchStatus::Rejected, reason};
+        }
+    }
+
+    if constexpr (Type == OrderType::PostOnly) {
+        // Reject before touching any storage
+        if (BOOK_UNLIKELY(crosses<Resting>(limit))) {
+            return MatchResult{0, MatchStatus::Rejected, RejectReason::PostOnlyCross};
+        }
+        record_journal(JournalOp::Match, order);
+        rest_order<S>(order, limit);
+        return MatchResult{0, MatchStatus::Rested};
+    } else {
+        if constexpr (Tif == TimeInForce::FillOrKill) {
+            // Check level totals before any order is touched
+            if (BOOK_UNLIKELY(available<Resting>(order, limit, order.quantity) < order.quantity)) {
+                return MatchResult{0, MatchStatus::Rejected, RejectReason::FillOrKill};
+            }
+        }
+
+        // Before the sweep touches the book. Self-trade maker cancels are not
+        // journaled: replay re-derives them from this record.
+        record_journal(JournalOp::Match, order);
+        bool self_trade = false;
+        const uint64_t filled = sweep<Resting>(order, limit, on_fill, self_trade);
+        if (filled == order.quantity) {
+            return MatchResult{filled, MatchStatus::Filled};
+        }
+        if (BOOK_UNLIKELY(self_trade)) {
+            return MatchResult{filled, MatchStatus::Cancelled, RejectReason::SelfTrade};
+        }
+
+        if constexpr (Type == OrderType::Market || Tif != TimeInForce::GoodTillCancel) {
+            return MatchResult{filled, MatchStatus::Cancelled};
+        } else {
+            // Rest only the remainder
+            Order remainder = order;
+            remainder.quantity -= filled;
+            rest_order<S>(remainder, limit);
+            return MatchResult{filled, MatchStatus::Rested};
+        }
+    }
+}
+
+template <OrderType Type, Side S>
+RejectReason OrderBook::pre_trade_check(const Order& order, Ticks& limit) const {
+    const auto& resting = levels<SideTraits<S>::opposite>();
+    const bool has_best = !resting.empty();
+    const Ticks best = has_best ? resting.begin()->first : 0;
+
+    if (config_.price_band_ticks > 0 && has_best) {
+        // Furthest price the band lets this order trade at
+        const Ticks edge = SideTraits<S>::is_buy ? best + config_.price_band_ticks : best - config_.price_band_ticks;
+        if constexpr (Type == OrderType::Market) {
+            limit = edge;
+        } else if (SideTraits<S>::better(limit, edge)) {
+            return RejectReason::PriceBand;
+        }
+    }
+
+    if (config_.risk) {
+        const AccountLimits& limits = config_.risk->limits(order.account);
+        if (order.quantity > limits.max_quantity) return RejectReason::OrderQuantity;
+        // A market order is valued at its band edge, or the opposite best without a band
+        double price = order.price;
+        if constexpr (Type == OrderType::Market) {
+            price = !has_best ? 0.0 : ticks_.to_price(config_.price_band_ticks > 0 ? limit : best);
+        }
+        if (price * static_cast<double>(order.quantity) > limits.max_notional) return RejectReason::Notional;
+    }
+    return RejectReason::None;
+}
+
+template <Side S>
+bool OrderBook::crosses(Ticks limit) const {
+    const auto& resting = levels<S>();
+    return !resting.empty() && SideTraits<S>::crossed_by(resting.begin()->first, limit);
+}
+
+template <Side S>
+uint64_t OrderBook::available(const Order& order, Ticks limit, uint64_t wanted) const {
+    const auto& resting = levels<S>();
+    uint64_t total = 0;
+    if (BOOK_UNLIKELY(self_trade_checked(order))) {
+        // Own orders never fill it: skipped when they would be cancelled on
+        // the way, and the end of the walk when they would stop the sweep
+        const bool skip_own = config_.self_trade == SelfTradePrevention::CancelMaker;
+        for (auto it = resting.begin(); it != resting.end() && total < wanted; ++it) {
+            if (!SideTraits<S>::crossed_by(it->first, limit)) break;
+            for (OrderHandle slot = it->second.orders.head; slot != kNullOrder; slot = pool_[slot].next) {
+                if (pool_.cold(slot).account == order.account) {
+                    if (skip_own) continue;
+                    return total;
+                }
+                total += pool_[slot].quantity;
+            }
+        }
+        return total;
+    }
+    for (auto it = resting.begin(); it != resting.end() && total < wanted; ++it) {
+        if (!SideTraits<S>::crossed_by(it->first, limit)) {
+            break;
+        }
+        total += it->second.total_quantity;
+    }
+    return total;
+}
+
+template <Side S, typename OnFill>
+uint64_t OrderBook::sweep(const Order& order, Ticks limit, OnFill& on_fill, bool& self_trade) {
+    constexpr bool is_buy = SideTraits<S>::is_buy;
+    auto& resting = levels<S>();
+    const bool check_self = self_trade_checked(order);
+    uint64_t remaining = order.quantity;
+    while (remaining > 0 && !self_trade && crosses<S>(limit)) {
+        auto price_it = resting.begin();
+        PriceLevelData& price_level = price_it->second;
+        const double price = ticks_.to_price(price_level.price);
+        const uint64_t level_before = price_level.total_quantity;
+
+        // Walk the FIFO queue, filling makers in time priority
+        while (remaining > 0 && !price_level.orders.empty()) {
+            const OrderHandle slot = price_level.orders.head;
+            OrderNode& maker = pool_[slot];
+            if (check_self && BOOK_UNLIKELY(pool_.cold(slot).account == order.account)) {
+                if (config_.self_trade != SelfTradePrevention::CancelTaker) {
+                    // Cancel the own resting order
+                    emit(BookEventType::OrderCancel, is_buy, price_level.price, maker.quantity, maker.order_id);
+                    queue_reduce(price_level, slot, maker.quantity);
+                    price_level.total_quantity -= maker.quantity;
+                    order_lookup_.erase(maker.order_id);
+                    price_level.orders.unlink(pool_, slot);
+                    owner_unlink(slot);
+                    expiry_cancel(slot);
+                    pool_.release(slot);
+                }
+                if (config_.self_trade != SelfTradePrevention::CancelMaker) {
+                    self_trade = true;
+                    break;
+                }
+                continue;
+            }
+            const uint64_t quantity = remaining < maker.quantity ? remaining : maker.quantity;
+
+            queue_reduce(price_level, slot, quantity);
+            maker.quantity -= quantity;
+            price_level.total_quantity -= quantity;
+            remaining -= quantity;
+            on_fill(Fill{order.order_id, maker.order_id, price, quantity});
+            if (trades_.enabled()) trades_.record(order.timestamp_ns, price_level.price, quantity);
+            emit(BookEventType::OrderExecute, is_buy, price_level.price, quantity, maker.order_id);
+
+            if (maker.quantity == 0) {
+                order_lookup_.erase(maker.order_id);
+                price_level.orders.unlink(pool_, slot);
+                owner_unlink(slot);
+                expiry_cancel(slot);
+                pool_.release(slot);
+            }
+        }
+
+        // If the price level is now empty, remove it
+        if (price_level.orders.empty()) {
+            const Ticks level_price = price_level.price;
+            resting.erase(price_it);
+            level_erased<S>(level_price);
+        } else if (price_level.total_quantity != level_before) {
+            level_changed<S>(price_level);
+        }
+    }
+    return order.quantity - remaining;
+}
@@ -0,0 +1,464 @@
+// OrderBook microbenchmark: parameterized sweeps of book shape and flow,
+// with warmup, CPU pinning, hardware counters and machine-readable output.
+//
+// Usage: order_book_bench [--depth D,...] [--per-level N,...] [--cancel R,...] [--dist uniform|touch,...]
+//                         [--ops N] [--warmup N] [--repeat N] [--cpu N] [--seed S] [--format table|csv|json]
+//   --depth       Price levels per side the flow rests on        (default 10,100,1000)
+//   --per-level   Resting orders per level at the start            (default 1,10)
+//   --cancel      Share of operations that are cancels             (default 0.2,0.5,0.8)
+//   --dist        Where adds land: uniform over the levels, or
+//                 geometric from the touch                         (default uniform,touch)
+//   --ops         Timed operations per case                        (default 1000000)
+//   --warmup N    Untimed passes over the same flow first          (default 1)
+//   --repeat N    Timed measurements per case, one row each        (default 1)
+//   --cpu N       Pin to CPU N                                     (default unpinned)
+//   --format      table for people; csv or json (one object per line) to track over time
+//
+// Every case replays a flow generated up front, so nothing but book calls
+// runs inside the timed loop. Each measurement is two passes on fresh
+// books: one back to back for throughput and perf_event counters (cycles,
+// instructions, cache, branch and L1I misses per op), one timing each
+// call with rdtsc for the latency percentiles. A build configured with
+// -DORDERBOOK_BRANCH_HINTS=OFF runs the same cases without the hot/cold
+// annotations, for an A/B of branch and I-cache misses.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "book_manager.h"
+#include "book_metrics.h"
+#include "latency_histogram.h"
+#include "order_book.h"
+
+namespace {
+
+#ifdef ORDERBOOK_NO_BRANCH_HINTS
+constexpr bool kBranchHints = false;
+#else
+constexpr bool kBranchHints = true;
+#endif
+
+enum class PriceDist { Uniform, Touch };
+
+enum class Format { Table, Csv, Json };
+
+struct BenchConfig {
+    std::vector<size_t> depths{10, 100, 1000};
+    std::vector<size_t> per_level{1, 10};
+    std::vector<double> cancel_ratios{0.2, 0.5, 0.8};
+    std::vector<PriceDist> dists{PriceDist::Uniform, PriceDist::Touch};
+    uint64_t ops = 1000000;
+    int warmup = 1;
+    int repeat = 1;
+    int cpu = -1;
+    uint64_t seed = 2027;
+    Format format = Format::Table;
+};
+
+struct BenchCase {
+    size_t depth;
+    size_t per_level;
+    double cancel_ratio;
+    PriceDist dist;
+};
+
+const char* dist_name(PriceDist dist) {
+    return dist == PriceDist::Uniform ? "uniform" : "touch";
+}
+
+std::string case_name(const BenchCase& c) {
+    char name[96];
+    std::snprintf(name, sizeof(name), "depth=%zu/per_level=%zu/cancel=%.2f/dist=%s", c.depth, c.per_level,
+                  c.cancel_ratio, dist_name(c.dist));
+    return name;
+}
+
+// Initial book and the operations to replay over it
+struct Workload {
+    std::vector<Order> initial;
+    std::vector<BookOp> ops;
+    uint64_t by_type[3] = {0, 0, 0}; // Add, Cancel, Amend
+};
+
+constexpr double kMid = 100.0;
+constexpr double kTick = 0.01;
+
+// Live orders tracked while generating, with O(1) random picks
+class LiveSet {
+public:
+    struct Entry {
+        uint64_t id;
+        size_t level;
+        bool is_buy;
+    };
+
+    size_t size() const { return entries_.size(); }
+
+    void add(const Entry& entry) {
+        positions_[entry.id] = entries_.size();
+        entries_.push_back(entry);
+    }
+
+    Entry& pick(std::mt19937_64& rng) { return entries_[rng() % entries_.size()]; }
+
+    void remove(uint64_t id) {
+        const size_t position = positions_[id];
+        positions_.erase(id);
+        if (position + 1 != entries_.size()) {
+            entries_[position] = entries_.back();
+            positions_[entries_[position].id] = position;
+        }
+        entries_.pop_back();
+    }
+
+private:
+    std::vector<Entry> entries_;
+    std::unordered_map<uint64_t, size_t> positions_;
+};
+
+double level_price(size_t level, bool is_buy) {
+    const double offset = static_cast<double>(level + 1) * kTick;
+    return is_buy ? kMid - offset : kMid + offset;
+}
+
+Workload make_workload(const BenchCase& c, uint64_t ops, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<size_t> uniform_level(0, c.depth - 1);
+    std::geometric_distribution<size_t> touch_level(std::min(1.0, 4.0 / static_cast<double>(c.depth)));
+    auto pick_level = [&] {
+        if (c.dist == PriceDist::Uniform) return uniform_level(rng);
+        return std::min(touch_level(rng), c.depth - 1);
+    };
+
+    Workload workload;
+    LiveSet live;
+    uint64_t next_id = 1;
+    uint64_t timestamp = 1;
+    for (size_t level = 0; level < c.depth; level++) {
+        for (size_t i = 0; i < 2 * c.per_level; i++) {
+            const bool is_buy = i % 2 == 0;
+            workload.initial.push_back({next_id, is_buy, level_price(level, is_buy), 100, timestamp++});
+            live.add({next_id++, level, is_buy});
+        }
+    }
+
+    // Hold the book near its starting size; inside the band the mix is as asked
+    const size_t target = live.size();
+    const size_t low = target - target / 4;
+    const size_t high = target + target / 4;
+    const double amend_ratio = (1.0 - c.cancel_ratio) * 0.2;
+    workload.ops.reserve(ops);
+    for (uint64_t i = 0; i < ops; i++) {
+        const double dice = unit(rng);
+        BookOp op{};
+        if (live.size() > low && (live.size() >= high || dice < c.cancel_ratio)) {
+            const LiveSet::Entry entry = live.pick(rng);
+            op.type = BookOpType::Cancel;
+            op.order.order_id = entry.id;
+            live.remove(entry.id);
+        } else if (live.size() > low && dice < c.cancel_ratio + amend_ratio) {
+            LiveSet::Entry& entry = live.pick(rng);
+            entry.level = pick_level();
+            op.type = BookOpType::Amend;
+            op.order = {entry.id, entry.is_buy, level_price(entry.level, entry.is_buy), 50 + rng() % 100, 0};
+        } else {
+            const bool is_buy = rng() & 1;
+            const size_t level = pick_level();
+            op.type = BookOpType::Add;
+            op.order = {next_id, is_buy, level_price(level, is_buy), 100, timestamp++};
+            live.add({next_id++, level, is_buy});
+        }
+        workload.by_type[static_cast<size_t>(op.type)]++;
+        workload.ops.push_back(op);
+    }
+    return workload;
+}
+
+// Per-thread hardware counters through perf_event_open. Each event is its
+// own fd so one the PMU (or a VM) lacks only blanks that column.
+class PerfCounters {
+public:
+    static constexpr size_t kEvents = 5;
+
+    PerfCounters() {
+        // L1I read misses show what hot/cold layout (branch_hints.h) buys
+        const uint64_t icache_misses = PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const uint32_t types[kEvents] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                         PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE};
+        const uint64_t configs[kEvents] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                           PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+                                           icache_misses};
+        for (size_t i = 0; i < kEvents; i++) {
+            perf_event_attr attr{};
+            attr.type = types[i];
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds_[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds_) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    void start() {
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    // values[i] = -1 where event i is unavailable
+    void stop(double (&values)[kEvents]) {
+        for (size_t i = 0; i < kEvents; i++) {
+            values[i] = -1.0;
+            if (fds_[i] < 0) continue;
+            ::ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t count = 0;
+            if (::read(fds_[i], &count, sizeof(count)) == sizeof(count)) values[i] = static_cast<double>(count);
+        }
+    }
+
+private:
+    int fds_[kEvents];
+};
+
+struct Measurement {
+    double ns_per_op = 0.0;
+    double counters[PerfCounters::kEvents]; // Per op; -1 = unavailable
+    LatencyHistogram all;                   // Cycles
+    LatencyHistogram by_type[3];
+};
+
+OrderBook fresh_book(const Workload& workload) {
+    OrderBookConfig config;
+    config.order_capacity = workload.initial.size() * 2 + 1024;
+    OrderBook book(config);
+    for (const Order& order : workload.initial) book.add_order(order);
+    return book;
+}
+
+double run_back_to_back(const Workload& workload, PerfCounters* perf, double (&counters)[PerfCounters::kEvents]) {
+    OrderBook book = fresh_book(workload);
+    if (perf) perf->start();
+    const uint64_t start = tsc_begin();
+    for (const BookOp& op : workload.ops) book.apply(op);
+    const uint64_t stop = tsc_end();
+    if (perf) perf->stop(counters);
+    return static_cast<double>(stop - start);
+}
+
+void measure(const Workload& workload, PerfCounters& perf, Measurement& result) {
+    const double ops = static_cast<double>(workload.ops.size());
+    const double cycles = run_back_to_back(workload, &perf, result.counters);
+    result.ns_per_op = cycles / tsc_ticks_per_ns() / ops;
+    for (double& counter : result.counters) {
+        if (counter >= 0) counter /= ops;
+    }
+
+    OrderBook book = fresh_book(workload);
+    for (const BookOp& op : workload.ops) {
+        const uint64_t start = tsc_begin();
+        book.apply(op);
+        const uint64_t elapsed = tsc_end() - start;
+        result.all.record(elapsed);
+        result.by_type[static_cast<size_t>(op.type)].record(elapsed);
+    }
+}
+
+double ns(uint64_t cycles) {
+    return static_cast<double>(cycles) / tsc_ticks_per_ns();
+}
+
+const char* kColumns = "benchmark,repeat,ops,ns_per_op,mops,p50_ns,p99_ns,p999_ns,max_ns,add_p50_ns,cancel_p50_ns,"
+                       "amend_p50_ns,add_p99_ns,cancel_p99_ns,amend_p99_ns,cycles_per_op,instructions_per_op,"
+                       "cache_misses_per_op,branch_misses_per_op,icache_misses_per_op";
+
+void print_row(const BenchConfig& config, const BenchCase& c, int repeat, const Workload& workload,
+               const Measurement& m) {
+    const std::string name = case_name(c);
+    const double mops = 1e3 / m.ns_per_op;
+    if (config.format == Format::Table) {
+        std::printf("%-48s %7.1f %7.2f %7.0f %7.0f %8.0f %7.0f %7.0f %7.0f", name.c_str(), m.ns_per_op, mops,
+                    ns(m.all.percentile(50)), ns(m.all.percentile(99)), ns(m.all.percentile(99.9)),
+                    ns(m.by_type[0].percentile(50)), ns(m.by_type[1].percentile(50)),
+                    ns(m.by_type[2].percentile(50)));
+        for (double counter : m.counters) {
+            if (counter < 0) {
+                std::printf(" %8s", "-");
+            } else {
+                std::printf(" %8.2f", counter);
+            }
+        }
+        std::printf("\n");
+        return;
+    }
+
+    const double values[] = {m.ns_per_op, mops, ns(m.all.percentile(50)), ns(m.all.percentile(99)),
+                             ns(m.all.percentile(99.9)), ns(m.all.max()), ns(m.by_type[0].percentile(50)),
+                             ns(m.by_type[1].percentile(50)), ns(m.by_type[2].percentile(50)),
+                             ns(m.by_type[0].percentile(99)), ns(m.by_type[1].percentile(99)),
+                             ns(m.by_type[2].percentile(99)), m.counters[0], m.counters[1], m.counters[2],
+                             m.counters[3], m.counters[4]};
+    if (config.format == Format::Csv) {
+        std::printf("%s,%d,%zu", name.c_str(), repeat, workload.ops.size());
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+            if (values[i] < 0) {
+                std::printf(",");
+            } else {
+                std::printf(",%.3f", values[i]);
+            }
+        }
+        std::printf("\n");
+        return;
+    }
+
+    // JSON: the CSV columns as keys, unavailable counters as null
+    std::printf("{\"benchmark\":\"%s\",\"depth\":%zu,\"per_level\":%zu,\"cancel_ratio\":%.2f,\"dist\":\"%s\","
+                "\"hints\":%s,\"repeat\":%d,\"ops\":%zu,\"mix\":{\"add\":%llu,\"cancel\":%llu,\"amend\":%llu}",
+                name.c_str(), c.depth, c.per_level, c.cancel_ratio, dist_name(c.dist),
+                kBranchHints ? "true" : "false", repeat, workload.ops.size(),
+                static_cast<unsigned long long>(workload.by_type[0]),
+                static_cast<unsigned long long>(workload.by_type[1]),
+                static_cast<unsigned long long>(workload.by_type[2]));
+    const char* columns = std::strstr(kColumns, "ns_per_op");
+    for (double value : values) {
+        const char* comma = std::strchr(columns, ',');
+        const int length = comma ? static_cast<int>(comma - columns) : static_cast<int>(std::strlen(columns));
+        if (value < 0) {
+            std::printf(",\"%.*s\":null", length, columns);
+        } else {
+            std::printf(",\"%.*s\":%.3f", length, columns, value);
+        }
+        columns = comma ? comma + 1 : columns + length;
+    }
+    std::printf("}\n");
+}
+
+template <typename T, typename Parse>
+bool parse_list(const char* text, std::vector<T>& out, Parse parse) {
+    out.clear();
+    std::string list = text;
+    size_t start = 0;
+    while (start <= list.size()) {
+        const size_t comma = std::min(list.find(',', start), list.size());
+        T value;
+        if (!parse(list.substr(start, comma - start), value)) return false;
+        out.push_back(value);
+        start = comma + 1;
+    }
+    return !out.empty();
+}
+
+bool parse_args(int argc, char** argv, BenchConfig& config) {
+    auto parse_size = [](const std::string& text, size_t& value) {
+        value = std::strtoull(text.c_str(), nullptr, 10);
+        return value > 0;
+    };
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        bool ok = has_value;
+        if (arg == "--depth" && has_value) {
+            ok = parse_list(argv[++i], config.depths, parse_size);
+        } else if (arg == "--per-level" && has_value) {
+            ok = parse_list(argv[++i], config.per_level, parse_size);
+        } else if (arg == "--cancel" && has_value) {
+            ok = parse_list(argv[++i], config.cancel_ratios, [](const std::string& text, double& value) {
+                value = std::strtod(text.c_str(), nullptr);
+                return value >= 0.0 && value < 1.0;
+            });
+        } else if (arg == "--dist" && has_value) {
+            ok = parse_list(argv[++i], config.dists, [](const std::string& text, PriceDist& value) {
+                value = text == "touch" ? PriceDist::Touch : PriceDist::Uniform;
+                return text == "touch" || text == "uniform";
+            });
+        } else if (arg == "--ops" && has_value) {
+            config.ops = std::strtoull(argv[++i], nullptr, 10);
+            ok = config.ops > 0;
+        } else if (arg == "--warmup" && has_value) {
+            config.warmup = std::atoi(argv[++i]);
+        } else if (arg == "--repeat" && has_value) {
+            config.repeat = std::atoi(argv[++i]);
+            ok = config.repeat > 0;
+        } else if (arg == "--cpu" && has_value) {
+            config.cpu = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--format" && has_value) {
+            const std::string format = argv[++i];
+            config.format = format == "csv" ? Format::Csv : format == "json" ? Format::Json : Format::Table;
+            ok = format == "csv" || format == "json" || format == "table";
+        } else {
+            ok = false;
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!parse_args(argc, argv, config)) {
+        std::fprintf(stderr,
+                     "usage: %s [--depth D,...] [--per-level N,...] [--cancel R,...] [--dist uniform|touch,...]\n"
+                     "          [--ops N] [--warmup N] [--repeat N] [--cpu N] [--seed S] [--format table|csv|json]\n",
+                     argv[0]);
+        return 1;
+    }
+    if (config.cpu >= 0 && !pin_current_thread(config.cpu)) {
+        std::fprintf(stderr, "cannot pin to cpu %d\n", config.cpu);
+        return 1;
+    }
+
+    PerfCounters perf;
+    tsc_ticks_per_ns(); // Calibrate before anything is timed
+    if (config.format == Format::Table) {
+        std::printf("%llu ops per case, %d warmup pass(es), cpu %d, TSC %.3f GHz, branch hints %s\n\n",
+                    static_cast<unsigned long long>(config.ops), config.warmup, config.cpu, tsc_ticks_per_ns(),
+                    kBranchHints ? "on" : "off");
+        std::printf("%-48s %7s %7s %7s %7s %8s %7s %7s %7s %8s %8s %8s %8s %8s\n", "benchmark", "ns/op", "Mop/s",
+                    "p50", "p99", "p99.9", "add50", "cxl50", "amd50", "cyc/op", "ins/op", "cmiss", "bmiss",
+                    "imiss");
+    } else if (config.format == Format::Csv) {
+        std::printf("%s\n", kColumns);
+    }
+
+    for (size_t depth : config.depths) {
+        for (size_t per_level : config.per_level) {
+            for (double cancel_ratio : config.cancel_ratios) {
+                for (PriceDist dist : config.dists) {
+                    const BenchCase c{depth, per_level, cancel_ratio, dist};
+                    const Workload workload = make_workload(c, config.ops, config.seed);
+                    double ignored[PerfCounters::kEvents];
+                    for (int i = 0; i < config.warmup; i++) run_back_to_back(workload, nullptr, ignored);
+                    for (int repeat = 0; repeat < config.repeat; repeat++) {
+                        Measurement measurement;
+                        measure(workload, perf, measurement);
+                        print_row(config, c, repeat, workload, measurement);
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
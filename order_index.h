@@ -0,0 +1,268 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "branch_hints.h"
+
+// How an OrderIdIndex maps external order ids to slots
+enum class OrderIdIndexMode : uint8_t {
+    Hashed, // Robin Hood open addressing; any id distribution
+    Direct  // ids are dense and increasing from a base; slot = id - base
+};
+
+// Direct mode keeps a window of slots over the live ids. An id past its
+// end first slides the window up over slots that have emptied (ids only
+// increase, so the oldest end drains), then grows it while the live span
+// stays within kDirectSpanFactor x max(capacity, live entries). An id below
+// the window, or a span too sparse to index directly, switches the index
+// to Hashed for good, so memory follows the live ids, not the largest one.
+inline constexpr size_t kDirectSpanFactor = 2;
+
+// Flat order-id -> Value table with no per-entry allocation.
+// Hashed mode uses Robin Hood linear probing with backward-shift deletion,
+// so cancels never leave tombstones and the table never needs a cleanup
+// rehash. The table is presized to keep load under 50% at the configured
+// capacity; growing past that is a fallback that happens off the hot path.
+template <typename Value>
+class OrderIdIndex {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit OrderIdIndex(size_t capacity = 0,
+                          OrderIdIndexMode mode = OrderIdIndexMode::Hashed,
+                          uint64_t direct_base = 0)
+        : mode_(mode)
+        , base_(direct_base)
+        , capacity_(capacity) {
+        if (mode_ == OrderIdIndexMode::Direct) {
+            slots_.resize(capacity);
+        } else {
+            resize_hashed(capacity * 2);
+        }
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    OrderIdIndexMode mode() const { return mode_; }
+
+    // The slot table, e.g. to mlock it
+    const void* data() const { return slots_.data(); }
+    size_t bytes() const { return slots_.size() * sizeof(Slot); }
+
+    // Slot holding id, or npos
+    size_t find(uint64_t id) const {
+        if (mode_ == OrderIdIndexMode::Direct) {
+            const uint64_t slot = id - base_;
+            return (slot < slots_.size() && slots_[slot].dist != 0) ? slot : npos;
+        }
+        size_t slot = home(id);
+        for (uint32_t dist = 1;; ++dist) {
+            const Slot& s = slots_[slot];
+            // An entry closer to its home than we are means id is absent
+            if (s.dist < dist) return npos;
+            if (s.key == id) return slot;
+            slot = (slot + 1) & mask_;
+        }
+    }
+
+    // Pull the slot id would probe first into cache ahead of a find()
+    void prefetch(uint64_t id) const {
+        size_t slot = mode_ == OrderIdIndexMode::Direct ? static_cast<size_t>(id - base_) : home(id);
+        if (slot < slots_.size()) {
+            __builtin_prefetch(&slots_[slot]);
+        }
+    }
+
+    Value& value_at(size_t slot) { return slots_[slot].value; }
+    const Value& value_at(size_t slot) const { return slots_[slot].value; }
+
+    Value* get(uint64_t id) {
+        size_t slot = find(id);
+        return slot == npos ? nullptr : &slots_[slot].value;
+    }
+
+    // Insert or overwrite the entry for id
+    void insert(uint64_t id, const Value& value) {
+        if (mode_ == OrderIdIndexMode::Direct) {
+            uint64_t slot = id - base_;
+            if (BOOK_UNLIKELY(id < base_ || slot >= slots_.size()) && !make_direct_room(id)) {
+                insert(id, value); // Now hashed
+                return;
+            }
+            slot = id - base_;
+            low_ = std::min<size_t>(low_, slot);
+            Slot& s = slots_[slot];
+            size_ += (s.dist == 0);
+            s.key = id;
+            s.dist = 1;
+            s.value = value;
+            return;
+        }
+
+        if (BOOK_UNLIKELY((size_ + 1) * 2 > slots_.size())) {
+            resize_hashed(slots_.size() * 2);
+        }
+
+        Slot incoming{id, 1, value};
+        size_t slot = home(id);
+        bool displaced = false;
+        for (;;) {
+            Slot& s = slots_[slot];
+            if (s.dist == 0) {
+                s = incoming;
+                ++size_;
+                return;
+            }
+            if (!displaced && s.key == id) {
+                s.value = incoming.value;
+                return;
+            }
+            // Robin Hood: the entry further from home keeps the slot
+            if (s.dist < incoming.dist) {
+                std::swap(s, incoming);
+                displaced = true;
+            }
+            slot = (slot + 1) & mask_;
+            ++incoming.dist;
+        }
+    }
+
+    // Make room for capacity entries without growing in between
+    void reserve(size_t capacity) {
+        capacity_ = std::max(capacity_, capacity);
+        if (mode_ == OrderIdIndexMode::Direct) {
+            if (capacity > slots_.size()) slots_.resize(capacity);
+        } else if (capacity * 2 > slots_.size()) {
+            resize_hashed(capacity * 2);
+        }
+    }
+
+    // Bulk-load insert: id must be absent and reserve() must cover it, so
+    // there is no load check and no key compare on the probe
+    void insert_new(uint64_t id, const Value& value) {
+        if (mode_ == OrderIdIndexMode::Direct) {
+            insert(id, value);
+            return;
+        }
+        Slot incoming{id, 1, value};
+        size_t slot = home(id);
+        for (;;) {
+            Slot& s = slots_[slot];
+            if (s.dist == 0) {
+                s = incoming;
+                ++size_;
+                return;
+            }
+            if (s.dist < incoming.dist) std::swap(s, incoming);
+            slot = (slot + 1) & mask_;
+            ++incoming.dist;
+        }
+    }
+
+    // Remove the entry at a slot returned by find()
+    void erase_at(size_t slot) {
+        --size_;
+        if (mode_ == OrderIdIndexMode::Direct) {
+            slots_[slot].dist = 0;
+            return;
+        }
+        // Backward-shift the rest of the probe run into the hole
+        size_t next = (slot + 1) & mask_;
+        while (slots_[next].dist > 1) {
+            slots_[slot] = slots_[next];
+            --slots_[slot].dist;
+            slot = next;
+            next = (next + 1) & mask_;
+        }
+        slots_[slot].dist = 0;
+    }
+
+    bool erase(uint64_t id) {
+        size_t slot = find(id);
+        if (slot == npos) return false;
+        erase_at(slot);
+        return true;
+    }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        uint32_t dist = 0; // 1 + distance from home slot; 0 = empty
+        Value value{};
+    };
+
+    // Fibonacci hashing spreads sequential ids across the table
+    size_t home(uint64_t id) const {
+        return static_cast<size_t>((id * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    // Growth paths: only reached past the presized capacity
+
+    // Bring id inside the direct window by sliding it or growing it
+    // @return false if the index switched to Hashed instead
+    BOOK_COLD bool make_direct_room(uint64_t id) {
+        if (size_ == 0) {
+            base_ = id;
+            low_ = 0;
+            if (slots_.empty()) slots_.resize(std::max<size_t>(capacity_, 1));
+            return true;
+        }
+        if (id < base_) return to_hashed();
+
+        while (slots_[low_].dist == 0) ++low_; // size_ > 0: a live slot exists
+        const uint64_t span = id - (base_ + low_) + 1;
+        if (span > kDirectSpanFactor * std::max(capacity_, size_ + 1)) return to_hashed();
+
+        // Slide down over the drained slots; resize too unless that alone
+        // freed a real share of the window. Either leaves room for as many
+        // ids again as it took to get here, so the cost amortizes.
+        const bool slide_only = span <= slots_.size() && low_ >= slots_.size() / 4;
+        if (low_ > 0) {
+            std::move(slots_.begin() + low_, slots_.end(), slots_.begin());
+            std::fill(slots_.end() - low_, slots_.end(), Slot{});
+            base_ += low_;
+            low_ = 0;
+        }
+        if (!slide_only) {
+            slots_.resize(std::max<size_t>(capacity_, 2 * span));
+            slots_.shrink_to_fit();
+        }
+        return true;
+    }
+
+    BOOK_COLD bool to_hashed() {
+        mode_ = OrderIdIndexMode::Hashed;
+        resize_hashed(std::max(capacity_, size_ + 1) * 2); // Rehashes the live direct slots
+        return false;
+    }
+
+    BOOK_COLD void resize_hashed(size_t min_slots) {
+        size_t count = 16;
+        unsigned bits = 4;
+        while (count < min_slots) {
+            count <<= 1;
+            ++bits;
+        }
+
+        std::vector<Slot> old(count);
+        old.swap(slots_);
+        mask_ = count - 1;
+        shift_ = 64 - bits;
+        size_ = 0;
+        for (const Slot& s : old) {
+            if (s.dist != 0) insert(s.key, s.value);
+        }
+    }
+
+    OrderIdIndexMode mode_;
+    uint64_t base_;
+    size_t capacity_;
+    size_t low_ = 0; // Direct: every slot below it is empty
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+    size_t mask_ = 0;
+    unsigned shift_ = 64;
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "branch_hints.h"
+
+// 32-bit handle of an order slot inside an OrderPool
+using OrderHandle = uint32_t;
+constexpr OrderHandle kNullOrder = UINT32_MAX;
+
+// Slots one pool may hold: every handle below kNullOrder, or 2^31 in compact
+// builds, where an id-index entry packs the side into the handle's top bit.
+// A pool sized or grown past it throws rather than hand out a handle that
+// would alias kNullOrder or the side bit.
+#ifdef ORDERBOOK_COMPACT_ORDERS
+constexpr size_t kMaxOrderCapacity = size_t{1} << 31;
+#else
+constexpr size_t kMaxOrderCapacity = kNullOrder;
+#endif
+
+// @throw std::length_error if slots exceeds the handle space
+inline size_t checked_order_capacity(size_t slots) {
+    if (slots > kMaxOrderCapacity) throw std::length_error("order capacity exceeds the 32-bit handle space");
+    return slots;
+}
+
+// Placeholder for pools without cold per-node data
+struct NoColdData {};
+
+// Slab of fixed-size nodes with a bump pointer and an intrusive free list.
+// Like the MemoryPool in L5/memory_allocator.cpp, but released slots are
+// reused (LIFO, so the most recently freed and still cache-warm slot goes
+// out first). The slab only grows when the configured capacity is exceeded.
+//
+// Cold holds rarely-read per-node fields in a parallel array indexed by the
+// same handle, so they never share cache lines with the hot nodes.
+template <typename Node, typename Cold = NoColdData>
+class NodePool {
+public:
+    // @throw std::length_error if capacity exceeds kMaxOrderCapacity
+    explicit NodePool(size_t capacity = 0) : nodes_(checked_order_capacity(capacity)) {
+        if constexpr (!std::is_empty_v<Cold>) {
+            cold_.resize(capacity);
+        }
+    }
+
+    // Take a slot; contents are left for the caller to initialise
+    OrderHandle allocate() {
+        if (BOOK_LIKELY(free_head_ != kNullOrder)) {
+            OrderHandle handle = free_head_;
+            free_head_ = nodes_[handle].next;
+            ++in_use_;
+            return handle;
+        }
+        if (BOOK_UNLIKELY(bump_ == nodes_.size())) {
+            grow();
+        }
+        ++in_use_;
+        return static_cast<OrderHandle>(bump_++);
+    }
+
+    // Take count consecutive slots from the bump region, growing once if
+    // needed; used to rebuild a book in bulk. @return the first handle
+    // @throw std::length_error past kMaxOrderCapacity
+    OrderHandle allocate_run(size_t count) {
+        if (bump_ + count > nodes_.size()) {
+            nodes_.resize(checked_order_capacity(bump_ + count));
+            if constexpr (!std::is_empty_v<Cold>) {
+                cold_.resize(nodes_.size());
+            }
+        }
+        const OrderHandle first = static_cast<OrderHandle>(bump_);
+        bump_ += count;
+        in_use_ += count;
+        return first;
+    }
+
+    // Return a slot to the free list
+    void release(OrderHandle handle) {
+        nodes_[handle].next = free_head_;
+        free_head_ = handle;
+        --in_use_;
+    }
+
+    Node& operator[](OrderHandle handle) { return nodes_[handle]; }
+    const Node& operator[](OrderHandle handle) const { return nodes_[handle]; }
+
+    Cold& cold(OrderHandle handle) { return cold_[handle]; }
+    const Cold& cold(OrderHandle handle) const { return cold_[handle]; }
+
+    // Number of live slots
+    size_t size() const { return in_use_; }
+
+    // Start of the slab; moves when the pool grows
+    const Node* data() const { return nodes_.data(); }
+
+    // Call fn(pointer, bytes) for the slab and the cold array, e.g. to mlock them
+    template <typename Fn>
+    void for_each_region(Fn&& fn) const {
+        fn(static_cast<const void*>(nodes_.data()), nodes_.size() * sizeof(Node));
+        if constexpr (!std::is_empty_v<Cold>) {
+            fn(static_cast<const void*>(cold_.data()), cold_.size() * sizeof(Cold));
+        }
+    }
+
+    // Number of slots available without growing
+    size_t capacity() const { return nodes_.size(); }
+
+private:
+    // Capacity exceeded: grow off the steady-state path, up to the handle space
+    BOOK_COLD void grow() {
+        const size_t grown = nodes_.empty() ? 64 : nodes_.size() * 2;
+        nodes_.resize(grown < kMaxOrderCapacity ? grown : checked_order_capacity(std::max(nodes_.size() + 1, kMaxOrderCapacity)));
+        if constexpr (!std::is_empty_v<Cold>) {
+            cold_.resize(nodes_.size());
+        }
+    }
+
+    std::vector<Node> nodes_;
+    std::vector<Cold> cold_;
+    size_t bump_ = 0;
+    size_t in_use_ = 0;
+    OrderHandle free_head_ = kNullOrder;
+};
+
+// Doubly-linked FIFO threaded through pool nodes by index.
+// Node must expose `prev` and `next` handles.
+struct OrderQueue {
+    OrderHandle head = kNullOrder;
+    OrderHandle tail = kNullOrder;
+
+    bool empty() const { return head == kNullOrder; }
+
+    template <typename Pool>
+    void push_back(Pool& pool, OrderHandle handle) {
+        auto& node = pool[handle];
+        node.prev = tail;
+        node.next = kNullOrder;
+        if (tail != kNullOrder) {
+            pool[tail].next = handle;
+        } else {
+            head = handle;
+        }
+        tail = handle;
+    }
+
+    template <typename Pool>
+    void unlink(Pool& pool, OrderHandle handle) {
+        auto& node = pool[handle];
+        if (node.prev != kNullOrder) {
+            pool[node.prev].next = node.next;
+        } else {
+            head = node.next;
+        }
+        if (node.next != kNullOrder) {
+            pool[node.next].prev = node.prev;
+        } else {
+            tail = node.prev;
+        }
+    }
+};
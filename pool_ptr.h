@@ -0,0 +1,227 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include "arena.h"
+
+// Owning pointers over arena memory, for objects handed between stages
+// (immutable book snapshots, message buffers) without heap churn.
+//
+// UniquePtr<T, Deleter> is a move-only owner whose deleter returns the
+// object to where it came from: ArenaPoolDeleter to an ArenaPool free list,
+// ArenaDeleter to the Arena's per-size free lists. An empty deleter takes
+// no space.
+//
+// IntrusivePtr<T> shares a T derived from RefCounted<T, Count>: the count
+// lives in the object, so there is no separate control block to allocate,
+// and Count picks what sharing costs. LocalCount is a plain integer for
+// objects confined to one thread; AtomicCount makes copies and releases
+// safe across threads. The last release recycles the object the same way
+// a UniquePtr deleter would.
+//
+// ArenaPool is single-threaded, so an object from make_intrusive_in(pool)
+// must drop its last reference on the pool's thread. Share across threads
+// from an Arena with ArenaConfig::thread_safe (its frees take the lock), or
+// from the heap.
+
+template <typename T>
+struct ArenaPoolDeleter {
+    ArenaPool<T>* pool = nullptr;
+    void operator()(T* pointer) const { pool->destroy(pointer); }
+};
+
+template <typename T>
+struct ArenaDeleter {
+    Arena* arena = nullptr;
+    void operator()(T* pointer) const {
+        pointer->~T();
+        arena->deallocate(pointer, sizeof(T));
+    }
+};
+
+template <typename T, typename Deleter = std::default_delete<T>>
+class UniquePtr : private Deleter { // Private base: an empty deleter adds no bytes
+public:
+    UniquePtr() = default;
+    explicit UniquePtr(T* pointer, Deleter deleter = Deleter{}) : Deleter(std::move(deleter)), pointer_(pointer) {}
+    ~UniquePtr() { reset(); }
+
+    UniquePtr(const UniquePtr&) = delete;
+    UniquePtr& operator=(const UniquePtr&) = delete;
+
+    UniquePtr(UniquePtr&& other) noexcept : Deleter(std::move(other.deleter())), pointer_(other.release()) {}
+    UniquePtr& operator=(UniquePtr&& other) noexcept {
+        if (this != &other) {
+            reset(other.release());
+            deleter() = std::move(other.deleter());
+        }
+        return *this;
+    }
+
+    T& operator*() const { return *pointer_; }
+    T* operator->() const { return pointer_; }
+    T* get() const { return pointer_; }
+    explicit operator bool() const { return pointer_ != nullptr; }
+
+    Deleter& deleter() { return *this; }
+    const Deleter& deleter() const { return *this; }
+
+    // Give up ownership without recycling
+    T* release() {
+        T* pointer = pointer_;
+        pointer_ = nullptr;
+        return pointer;
+    }
+
+    // Recycle the current object, if any, and own pointer
+    void reset(T* pointer = nullptr) {
+        T* old = pointer_;
+        pointer_ = pointer;
+        if (old) deleter()(old);
+    }
+
+private:
+    T* pointer_ = nullptr;
+};
+
+// Construct a T in a pool slot; empty if the arena is out of memory
+template <typename T, typename... Args>
+UniquePtr<T, ArenaPoolDeleter<T>> make_unique_in(ArenaPool<T>& pool, Args&&... args) {
+    return UniquePtr<T, ArenaPoolDeleter<T>>(pool.create(std::forward<Args>(args)...), ArenaPoolDeleter<T>{&pool});
+}
+
+// Construct a T in arena memory; empty if the arena is out of memory
+template <typename T, typename... Args>
+UniquePtr<T, ArenaDeleter<T>> make_unique_in(Arena& arena, Args&&... args) {
+    return UniquePtr<T, ArenaDeleter<T>>(arena.create<T>(std::forward<Args>(args)...), ArenaDeleter<T>{&arena});
+}
+
+// Reference count for objects shared by one thread only
+class LocalCount {
+public:
+    void increment() { count_++; }
+    // @return true when the count reaches zero
+    bool decrement() { return --count_ == 0; }
+    uint32_t load() const { return count_; }
+
+private:
+    uint32_t count_ = 0;
+};
+
+// Reference count for objects shared across threads
+class AtomicCount {
+public:
+    // A new reference is always made from an existing one, so it needs no ordering
+    void increment() { count_.fetch_add(1, std::memory_order_relaxed); }
+    // Release publishes this thread's writes; the last owner acquires them
+    // all before recycling
+    bool decrement() { return count_.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    uint32_t load() const { return count_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> count_{0};
+};
+
+template <typename T>
+class IntrusivePtr;
+template <typename T, typename... Args>
+IntrusivePtr<T> make_intrusive_in(ArenaPool<T>& pool, Args&&... args);
+template <typename T, typename... Args>
+IntrusivePtr<T> make_intrusive_in(Arena& arena, Args&&... args);
+
+// Base of objects shared through IntrusivePtr<Derived>
+template <typename Derived, typename Count = AtomicCount>
+class RefCounted {
+public:
+    RefCounted() = default;
+    // A copy is a new object: its count and origin are its own
+    RefCounted(const RefCounted&) {}
+    RefCounted& operator=(const RefCounted&) { return *this; }
+
+    // References held; exact only while no other thread changes it
+    uint32_t use_count() const { return refs_.load(); }
+
+private:
+    template <typename> friend class IntrusivePtr;
+    template <typename T, typename... Args>
+    friend IntrusivePtr<T> make_intrusive_in(ArenaPool<T>& pool, Args&&... args);
+    template <typename T, typename... Args>
+    friend IntrusivePtr<T> make_intrusive_in(Arena& arena, Args&&... args);
+
+    // Where the object goes when the last reference drops; none = delete
+    using Recycler = void (*)(void* origin, Derived* object);
+
+    void add_ref() const { refs_.increment(); }
+    void release_ref() const {
+        if (!refs_.decrement()) return;
+        Derived* object = static_cast<Derived*>(const_cast<RefCounted*>(this));
+        if (recycle_) {
+            recycle_(origin_, object);
+        } else {
+            delete object;
+        }
+    }
+
+    mutable Count refs_;
+    Recycler recycle_ = nullptr;
+    void* origin_ = nullptr;
+};
+
+template <typename T>
+class IntrusivePtr {
+public:
+    IntrusivePtr() = default;
+    // Share an object from new (or one already shared)
+    explicit IntrusivePtr(T* pointer) : pointer_(pointer) {
+        if (pointer_) pointer_->add_ref();
+    }
+    ~IntrusivePtr() {
+        if (pointer_) pointer_->release_ref();
+    }
+
+    IntrusivePtr(const IntrusivePtr& other) : pointer_(other.pointer_) {
+        if (pointer_) pointer_->add_ref();
+    }
+    IntrusivePtr(IntrusivePtr&& other) noexcept : pointer_(other.pointer_) { other.pointer_ = nullptr; }
+    IntrusivePtr& operator=(IntrusivePtr other) noexcept {
+        std::swap(pointer_, other.pointer_);
+        return *this;
+    }
+
+    T& operator*() const { return *pointer_; }
+    T* operator->() const { return pointer_; }
+    T* get() const { return pointer_; }
+    explicit operator bool() const { return pointer_ != nullptr; }
+
+    void reset() { IntrusivePtr().swap(*this); }
+    void swap(IntrusivePtr& other) noexcept { std::swap(pointer_, other.pointer_); }
+
+private:
+    T* pointer_ = nullptr;
+};
+
+// Share a T built in a pool slot; empty if the arena is out of memory
+template <typename T, typename... Args>
+IntrusivePtr<T> make_intrusive_in(ArenaPool<T>& pool, Args&&... args) {
+    T* object = pool.create(std::forward<Args>(args)...);
+    if (!object) return IntrusivePtr<T>();
+    object->recycle_ = [](void* origin, T* dead) { static_cast<ArenaPool<T>*>(origin)->destroy(dead); };
+    object->origin_ = &pool;
+    return IntrusivePtr<T>(object);
+}
+
+// Share a T built in arena memory; empty if the arena is out of memory
+template <typename T, typename... Args>
+IntrusivePtr<T> make_intrusive_in(Arena& arena, Args&&... args) {
+    T* object = arena.create<T>(std::forward<Args>(args)...);
+    if (!object) return IntrusivePtr<T>();
+    object->recycle_ = [](void* origin, T* dead) {
+        dead->~T();
+        static_cast<Arena*>(origin)->deallocate(dead, sizeof(T));
+    };
+    object->origin_ = &arena;
+    return IntrusivePtr<T>(object);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+
+// Fixed-point price expressed as an integer number of ticks
+using Ticks = int64_t;
+
+// PriceLevel represents a price level with aggregated volume
+struct PriceLevel {
+    double price;
+    uint64_t total_quantity;
+};
+
+// Per-instrument tick size; converts between API prices and native ticks.
+// The book only ever compares and hashes Ticks; doubles exist at the API edge.
+class TickScale {
+public:
+    explicit TickScale(double tick_size = 0.01)
+        : tick_size_(tick_size)
+        , ticks_per_unit_(1.0 / tick_size) {}
+
+    double tick_size() const { return tick_size_; }
+
+    // Round a price to the nearest tick
+    Ticks to_ticks(double price) const {
+        return static_cast<Ticks>(std::llround(price * ticks_per_unit_));
+    }
+
+    // Divide rather than multiply so 10007 ticks @ 0.01 gives exactly 100.07
+    double to_price(Ticks ticks) const {
+        return static_cast<double>(ticks) / ticks_per_unit_;
+    }
+
+    // Same for a fractional tick count, such as an average over fills
+    double to_price_fraction(double ticks) const {
+        return ticks / ticks_per_unit_;
+    }
+
+private:
+    double tick_size_;
+    double ticks_per_unit_;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Quantity ahead of each order in one FIFO price level, in O(log n).
+// Orders take increasing sequence numbers as they join the back of the
+// queue, so queue order is sequence order and "quantity ahead" is a prefix
+// sum over a Fenwick tree indexed by sequence. Fills, cancels and amends
+// only subtract at the order's own sequence. Numbers are never reused:
+// when they run out the owner renumbers the live orders from 1 and calls
+// rebuild(), which sizes the tree at twice their count, so joins stay
+// amortised O(log n).
+class QueuePositionIndex {
+public:
+    // No sequence left for another join; rebuild first
+    bool full() const { return next_ >= tree_.size(); }
+
+    // An order of quantity joined the back; @return its sequence number
+    uint32_t append(uint64_t quantity) {
+        const uint32_t sequence = next_++;
+        add(sequence, quantity);
+        return sequence;
+    }
+
+    // quantity left the order with this sequence (fill, cancel, amend down)
+    void reduce(uint32_t sequence, uint64_t quantity) {
+        // Unsigned wrap-around keeps every partial sum exact
+        add(sequence, uint64_t{0} - quantity);
+    }
+
+    // Quantity of the orders that joined before sequence and are still queued
+    uint64_t ahead(uint32_t sequence) const {
+        uint64_t total = 0;
+        for (size_t i = sequence - 1; i > 0; i -= i & (~i + 1)) total += tree_[i];
+        return total;
+    }
+
+    // Renumber: quantities[i] is the (i + 1)-th live order in queue order,
+    // which now holds sequence i + 1. Linear-time Fenwick build.
+    void rebuild(const uint64_t* quantities, size_t count) {
+        const size_t capacity = count * 2 + 2 < kMinCapacity ? kMinCapacity : count * 2 + 2;
+        tree_.assign(capacity + 1, 0);
+        for (size_t i = 0; i < count; i++) tree_[i + 1] = quantities[i];
+        for (size_t i = 1; i <= capacity; i++) {
+            const size_t parent = i + (i & (~i + 1));
+            if (parent <= capacity) tree_[parent] += tree_[i];
+        }
+        next_ = static_cast<uint32_t>(count + 1);
+    }
+
+private:
+    static constexpr size_t kMinCapacity = 8;
+
+    void add(size_t i, uint64_t delta) {
+        for (; i < tree_.size(); i += i & (~i + 1)) tree_[i] += delta;
+    }
+
+    std::vector<uint64_t> tree_; // 1-based; tree_[0] unused
+    uint32_t next_ = 1;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Pre-trade controls applied inside OrderBook::match_order, on the same
+// pass that matches the order: no separate gateway hop, and nothing runs
+// for books that leave them unset.
+
+// What match_order does when an incoming order would trade against a
+// resting order of the same (non-zero) account
+enum class SelfTradePrevention : uint8_t {
+    None,        // Let them trade
+    CancelTaker, // Stop before the own order; the incoming remainder is cancelled
+    CancelMaker, // Cancel each own resting order in the way and keep matching
+    CancelBoth   // Cancel the own resting order and the incoming remainder
+};
+
+// Why match_order rejected an order or cut it short
+enum class RejectReason : uint8_t {
+    None,
+    InvalidOrder,  // Type / time-in-force combination not supported
+    PostOnlyCross, // Post-only order would have crossed
+    FillOrKill,    // Not enough quantity to fill in full
+    OrderQuantity, // Above the account's max_quantity
+    Notional,      // Price x quantity above the account's max_notional
+    PriceBand,     // Limit further through the opposite best than the band allows
+    SelfTrade      // Remainder cancelled by self-trade prevention (status Cancelled)
+};
+
+// Per-order limits of one account
+struct AccountLimits {
+    uint64_t max_quantity = std::numeric_limits<uint64_t>::max();
+    double max_notional = std::numeric_limits<double>::infinity();
+};
+
+// Limits for every account in one flat array indexed by account id, so a
+// check is an index and two compares on a line that stays in cache (four
+// accounts per line). Accounts past the end get the defaults.
+class AccountRiskTable {
+public:
+    explicit AccountRiskTable(size_t accounts = 0, const AccountLimits& defaults = AccountLimits{})
+        : limits_(accounts, defaults)
+        , defaults_(defaults) {}
+
+    // Not safe while a book using the table is matching; set limits up front
+    void set(uint32_t account, const AccountLimits& limits) {
+        if (account >= limits_.size()) limits_.resize(static_cast<size_t>(account) + 1, defaults_);
+        limits_[account] = limits;
+    }
+
+    const AccountLimits& limits(uint32_t account) const {
+        return account < limits_.size() ? limits_[account] : defaults_;
+    }
+
+    size_t size() const { return limits_.size(); }
+
+private:
+    std::vector<AccountLimits> limits_;
+    AccountLimits defaults_;
+};
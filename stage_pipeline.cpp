@@ -0,0 +1,94 @@
+#include "stage_pipeline.h"
+#include "book_manager.h"
+#include <cstdio>
+#include <cstdlib>
+
+bool parse_stage_cpus(const std::string& spec, std::map<std::string, int>& cpus) {
+    size_t begin = 0;
+    while (begin < spec.size()) {
+        size_t end = spec.find(',', begin);
+        if (end == std::string::npos) end = spec.size();
+        const std::string entry = spec.substr(begin, end - begin);
+        const size_t equals = entry.find('=');
+        if (equals == 0 || equals == std::string::npos || equals + 1 == entry.size()) return false;
+        char* tail = nullptr;
+        const long cpu = std::strtol(entry.c_str() + equals + 1, &tail, 10);
+        if (*tail != '\0' || cpu < -1) return false;
+        cpus[entry.substr(0, equals)] = static_cast<int>(cpu);
+        begin = end + 1;
+    }
+    return true;
+}
+
+StagePipeline::~StagePipeline() {
+    stop();
+}
+
+void StagePipeline::start() {
+    if (running_.exchange(true)) return;
+    for (auto& stage : stages_) {
+        stage->finished_.store(false, std::memory_order_relaxed);
+    }
+    for (auto& stage : stages_) {
+        PipelineStage& s = *stage;
+        threads_.emplace_back([this, &s] { run(s); });
+    }
+}
+
+void StagePipeline::stop() {
+    if (!running_.exchange(false)) return;
+    // Stages were added upstream first, and each one exits only after its
+    // producer has, so joining in order waits for the chain to drain
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+void StagePipeline::run(PipelineStage& stage) {
+    pin_current_thread(stage.cpu());
+    for (;;) {
+        // Sampled before the step: once the producer is done, everything it
+        // pushed is visible, so an empty input means drained
+        const bool upstream_done = stage.upstream_ ? stage.upstream_->finished_.load(std::memory_order_acquire)
+                                                   : !running_.load(std::memory_order_acquire);
+        if (!stage.upstream_ && upstream_done) break; // Sources stop at once
+        if (stage.step()) continue;
+        if (upstream_done) break;
+        __builtin_ia32_pause();
+    }
+    stage.finished_.store(true, std::memory_order_release);
+}
+
+StageStats StagePipeline::stats(size_t index) const {
+    const PipelineStage& stage = *stages_[index];
+    const StageCounters& counters = stage.counters();
+    LatencyHistogram service;
+    counters.service.snapshot(service);
+    const double ticks_per_ns = tsc_ticks_per_ns();
+
+    StageStats stats;
+    stats.name = stage.name();
+    stats.cpu = stage.cpu();
+    stats.processed = counters.processed.load(std::memory_order_relaxed);
+    stats.queue_depth = counters.depth.load(std::memory_order_relaxed);
+    stats.queue_high_water = counters.high_water.load(std::memory_order_relaxed);
+    stats.queue_capacity = stage.queue_capacity();
+    stats.stalls = counters.stalls.load(std::memory_order_relaxed);
+    stats.stall_ns = static_cast<double>(counters.stall_cycles.load(std::memory_order_relaxed)) / ticks_per_ns;
+    stats.service_p50_ns = static_cast<double>(service.percentile(50)) / ticks_per_ns;
+    stats.service_p99_ns = static_cast<double>(service.percentile(99)) / ticks_per_ns;
+    stats.service_max_ns = static_cast<double>(service.max()) / ticks_per_ns;
+    return stats;
+}
+
+void StagePipeline::print_stats() const {
+    for (size_t i = 0; i < stages_.size(); i++) {
+        const StageStats s = stats(i);
+        std::printf("  %-12s cpu %3d  %10llu items  queue %zu/%zu (high %zu)  stalls %llu (%.0f ns)  "
+                    "service p50 %.0f p99 %.0f max %.0f ns\n",
+                    s.name.c_str(), s.cpu, static_cast<unsigned long long>(s.processed), s.queue_depth,
+                    s.queue_capacity, s.queue_high_water, static_cast<unsigned long long>(s.stalls), s.stall_ns,
+                    s.service_p50_ns, s.service_p99_ns, s.service_max_ns);
+    }
+}
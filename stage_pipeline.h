@@ -0,0 +1,320 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "book_metrics.h"
+#include "branch_hints.h"
+#include "SPSC_QUEUES/spsc_q3.cpp"
+
+// Wires processing stages (e.g. feed decode -> book update -> delta publish)
+// into a chain over Fifo3 rings, one thread per stage, each pinned to the
+// CPU named for it in StagePipelineConfig::stage_cpus. Stages are looked up
+// by name, so moving one to another core is a configuration change
+// (parse_stage_cpus reads "decode=2,book=3,publish=4").
+//
+// A stage pushes to its output ring through a PipelineOutput, which spins
+// while the ring is full: a slow stage backs its producers up instead of
+// dropping. Per-stage counters make that visible from any thread: input
+// ring depth and high-water mark, pushes that found the output full, and a
+// service-time histogram of each item with the time spent waiting on a full
+// output taken out.
+//
+// Build the chain (sources first, each ring consumed by exactly one stage)
+// before start(). stop() stops the sources; every later stage drains what
+// its input still holds before its thread exits, so nothing in flight is
+// lost.
+
+class PipelineStage;
+
+// Output ring of one stage and input of the next
+template <typename T>
+class PipelineRing {
+public:
+    PipelineRing(size_t capacity, PipelineStage* producer) : fifo_(capacity), producer_(producer) {}
+
+    // Occupancy; call on the producing or consuming stage's thread
+    size_t size() const { return fifo_.size(); }
+    size_t capacity() const { return fifo_.capacity(); }
+
+private:
+    friend class StagePipeline;
+    template <typename> friend class PipelineOutput;
+    template <typename, typename, typename> friend class TransformStage;
+    template <typename, typename> friend class SinkStage;
+
+    Fifo3<T> fifo_;
+    PipelineStage* producer_;
+    bool consumed_ = false; // A stage reads it; SPSC allows only one
+};
+
+// Per-stage counters, readable from any thread. Each is written only by the
+// stage's own thread, so plain relaxed loads and stores suffice.
+struct StageCounters {
+    std::atomic<uint64_t> processed{0};
+    std::atomic<uint64_t> stalls{0};      // Pushes that found the output ring full
+    std::atomic<uint64_t> stall_cycles{0}; // TSC cycles spent waiting on it
+    std::atomic<size_t> depth{0};         // Input ring occupancy at the last poll
+    std::atomic<size_t> high_water{0};    // Deepest input ring seen at a poll
+    AtomicLatencyHistogram service;       // TSC cycles per item, stalls excluded
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+};
+
+// Where a stage's function sends its results; push() blocks on a full ring
+template <typename T>
+class PipelineOutput {
+public:
+    PipelineOutput(PipelineRing<T>& ring, StageCounters& counters) : ring_(ring), counters_(counters) {}
+
+    void push(const T& value) {
+        if (BOOK_LIKELY(ring_.fifo_.push(value))) return;
+        const uint64_t start = tsc_begin();
+        while (!ring_.fifo_.push(value)) __builtin_ia32_pause();
+        StageCounters::bump(counters_.stalls, 1);
+        StageCounters::bump(counters_.stall_cycles, tsc_end() - start);
+    }
+
+private:
+    PipelineRing<T>& ring_;
+    StageCounters& counters_;
+};
+
+// Type-erased stage run by one pipeline thread
+class PipelineStage {
+public:
+    PipelineStage(std::string name, int cpu, const PipelineStage* upstream)
+        : name_(std::move(name))
+        , cpu_(cpu)
+        , upstream_(upstream) {}
+    virtual ~PipelineStage() = default;
+
+    const std::string& name() const { return name_; }
+    int cpu() const { return cpu_; }
+    const StageCounters& counters() const { return counters_; }
+
+    // Input ring size; 0 for a source
+    virtual size_t queue_capacity() const = 0;
+
+protected:
+    // Handle one item; @return false if there was nothing to do
+    virtual bool step() = 0;
+
+    // Time one item, leaving out any wait on a full output
+    template <typename Fn>
+    void timed(Fn&& fn) {
+        const uint64_t stalled = counters_.stall_cycles.load(std::memory_order_relaxed);
+        const uint64_t start = tsc_begin();
+        fn();
+        const uint64_t elapsed = tsc_end() - start;
+        counters_.service.record(elapsed - (counters_.stall_cycles.load(std::memory_order_relaxed) - stalled));
+        StageCounters::bump(counters_.processed, 1);
+    }
+
+    // Sampled by the consumer: Fifo3::size() is only consistent on the
+    // producer or consumer thread
+    void note_depth(size_t depth) {
+        counters_.depth.store(depth, std::memory_order_relaxed);
+        if (depth > counters_.high_water.load(std::memory_order_relaxed)) {
+            counters_.high_water.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    StageCounters counters_;
+
+private:
+    friend class StagePipeline;
+
+    std::string name_;
+    int cpu_;
+    const PipelineStage* upstream_;   // Stage feeding the input ring; nullptr for a source
+    std::atomic<bool> finished_{false}; // Thread exited; everything it pushed is visible
+};
+
+// fn(PipelineOutput<Out>&) -> bool: produce zero or more items, false if idle
+template <typename Out, typename Fn>
+class SourceStage final : public PipelineStage {
+public:
+    SourceStage(std::string name, int cpu, Fn fn, size_t capacity)
+        : PipelineStage(std::move(name), cpu, nullptr)
+        , fn_(std::move(fn))
+        , out_ring_(capacity, this)
+        , out_(out_ring_, counters_) {}
+
+    PipelineRing<Out>& output() { return out_ring_; }
+    size_t queue_capacity() const override { return 0; }
+
+protected:
+    bool step() override {
+        const uint64_t stalled = counters_.stall_cycles.load(std::memory_order_relaxed);
+        const uint64_t start = tsc_begin();
+        const bool produced = fn_(out_);
+        const uint64_t elapsed = tsc_end() - start;
+        // Idle polls are not service time
+        if (produced) {
+            counters_.service.record(elapsed - (counters_.stall_cycles.load(std::memory_order_relaxed) - stalled));
+            StageCounters::bump(counters_.processed, 1);
+        }
+        return produced;
+    }
+
+private:
+    Fn fn_;
+    PipelineRing<Out> out_ring_;
+    PipelineOutput<Out> out_;
+};
+
+// fn(const In&, PipelineOutput<Out>&): zero or more outputs per input
+template <typename In, typename Out, typename Fn>
+class TransformStage final : public PipelineStage {
+public:
+    TransformStage(std::string name, int cpu, PipelineRing<In>& input, Fn fn, size_t capacity)
+        : PipelineStage(std::move(name), cpu, input.producer_)
+        , input_(input)
+        , fn_(std::move(fn))
+        , out_ring_(capacity, this)
+        , out_(out_ring_, counters_) {}
+
+    PipelineRing<Out>& output() { return out_ring_; }
+    size_t queue_capacity() const override { return input_.capacity(); }
+
+protected:
+    bool step() override {
+        note_depth(input_.size());
+        if (!input_.fifo_.pop(item_)) return false;
+        timed([this] { fn_(item_, out_); });
+        return true;
+    }
+
+private:
+    PipelineRing<In>& input_;
+    Fn fn_;
+    In item_{};
+    PipelineRing<Out> out_ring_;
+    PipelineOutput<Out> out_;
+};
+
+// fn(const In&): the end of a chain
+template <typename In, typename Fn>
+class SinkStage final : public PipelineStage {
+public:
+    SinkStage(std::string name, int cpu, PipelineRing<In>& input, Fn fn)
+        : PipelineStage(std::move(name), cpu, input.producer_)
+        , input_(input)
+        , fn_(std::move(fn)) {}
+
+    size_t queue_capacity() const override { return input_.capacity(); }
+
+protected:
+    bool step() override {
+        note_depth(input_.size());
+        if (!input_.fifo_.pop(item_)) return false;
+        timed([this] { fn_(item_); });
+        return true;
+    }
+
+private:
+    PipelineRing<In>& input_;
+    Fn fn_;
+    In item_{};
+};
+
+struct StagePipelineConfig {
+    size_t ring_capacity = 1 << 12;        // Slots in each stage's output ring
+    std::map<std::string, int> stage_cpus; // CPU to pin each stage to, by name; missing = unpinned
+};
+
+// Parse "name=cpu,name=cpu" into cpus; @return false on bad syntax
+bool parse_stage_cpus(const std::string& spec, std::map<std::string, int>& cpus);
+
+// One stage's counters, converted to ns
+struct StageStats {
+    std::string name;
+    int cpu;                 // -1 = unpinned
+    uint64_t processed;      // Items handled (sources: polls that produced)
+    size_t queue_depth;      // Input ring occupancy at the stage's last poll
+    size_t queue_high_water; // Deepest input ring seen
+    size_t queue_capacity;
+    uint64_t stalls;         // Pushes that waited on a full output ring
+    double stall_ns;         // Total time those waits took
+    double service_p50_ns;
+    double service_p99_ns;
+    double service_max_ns;
+};
+
+class StagePipeline {
+public:
+    explicit StagePipeline(const StagePipelineConfig& config = StagePipelineConfig{}) : config_(config) {}
+    ~StagePipeline();
+
+    StagePipeline(const StagePipeline&) = delete;
+    StagePipeline& operator=(const StagePipeline&) = delete;
+
+    // Add a stage that generates items; @return its output ring
+    template <typename Out, typename Fn>
+    PipelineRing<Out>& add_source(const std::string& name, Fn fn) {
+        auto stage = std::make_unique<SourceStage<Out, Fn>>(name, cpu_for(name), std::move(fn), config_.ring_capacity);
+        PipelineRing<Out>& out = stage->output();
+        stages_.push_back(std::move(stage));
+        return out;
+    }
+
+    // Add a stage that consumes input; @return its output ring
+    template <typename Out, typename In, typename Fn>
+    PipelineRing<Out>& add_stage(const std::string& name, PipelineRing<In>& input, Fn fn) {
+        claim(input);
+        auto stage = std::make_unique<TransformStage<In, Out, Fn>>(name, cpu_for(name), input, std::move(fn),
+                                                                   config_.ring_capacity);
+        PipelineRing<Out>& out = stage->output();
+        stages_.push_back(std::move(stage));
+        return out;
+    }
+
+    // Add the stage that ends a chain
+    template <typename In, typename Fn>
+    void add_sink(const std::string& name, PipelineRing<In>& input, Fn fn) {
+        claim(input);
+        stages_.push_back(std::make_unique<SinkStage<In, Fn>>(name, cpu_for(name), input, std::move(fn)));
+    }
+
+    // Spawn and pin one thread per stage
+    void start();
+
+    // Stop the sources, then join every stage once its input is drained
+    void stop();
+
+    bool running() const { return running_.load(std::memory_order_relaxed); }
+
+    size_t stage_count() const { return stages_.size(); }
+    StageStats stats(size_t stage) const;
+
+    // One line per stage, to stdout
+    void print_stats() const;
+
+private:
+    template <typename T>
+    void claim(PipelineRing<T>& ring) {
+        assert(!running() && !ring.consumed_);
+        ring.consumed_ = true;
+    }
+
+    int cpu_for(const std::string& name) const {
+        const auto it = config_.stage_cpus.find(name);
+        return it == config_.stage_cpus.end() ? -1 : it->second;
+    }
+
+    void run(PipelineStage& stage);
+
+    StagePipelineConfig config_;
+    std::vector<std::unique_ptr<PipelineStage>> stages_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_{false};
+};
@@ -0,0 +1,390 @@
+#include "tick_store.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "order_book.h"
+
+namespace {
+
+constexpr size_t kFileHeaderBytes = sizeof(TickStoreHeader);
+constexpr size_t kBlockHeaderBytes = sizeof(TickBlockHeader);
+
+uint64_t zigzag(uint64_t value, uint64_t previous) {
+    const int64_t delta = static_cast<int64_t>(value - previous);
+    return (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+}
+
+uint64_t unzigzag(uint64_t encoded, uint64_t previous) {
+    return previous + ((encoded >> 1) ^ (~(encoded & 1) + 1));
+}
+
+uint8_t flags_of(const TickRecord& record) {
+    return static_cast<uint8_t>(static_cast<uint8_t>(record.type) | (record.is_buy ? 1u << 3 : 0u));
+}
+
+size_t varint_bytes(uint64_t value) {
+    size_t bytes = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        bytes++;
+    }
+    return bytes;
+}
+
+unsigned bit_width(uint64_t value) {
+    return value == 0 ? 0 : 64 - static_cast<unsigned>(__builtin_clzll(value));
+}
+
+// Append values to out in whichever encoding is smaller
+void encode_column(const std::vector<uint64_t>& values, std::vector<char>& out, uint8_t& encoding,
+                   uint8_t& width, uint32_t& bytes) {
+    size_t varint_total = 0;
+    uint64_t widest = 0;
+    for (const uint64_t value : values) {
+        varint_total += varint_bytes(value);
+        widest |= value;
+    }
+    const unsigned bits = bit_width(widest);
+    const size_t packed_total = (values.size() * bits + 7) / 8;
+    const size_t start = out.size();
+
+    if (packed_total < varint_total) {
+        encoding = static_cast<uint8_t>(TickEncoding::BitPacked);
+        width = static_cast<uint8_t>(bits);
+        // Fewer than 8 bits are ever left in acc between values, so a
+        // value of up to 64 bits is split across at most two shifts
+        uint64_t acc = 0;
+        unsigned held = 0;
+        for (uint64_t value : values) {
+            unsigned left = bits;
+            while (left > 0) {
+                const unsigned take = std::min(left, 64 - held);
+                const uint64_t part = take == 64 ? value : value & ((uint64_t{1} << take) - 1);
+                acc |= part << held;
+                held += take;
+                value = take == 64 ? 0 : value >> take;
+                left -= take;
+                while (held >= 8) {
+                    out.push_back(static_cast<char>(acc & 0xff));
+                    acc >>= 8;
+                    held -= 8;
+                }
+            }
+        }
+        if (held > 0) out.push_back(static_cast<char>(acc & 0xff));
+    } else {
+        encoding = static_cast<uint8_t>(TickEncoding::Varint);
+        width = 0;
+        for (uint64_t value : values) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+    }
+    bytes = static_cast<uint32_t>(out.size() - start);
+}
+
+// Decode count values of one column; @return false if it is malformed
+bool decode_column(const unsigned char* data, uint32_t bytes, uint8_t encoding, uint8_t width, uint32_t count,
+                   std::vector<uint64_t>& values) {
+    values.resize(count);
+    if (encoding == static_cast<uint8_t>(TickEncoding::BitPacked)) {
+        if (width > 64 || (static_cast<uint64_t>(count) * width + 7) / 8 > bytes) return false;
+        uint64_t position = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint64_t value = 0;
+            unsigned got = 0;
+            while (got < width) {
+                const unsigned offset = static_cast<unsigned>(position & 7);
+                const unsigned take = std::min(8 - offset, width - got);
+                const uint64_t part = (data[position >> 3] >> offset) & ((1u << take) - 1);
+                value |= part << got;
+                got += take;
+                position += take;
+            }
+            values[i] = value;
+        }
+        return true;
+    }
+    if (encoding != static_cast<uint8_t>(TickEncoding::Varint)) return false;
+    uint32_t at = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t value = 0;
+        unsigned shift = 0;
+        while (true) {
+            if (at >= bytes || shift > 63) return false;
+            const unsigned char byte = data[at++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) break;
+            shift += 7;
+        }
+        values[i] = value;
+    }
+    return true;
+}
+
+bool write_all(int fd, const char* data, size_t bytes) {
+    while (bytes > 0) {
+        const ssize_t written = ::write(fd, data, bytes);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        bytes -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+TickStoreWriter::TickStoreWriter(const TickStoreConfig& config) : config_(config) {
+    if (config_.block_records == 0) config_.block_records = 1;
+    pending_.reserve(config_.block_records);
+    values_.reserve(config_.block_records);
+}
+
+bool TickStoreWriter::open() {
+    close();
+    fd_ = ::open(config_.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) return false;
+    failed_ = false;
+    stats_ = TickStoreStats{};
+
+    TickStoreHeader header{};
+    std::memcpy(header.magic, kTickStoreMagic, sizeof(header.magic));
+    header.version = kTickStoreVersion;
+    header.block_records = config_.block_records;
+    if (!write_all(fd_, reinterpret_cast<const char*>(&header), sizeof(header))) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    stats_.bytes = sizeof(header);
+    return true;
+}
+
+bool TickStoreWriter::close() {
+    if (fd_ < 0) return !failed_;
+    if (!pending_.empty()) flush_block();
+    ::close(fd_);
+    fd_ = -1;
+    return !failed_;
+}
+
+bool TickStoreWriter::flush_block() {
+    const TickRecord& first = pending_.front();
+    TickBlockHeader header{};
+    header.magic = kTickBlockMagic;
+    header.count = static_cast<uint32_t>(pending_.size());
+    header.min_timestamp_ns = UINT64_MAX;
+    header.min_price = INT64_MAX;
+    header.max_price = INT64_MIN;
+    header.first_timestamp_ns = first.timestamp_ns;
+    header.first_sequence = first.sequence;
+    header.first_order_id = first.order_id;
+    header.first_price = first.price;
+    for (const TickRecord& record : pending_) {
+        header.min_timestamp_ns = std::min(header.min_timestamp_ns, record.timestamp_ns);
+        header.max_timestamp_ns = std::max(header.max_timestamp_ns, record.timestamp_ns);
+        header.min_price = std::min(header.min_price, record.price);
+        header.max_price = std::max(header.max_price, record.price);
+    }
+
+    block_.assign(kBlockHeaderBytes, 0);
+    // Fill values_ from one field of each record, then encode it
+    const auto column = [&](TickColumn id, auto&& extract) {
+        values_.clear();
+        for (const TickRecord& record : pending_) values_.push_back(extract(record));
+        const size_t index = static_cast<size_t>(id);
+        encode_column(values_, block_, header.column_encoding[index], header.column_width[index],
+                      header.column_bytes[index]);
+    };
+    // Delta columns: each value against the one before, the first against itself
+    uint64_t previous = first.timestamp_ns;
+    column(TickColumn::Time, [&](const TickRecord& r) {
+        return zigzag(r.timestamp_ns, std::exchange(previous, r.timestamp_ns));
+    });
+    previous = first.sequence;
+    column(TickColumn::Sequence, [&](const TickRecord& r) {
+        return zigzag(r.sequence, std::exchange(previous, r.sequence));
+    });
+    previous = first.order_id;
+    column(TickColumn::OrderId, [&](const TickRecord& r) {
+        return zigzag(r.order_id, std::exchange(previous, r.order_id));
+    });
+    previous = static_cast<uint64_t>(first.price);
+    column(TickColumn::Price, [&](const TickRecord& r) {
+        const uint64_t price = static_cast<uint64_t>(r.price);
+        return zigzag(price, std::exchange(previous, price));
+    });
+    column(TickColumn::Quantity, [](const TickRecord& r) { return r.quantity; });
+    column(TickColumn::Flags, [](const TickRecord& r) { return uint64_t{flags_of(r)}; });
+
+    // Pad so the next block header is 8-byte aligned in the mapping
+    block_.resize((block_.size() + 7) & ~size_t{7}, 0);
+    header.payload_bytes = block_.size() - kBlockHeaderBytes;
+    std::memcpy(block_.data(), &header, sizeof(header));
+
+    stats_.records += pending_.size();
+    pending_.clear();
+    if (!write_all(fd_, block_.data(), block_.size())) {
+        failed_ = true;
+        return false;
+    }
+    stats_.blocks++;
+    stats_.bytes += block_.size();
+    return true;
+}
+
+bool TickStoreReader::open(const std::string& path, bool populate) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kFileHeaderBytes) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+    ::close(fd); // The mapping keeps the file alive
+    if (map == MAP_FAILED) {
+        size_ = 0;
+        return false;
+    }
+    ::madvise(map, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(map);
+
+    const TickStoreHeader& header = *reinterpret_cast<const TickStoreHeader*>(data_);
+    if (std::memcmp(header.magic, kTickStoreMagic, sizeof(header.magic)) != 0 ||
+        header.version != kTickStoreVersion) {
+        close();
+        return false;
+    }
+
+    // Index blocks until the end or the first torn one
+    size_t offset = kFileHeaderBytes;
+    while (size_ - offset >= kBlockHeaderBytes) {
+        const TickBlockHeader* block = reinterpret_cast<const TickBlockHeader*>(data_ + offset);
+        if (block->magic != kTickBlockMagic || block->count == 0) break;
+        if (block->payload_bytes > size_ - offset - kBlockHeaderBytes) break;
+        uint64_t columns = 0;
+        for (const uint32_t bytes : block->column_bytes) columns += bytes;
+        if (columns > block->payload_bytes) break;
+        blocks_.push_back(block);
+        records_ += block->count;
+        offset += kBlockHeaderBytes + block->payload_bytes;
+    }
+    return true;
+}
+
+void TickStoreReader::close() {
+    if (data_ != nullptr) ::munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    blocks_.clear();
+    records_ = 0;
+}
+
+bool TickStoreReader::decode_block(size_t index, std::vector<TickRecord>& out) const {
+    const TickBlockHeader& header = *blocks_[index];
+    const uint32_t count = header.count;
+    out.resize(count);
+    const unsigned char* column = reinterpret_cast<const unsigned char*>(&header) + kBlockHeaderBytes;
+
+    for (size_t id = 0; id < kTickColumns; id++) {
+        if (!decode_column(column, header.column_bytes[id], header.column_encoding[id], header.column_width[id],
+                           count, values_)) {
+            return false;
+        }
+        column += header.column_bytes[id];
+        switch (static_cast<TickColumn>(id)) {
+        case TickColumn::Time: {
+            uint64_t previous = header.first_timestamp_ns;
+            for (uint32_t i = 0; i < count; i++) previous = out[i].timestamp_ns = unzigzag(values_[i], previous);
+            break;
+        }
+        case TickColumn::Sequence: {
+            uint64_t previous = header.first_sequence;
+            for (uint32_t i = 0; i < count; i++) previous = out[i].sequence = unzigzag(values_[i], previous);
+            break;
+        }
+        case TickColumn::OrderId: {
+            uint64_t previous = header.first_order_id;
+            for (uint32_t i = 0; i < count; i++) previous = out[i].order_id = unzigzag(values_[i], previous);
+            break;
+        }
+        case TickColumn::Price: {
+            uint64_t previous = static_cast<uint64_t>(header.first_price);
+            for (uint32_t i = 0; i < count; i++) {
+                previous = unzigzag(values_[i], previous);
+                out[i].price = static_cast<Ticks>(previous);
+            }
+            break;
+        }
+        case TickColumn::Quantity:
+            for (uint32_t i = 0; i < count; i++) out[i].quantity = values_[i];
+            break;
+        case TickColumn::Flags:
+            for (uint32_t i = 0; i < count; i++) {
+                out[i].type = static_cast<BookEventType>(values_[i] & 7);
+                out[i].is_buy = (values_[i] & 8) != 0;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+uint64_t TickStoreReader::replay(BookEventSink& sink, uint64_t from_ns, uint64_t to_ns) const {
+    return for_each(
+        [&](const TickRecord& r) {
+            sink.publish(BookEvent{r.sequence, r.order_id, r.price, r.quantity, r.type, r.is_buy});
+        },
+        from_ns, to_ns);
+}
+
+uint64_t TickStoreReader::replay(OrderBook& book, uint64_t from_ns, uint64_t to_ns) const {
+    const TickScale& ticks = book.tick_scale();
+    uint64_t applied = 0;
+    for_each(
+        [&](const TickRecord& r) {
+            const double price = ticks.to_price(r.price);
+            switch (r.type) {
+            case BookEventType::OrderAdd:
+                book.add_order(Order{r.order_id, r.is_buy, price, r.quantity, r.timestamp_ns});
+                break;
+            case BookEventType::OrderCancel:
+                book.cancel_order(r.order_id);
+                break;
+            case BookEventType::OrderModify:
+                book.amend_order(r.order_id, price, r.quantity);
+                break;
+            case BookEventType::OrderExecute: {
+                // The event carries the traded quantity; a partial fill
+                // leaves the rest in place, as the match did
+                uint64_t resting = 0;
+                if (!book.resting_quantity(r.order_id, resting)) return;
+                if (resting > r.quantity) {
+                    book.amend_order(r.order_id, price, resting - r.quantity);
+                } else {
+                    book.cancel_order(r.order_id);
+                }
+                break;
+            }
+            default:
+                return; // L2
+            }
+            applied++;
+        },
+        from_ns, to_ns);
+    return applied;
+}
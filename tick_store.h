@@ -0,0 +1,220 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "book_events.h"
+#include "price.h"
+
+class OrderBook;
+
+// Columnar archive of book events for research and replay, written by
+// TickStoreWriter and read back memory-mapped by TickStoreReader.
+//
+// Records are grouped into blocks of TickStoreConfig::block_records. Each
+// block stores every field as its own column, in record order:
+//
+//   time      delta from the previous record, zigzag
+//   sequence  delta, zigzag
+//   order_id  delta, zigzag (0 for L2 events)
+//   price     delta in ticks, zigzag
+//   quantity  as is
+//   flags     event type | is_buy << 3
+//
+// A numeric column is LEB128 varints, or bit-packed at the width of its
+// largest value when that is smaller, chosen per column per block. The
+// block header carries the first value of each delta column, so blocks
+// decode on their own, and min/max time and price, so a range query skips
+// blocks without touching their columns. Typical flow (small time gaps,
+// nearby prices, sequences counting up) takes a few bytes per event
+// instead of a 40-byte fixed-width record.
+//
+// Blocks are padded to 8 bytes so every header is aligned in the mapping.
+// A block is written with one write() once it is complete; a reader stops
+// at the first block that is cut short or fails its magic, so an archive
+// torn by a crash keeps every block before the tear.
+
+// One archived event
+struct TickRecord {
+    uint64_t timestamp_ns;
+    uint64_t sequence;  // BookEvent::sequence of its stream
+    uint64_t order_id;  // L3 only
+    Ticks price;
+    uint64_t quantity;
+    BookEventType type;
+    bool is_buy;
+};
+
+constexpr size_t kTickColumns = 6;
+
+enum class TickColumn : uint8_t { Time, Sequence, OrderId, Price, Quantity, Flags };
+
+enum class TickEncoding : uint8_t {
+    Varint,   // LEB128, 7 bits per byte
+    BitPacked // Fixed width per value (TickBlockHeader::column_width), LSB first
+};
+
+constexpr char kTickStoreMagic[8] = {'O', 'B', 'T', 'I', 'C', 'K', '0', '1'};
+constexpr uint32_t kTickStoreVersion = 1;
+constexpr uint32_t kTickBlockMagic = 0x4b4c4254; // "TBLK"
+
+// First bytes of the file; blocks follow it
+struct TickStoreHeader {
+    char magic[8]; // kTickStoreMagic
+    uint32_t version;
+    uint32_t block_records;
+    uint8_t reserved[16];
+};
+static_assert(sizeof(TickStoreHeader) == 32, "tick store header is fixed-size on disk");
+
+// Header of one block; its columns follow in TickColumn order
+struct TickBlockHeader {
+    uint32_t magic;         // kTickBlockMagic
+    uint32_t count;         // Records in the block
+    uint64_t payload_bytes; // Column bytes after this header
+    uint64_t min_timestamp_ns;
+    uint64_t max_timestamp_ns;
+    Ticks min_price;
+    Ticks max_price;
+    // Delta bases: the first record's values
+    uint64_t first_timestamp_ns;
+    uint64_t first_sequence;
+    uint64_t first_order_id;
+    Ticks first_price;
+    uint32_t column_bytes[kTickColumns];
+    uint8_t column_encoding[kTickColumns]; // TickEncoding
+    uint8_t column_width[kTickColumns];    // Bits per value when BitPacked
+    uint8_t reserved[4];
+};
+static_assert(sizeof(TickBlockHeader) == 120, "tick block header is fixed-size on disk");
+
+struct TickStoreConfig {
+    std::string path = "book.ticks";
+    uint32_t block_records = 4096; // Records per block: larger packs tighter, smaller seeks finer
+};
+
+struct TickStoreStats {
+    uint64_t records = 0;
+    uint64_t blocks = 0;
+    uint64_t bytes = 0; // Written to the file, headers included
+};
+
+// Appends records to a new archive. One thread.
+class TickStoreWriter {
+public:
+    explicit TickStoreWriter(const TickStoreConfig& config = TickStoreConfig{});
+    ~TickStoreWriter() { close(); }
+
+    TickStoreWriter(const TickStoreWriter&) = delete;
+    TickStoreWriter& operator=(const TickStoreWriter&) = delete;
+
+    // Create (or truncate) config.path and write the file header
+    // @return false if the file cannot be created
+    bool open();
+
+    // Write out the last, partial block and close the file
+    // @return false if a write failed at any point since open()
+    bool close();
+
+    bool is_open() const { return fd_ >= 0; }
+
+    // Buffer one record; a full block is encoded and written
+    // @return false if the archive is closed or the block write failed
+    bool append(const TickRecord& record) {
+        if (fd_ < 0) return false;
+        pending_.push_back(record);
+        return pending_.size() < config_.block_records || flush_block();
+    }
+
+    TickStoreStats stats() const { return stats_; }
+
+private:
+    bool flush_block();
+
+    TickStoreConfig config_;
+    int fd_ = -1;
+    bool failed_ = false;
+    std::vector<TickRecord> pending_;
+    std::vector<uint64_t> values_; // One column's encoded integers
+    std::vector<char> block_;      // Header and columns being assembled
+    TickStoreStats stats_;
+};
+
+// Book event sink that archives every event it receives. Events carry no
+// time, so the caller sets the clock (e.g. to each message's exchange
+// timestamp) before driving the book.
+class TickStoreSink : public BookEventSink {
+public:
+    explicit TickStoreSink(TickStoreWriter& writer) : writer_(writer) {}
+
+    void set_time(uint64_t timestamp_ns) { timestamp_ns_ = timestamp_ns; }
+
+    void publish(const BookEvent& event) override {
+        writer_.append(TickRecord{timestamp_ns_, event.sequence, event.order_id, event.price, event.quantity,
+                                  event.type, event.is_buy});
+    }
+
+private:
+    TickStoreWriter& writer_;
+    uint64_t timestamp_ns_ = 0;
+};
+
+// Read-only, memory-mapped view of an archive
+class TickStoreReader {
+public:
+    TickStoreReader() = default;
+    ~TickStoreReader() { close(); }
+
+    TickStoreReader(const TickStoreReader&) = delete;
+    TickStoreReader& operator=(const TickStoreReader&) = delete;
+
+    // Map the file and index its blocks from their headers
+    // @return false if the file cannot be mapped or is not an archive
+    bool open(const std::string& path, bool populate = false);
+    void close();
+
+    bool is_open() const { return data_ != nullptr; }
+
+    size_t block_count() const { return blocks_.size(); }
+    const TickBlockHeader& block(size_t index) const { return *blocks_[index]; }
+    uint64_t record_count() const { return records_; }
+
+    // Decode one block into out (replacing its contents)
+    // @return false if a column is malformed
+    bool decode_block(size_t index, std::vector<TickRecord>& out) const;
+
+    // Call fn(const TickRecord&) for every record with a timestamp in
+    // [from_ns, to_ns], in file order; blocks outside the range are skipped
+    // on their headers alone. @return records visited
+    template <typename Fn>
+    uint64_t for_each(Fn&& fn, uint64_t from_ns = 0, uint64_t to_ns = UINT64_MAX) const {
+        uint64_t visited = 0;
+        for (size_t i = 0; i < blocks_.size(); i++) {
+            const TickBlockHeader& header = *blocks_[i];
+            if (header.max_timestamp_ns < from_ns || header.min_timestamp_ns > to_ns) continue;
+            if (!decode_block(i, scratch_)) break;
+            for (const TickRecord& record : scratch_) {
+                if (record.timestamp_ns < from_ns || record.timestamp_ns > to_ns) continue;
+                fn(record);
+                visited++;
+            }
+        }
+        return visited;
+    }
+
+    // Publish the records in [from_ns, to_ns] to sink as book events
+    uint64_t replay(BookEventSink& sink, uint64_t from_ns = 0, uint64_t to_ns = UINT64_MAX) const;
+
+    // Rebuild a book from the archived L3 stream: adds, cancels, in-place
+    // modifies and executions applied as the calls that produced them. L2
+    // records are skipped. @return L3 records applied
+    uint64_t replay(OrderBook& book, uint64_t from_ns = 0, uint64_t to_ns = UINT64_MAX) const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<const TickBlockHeader*> blocks_;
+    uint64_t records_ = 0;
+    mutable std::vector<TickRecord> scratch_;
+    mutable std::vector<uint64_t> values_;
+};
@@ -0,0 +1,180 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel of deadlines keyed by a dense 32-bit handle
+// (an OrderPool slot). kLevels wheels of kSlots slots each: level k slots
+// are kSlots^k ticks wide, so 4 x 64 slots cover 2^24 ticks. Deadlines past
+// that sit in the farthest slot and are re-placed whenever they come round.
+// Entries are intrusive doubly linked lists in a table indexed by handle,
+// so schedule and cancel are O(1) with no allocation once the table covers
+// the handles. advance() moves one tick at a time, expiring level-0 slots
+// and, as each lower wheel wraps, cascading the next one down: amortised
+// O(1) per tick and per entry. Runs of ticks over empty wheels are skipped
+// a whole lower-wheel turn at a time, and an empty wheel jumps straight to
+// now.
+class TimerWheel {
+public:
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr size_t kSlots = size_t{1} << kSlotBits;
+    static constexpr unsigned kLevels = 4;
+
+    // tick_ns = 0 disables the wheel
+    explicit TimerWheel(uint64_t tick_ns = 0, size_t handles = 0)
+        : tick_ns_(tick_ns)
+        , timers_(tick_ns ? handles : 0) {
+        for (auto& level : heads_) {
+            for (uint32_t& head : level) head = kNone;
+        }
+    }
+
+    bool enabled() const { return tick_ns_ != 0; }
+    uint64_t tick_ns() const { return tick_ns_; }
+    // Start of the last tick processed
+    uint64_t now_ns() const { return current_ * tick_ns_; }
+    size_t size() const { return size_; }
+
+    // Expire handle at deadline_ns (rounded up to a whole tick); now_ns
+    // lets an empty wheel catch up first. A deadline already passed fires on
+    // the next advance(). Replaces any earlier deadline of handle.
+    void schedule(uint32_t handle, uint64_t deadline_ns, uint64_t now_ns) {
+        if (handle >= timers_.size()) grow(handle);
+        cancel(handle);
+        if (size_ == 0 && now_ns / tick_ns_ > current_) current_ = now_ns / tick_ns_;
+        Timer& timer = timers_[handle];
+        timer.tick = deadline_ns / tick_ns_ + (deadline_ns % tick_ns_ != 0);
+        if (timer.tick <= current_) timer.tick = current_ + 1;
+        size_++;
+        place(handle);
+    }
+
+    // Drop handle's deadline, if it has one
+    void cancel(uint32_t handle) {
+        if (handle >= timers_.size()) return;
+        Timer& timer = timers_[handle];
+        if (timer.bucket == kNone) return;
+        uint32_t& head = heads_[timer.bucket / kSlots][timer.bucket % kSlots];
+        if (timer.prev != kNone) {
+            timers_[timer.prev].next = timer.next;
+        } else {
+            head = timer.next;
+        }
+        if (timer.next != kNone) timers_[timer.next].prev = timer.prev;
+        level_size_[timer.bucket / kSlots]--;
+        timer.bucket = kNone;
+        size_--;
+    }
+
+    bool scheduled(uint32_t handle) const {
+        return handle < timers_.size() && timers_[handle].bucket != kNone;
+    }
+
+    // Deadline of handle as scheduled (rounded up to its tick); 0 if none
+    uint64_t deadline_ns(uint32_t handle) const {
+        return scheduled(handle) ? timers_[handle].tick * tick_ns_ : 0;
+    }
+
+    // Move time on to now_ns and append every handle whose deadline is at
+    // or before it to expired (unscheduled, in deadline-tick order)
+    // @return handles expired
+    size_t advance(uint64_t now_ns, std::vector<uint32_t>& expired) {
+        if (!enabled()) return 0;
+        const uint64_t target = now_ns / tick_ns_;
+        const size_t before = expired.size();
+        while (current_ < target) {
+            // With the lowest wheels empty, the next event is their wrap
+            unsigned empty = 0;
+            while (empty < kLevels && level_size_[empty] == 0) empty++;
+            if (empty > 0) {
+                const uint64_t wrap = empty == kLevels ? target
+                                                       : current_ | ((uint64_t{1} << (kSlotBits * empty)) - 1);
+                if (wrap >= target) {
+                    current_ = target;
+                    break;
+                }
+                current_ = wrap;
+            }
+            ++current_;
+            for (unsigned level = 1; level < kLevels; level++) {
+                if ((current_ & ((uint64_t{1} << (kSlotBits * level)) - 1)) != 0) break;
+                cascade(level, (current_ >> (kSlotBits * level)) & (kSlots - 1));
+            }
+            expire_slot(current_ & (kSlots - 1), expired);
+        }
+        return expired.size() - before;
+    }
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Timer {
+        uint64_t tick = 0;       // Deadline, in whole ticks rounded up
+        uint32_t prev = kNone;
+        uint32_t next = kNone;
+        uint32_t bucket = kNone; // level * kSlots + slot; kNone = not scheduled
+    };
+
+    // Put a scheduled timer in the slot its tick falls in, relative to now
+    void place(uint32_t handle) {
+        Timer& timer = timers_[handle];
+        const uint64_t delta = timer.tick - current_;
+        unsigned level = 0;
+        while (level + 1 < kLevels && delta >= (uint64_t{1} << (kSlotBits * (level + 1)))) level++;
+        // Beyond the top wheel: park in its farthest slot until it comes round
+        const uint64_t horizon = uint64_t{1} << (kSlotBits * kLevels);
+        const uint64_t tick = delta < horizon ? timer.tick : current_ + horizon - 1;
+        const size_t slot = (tick >> (kSlotBits * level)) & (kSlots - 1);
+
+        uint32_t& head = heads_[level][slot];
+        level_size_[level]++;
+        timer.bucket = static_cast<uint32_t>(level * kSlots + slot);
+        timer.prev = kNone;
+        timer.next = head;
+        if (head != kNone) timers_[head].prev = handle;
+        head = handle;
+    }
+
+    // Re-place every timer of a higher-level slot now that it is current
+    void cascade(unsigned level, size_t slot) {
+        uint32_t handle = heads_[level][slot];
+        heads_[level][slot] = kNone;
+        while (handle != kNone) {
+            const uint32_t next = timers_[handle].next;
+            level_size_[level]--;
+            place(handle);
+            handle = next;
+        }
+    }
+
+    void expire_slot(size_t slot, std::vector<uint32_t>& expired) {
+        uint32_t handle = heads_[0][slot];
+        heads_[0][slot] = kNone;
+        while (handle != kNone) {
+            Timer& timer = timers_[handle];
+            const uint32_t next = timer.next;
+            level_size_[0]--;
+            if (timer.tick > current_) {
+                place(handle); // Parked past the horizon; not due yet
+            } else {
+                timer.bucket = kNone;
+                size_--;
+                expired.push_back(handle);
+            }
+            handle = next;
+        }
+    }
+
+    // Growth path: only reached past the presized handle count
+    void grow(uint32_t handle) {
+        timers_.resize(std::max<size_t>(static_cast<size_t>(handle) + 1, timers_.size() * 2));
+    }
+
+    uint64_t tick_ns_;
+    uint64_t current_ = 0; // Last tick processed
+    size_t size_ = 0;
+    size_t level_size_[kLevels] = {};
+    std::vector<Timer> timers_;
+    uint32_t heads_[kLevels][kSlots];
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "price.h"
+
+// Rolling fill totals over a time window, kept incrementally. The window is
+// kBuckets fixed-width buckets in a ring keyed by timestamp_ns / bucket
+// width; a fill lands in the newest bucket and running totals are updated
+// in place, and moving into a new bucket subtracts the buckets that fall
+// out. Reads are O(1). Notional is summed in ticks x quantity, so totals
+// never drift however many fills pass through.
+class TradeWindow {
+public:
+    static constexpr size_t kBuckets = 64;
+
+    struct Totals {
+        uint64_t volume = 0;
+        uint64_t trades = 0;
+        int64_t notional = 0; // Sum of price ticks x quantity
+    };
+
+    // window_ns = 0 disables recording
+    explicit TradeWindow(uint64_t window_ns = 0)
+        : bucket_ns_(window_ns == 0 ? 0 : (window_ns + kBuckets - 1) / kBuckets) {}
+
+    bool enabled() const { return bucket_ns_ != 0; }
+
+    // Window actually covered; window_ns rounded up to whole buckets
+    uint64_t window_ns() const { return bucket_ns_ * kBuckets; }
+
+    void record(uint64_t timestamp_ns, Ticks price, uint64_t quantity) {
+        advance(timestamp_ns);
+        Totals& bucket = buckets_[current_ % kBuckets];
+        bucket.volume += quantity;
+        bucket.trades += 1;
+        bucket.notional += price * static_cast<int64_t>(quantity);
+        totals_.volume += quantity;
+        totals_.trades += 1;
+        totals_.notional += price * static_cast<int64_t>(quantity);
+        last_price_ = price;
+    }
+
+    // Move the end of the window to now_ns, expiring older buckets. Time
+    // never moves back: an older timestamp counts in the newest bucket.
+    void advance(uint64_t now_ns) {
+        const uint64_t index = now_ns / bucket_ns_;
+        if (index <= current_) return;
+        const uint64_t expired = index - current_ < kBuckets ? index - current_ : kBuckets;
+        for (uint64_t i = 1; i <= expired; i++) {
+            Totals& bucket = buckets_[(current_ + i) % kBuckets];
+            totals_.volume -= bucket.volume;
+            totals_.trades -= bucket.trades;
+            totals_.notional -= bucket.notional;
+            bucket = Totals{};
+        }
+        current_ = index;
+    }
+
+    const Totals& totals() const { return totals_; }
+    Ticks last_price() const { return last_price_; }
+
+    // Start of the oldest bucket still counted
+    uint64_t start_ns() const {
+        return current_ >= kBuckets - 1 ? (current_ - (kBuckets - 1)) * bucket_ns_ : 0;
+    }
+
+private:
+    uint64_t bucket_ns_;
+    uint64_t current_ = 0; // Bucket index of the newest timestamp seen
+    Totals totals_;
+    Ticks last_price_ = 0;
+    Totals buckets_[kBuckets];
+};